@@ -0,0 +1,311 @@
+#include "PCulling.h"
+#include <bit>
+#include <cstring>
+
+namespace PMath
+{
+	// ------------------------------------------------------------------
+	//		Bounds Table.
+	// ------------------------------------------------------------------
+
+	// Remove every box from the table. Capacity is kept so the table can be refilled every frame without allocating.
+	void PBoundsTable::Clear()
+	{
+		Count = 0;
+
+		CenterX.clear();
+		CenterY.clear();
+		CenterZ.clear();
+		ExtentX.clear();
+		ExtentY.clear();
+		ExtentZ.clear();
+	}
+
+	// Reserve room for Count boxes.
+	void PBoundsTable::Reserve(size_t InCount)
+	{
+		size_t Padded = PRoundUp(InCount, 8);
+
+		CenterX.reserve(Padded);
+		CenterY.reserve(Padded);
+		CenterZ.reserve(Padded);
+		ExtentX.reserve(Padded);
+		ExtentY.reserve(Padded);
+		ExtentZ.reserve(Padded);
+	}
+
+	// Grow or shrink the arrays, keeping them padded to a multiple of 8 with zeroed boxes.
+	void PBoundsTable::Resize(size_t NewCount)
+	{
+		size_t Padded = PRoundUp(NewCount, 8);
+
+		CenterX.resize(Padded, 0.0f);
+		CenterY.resize(Padded, 0.0f);
+		CenterZ.resize(Padded, 0.0f);
+		ExtentX.resize(Padded, 0.0f);
+		ExtentY.resize(Padded, 0.0f);
+		ExtentZ.resize(Padded, 0.0f);
+
+		Count = NewCount;
+	}
+
+	// Add a box to the end of the table and return its index.
+	uint32_t PBoundsTable::Add(const PAABB& Box)
+	{
+		uint32_t Index = (uint32_t)Count;
+
+		Resize(Count + 1);
+		Set(Index, Box);
+
+		return Index;
+	}
+
+	// Overwrite the box at Index.
+	void PBoundsTable::Set(uint32_t Index, const PAABB& Box)
+	{
+		CenterX[Index] = Box.Center.x;
+		CenterY[Index] = Box.Center.y;
+		CenterZ[Index] = Box.Center.z;
+		ExtentX[Index] = Box.Extents.x;
+		ExtentY[Index] = Box.Extents.y;
+		ExtentZ[Index] = Box.Extents.z;
+	}
+
+	// Return the box at Index.
+	PAABB PBoundsTable::Get(uint32_t Index) const
+	{
+		return { { CenterX[Index], CenterY[Index], CenterZ[Index] }, { ExtentX[Index], ExtentY[Index], ExtentZ[Index] } };
+	}
+
+
+	// ------------------------------------------------------------------
+	//		Culling Kernels.
+	// ------------------------------------------------------------------
+
+	namespace
+	{
+		constexpr unsigned int FrustumPlaneCount = (sizeof(PFrustum) / sizeof(PPlane));
+
+		// Calls Visit(BlockStart, BlockMask) once per block of boxes. Bit n of BlockMask is set when box (BlockStart + n)
+		// is at least partially inside the frustum. Padding boxes past the end of the table may be reported and must be
+		// ignored by the caller.
+		template<typename VisitFunc>
+		void CullBlocks(const PBoundsTable& Bounds, const PFrustum& Frustum, PCullBackend Backend, VisitFunc&& Visit)
+		{
+			const size_t Count = Bounds.Size();
+
+			// Never run a kernel wider than the one this build was compiled with.
+			if (Backend > PGetCullBackend())
+			{
+				Backend = PGetCullBackend();
+			}
+
+#if defined(PMATH_AVX2)
+			if (Backend == PCullBackend::AVX2)
+			{
+				const __m256 SignMask = _mm256_set1_ps(-0.0f);
+
+				__m256 PlaneNX[FrustumPlaneCount], PlaneNY[FrustumPlaneCount], PlaneNZ[FrustumPlaneCount];
+				__m256 PlaneAX[FrustumPlaneCount], PlaneAY[FrustumPlaneCount], PlaneAZ[FrustumPlaneCount];
+				__m256 PlaneOffset[FrustumPlaneCount];
+
+				// Broadcast every plane once, including the absolute value of the normal used to project the extents.
+				for (unsigned int p = 0; p < FrustumPlaneCount; ++p)
+				{
+					PlaneNX[p] = _mm256_set1_ps(Frustum.Planes[p].Normal.x);
+					PlaneNY[p] = _mm256_set1_ps(Frustum.Planes[p].Normal.y);
+					PlaneNZ[p] = _mm256_set1_ps(Frustum.Planes[p].Normal.z);
+					PlaneAX[p] = _mm256_andnot_ps(SignMask, PlaneNX[p]);
+					PlaneAY[p] = _mm256_andnot_ps(SignMask, PlaneNY[p]);
+					PlaneAZ[p] = _mm256_andnot_ps(SignMask, PlaneNZ[p]);
+					PlaneOffset[p] = _mm256_set1_ps(Frustum.Planes[p].Offset);
+				}
+
+				for (size_t i = 0; i < Count; i += 8)
+				{
+					__m256 CX = _mm256_load_ps(Bounds.CenterX.data() + i);
+					__m256 CY = _mm256_load_ps(Bounds.CenterY.data() + i);
+					__m256 CZ = _mm256_load_ps(Bounds.CenterZ.data() + i);
+					__m256 EX = _mm256_load_ps(Bounds.ExtentX.data() + i);
+					__m256 EY = _mm256_load_ps(Bounds.ExtentY.data() + i);
+					__m256 EZ = _mm256_load_ps(Bounds.ExtentZ.data() + i);
+
+					__m256 Outside = _mm256_setzero_ps();
+
+					for (unsigned int p = 0; p < FrustumPlaneCount; ++p)
+					{
+						// Signed distance from the plane, and the box extents projected onto the plane normal.
+						__m256 Distance = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(CX, PlaneNX[p]), _mm256_mul_ps(CY, PlaneNY[p])), _mm256_mul_ps(CZ, PlaneNZ[p])), PlaneOffset[p]);
+						__m256 Radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(EX, PlaneAX[p]), _mm256_mul_ps(EY, PlaneAY[p])), _mm256_mul_ps(EZ, PlaneAZ[p]));
+
+						Outside = _mm256_or_ps(Outside, _mm256_cmp_ps(Distance, _mm256_xor_ps(Radius, SignMask), _CMP_LT_OQ));
+
+						// Every box in this block is already behind a plane.
+						if (_mm256_movemask_ps(Outside) == 0xFF)
+						{
+							break;
+						}
+					}
+
+					Visit(i, (uint32_t)(~_mm256_movemask_ps(Outside) & 0xFF));
+				}
+
+				return;
+			}
+#endif
+
+#if defined(PMATH_SSE)
+			if (Backend == PCullBackend::SSE)
+			{
+				const __m128 SignMask = _mm_set1_ps(-0.0f);
+
+				__m128 PlaneNX[FrustumPlaneCount], PlaneNY[FrustumPlaneCount], PlaneNZ[FrustumPlaneCount];
+				__m128 PlaneAX[FrustumPlaneCount], PlaneAY[FrustumPlaneCount], PlaneAZ[FrustumPlaneCount];
+				__m128 PlaneOffset[FrustumPlaneCount];
+
+				for (unsigned int p = 0; p < FrustumPlaneCount; ++p)
+				{
+					PlaneNX[p] = _mm_set1_ps(Frustum.Planes[p].Normal.x);
+					PlaneNY[p] = _mm_set1_ps(Frustum.Planes[p].Normal.y);
+					PlaneNZ[p] = _mm_set1_ps(Frustum.Planes[p].Normal.z);
+					PlaneAX[p] = _mm_andnot_ps(SignMask, PlaneNX[p]);
+					PlaneAY[p] = _mm_andnot_ps(SignMask, PlaneNY[p]);
+					PlaneAZ[p] = _mm_andnot_ps(SignMask, PlaneNZ[p]);
+					PlaneOffset[p] = _mm_set1_ps(Frustum.Planes[p].Offset);
+				}
+
+				for (size_t i = 0; i < Count; i += 4)
+				{
+					__m128 CX = _mm_load_ps(Bounds.CenterX.data() + i);
+					__m128 CY = _mm_load_ps(Bounds.CenterY.data() + i);
+					__m128 CZ = _mm_load_ps(Bounds.CenterZ.data() + i);
+					__m128 EX = _mm_load_ps(Bounds.ExtentX.data() + i);
+					__m128 EY = _mm_load_ps(Bounds.ExtentY.data() + i);
+					__m128 EZ = _mm_load_ps(Bounds.ExtentZ.data() + i);
+
+					__m128 Outside = _mm_setzero_ps();
+
+					for (unsigned int p = 0; p < FrustumPlaneCount; ++p)
+					{
+						__m128 Distance = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(CX, PlaneNX[p]), _mm_mul_ps(CY, PlaneNY[p])), _mm_mul_ps(CZ, PlaneNZ[p])), PlaneOffset[p]);
+						__m128 Radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(EX, PlaneAX[p]), _mm_mul_ps(EY, PlaneAY[p])), _mm_mul_ps(EZ, PlaneAZ[p]));
+
+						Outside = _mm_or_ps(Outside, _mm_cmplt_ps(Distance, _mm_xor_ps(Radius, SignMask)));
+
+						if (_mm_movemask_ps(Outside) == 0xF)
+						{
+							break;
+						}
+					}
+
+					Visit(i, (uint32_t)(~_mm_movemask_ps(Outside) & 0xF));
+				}
+
+				return;
+			}
+#endif
+
+			// Scalar fallback. This produces exactly the same result as calling PAABBToFrustum() on every box.
+			for (size_t i = 0; i < Count; i += 8)
+			{
+				uint32_t BlockMask = 0;
+				size_t BlockEnd = ((i + 8) < Count) ? (i + 8) : Count;
+
+				for (size_t j = i; j < BlockEnd; ++j)
+				{
+					if (PAABBToFrustum(Bounds.Get((uint32_t)j), Frustum))
+					{
+						BlockMask |= (1u << (j - i));
+					}
+				}
+
+				Visit(i, BlockMask);
+			}
+		}
+	}
+
+	// Returns the widest culling kernel this build was compiled with and the CPU can run.
+	PCullBackend PGetCullBackend()
+	{
+		switch (PGetSimdLevel())
+		{
+		case PSimdLevel::AVX2:
+			return PCullBackend::AVX2;
+		case PSimdLevel::SSE41:
+		case PSimdLevel::SSE2:
+			return PCullBackend::SSE;
+		default:
+			return PCullBackend::SCALAR;
+		}
+	}
+
+	// Returns a readable name for a culling kernel ("Scalar", "SSE", "AVX2").
+	const char* PGetCullBackendName(PCullBackend Backend)
+	{
+		switch (Backend)
+		{
+			case PCullBackend::AVX2:
+			{
+				return "AVX2";
+			}
+			case PCullBackend::SSE:
+			{
+				return "SSE";
+			}
+			default:
+			{
+				return "Scalar";
+			}
+		}
+	}
+
+	// Tests every box in the table against all 6 planes of the frustum and writes a visibility bitmask.
+	void PCullAABBsToFrustum(const PBoundsTable& Bounds, const PFrustum& Frustum, uint32_t* OutVisibleMask, PCullBackend Backend)
+	{
+		const size_t Words = Bounds.MaskWords();
+
+		if (Words == 0)
+		{
+			return;
+		}
+
+		memset(OutVisibleMask, 0, Words * sizeof(uint32_t));
+
+		CullBlocks(Bounds, Frustum, Backend, [OutVisibleMask](size_t BlockStart, uint32_t BlockMask)
+		{
+			// Blocks are 4 or 8 wide and start on a multiple of their width, so they never straddle two words.
+			OutVisibleMask[BlockStart / 32] |= (BlockMask << (BlockStart % 32));
+		});
+
+		// Clear the bits of any padding boxes in the last word.
+		const size_t Tail = (Bounds.Size() % 32);
+		if (Tail != 0)
+		{
+			OutVisibleMask[Words - 1] &= ((1u << Tail) - 1u);
+		}
+	}
+
+	// Tests every box in the table against the frustum and writes the index of each visible box to OutIndices, in order.
+	size_t PCullAABBsToFrustumIndices(const PBoundsTable& Bounds, const PFrustum& Frustum, uint32_t* OutIndices, PCullBackend Backend)
+	{
+		const size_t Count = Bounds.Size();
+		size_t NumVisible = 0;
+
+		CullBlocks(Bounds, Frustum, Backend, [OutIndices, Count, &NumVisible](size_t BlockStart, uint32_t BlockMask)
+		{
+			while (BlockMask != 0)
+			{
+				size_t Index = BlockStart + std::countr_zero(BlockMask);
+
+				if (Index < Count)
+				{
+					OutIndices[NumVisible++] = (uint32_t)Index;
+				}
+
+				BlockMask &= (BlockMask - 1);
+			}
+		});
+
+		return NumVisible;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "PMath.h"
+#include "PSimd.h"
+
+namespace PMath
+{
+	// A structure-of-arrays table of axis aligned bounding boxes. Every component is stored in its own contiguous,
+	// 32 byte aligned array so the culling kernels can load 4 (SSE) or 8 (AVX2) boxes with a single instruction.
+	// The arrays are always padded to a multiple of 8 entries, the padding is never reported as visible.
+	class PBoundsTable
+	{
+	public:
+		using float_array_t = std::vector<float, PAlignedAllocator<float, 32>>;
+
+		float_array_t CenterX;
+		float_array_t CenterY;
+		float_array_t CenterZ;
+		float_array_t ExtentX;
+		float_array_t ExtentY;
+		float_array_t ExtentZ;
+
+		// Remove every box from the table. Capacity is kept so the table can be refilled every frame without allocating.
+		void Clear();
+
+		// Reserve room for Count boxes.
+		void Reserve(size_t Count);
+
+		// Add a box to the end of the table and return its index.
+		uint32_t Add(const PAABB& Box);
+
+		// Overwrite the box at Index.
+		void Set(uint32_t Index, const PAABB& Box);
+
+		// Return the box at Index.
+		PAABB Get(uint32_t Index) const;
+
+		// Return the number of boxes in the table.
+		size_t Size() const { return Count; }
+
+		// Return the number of 32 bit words needed to hold a visibility mask for this table.
+		size_t MaskWords() const { return ((Count + 31) / 32); }
+
+	private:
+		size_t Count = 0;
+
+		void Resize(size_t NewCount);
+	};
+
+	// The kernel that PCullAABBsToFrustum will use in this build.
+	enum class PCullBackend
+	{
+		SCALAR,
+		SSE,
+		AVX2
+	};
+
+	// Returns the widest culling kernel this build was compiled with and the CPU can run.
+	PCullBackend PGetCullBackend();
+
+	// Returns a readable name for a culling kernel ("Scalar", "SSE", "AVX2").
+	const char* PGetCullBackendName(PCullBackend Backend);
+
+	// Tests every box in the table against all 6 planes of the frustum. Bit (i % 32) of OutVisibleMask[i / 32] is set when
+	// box i is at least partially inside the frustum, matching PAABBToFrustum(). OutVisibleMask must hold MaskWords() words.
+	void PCullAABBsToFrustum(const PBoundsTable& Bounds, const PFrustum& Frustum, uint32_t* OutVisibleMask, PCullBackend Backend = PGetCullBackend());
+
+	// Tests every box in the table against the frustum and writes the index of each visible box to OutIndices, in order.
+	// OutIndices must have room for Bounds.Size() entries.
+	//
+	// Returns the number of visible boxes written.
+	size_t PCullAABBsToFrustumIndices(const PBoundsTable& Bounds, const PFrustum& Frustum, uint32_t* OutIndices, PCullBackend Backend = PGetCullBackend());
+}
@@ -1,47 +1,116 @@
 #include "PMath.h"
+#include "PSimd.h"
+#include "PVectorMath.h"
+#include <cmath>
 
 namespace PMath
 {
 	// Calculates the plane of a triangle from three points.
 	PPlane PCalculatePlane(float3 a, float3 b, float3 c)
 	{
-		DirectX::XMVECTOR PlaneNormal = XMVector3Normalize(XMVector3Cross(PFloat3_Vector(b - a), PFloat3_Vector(c - b)));
-		DirectX::XMVECTOR PlaneOffset = XMVector3Dot(PlaneNormal, PFloat3_Vector(a));
+		PVector PlaneNormal = PVector3Normalize(PVector3Cross(PLoadFloat3(b - a), PLoadFloat3(c - b)));
 
 		PPlane Plane = PPlane{};
-		Plane.Normal = PVector_Float3(PlaneNormal);
-		Plane.Offset = XMVectorGetY(PlaneOffset);
+		Plane.Normal = PStoreFloat3(PlaneNormal);
+		Plane.Offset = PVector3Dot(PlaneNormal, PLoadFloat3(a));
 
 		return Plane;
 	}
 
+	// Map a point on a ScreenX by ScreenY viewport (z from 0 to 1) back into world space. InverseViewProjection undoes
+	// the view and projection matrices, the same as XMVector3Unproject() with an identity world matrix.
+	static float3 PUnproject(float x, float y, float z, int ScreenX, int ScreenY, const PMatrix& InverseViewProjection)
+	{
+		PVector Ndc = PVectorSet(((x / (ScreenX * 0.5f)) - 1.0f), (1.0f - (y / (ScreenY * 0.5f))), z, 1.0f);
+		return PStoreFloat3(PVector3TransformCoord(Ndc, InverseViewProjection));
+	}
+
 	// Calculates a frustum (6 planes) from the input view parameter.
 	PFrustum PCalculateFrustum(const view_t& View, int ScreenX, int ScreenY)
 	{
-		XMMATRIX Ident = XMMatrixIdentity();
+		PMatrix InverseViewProjection = PMatrixInverse(PMatrixMultiply(PLoadMatrix(View.ViewMatrix), PLoadMatrix(View.ProjectionMatrix)));
 
 		// Get points for each plane to use in calculate_plane function.
-		DirectX::XMVECTOR FTL = XMVector3Unproject(XMVectorSet(0, (ScreenY), 1, 1), 0, 0, ScreenX, ScreenY, 0, 1, (XMMATRIX&)View.ProjectionMatrix, (XMMATRIX&)View.ViewMatrix, Ident);
-		DirectX::XMVECTOR FTR = XMVector3Unproject(XMVectorSet((ScreenX), (ScreenY), 1, 1), 0, 0, ScreenX, ScreenY, 0, 1, (XMMATRIX&)View.ProjectionMatrix, (XMMATRIX&)View.ViewMatrix, Ident);
-		DirectX::XMVECTOR FBL = XMVector3Unproject(XMVectorSet(0, 0, 1, 1), 0, 0, ScreenX, ScreenY, 0, 1, (XMMATRIX&)View.ProjectionMatrix, (XMMATRIX&)View.ViewMatrix, Ident);
-		DirectX::XMVECTOR FBR = XMVector3Unproject(XMVectorSet((ScreenX), 0, 1, 1), 0, 0, ScreenX, ScreenY, 0, 1, (XMMATRIX&)View.ProjectionMatrix, (XMMATRIX&)View.ViewMatrix, Ident);
-		DirectX::XMVECTOR NTL = XMVector3Unproject(XMVectorSet(0, (ScreenY), 0, 1), 0, 0, ScreenX, ScreenY, 0, 1, (XMMATRIX&)View.ProjectionMatrix, (XMMATRIX&)View.ViewMatrix, Ident);
-		DirectX::XMVECTOR NTR = XMVector3Unproject(XMVectorSet((ScreenX), (ScreenY), 0, 1), 0, 0, ScreenX, ScreenY, 0, 1, (XMMATRIX&)View.ProjectionMatrix, (XMMATRIX&)View.ViewMatrix, Ident);
-		DirectX::XMVECTOR NBL = XMVector3Unproject(XMVectorSet(0, 0, 0, 1), 0, 0, ScreenX, ScreenY, 0, 1, (XMMATRIX&)View.ProjectionMatrix, (XMMATRIX&)View.ViewMatrix, Ident);
-		DirectX::XMVECTOR NBR = XMVector3Unproject(XMVectorSet((ScreenX), 0, 0, 1), 0, 0, ScreenX, ScreenY, 0, 1, (XMMATRIX&)View.ProjectionMatrix, (XMMATRIX&)View.ViewMatrix, Ident);
+		float3 FTL = PUnproject(0, (ScreenY), 1, ScreenX, ScreenY, InverseViewProjection);
+		float3 FTR = PUnproject((ScreenX), (ScreenY), 1, ScreenX, ScreenY, InverseViewProjection);
+		float3 FBL = PUnproject(0, 0, 1, ScreenX, ScreenY, InverseViewProjection);
+		float3 FBR = PUnproject((ScreenX), 0, 1, ScreenX, ScreenY, InverseViewProjection);
+		float3 NTL = PUnproject(0, (ScreenY), 0, ScreenX, ScreenY, InverseViewProjection);
+		float3 NTR = PUnproject((ScreenX), (ScreenY), 0, ScreenX, ScreenY, InverseViewProjection);
+		float3 NBL = PUnproject(0, 0, 0, ScreenX, ScreenY, InverseViewProjection);
+		float3 NBR = PUnproject((ScreenX), 0, 0, ScreenX, ScreenY, InverseViewProjection);
 
 		// Get each plane for frustum culling.
-		PPlane TopPlane = PCalculatePlane(PVector_Float3(NTL), PVector_Float3(FTL), PVector_Float3(FTR));
-		PPlane BottomPlane = PCalculatePlane(PVector_Float3(NBR), PVector_Float3(FBR), PVector_Float3(FBL));
-		PPlane FrontPlane = PCalculatePlane(PVector_Float3(NBR), PVector_Float3(NBL), PVector_Float3(NTL));
-		PPlane BackPlane = PCalculatePlane(PVector_Float3(FBL), PVector_Float3(FBR), PVector_Float3(FTR));
-		PPlane RightPlane = PCalculatePlane(PVector_Float3(FBR), PVector_Float3(NBR), PVector_Float3(NTR));
-		PPlane LeftPlane = PCalculatePlane(PVector_Float3(NBL), PVector_Float3(FBL), PVector_Float3(FTL));
+		PPlane TopPlane = PCalculatePlane(NTL, FTL, FTR);
+		PPlane BottomPlane = PCalculatePlane(NBR, FBR, FBL);
+		PPlane FrontPlane = PCalculatePlane(NBR, NBL, NTL);
+		PPlane BackPlane = PCalculatePlane(FBL, FBR, FTR);
+		PPlane RightPlane = PCalculatePlane(FBR, NBR, NTR);
+		PPlane LeftPlane = PCalculatePlane(NBL, FBL, FTL);
 
 		// Return array of all planes.
 		return { TopPlane, BottomPlane, FrontPlane, BackPlane, RightPlane, LeftPlane };
 	}
 
+	// Builds the world space ray under a pixel by unprojecting it onto the near and far planes.
+	void PScreenPointToRay(float x, float y, int ScreenX, int ScreenY, const float4x4_a& ViewProjection, float3& OutOrigin, float3& OutDirection)
+	{
+		PMatrix InverseViewProjection = PMatrixInverse(PLoadMatrix(ViewProjection));
+
+		float3 NearPoint = PUnproject(x, y, 0.0f, ScreenX, ScreenY, InverseViewProjection);
+		float3 FarPoint = PUnproject(x, y, 1.0f, ScreenX, ScreenY, InverseViewProjection);
+
+		OutOrigin = NearPoint;
+		OutDirection = (FarPoint - NearPoint);
+	}
+
+	// Extracts a world space frustum (6 planes) directly from a view-projection matrix. With row vectors a point is inside
+	// the D3D clip volume when -w <= x <= w, -w <= y <= w and 0 <= z <= w, and each of those bounds is a sum or difference
+	// of two columns of the matrix, so no unprojection or cross products are needed.
+	PFrustum PExtractFrustum(const float4x4_a& ViewProjection)
+	{
+		const float4x4_a& M = ViewProjection;
+
+		// Build a normalized plane from Sign times column Column, plus column 3 when bUseW is set.
+		auto ColumnPlane = [&M](int Column, float Sign, bool bUseW) -> PPlane
+		{
+			float a = (Sign * M[0][Column]) + (bUseW ? M[0][3] : 0.0f);
+			float b = (Sign * M[1][Column]) + (bUseW ? M[1][3] : 0.0f);
+			float c = (Sign * M[2][Column]) + (bUseW ? M[2][3] : 0.0f);
+			float d = (Sign * M[3][Column]) + (bUseW ? M[3][3] : 0.0f);
+
+			float Length = sqrtf((a * a) + (b * b) + (c * c));
+			float InvLength = (Length > 0.0f) ? (1.0f / Length) : 0.0f;
+
+			return { float3{ (a * InvLength), (b * InvLength), (c * InvLength) }, (-d * InvLength) };
+		};
+
+		PPlane TopPlane = ColumnPlane(1, -1.0f, true);
+		PPlane BottomPlane = ColumnPlane(1, 1.0f, true);
+		PPlane FrontPlane = ColumnPlane(2, 1.0f, false);
+		PPlane BackPlane = ColumnPlane(2, -1.0f, true);
+		PPlane RightPlane = ColumnPlane(0, -1.0f, true);
+		PPlane LeftPlane = ColumnPlane(0, 1.0f, true);
+
+		return { TopPlane, BottomPlane, FrontPlane, BackPlane, RightPlane, LeftPlane };
+	}
+
+	// Build a view context from a camera's world matrix and its projection matrix.
+	PViewContext PBuildViewContext(const float4x4_a& CameraWorld, const float4x4_a& Projection)
+	{
+		PMatrix View_Mat = PMatrixInverse(PLoadMatrix(CameraWorld));
+		PMatrix ViewProj_Mat = PMatrixMultiply(View_Mat, PLoadMatrix(Projection));
+
+		PViewContext Context;
+		Context.View = PStoreMatrix(View_Mat);
+		Context.Projection = Projection;
+		Context.ViewProjection = PStoreMatrix(ViewProj_Mat);
+		Context.InverseView = CameraWorld;
+		Context.Frustum = PExtractFrustum(Context.ViewProjection);
+
+		return Context;
+	}
+
 	// Calculates which side of a plane the sphere is on.
 	// Returns -1 if the sphere is completely behind the plane.
 	// Returns 1 if the sphere is completely in front of the plane.
@@ -72,7 +141,7 @@ namespace PMath
 	int PClassifyAABBToPlane(const PAABB& aabb, const PPlane& Plane)
 	{
 		float3 SphereCenter = aabb.Center;
-		float SphereRadius = ((aabb.Extents.x * abs(Plane.Normal.x)) + (aabb.Extents.y * abs(Plane.Normal.y)) + (aabb.Extents.z * abs(Plane.Normal.z)));
+		float SphereRadius = ((aabb.Extents.x * fabsf(Plane.Normal.x)) + (aabb.Extents.y * fabsf(Plane.Normal.y)) + (aabb.Extents.z * fabsf(Plane.Normal.z)));
 		float SignedDistance = (dot(SphereCenter, Plane.Normal) - Plane.Offset);
 
 		if (SignedDistance > SphereRadius)
@@ -107,12 +176,103 @@ namespace PMath
 		return true;
 	}
 
-	// Convert a Vector into a float3.
-	float3 PVector_Float3(XMVECTOR In)
+	// Fits an aabb around the positions of a list of vertices. Returns an empty box at the origin if Count is 0.
+	PAABB PComputeAABB(const Vertex* Vertices, size_t Count)
 	{
-		return { XMVectorGetX(In), XMVectorGetY(In), XMVectorGetZ(In) };
+		if (Count == 0)
+		{
+			return { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+		}
+
+		float3 Min = Vertices[0].Position;
+		float3 Max = Vertices[0].Position;
+
+		for (size_t i = 1; i < Count; ++i)
+		{
+			const float3& Position = Vertices[i].Position;
+
+			Min = { fminf(Min.x, Position.x), fminf(Min.y, Position.y), fminf(Min.z, Position.z) };
+			Max = { fmaxf(Max.x, Position.x), fmaxf(Max.y, Position.y), fmaxf(Max.z, Position.z) };
+		}
+
+		return { ((Min + Max) * 0.5f), ((Max - Min) * 0.5f) };
 	}
 
+	// Fits a sphere around the positions of a list of vertices, centered on Center.
+	PSphere PComputeBoundingSphere(const Vertex* Vertices, size_t Count, const float3& Center)
+	{
+		float RadiusSq = 0.0f;
+
+		for (size_t i = 0; i < Count; ++i)
+		{
+			float3 Delta = Vertices[i].Position - Center;
+			RadiusSq = fmaxf(RadiusSq, dot(Delta, Delta));
+		}
+
+		return { Center, sqrtf(RadiusSq) };
+	}
+
+	// Transforms an aabb by a matrix and returns the aabb that tightly encloses the result (Arvo's method).
+	// Works for any combination of rotation, scale, and translation.
+	PAABB PTransformAABB(const PAABB& aabb, const float4x4_a& Matrix)
+	{
+		// With row vectors the new center is Center * Matrix, and each new extent is the sum of the old extents
+		// projected onto that axis: Extents * |Matrix|.
+#if defined(PMATH_SSE)
+		const __m128 SignMask = _mm_set1_ps(-0.0f);
+
+		__m128 Row0 = _mm_load_ps(Matrix[0].data());
+		__m128 Row1 = _mm_load_ps(Matrix[1].data());
+		__m128 Row2 = _mm_load_ps(Matrix[2].data());
+		__m128 Row3 = _mm_load_ps(Matrix[3].data());
+
+		__m128 Center = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(aabb.Center.x), Row0), _mm_mul_ps(_mm_set1_ps(aabb.Center.y), Row1)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(aabb.Center.z), Row2), Row3));
+
+		__m128 Extents = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(aabb.Extents.x), _mm_andnot_ps(SignMask, Row0)), _mm_mul_ps(_mm_set1_ps(aabb.Extents.y), _mm_andnot_ps(SignMask, Row1))),
+			_mm_mul_ps(_mm_set1_ps(aabb.Extents.z), _mm_andnot_ps(SignMask, Row2)));
+
+		float4_a OutCenter;
+		float4_a OutExtents;
+		_mm_store_ps(OutCenter.data(), Center);
+		_mm_store_ps(OutExtents.data(), Extents);
+
+		return { OutCenter.xyz, OutExtents.xyz };
+#else
+		PAABB Result;
+
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			Result.Center[Axis] = (aabb.Center.x * Matrix[0][Axis]) + (aabb.Center.y * Matrix[1][Axis]) + (aabb.Center.z * Matrix[2][Axis]) + Matrix[3][Axis];
+			Result.Extents[Axis] = (aabb.Extents.x * fabsf(Matrix[0][Axis])) + (aabb.Extents.y * fabsf(Matrix[1][Axis])) + (aabb.Extents.z * fabsf(Matrix[2][Axis]));
+		}
+
+		return Result;
+#endif
+	}
+
+	// Transforms a sphere by a matrix. The radius is scaled by the largest axis scale so the result still encloses the shape.
+	PSphere PTransformSphere(const PSphere& Sphere, const float4x4_a& Matrix)
+	{
+		PSphere Result;
+
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			Result.Center[Axis] = (Sphere.Center.x * Matrix[0][Axis]) + (Sphere.Center.y * Matrix[1][Axis]) + (Sphere.Center.z * Matrix[2][Axis]) + Matrix[3][Axis];
+		}
+
+		float ScaleSq = 0.0f;
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			ScaleSq = fmaxf(ScaleSq, (Matrix[Axis][0] * Matrix[Axis][0]) + (Matrix[Axis][1] * Matrix[Axis][1]) + (Matrix[Axis][2] * Matrix[Axis][2]));
+		}
+
+		Result.Radius = Sphere.Radius * sqrtf(ScaleSq);
+
+		return Result;
+	}
+
+
 	/**
 	* This will return whether or not two things are nearly equal.
 	* You can change the delta to alter how much difference is allowed.
@@ -120,7 +280,7 @@ namespace PMath
 	*/
 	bool IsNearlyEqual(float Lhs, float Rhs, float Delta)
 	{
-		return (abs(Lhs - Rhs) < Delta);
+		return (fabsf(Lhs - Rhs) < Delta);
 	}
 
 	/**
@@ -133,11 +293,22 @@ namespace PMath
 		return (abs(Lhs - Rhs) < Delta);
 	}
 
+#if defined(_WIN32)
+	// Convert a Vector into a float3. One store instead of three lane extracts.
+	float3 PVector_Float3(XMVECTOR In)
+	{
+		float3 Out;
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&Out), In);
+
+		return Out;
+	}
+
 	// Convert a float3 into a vector.
 	XMVECTOR PFloat3_Vector(float3 In)
 	{
-		return { In.x, In.y, In.z, 0 };
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&In));
 	}
+#endif
 
 	// Convert a number from degrees to radians.
 	float PDegrees_Radians(float Degrees)
@@ -1,14 +1,20 @@
 #pragma once
 
-#include <DirectXMath.h>
+#if defined(_WIN32)
+	#include <DirectXMath.h>
+#endif
+
 #include <array>
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <cmath>
 
 #define PI 3.14159265359f
 
+#if defined(_WIN32)
 using namespace DirectX;
+#endif
 
 namespace PMath
 {
@@ -189,11 +195,13 @@ namespace PMath
 	*/
 	bool IsNearlyEqual(int Lhs, int Rhs, int Delta);
 
+#if defined(_WIN32)
 	// Convert a Vector into a float3.
 	float3 PVector_Float3(XMVECTOR In);
 
 	// Convert a float3 into a vector.
 	XMVECTOR PFloat3_Vector(float3 In);
+#endif
 
 	// Convert a number from degrees to radians.
 	float PDegrees_Radians(float Degrees);
@@ -246,6 +254,27 @@ namespace PMath
 	// Calculates a frustum (6 planes) from the input view parameter.
 	PFrustum PCalculateFrustum(const view_t& View, int ScreenX, int ScreenY);
 
+	// Extracts a world space frustum (6 planes) directly from a view-projection matrix. The planes are in the same order
+	// as PCalculateFrustum() and face inward.
+	PFrustum PExtractFrustum(const float4x4_a& ViewProjection);
+
+	// Builds the world space ray under pixel (x, y) of a ScreenX by ScreenY viewport. OutOrigin is on the near plane and
+	// OutDirection reaches the far plane, so the ray spans the visible depth range at distances 0 to 1.
+	void PScreenPointToRay(float x, float y, int ScreenX, int ScreenY, const float4x4_a& ViewProjection, float3& OutOrigin, float3& OutDirection);
+
+	// The matrices and frustum needed to render and cull from one camera. Built once and reused until the camera changes.
+	struct PViewContext
+	{
+		float4x4_a View;				// World space to view space.
+		float4x4_a Projection;			// View space to clip space.
+		float4x4_a ViewProjection;		// World space to clip space.
+		float4x4_a InverseView;			// View space to world space (the camera's world matrix).
+		PFrustum Frustum;				// World space frustum extracted from ViewProjection.
+	};
+
+	// Build a view context from a camera's world matrix and its projection matrix.
+	PViewContext PBuildViewContext(const float4x4_a& CameraWorld, const float4x4_a& Projection);
+
 	// Calculates which side of a plane the sphere is on.
 	// Returns -1 if the sphere is completely behind the plane.
 	// Returns 1 if the sphere is completely in front of the plane.
@@ -263,6 +292,19 @@ namespace PMath
 	// Otherwise returns true.
 	bool PAABBToFrustum(const PAABB& aabb, const PFrustum& Frustum);
 
+	// Fits an aabb around the positions of a list of vertices. Returns an empty box at the origin if Count is 0.
+	PAABB PComputeAABB(const Vertex* Vertices, size_t Count);
+
+	// Fits a sphere around the positions of a list of vertices, centered on Center.
+	PSphere PComputeBoundingSphere(const Vertex* Vertices, size_t Count, const float3& Center);
+
+	// Transforms an aabb by a matrix and returns the aabb that tightly encloses the result (Arvo's method).
+	// Works for any combination of rotation, scale, and translation.
+	PAABB PTransformAABB(const PAABB& aabb, const float4x4_a& Matrix);
+
+	// Transforms a sphere by a matrix. The radius is scaled by the largest axis scale so the result still encloses the shape.
+	PSphere PTransformSphere(const PSphere& Sphere, const float4x4_a& Matrix);
+
 	// Clamp a float Val between minimum Min and maximum Max.
 	float fclamp(float Val, float Min, float Max);
 }
\ No newline at end of file
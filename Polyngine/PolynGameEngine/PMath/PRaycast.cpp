@@ -0,0 +1,222 @@
+#include "PRaycast.h"
+#include <algorithm>
+#include <cmath>
+
+namespace PMath
+{
+	// Remove every ray from the packet. Every lane is reset so the kernels never read uninitialized floats.
+	void PRayPacket::Clear()
+	{
+		Count = 0;
+
+		for (uint32_t Lane = 0; Lane < Width; ++Lane)
+		{
+			OriginX[Lane] = OriginY[Lane] = OriginZ[Lane] = 0.0f;
+			InvDirectionX[Lane] = InvDirectionY[Lane] = InvDirectionZ[Lane] = 1.0f;
+			MaxDistance[Lane] = -1.0f;
+		}
+	}
+
+	// Add a ray to the next free lane.
+	int PRayPacket::Add(const float3& Origin, const float3& Direction, float InMaxDistance)
+	{
+		if (Count >= Width)
+		{
+			return -1;
+		}
+
+		int Lane = (int)Count++;
+
+		OriginX[Lane] = Origin.x;
+		OriginY[Lane] = Origin.y;
+		OriginZ[Lane] = Origin.z;
+		InvDirectionX[Lane] = (1.0f / Direction.x);
+		InvDirectionY[Lane] = (1.0f / Direction.y);
+		InvDirectionZ[Lane] = (1.0f / Direction.z);
+		MaxDistance[Lane] = InMaxDistance;
+
+		return Lane;
+	}
+
+	// Return a bit mask of the lanes that are still being tested.
+	uint32_t PRayPacket::ActiveMask() const
+	{
+		uint32_t Mask = 0;
+
+		for (uint32_t Lane = 0; Lane < Count; ++Lane)
+		{
+			Mask |= ((MaxDistance[Lane] >= 0.0f) ? (1u << Lane) : 0u);
+		}
+
+		return Mask;
+	}
+
+	namespace
+	{
+		// ------------------------------------------------------------------
+		//		Scalar Kernel.
+		// ------------------------------------------------------------------
+
+		uint32_t IntersectScalar(const PRayPacket& Packet, const float3& Min, const float3& Max, float* OutNear)
+		{
+			uint32_t HitMask = 0;
+
+			for (uint32_t Lane = 0; Lane < PRayPacket::Width; ++Lane)
+			{
+				float T1 = ((Min.x - Packet.OriginX[Lane]) * Packet.InvDirectionX[Lane]);
+				float T2 = ((Max.x - Packet.OriginX[Lane]) * Packet.InvDirectionX[Lane]);
+				float Near = fmaxf(0.0f, fminf(T1, T2));
+				float Far = fminf(Packet.MaxDistance[Lane], fmaxf(T1, T2));
+
+				T1 = ((Min.y - Packet.OriginY[Lane]) * Packet.InvDirectionY[Lane]);
+				T2 = ((Max.y - Packet.OriginY[Lane]) * Packet.InvDirectionY[Lane]);
+				Near = fmaxf(Near, fminf(T1, T2));
+				Far = fminf(Far, fmaxf(T1, T2));
+
+				T1 = ((Min.z - Packet.OriginZ[Lane]) * Packet.InvDirectionZ[Lane]);
+				T2 = ((Max.z - Packet.OriginZ[Lane]) * Packet.InvDirectionZ[Lane]);
+				Near = fmaxf(Near, fminf(T1, T2));
+				Far = fminf(Far, fmaxf(T1, T2));
+
+				if (Near <= Far)
+				{
+					HitMask |= (1u << Lane);
+
+					if (OutNear)
+					{
+						OutNear[Lane] = Near;
+					}
+				}
+			}
+
+			return HitMask;
+		}
+
+
+		// ------------------------------------------------------------------
+		//		SSE Kernel.
+		// ------------------------------------------------------------------
+
+#if defined(PMATH_SSE)
+		// The operand order of min/max matters: when a ray lies exactly on a slab plane with a zero direction component,
+		// 0 * infinity gives NaN, and _mm_min_ps / _mm_max_ps return their second operand in that case. Keeping the running
+		// Near / Far second ignores that axis, the same as fminf / fmaxf in the scalar kernel.
+		uint32_t IntersectSSE(const PRayPacket& Packet, const float3& Min, const float3& Max, float* OutNear)
+		{
+			const __m128 MinX = _mm_set1_ps(Min.x), MinY = _mm_set1_ps(Min.y), MinZ = _mm_set1_ps(Min.z);
+			const __m128 MaxX = _mm_set1_ps(Max.x), MaxY = _mm_set1_ps(Max.y), MaxZ = _mm_set1_ps(Max.z);
+
+			uint32_t HitMask = 0;
+
+			for (uint32_t Base = 0; Base < PRayPacket::Width; Base += 4)
+			{
+				__m128 OriginX = _mm_load_ps(Packet.OriginX + Base);
+				__m128 OriginY = _mm_load_ps(Packet.OriginY + Base);
+				__m128 OriginZ = _mm_load_ps(Packet.OriginZ + Base);
+				__m128 InvX = _mm_load_ps(Packet.InvDirectionX + Base);
+				__m128 InvY = _mm_load_ps(Packet.InvDirectionY + Base);
+				__m128 InvZ = _mm_load_ps(Packet.InvDirectionZ + Base);
+
+				__m128 T1 = _mm_mul_ps(_mm_sub_ps(MinX, OriginX), InvX);
+				__m128 T2 = _mm_mul_ps(_mm_sub_ps(MaxX, OriginX), InvX);
+				__m128 Near = _mm_max_ps(_mm_min_ps(T1, T2), _mm_setzero_ps());
+				__m128 Far = _mm_min_ps(_mm_max_ps(T1, T2), _mm_load_ps(Packet.MaxDistance + Base));
+
+				T1 = _mm_mul_ps(_mm_sub_ps(MinY, OriginY), InvY);
+				T2 = _mm_mul_ps(_mm_sub_ps(MaxY, OriginY), InvY);
+				Near = _mm_max_ps(_mm_min_ps(T1, T2), Near);
+				Far = _mm_min_ps(_mm_max_ps(T1, T2), Far);
+
+				T1 = _mm_mul_ps(_mm_sub_ps(MinZ, OriginZ), InvZ);
+				T2 = _mm_mul_ps(_mm_sub_ps(MaxZ, OriginZ), InvZ);
+				Near = _mm_max_ps(_mm_min_ps(T1, T2), Near);
+				Far = _mm_min_ps(_mm_max_ps(T1, T2), Far);
+
+				HitMask |= ((uint32_t)_mm_movemask_ps(_mm_cmple_ps(Near, Far)) << Base);
+
+				if (OutNear)
+				{
+					_mm_storeu_ps(OutNear + Base, Near);
+				}
+			}
+
+			return HitMask;
+		}
+#endif
+
+
+		// ------------------------------------------------------------------
+		//		AVX2 Kernel.
+		// ------------------------------------------------------------------
+
+#if defined(PMATH_AVX2_KERNELS)
+		PMATH_AVX2_TARGET uint32_t IntersectAVX2(const PRayPacket& Packet, const float3& Min, const float3& Max, float* OutNear)
+		{
+			__m256 OriginX = _mm256_load_ps(Packet.OriginX);
+			__m256 OriginY = _mm256_load_ps(Packet.OriginY);
+			__m256 OriginZ = _mm256_load_ps(Packet.OriginZ);
+			__m256 InvX = _mm256_load_ps(Packet.InvDirectionX);
+			__m256 InvY = _mm256_load_ps(Packet.InvDirectionY);
+			__m256 InvZ = _mm256_load_ps(Packet.InvDirectionZ);
+
+			// Kept as (Box - Origin) * Inv rather than a fused Box * Inv - Origin * Inv: with a zero direction component the fused
+			// form is infinity minus infinity, a NaN that would drop the axis from the test.
+			__m256 T1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(Min.x), OriginX), InvX);
+			__m256 T2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(Max.x), OriginX), InvX);
+			__m256 Near = _mm256_max_ps(_mm256_min_ps(T1, T2), _mm256_setzero_ps());
+			__m256 Far = _mm256_min_ps(_mm256_max_ps(T1, T2), _mm256_load_ps(Packet.MaxDistance));
+
+			T1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(Min.y), OriginY), InvY);
+			T2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(Max.y), OriginY), InvY);
+			Near = _mm256_max_ps(_mm256_min_ps(T1, T2), Near);
+			Far = _mm256_min_ps(_mm256_max_ps(T1, T2), Far);
+
+			T1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(Min.z), OriginZ), InvZ);
+			T2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(Max.z), OriginZ), InvZ);
+			Near = _mm256_max_ps(_mm256_min_ps(T1, T2), Near);
+			Far = _mm256_min_ps(_mm256_max_ps(T1, T2), Far);
+
+			if (OutNear)
+			{
+				_mm256_storeu_ps(OutNear, Near);
+			}
+
+			return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(Near, Far, _CMP_LE_OQ));
+		}
+#endif
+	}
+
+	// Returns the widest path PIntersectRayPacketAABB() will use on this machine.
+	PSimdLevel PGetRaycastSimdLevel()
+	{
+#if defined(PMATH_AVX2_KERNELS)
+		if (PGetCpuSimdLevel() == PSimdLevel::AVX2)
+		{
+			return PSimdLevel::AVX2;
+		}
+#endif
+		return PGetSimdLevel();
+	}
+
+	// Slab test every ray in the packet against one box.
+	uint32_t PIntersectRayPacketAABB(const PRayPacket& Packet, const float3& Min, const float3& Max, float* OutNear, PSimdLevel Level)
+	{
+		// The CPU level is looked up once, this runs for every node a packet visits.
+		static const PSimdLevel Supported = PGetRaycastSimdLevel();
+		Level = std::min(Level, Supported);
+
+#if defined(PMATH_AVX2_KERNELS)
+		if (Level == PSimdLevel::AVX2)
+		{
+			return IntersectAVX2(Packet, Min, Max, OutNear);
+		}
+#endif
+#if defined(PMATH_SSE)
+		if (Level >= PSimdLevel::SSE2)
+		{
+			return IntersectSSE(Packet, Min, Max, OutNear);
+		}
+#endif
+		return IntersectScalar(Packet, Min, Max, OutNear);
+	}
+}
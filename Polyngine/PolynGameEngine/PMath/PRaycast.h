@@ -0,0 +1,48 @@
+#pragma once
+
+#include "PMath.h"
+#include "PSimd.h"
+
+// Packet ray tests.
+//
+// Rays are tested in packets of up to 8, stored as a structure of arrays so one slab test covers the whole packet (two 4
+// wide halves with SSE, one 8 wide pass with AVX2). A ray is Origin + (Direction * t) for 0 <= t <= MaxDistance.
+// Direction does not need to be normalized, distances are measured in multiples of it.
+namespace PMath
+{
+	// Up to 8 rays in structure-of-arrays form. Unused lanes have a negative MaxDistance and never hit anything.
+	struct alignas(32) PRayPacket
+	{
+		static constexpr uint32_t Width = 8;
+
+		float OriginX[Width];
+		float OriginY[Width];
+		float OriginZ[Width];
+		float InvDirectionX[Width];			// 1 / Direction, so the slab test is multiplies only. Zero components become +/- infinity.
+		float InvDirectionY[Width];
+		float InvDirectionZ[Width];
+		float MaxDistance[Width];			// Lower a lane's value to clip it, set it negative to stop testing it.
+		uint32_t Count = 0;
+
+		PRayPacket() { Clear(); }
+
+		// Remove every ray from the packet.
+		void Clear();
+
+		// Add a ray to the next free lane.
+		//
+		// RETURN: The lane the ray was given, or -1 if the packet is full.
+		int Add(const float3& Origin, const float3& Direction, float InMaxDistance);
+
+		// Return a bit mask of the lanes that are still being tested (MaxDistance >= 0).
+		uint32_t ActiveMask() const;
+	};
+
+	// Returns the widest path PIntersectRayPacketAABB() will use on this machine.
+	PSimdLevel PGetRaycastSimdLevel();
+
+	// Slab test every ray in the packet against the box Min to Max. Bit i of the result is set when lane i enters the box
+	// somewhere in [0, MaxDistance[i]]. A ray that starts inside the box hits it at 0. If OutNear is given, OutNear[i] is set
+	// to the entry distance of each hit lane (other lanes are left undefined).
+	uint32_t PIntersectRayPacketAABB(const PRayPacket& Packet, const float3& Min, const float3& Max, float* OutNear = nullptr, PSimdLevel Level = PSimdLevel::AVX2);
+}
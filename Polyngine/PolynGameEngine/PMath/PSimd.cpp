@@ -0,0 +1,146 @@
+#include "PSimd.h"
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <cpuid.h>
+#endif
+
+namespace PMath
+{
+	namespace
+	{
+		// Query the CPU. AVX state also has to be enabled by the OS (OSXSAVE and XCR0), or AVX instructions will fault even
+		// on hardware that has them.
+		PSimdLevel DetectCpuSimdLevel()
+		{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+			int Info[4] = {};
+			__cpuid(Info, 0);
+			int MaxLeaf = Info[0];
+
+			__cpuid(Info, 1);
+			unsigned int Ecx1 = (unsigned int)Info[2];
+			unsigned int Edx1 = (unsigned int)Info[3];
+
+			unsigned int Ebx7 = 0;
+			if (MaxLeaf >= 7)
+			{
+				__cpuidex(Info, 7, 0);
+				Ebx7 = (unsigned int)Info[1];
+			}
+
+			bool bOSSupportsAVX = ((Ecx1 & (1u << 27)) != 0) && ((_xgetbv(0) & 0x6) == 0x6);
+#elif defined(__x86_64__) || defined(__i386__)
+			unsigned int Eax = 0;
+			unsigned int Ebx = 0;
+			unsigned int Ecx1 = 0;
+			unsigned int Edx1 = 0;
+			unsigned int MaxLeaf = __get_cpuid_max(0, nullptr);
+
+			__get_cpuid(1, &Eax, &Ebx, &Ecx1, &Edx1);
+
+			unsigned int Ebx7 = 0;
+			if (MaxLeaf >= 7)
+			{
+				unsigned int Ecx7 = 0;
+				unsigned int Edx7 = 0;
+				__get_cpuid_count(7, 0, &Eax, &Ebx7, &Ecx7, &Edx7);
+			}
+
+			bool bOSSupportsAVX = false;
+			if ((Ecx1 & (1u << 27)) != 0)
+			{
+				unsigned int Xcr0Low = 0;
+				unsigned int Xcr0High = 0;
+				__asm__("xgetbv" : "=a"(Xcr0Low), "=d"(Xcr0High) : "c"(0));
+				bOSSupportsAVX = ((Xcr0Low & 0x6) == 0x6);
+			}
+#else
+			return PSimdLevel::SCALAR;
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+			bool bAVX = bOSSupportsAVX && ((Ecx1 & (1u << 28)) != 0);
+			bool bFMA = ((Ecx1 & (1u << 12)) != 0);
+			bool bAVX2 = ((Ebx7 & (1u << 5)) != 0);
+
+			if (bAVX && bAVX2 && bFMA)
+			{
+				return PSimdLevel::AVX2;
+			}
+			if ((Ecx1 & (1u << 19)) != 0)
+			{
+				return PSimdLevel::SSE41;
+			}
+			if ((Edx1 & (1u << 26)) != 0)
+			{
+				return PSimdLevel::SSE2;
+			}
+
+			return PSimdLevel::SCALAR;
+#endif
+		}
+	}
+
+	// Returns the widest instruction set the CPU and OS support, found with CPUID the first time it is called.
+	PSimdLevel PGetCpuSimdLevel()
+	{
+		static const PSimdLevel Level = DetectCpuSimdLevel();
+		return Level;
+	}
+
+	// Returns the level kernels should run at: the compiled level, lowered to what the CPU supports.
+	PSimdLevel PGetSimdLevel()
+	{
+		PSimdLevel Cpu = PGetCpuSimdLevel();
+		return (Cpu < PGetCompiledSimdLevel()) ? Cpu : PGetCompiledSimdLevel();
+	}
+
+	// Returns the widest path the batch kernels will use on this machine.
+	PSimdLevel PGetTransformSimdLevel()
+	{
+#if defined(PMATH_AVX2_KERNELS)
+		if (PGetCpuSimdLevel() == PSimdLevel::AVX2)
+		{
+			return PSimdLevel::AVX2;
+		}
+#endif
+		return PGetSimdLevel();
+	}
+
+	// Returns the path for a kernel with scalar, SSE, and AVX2 versions: Requested, lowered to PGetTransformSimdLevel().
+	PSimdPath PSelectSimdPath(PSimdLevel Requested)
+	{
+		PSimdLevel Widest = PGetTransformSimdLevel();
+		PSimdLevel Level = (Requested < Widest) ? Requested : Widest;
+
+		if (Level == PSimdLevel::AVX2)
+		{
+			return PSimdPath::AVX2;
+		}
+#if defined(PMATH_SSE)
+		if (Level >= PSimdLevel::SSE2)
+		{
+			return PSimdPath::SSE;
+		}
+#endif
+		return PSimdPath::SCALAR;
+	}
+
+	// Returns a readable name for an instruction set level ("Scalar", "SSE2", "SSE4.1", "AVX2").
+	const char* PGetSimdLevelName(PSimdLevel Level)
+	{
+		switch (Level)
+		{
+		case PSimdLevel::AVX2:
+			return "AVX2";
+		case PSimdLevel::SSE41:
+			return "SSE4.1";
+		case PSimdLevel::SSE2:
+			return "SSE2";
+		default:
+			return "Scalar";
+		}
+	}
+}
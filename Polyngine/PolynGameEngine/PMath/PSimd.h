@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// ------------------------------------------------------------------
+//		SIMD Instruction Set Selection.
+// ------------------------------------------------------------------
+//
+// The instruction sets below are selected at compile time from the compiler flags. Define PMATH_NO_SIMD before
+// including any PMath header to force every kernel down its scalar path (useful when checking SIMD results).
+//
+//	PMATH_SSE	SSE2. Always available on x64.
+//	PMATH_SSE41	SSE4.1 (dot products, blends). MSVC only reports it through /arch:AVX and above.
+//	PMATH_AVX2	AVX2, 8 wide kernels.
+//	PMATH_FMA	Fused multiply-add. Every AVX2 CPU has it, but gcc and clang only enable it with -mfma (or -march).
+
+#if !defined(PMATH_NO_SIMD)
+	#if defined(__AVX2__)
+		#define PMATH_AVX2 1
+	#endif
+
+	#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+		#define PMATH_FMA 1
+	#endif
+
+	#if defined(__SSE4_1__) || defined(__AVX__)
+		#define PMATH_SSE41 1
+	#endif
+
+	#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+		#define PMATH_SSE 1
+	#endif
+#endif
+
+#if defined(PMATH_SSE)
+	#include <immintrin.h>
+#endif
+
+// Out of line kernels can carry an AVX2 version even when the rest of the build targets SSE2, and pick it at runtime
+// with PGetCpuSimdLevel(). MSVC accepts AVX2 intrinsics anywhere; gcc and clang need the function marked with a target.
+// Functions marked PMATH_AVX2_TARGET must only be called after checking the CPU.
+#if defined(PMATH_SSE) && (defined(_MSC_VER) || defined(__GNUC__) || defined(__clang__))
+	#define PMATH_AVX2_KERNELS 1
+
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#define PMATH_AVX2_TARGET
+	#else
+		#define PMATH_AVX2_TARGET __attribute__((target("avx2,fma")))
+	#endif
+#endif
+
+namespace PMath
+{
+	// Instruction set levels, in increasing order.
+	enum class PSimdLevel
+	{
+		SCALAR,
+		SSE2,
+		SSE41,
+		AVX2
+	};
+
+	// Returns the widest instruction set this build was compiled with.
+	constexpr PSimdLevel PGetCompiledSimdLevel()
+	{
+#if defined(PMATH_AVX2)
+		return PSimdLevel::AVX2;
+#elif defined(PMATH_SSE41)
+		return PSimdLevel::SSE41;
+#elif defined(PMATH_SSE)
+		return PSimdLevel::SSE2;
+#else
+		return PSimdLevel::SCALAR;
+#endif
+	}
+
+	// Returns the widest instruction set the CPU and OS support, found with CPUID the first time it is called. Kernels
+	// compiled above this level must not run.
+	PSimdLevel PGetCpuSimdLevel();
+
+	// Returns the level kernels should run at: the compiled level, lowered to what the CPU supports.
+	PSimdLevel PGetSimdLevel();
+
+	// Returns the widest path the batch kernels will use on this machine. Unlike PGetSimdLevel(), this is AVX2 on an AVX2
+	// CPU even when the build only targets SSE2, since out of line kernels carry their own AVX2 version.
+	PSimdLevel PGetTransformSimdLevel();
+
+	// The version of an out of line kernel a call runs. SSE covers both SSE2 and SSE4.1 builds.
+	enum class PSimdPath
+	{
+		SCALAR,
+		SSE,
+		AVX2
+	};
+
+	// Returns the path for a kernel with scalar, SSE, and AVX2 versions: Requested, lowered to PGetTransformSimdLevel().
+	PSimdPath PSelectSimdPath(PSimdLevel Requested);
+
+	// Returns a readable name for an instruction set level ("Scalar", "SSE2", "SSE4.1", "AVX2").
+	const char* PGetSimdLevelName(PSimdLevel Level);
+
+	// The number of floats processed per instruction by the widest instruction set this build was compiled with.
+#if defined(PMATH_AVX2)
+	constexpr size_t PSimdWidth = 8;
+#elif defined(PMATH_SSE)
+	constexpr size_t PSimdWidth = 4;
+#else
+	constexpr size_t PSimdWidth = 1;
+#endif
+
+	// Round a count up to the next multiple of Multiple. Multiple must be a power of two.
+	constexpr size_t PRoundUp(size_t Count, size_t Multiple)
+	{
+		return ((Count + (Multiple - 1)) & ~(Multiple - 1));
+	}
+
+	// An allocator for std::vector that aligns the storage to Alignment bytes, so SIMD kernels can use aligned loads.
+	template<typename T, size_t Alignment = 32>
+	struct PAlignedAllocator
+	{
+		using value_type = T;
+
+		template<typename U>
+		struct rebind { using other = PAlignedAllocator<U, Alignment>; };
+
+		PAlignedAllocator() = default;
+
+		template<typename U>
+		PAlignedAllocator(const PAlignedAllocator<U, Alignment>&) {}
+
+		T* allocate(size_t Count)
+		{
+			return static_cast<T*>(::operator new(Count * sizeof(T), std::align_val_t(Alignment)));
+		}
+
+		void deallocate(T* Ptr, size_t)
+		{
+			::operator delete(Ptr, std::align_val_t(Alignment));
+		}
+
+		template<typename U>
+		bool operator==(const PAlignedAllocator<U, Alignment>&) const { return true; }
+
+		template<typename U>
+		bool operator!=(const PAlignedAllocator<U, Alignment>&) const { return false; }
+	};
+}
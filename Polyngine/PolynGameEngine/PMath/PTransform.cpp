@@ -0,0 +1,520 @@
+#include "PTransform.h"
+#include "PVectorMath.h"
+#include <algorithm>
+#include <cmath>
+
+namespace PMath
+{
+	namespace
+	{
+		// The upper 3x3 of the inverse-transpose of Matrix, as rows. Its rows are the cross products of the matrix rows over
+		// the determinant. The magnitude doesn't matter since the normals are renormalized, but the sign does, so a
+		// singular matrix keeps the unscaled cross products.
+		float4x4_a NormalMatrix(const float4x4_a& Matrix)
+		{
+			float3 Row0 = Matrix[0].xyz;
+			float3 Row1 = Matrix[1].xyz;
+			float3 Row2 = Matrix[2].xyz;
+
+			float3 Cross0 = cross(Row1, Row2);
+			float3 Cross1 = cross(Row2, Row0);
+			float3 Cross2 = cross(Row0, Row1);
+
+			float Determinant = dot(Row0, Cross0);
+			float InvDet = (Determinant != 0.0f) ? (1.0f / Determinant) : 1.0f;
+
+			float4x4_a Result;
+			Result[0] = { Cross0.x * InvDet, Cross0.y * InvDet, Cross0.z * InvDet, 0.0f };
+			Result[1] = { Cross1.x * InvDet, Cross1.y * InvDet, Cross1.z * InvDet, 0.0f };
+			Result[2] = { Cross2.x * InvDet, Cross2.y * InvDet, Cross2.z * InvDet, 0.0f };
+			Result[3] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+			return Result;
+		}
+
+		// Scale a direction to unit length. Zero length directions stay zero.
+		float3 NormalizeOrZero(float3 V)
+		{
+			float LengthSq = dot(V, V);
+			return (LengthSq > 0.0f) ? (V * (1.0f / sqrtf(LengthSq))) : float3{ 0.0f, 0.0f, 0.0f };
+		}
+
+
+		// ------------------------------------------------------------------
+		//		Scalar Kernels.
+		// ------------------------------------------------------------------
+
+		float3 TransformPointScalar(const float3& P, const float4x4_a& M)
+		{
+			return { (P.x * M[0].x) + (P.y * M[1].x) + (P.z * M[2].x) + M[3].x,
+					 (P.x * M[0].y) + (P.y * M[1].y) + (P.z * M[2].y) + M[3].y,
+					 (P.x * M[0].z) + (P.y * M[1].z) + (P.z * M[2].z) + M[3].z };
+		}
+
+		float3 TransformNormalScalar(const float3& N, const float4x4_a& M)
+		{
+			return { (N.x * M[0].x) + (N.y * M[1].x) + (N.z * M[2].x),
+					 (N.x * M[0].y) + (N.y * M[1].y) + (N.z * M[2].y),
+					 (N.x * M[0].z) + (N.y * M[1].z) + (N.z * M[2].z) };
+		}
+
+		// Out = A * B, where each is 16 floats in row major order. Out may alias A or B.
+		void MultiplyScalar(const float* A, const float* B, float* Out)
+		{
+			float Result[16];
+
+			for (int Row = 0; Row < 4; ++Row)
+			{
+				for (int Col = 0; Col < 4; ++Col)
+				{
+					Result[(Row * 4) + Col] = (A[(Row * 4) + 0] * B[Col]) + (A[(Row * 4) + 1] * B[4 + Col]) + (A[(Row * 4) + 2] * B[8 + Col]) + (A[(Row * 4) + 3] * B[12 + Col]);
+				}
+			}
+
+			std::copy(Result, Result + 16, Out);
+		}
+
+
+		// ------------------------------------------------------------------
+		//		SSE Kernels.
+		// ------------------------------------------------------------------
+
+#if defined(PMATH_SSE)
+		template<bool bAligned>
+		__m128 LoadRow(const float* Source)
+		{
+			return bAligned ? _mm_load_ps(Source) : _mm_loadu_ps(Source);
+		}
+
+		template<bool bAligned>
+		void StoreRow(float* Destination, __m128 Row)
+		{
+			if (bAligned)
+			{
+				_mm_store_ps(Destination, Row);
+			}
+			else
+			{
+				_mm_storeu_ps(Destination, Row);
+			}
+		}
+
+		// Out = A * B, where each is 16 floats in row major order. Out may alias A or B.
+		template<bool bAligned>
+		void MultiplySSE(const float* A, const float* B, float* Out)
+		{
+			PMatrix MatB = { { LoadRow<bAligned>(B), LoadRow<bAligned>(B + 4), LoadRow<bAligned>(B + 8), LoadRow<bAligned>(B + 12) } };
+
+			__m128 Row0 = PVector4Transform(LoadRow<bAligned>(A), MatB);
+			__m128 Row1 = PVector4Transform(LoadRow<bAligned>(A + 4), MatB);
+			__m128 Row2 = PVector4Transform(LoadRow<bAligned>(A + 8), MatB);
+			__m128 Row3 = PVector4Transform(LoadRow<bAligned>(A + 12), MatB);
+
+			StoreRow<bAligned>(Out, Row0);
+			StoreRow<bAligned>(Out + 4, Row1);
+			StoreRow<bAligned>(Out + 8, Row2);
+			StoreRow<bAligned>(Out + 12, Row3);
+		}
+#endif
+
+
+		// ------------------------------------------------------------------
+		//		AVX2 Kernels.
+		// ------------------------------------------------------------------
+
+#if defined(PMATH_AVX2_KERNELS)
+		// Load 8 packed float3s (24 floats) and split them into x, y, and z registers.
+		PMATH_AVX2_TARGET inline void LoadPacked8(const float* Source, __m256& X, __m256& Y, __m256& Z)
+		{
+			// Each register holds the same 4 floats of two groups of 4 points: x0y0z0x1 | x4y4z4x5, and so on.
+			__m256 M03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(Source)), _mm_loadu_ps(Source + 12), 1);
+			__m256 M14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(Source + 4)), _mm_loadu_ps(Source + 16), 1);
+			__m256 M25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(Source + 8)), _mm_loadu_ps(Source + 20), 1);
+
+			__m256 XY = _mm256_shuffle_ps(M14, M25, _MM_SHUFFLE(2, 1, 3, 2));
+			__m256 YZ = _mm256_shuffle_ps(M03, M14, _MM_SHUFFLE(1, 0, 2, 1));
+
+			X = _mm256_shuffle_ps(M03, XY, _MM_SHUFFLE(2, 0, 3, 0));
+			Y = _mm256_shuffle_ps(YZ, XY, _MM_SHUFFLE(3, 1, 2, 0));
+			Z = _mm256_shuffle_ps(YZ, M25, _MM_SHUFFLE(3, 0, 3, 1));
+		}
+
+		// Interleave x, y, and z registers back into 8 packed float3s.
+		PMATH_AVX2_TARGET inline void StorePacked8(float* Destination, __m256 X, __m256 Y, __m256 Z)
+		{
+			__m256 RXY = _mm256_shuffle_ps(X, Y, _MM_SHUFFLE(2, 0, 2, 0));
+			__m256 RYZ = _mm256_shuffle_ps(Y, Z, _MM_SHUFFLE(3, 1, 3, 1));
+			__m256 RZX = _mm256_shuffle_ps(Z, X, _MM_SHUFFLE(3, 1, 2, 0));
+
+			__m256 R03 = _mm256_shuffle_ps(RXY, RZX, _MM_SHUFFLE(2, 0, 2, 0));
+			__m256 R14 = _mm256_shuffle_ps(RYZ, RXY, _MM_SHUFFLE(3, 1, 2, 0));
+			__m256 R25 = _mm256_shuffle_ps(RZX, RYZ, _MM_SHUFFLE(3, 1, 3, 1));
+
+			_mm_storeu_ps(Destination, _mm256_castps256_ps128(R03));
+			_mm_storeu_ps(Destination + 4, _mm256_castps256_ps128(R14));
+			_mm_storeu_ps(Destination + 8, _mm256_castps256_ps128(R25));
+			_mm_storeu_ps(Destination + 12, _mm256_extractf128_ps(R03, 1));
+			_mm_storeu_ps(Destination + 16, _mm256_extractf128_ps(R14, 1));
+			_mm_storeu_ps(Destination + 20, _mm256_extractf128_ps(R25, 1));
+		}
+
+		// 8 points per iteration as x, y, and z lanes. bTranslate adds the 4th row (points), otherwise it is skipped
+		// and the results are renormalized (normals).
+		template<bool bTranslate>
+		PMATH_AVX2_TARGET void TransformPackedAVX2(const float3* In, float3* Out, size_t Count, const float4x4_a& M)
+		{
+			__m256 M00 = _mm256_set1_ps(M[0].x), M01 = _mm256_set1_ps(M[0].y), M02 = _mm256_set1_ps(M[0].z);
+			__m256 M10 = _mm256_set1_ps(M[1].x), M11 = _mm256_set1_ps(M[1].y), M12 = _mm256_set1_ps(M[1].z);
+			__m256 M20 = _mm256_set1_ps(M[2].x), M21 = _mm256_set1_ps(M[2].y), M22 = _mm256_set1_ps(M[2].z);
+			__m256 M30 = _mm256_set1_ps(bTranslate ? M[3].x : 0.0f);
+			__m256 M31 = _mm256_set1_ps(bTranslate ? M[3].y : 0.0f);
+			__m256 M32 = _mm256_set1_ps(bTranslate ? M[3].z : 0.0f);
+
+			size_t i = 0;
+			for (; (i + 8) <= Count; i += 8)
+			{
+				__m256 X, Y, Z;
+				LoadPacked8(reinterpret_cast<const float*>(In + i), X, Y, Z);
+
+				__m256 OutX = _mm256_fmadd_ps(X, M00, _mm256_fmadd_ps(Y, M10, _mm256_fmadd_ps(Z, M20, M30)));
+				__m256 OutY = _mm256_fmadd_ps(X, M01, _mm256_fmadd_ps(Y, M11, _mm256_fmadd_ps(Z, M21, M31)));
+				__m256 OutZ = _mm256_fmadd_ps(X, M02, _mm256_fmadd_ps(Y, M12, _mm256_fmadd_ps(Z, M22, M32)));
+
+				if (!bTranslate)
+				{
+					__m256 LengthSq = _mm256_fmadd_ps(OutX, OutX, _mm256_fmadd_ps(OutY, OutY, _mm256_mul_ps(OutZ, OutZ)));
+					__m256 InvLength = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(_mm256_max_ps(LengthSq, _mm256_set1_ps(1e-30f))));
+
+					OutX = _mm256_mul_ps(OutX, InvLength);
+					OutY = _mm256_mul_ps(OutY, InvLength);
+					OutZ = _mm256_mul_ps(OutZ, InvLength);
+				}
+
+				StorePacked8(reinterpret_cast<float*>(Out + i), OutX, OutY, OutZ);
+			}
+
+			for (; i < Count; ++i)
+			{
+				Out[i] = bTranslate ? TransformPointScalar(In[i], M) : NormalizeOrZero(TransformNormalScalar(In[i], M));
+			}
+		}
+
+		// 2 points per iteration, one in each 128 bit half. Normals are renormalized with a per half dot product.
+		template<bool bTranslate>
+		PMATH_AVX2_TARGET void TransformAlignedAVX2(const float4_a* In, float4_a* Out, size_t Count, const float4x4_a& M)
+		{
+			__m256 Row0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(M[0].data()));
+			__m256 Row1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(M[1].data()));
+			__m256 Row2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(M[2].data()));
+			__m256 Row3 = bTranslate ? _mm256_broadcast_ps(reinterpret_cast<const __m128*>(M[3].data())) : _mm256_setzero_ps();
+
+			size_t i = 0;
+			for (; (i + 2) <= Count; i += 2)
+			{
+				__m256 P = _mm256_loadu_ps(In[i].data());
+
+				__m256 Result = _mm256_fmadd_ps(_mm256_permute_ps(P, _MM_SHUFFLE(0, 0, 0, 0)), Row0,
+								_mm256_fmadd_ps(_mm256_permute_ps(P, _MM_SHUFFLE(1, 1, 1, 1)), Row1,
+								_mm256_fmadd_ps(_mm256_permute_ps(P, _MM_SHUFFLE(2, 2, 2, 2)), Row2, Row3)));
+
+				if (!bTranslate)
+				{
+					__m256 LengthSq = _mm256_dp_ps(Result, Result, 0x7F);
+					Result = _mm256_div_ps(Result, _mm256_sqrt_ps(_mm256_max_ps(LengthSq, _mm256_set1_ps(1e-30f))));
+				}
+
+				_mm256_storeu_ps(Out[i].data(), Result);
+			}
+
+			for (; i < Count; ++i)
+			{
+				float3 Result = bTranslate ? TransformPointScalar(In[i].xyz, M) : NormalizeOrZero(TransformNormalScalar(In[i].xyz, M));
+				float W = bTranslate ? ((In[i].x * M[0].w) + (In[i].y * M[1].w) + (In[i].z * M[2].w) + M[3].w) : 0.0f;
+
+				Out[i].x = Result.x;
+				Out[i].y = Result.y;
+				Out[i].z = Result.z;
+				Out[i].w = W;
+			}
+		}
+
+		// Multiply the two rows of A held in Rows by the broadcast rows of B.
+		PMATH_AVX2_TARGET inline __m256 MultiplyRowPairAVX2(__m256 Rows, __m256 B0, __m256 B1, __m256 B2, __m256 B3)
+		{
+			__m256 Sum = _mm256_mul_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(0, 0, 0, 0)), B0);
+			Sum = _mm256_fmadd_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(1, 1, 1, 1)), B1, Sum);
+			Sum = _mm256_fmadd_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(2, 2, 2, 2)), B2, Sum);
+			return _mm256_fmadd_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(3, 3, 3, 3)), B3, Sum);
+		}
+
+		// Out[i] = A[i * AStride] * B[i * BStride], each 16 floats. A stride of 0 reuses the same matrix for every i.
+		PMATH_AVX2_TARGET void MultiplyMatricesAVX2(const float* A, size_t AStride, const float* B, size_t BStride, float* Out, size_t Count)
+		{
+			__m256 B0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(B));
+			__m256 B1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(B + 4));
+			__m256 B2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(B + 8));
+			__m256 B3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(B + 12));
+
+			for (size_t i = 0; i < Count; ++i)
+			{
+				if ((BStride != 0) && (i != 0))
+				{
+					const float* MatB = (B + (i * BStride));
+					B0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(MatB));
+					B1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(MatB + 4));
+					B2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(MatB + 8));
+					B3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(MatB + 12));
+				}
+
+				const float* MatA = (A + (i * AStride));
+				__m256 Rows01 = MultiplyRowPairAVX2(_mm256_loadu_ps(MatA), B0, B1, B2, B3);
+				__m256 Rows23 = MultiplyRowPairAVX2(_mm256_loadu_ps(MatA + 8), B0, B1, B2, B3);
+
+				_mm256_storeu_ps((Out + (i * 16)), Rows01);
+				_mm256_storeu_ps((Out + (i * 16) + 8), Rows23);
+			}
+		}
+#endif
+
+#if defined(PMATH_AVX2_KERNELS)
+		// Blend 8 floats per step. Returns how many floats were done, the caller finishes the rest.
+		PMATH_AVX2_TARGET size_t LerpAVX2(const float* A, const float* B, float* Out, size_t Count, float Alpha)
+		{
+			__m256 Weight = _mm256_set1_ps(Alpha);
+			size_t i = 0;
+
+			for (; (i + 8) <= Count; i += 8)
+			{
+				__m256 From = _mm256_loadu_ps(A + i);
+				_mm256_storeu_ps((Out + i), _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(B + i), From), Weight, From));
+			}
+
+			return i;
+		}
+#endif
+
+		// Dispatch Out[i] = A[i * AStride] * B[i * BStride] to the selected path.
+		template<bool bAligned>
+		void MultiplyMatrices(const float* A, size_t AStride, const float* B, size_t BStride, float* Out, size_t Count, PSimdLevel Level)
+		{
+			if (Count == 0)
+			{
+				return;
+			}
+
+			switch (PSelectSimdPath(Level))
+			{
+#if defined(PMATH_AVX2_KERNELS)
+			case PSimdPath::AVX2:
+				MultiplyMatricesAVX2(A, AStride, B, BStride, Out, Count);
+				return;
+#endif
+#if defined(PMATH_SSE)
+			case PSimdPath::SSE:
+				for (size_t i = 0; i < Count; ++i)
+				{
+					MultiplySSE<bAligned>((A + (i * AStride)), (B + (i * BStride)), (Out + (i * 16)));
+				}
+				return;
+#endif
+			default:
+				for (size_t i = 0; i < Count; ++i)
+				{
+					MultiplyScalar((A + (i * AStride)), (B + (i * BStride)), (Out + (i * 16)));
+				}
+				return;
+			}
+		}
+	}
+
+	// Transform Count points by an affine matrix: Out[i] = (In[i], 1) * Matrix.
+	void PTransformPoints(const float3* In, float3* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level)
+	{
+		switch (PSelectSimdPath(Level))
+		{
+#if defined(PMATH_AVX2_KERNELS)
+		case PSimdPath::AVX2:
+			TransformPackedAVX2<true>(In, Out, Count, Matrix);
+			return;
+#endif
+#if defined(PMATH_SSE)
+		case PSimdPath::SSE:
+		{
+			PMatrix M = PLoadMatrix(Matrix);
+			for (size_t i = 0; i < Count; ++i)
+			{
+				Out[i] = PStoreFloat3(PVector3Transform(PLoadFloat3(In[i]), M));
+			}
+			return;
+		}
+#endif
+		default:
+			for (size_t i = 0; i < Count; ++i)
+			{
+				Out[i] = TransformPointScalar(In[i], Matrix);
+			}
+			return;
+		}
+	}
+
+	// Transform Count points by a matrix: Out[i] = (In[i].xyz, 1) * Matrix.
+	void PTransformPointsA(const float4_a* In, float4_a* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level)
+	{
+		switch (PSelectSimdPath(Level))
+		{
+#if defined(PMATH_AVX2_KERNELS)
+		case PSimdPath::AVX2:
+			TransformAlignedAVX2<true>(In, Out, Count, Matrix);
+			return;
+#endif
+#if defined(PMATH_SSE)
+		case PSimdPath::SSE:
+		{
+			PMatrix M = PLoadMatrix(Matrix);
+			for (size_t i = 0; i < Count; ++i)
+			{
+				PStoreFloat4A(Out[i], PVector3Transform(PLoadFloat4A(In[i]), M));
+			}
+			return;
+		}
+#endif
+		default:
+			for (size_t i = 0; i < Count; ++i)
+			{
+				float3 P = In[i].xyz;
+				float3 Result = TransformPointScalar(P, Matrix);
+
+				Out[i].w = (P.x * Matrix[0].w) + (P.y * Matrix[1].w) + (P.z * Matrix[2].w) + Matrix[3].w;
+				Out[i].x = Result.x;
+				Out[i].y = Result.y;
+				Out[i].z = Result.z;
+			}
+			return;
+		}
+	}
+
+	// Transform Count normals by the inverse-transpose of Matrix and renormalize them.
+	void PTransformNormals(const float3* In, float3* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level)
+	{
+		float4x4_a NormalMat = NormalMatrix(Matrix);
+
+		switch (PSelectSimdPath(Level))
+		{
+#if defined(PMATH_AVX2_KERNELS)
+		case PSimdPath::AVX2:
+			TransformPackedAVX2<false>(In, Out, Count, NormalMat);
+			return;
+#endif
+#if defined(PMATH_SSE)
+		case PSimdPath::SSE:
+		{
+			PMatrix M = PLoadMatrix(NormalMat);
+			for (size_t i = 0; i < Count; ++i)
+			{
+				Out[i] = PStoreFloat3(PVector3Normalize(PVector3TransformNormal(PLoadFloat3(In[i]), M)));
+			}
+			return;
+		}
+#endif
+		default:
+			for (size_t i = 0; i < Count; ++i)
+			{
+				Out[i] = NormalizeOrZero(TransformNormalScalar(In[i], NormalMat));
+			}
+			return;
+		}
+	}
+
+	// Aligned version of PTransformNormals(). w is set to 0.
+	void PTransformNormalsA(const float4_a* In, float4_a* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level)
+	{
+		float4x4_a NormalMat = NormalMatrix(Matrix);
+
+		switch (PSelectSimdPath(Level))
+		{
+#if defined(PMATH_AVX2_KERNELS)
+		case PSimdPath::AVX2:
+			TransformAlignedAVX2<false>(In, Out, Count, NormalMat);
+			return;
+#endif
+#if defined(PMATH_SSE)
+		case PSimdPath::SSE:
+		{
+			PMatrix M = PLoadMatrix(NormalMat);
+			for (size_t i = 0; i < Count; ++i)
+			{
+				PStoreFloat4A(Out[i], PVector3Normalize(PVector3TransformNormal(PLoadFloat4A(In[i]), M)));
+			}
+			return;
+		}
+#endif
+		default:
+			for (size_t i = 0; i < Count; ++i)
+			{
+				float3 Result = NormalizeOrZero(TransformNormalScalar(In[i].xyz, NormalMat));
+
+				Out[i].x = Result.x;
+				Out[i].y = Result.y;
+				Out[i].z = Result.z;
+				Out[i].w = 0.0f;
+			}
+			return;
+		}
+	}
+
+	// Multiply Count matrices by one matrix: Out[i] = In[i] * Matrix.
+	void PMultiplyMatrices(const float4x4* In, float4x4* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level)
+	{
+		MultiplyMatrices<false>(reinterpret_cast<const float*>(In), 16, Matrix[0].data(), 0, reinterpret_cast<float*>(Out), Count, Level);
+	}
+
+	void PMultiplyMatricesA(const float4x4_a* In, float4x4_a* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level)
+	{
+		MultiplyMatrices<true>(reinterpret_cast<const float*>(In), 16, Matrix[0].data(), 0, reinterpret_cast<float*>(Out), Count, Level);
+	}
+
+	// Multiply two parallel arrays of matrices: Out[i] = A[i] * B[i].
+	void PMultiplyMatricesPairwise(const float4x4* A, const float4x4* B, float4x4* Out, size_t Count, PSimdLevel Level)
+	{
+		MultiplyMatrices<false>(reinterpret_cast<const float*>(A), 16, reinterpret_cast<const float*>(B), 16, reinterpret_cast<float*>(Out), Count, Level);
+	}
+
+	void PMultiplyMatricesPairwiseA(const float4x4_a* A, const float4x4_a* B, float4x4_a* Out, size_t Count, PSimdLevel Level)
+	{
+		MultiplyMatrices<true>(reinterpret_cast<const float*>(A), 16, reinterpret_cast<const float*>(B), 16, reinterpret_cast<float*>(Out), Count, Level);
+	}
+
+	// Blend two arrays of floats: Out[i] = A[i] + ((B[i] - A[i]) * Alpha).
+	void PLerpFloats(const float* A, const float* B, float* Out, size_t Count, float Alpha, PSimdLevel Level)
+	{
+		size_t i = 0;
+
+		switch (PSelectSimdPath(Level))
+		{
+#if defined(PMATH_AVX2_KERNELS)
+		case PSimdPath::AVX2:
+			i = LerpAVX2(A, B, Out, Count, Alpha);
+			break;
+#endif
+#if defined(PMATH_SSE)
+		case PSimdPath::SSE:
+		{
+			__m128 Weight = _mm_set1_ps(Alpha);
+			for (; (i + 4) <= Count; i += 4)
+			{
+				__m128 From = _mm_loadu_ps(A + i);
+				_mm_storeu_ps((Out + i), _mm_add_ps(From, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(B + i), From), Weight)));
+			}
+			break;
+		}
+#endif
+		default:
+			break;
+		}
+
+		for (; i < Count; ++i)
+		{
+			Out[i] = A[i] + ((B[i] - A[i]) * Alpha);
+		}
+	}
+}
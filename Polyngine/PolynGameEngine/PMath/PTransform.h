@@ -0,0 +1,41 @@
+#pragma once
+
+#include "PMath.h"
+#include "PSimd.h"
+
+// Batched transform kernels.
+//
+// Each kernel has a scalar, SSE, and AVX2 path. The AVX2 path is chosen at runtime when the CPU has it, even in builds
+// that only target SSE2. Level lowers the widest path a call may use (the benchmarks use it to compare paths), it is
+// never raised above what the CPU supports.
+//
+// Kernels ending in A take 16 byte aligned float4_a / float4x4_a arrays, the others take packed float3 / float4x4 arrays
+// with no alignment requirement. Out may be the same array as an input.
+namespace PMath
+{
+	// Transform Count points by an affine matrix: Out[i] = (In[i], 1) * Matrix.
+	void PTransformPoints(const float3* In, float3* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Transform Count points by a matrix: Out[i] = (In[i].xyz, 1) * Matrix. The w of each result is kept, so projective
+	// matrices can be divided out afterwards.
+	void PTransformPointsA(const float4_a* In, float4_a* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Transform Count normals by the inverse-transpose of Matrix and renormalize them, so they stay perpendicular to
+	// surfaces under non uniform scale.
+	void PTransformNormals(const float3* In, float3* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Aligned version of PTransformNormals(). w is set to 0.
+	void PTransformNormalsA(const float4_a* In, float4_a* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Multiply Count matrices by one matrix: Out[i] = In[i] * Matrix.
+	void PMultiplyMatrices(const float4x4* In, float4x4* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level = PSimdLevel::AVX2);
+	void PMultiplyMatricesA(const float4x4_a* In, float4x4_a* Out, size_t Count, const float4x4_a& Matrix, PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Multiply two parallel arrays of matrices: Out[i] = A[i] * B[i].
+	void PMultiplyMatricesPairwise(const float4x4* A, const float4x4* B, float4x4* Out, size_t Count, PSimdLevel Level = PSimdLevel::AVX2);
+	void PMultiplyMatricesPairwiseA(const float4x4_a* A, const float4x4_a* B, float4x4_a* Out, size_t Count, PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Blend two arrays of floats: Out[i] = A[i] + ((B[i] - A[i]) * Alpha). Used to interpolate every joint of two
+	// animation keyframes in one pass.
+	void PLerpFloats(const float* A, const float* B, float* Out, size_t Count, float Alpha, PSimdLevel Level = PSimdLevel::AVX2);
+}
@@ -0,0 +1,745 @@
+#pragma once
+
+#include "PMath.h"
+#include "PSimd.h"
+#include <cmath>
+
+// Portable vector, matrix, and quaternion math.
+//
+// This is the part of PMath that the simulation code (culling, transforms, animation) is written against, so it builds
+// with or without DirectXMath. Every function is inline and picks its backend at compile time from PSimd.h: SSE2, with
+// SSE4.1 dot products and AVX2/FMA matrix products where the build enables them, or plain floats with PMATH_NO_SIMD.
+//
+// The conventions match DirectXMath so results can be mixed freely with the renderer:
+//	- Row vectors. A point is transformed as P * M, and A * B applies A first.
+//	- PMatrix has the same layout as float4x4_a (and XMMATRIX), rows of 4 floats.
+//	- Quaternions are (x, y, z, w). PQuaternionMultiply(A, B) applies A first, then B.
+
+namespace PMath
+{
+	// ------------------------------------------------------------------
+	//		Types.
+	// ------------------------------------------------------------------
+
+#if defined(PMATH_SSE)
+	using PVector = __m128;
+#else
+	struct alignas(16) PVector { float f[4]; };
+#endif
+
+	// A rotation quaternion (x, y, z, w).
+	using PQuaternion = PVector;
+
+	struct alignas(16) PMatrix
+	{
+		PVector r[4];
+	};
+
+	static_assert(sizeof(PMatrix) == sizeof(float4x4_a), "PMatrix must match the float4x4_a layout.");
+
+
+	// ------------------------------------------------------------------
+	//		Vector Construction, Loads, and Stores.
+	// ------------------------------------------------------------------
+
+	inline PVector PVectorSet(float x, float y, float z, float w)
+	{
+#if defined(PMATH_SSE)
+		return _mm_setr_ps(x, y, z, w);
+#else
+		return { { x, y, z, w } };
+#endif
+	}
+
+	inline PVector PVectorReplicate(float Value)
+	{
+#if defined(PMATH_SSE)
+		return _mm_set1_ps(Value);
+#else
+		return { { Value, Value, Value, Value } };
+#endif
+	}
+
+	inline PVector PVectorZero()
+	{
+#if defined(PMATH_SSE)
+		return _mm_setzero_ps();
+#else
+		return { { 0.0f, 0.0f, 0.0f, 0.0f } };
+#endif
+	}
+
+	inline float PVectorGetX(PVector V)
+	{
+#if defined(PMATH_SSE)
+		return _mm_cvtss_f32(V);
+#else
+		return V.f[0];
+#endif
+	}
+
+	// Return component i (0 to 3) of V.
+	inline float PVectorGet(PVector V, int i)
+	{
+#if defined(PMATH_SSE)
+		alignas(16) float Lanes[4];
+		_mm_store_ps(Lanes, V);
+		return Lanes[i];
+#else
+		return V.f[i];
+#endif
+	}
+
+	// Load a float3 with w set to 0.
+	inline PVector PLoadFloat3(const float3& In)
+	{
+#if defined(PMATH_SSE)
+		__m128 XY = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(&In.x)));
+		__m128 Z = _mm_load_ss(&In.z);
+		return _mm_movelh_ps(XY, Z);
+#else
+		return { { In.x, In.y, In.z, 0.0f } };
+#endif
+	}
+
+	// Load a float3 as a point, with w set to 1.
+	inline PVector PLoadPoint3(const float3& In)
+	{
+		return PVectorSet(In.x, In.y, In.z, 1.0f);
+	}
+
+	inline PVector PLoadFloat4(const float4& In)
+	{
+#if defined(PMATH_SSE)
+		return _mm_loadu_ps(In.data());
+#else
+		return { { In.x, In.y, In.z, In.w } };
+#endif
+	}
+
+	inline PVector PLoadFloat4A(const float4_a& In)
+	{
+#if defined(PMATH_SSE)
+		return _mm_load_ps(In.data());
+#else
+		return { { In.x, In.y, In.z, In.w } };
+#endif
+	}
+
+	inline float3 PStoreFloat3(PVector V)
+	{
+		float3 Out;
+#if defined(PMATH_SSE)
+		_mm_store_sd(reinterpret_cast<double*>(&Out.x), _mm_castps_pd(V));
+		_mm_store_ss(&Out.z, _mm_movehl_ps(V, V));
+#else
+		Out = { V.f[0], V.f[1], V.f[2] };
+#endif
+		return Out;
+	}
+
+	inline float4 PStoreFloat4(PVector V)
+	{
+		float4 Out;
+#if defined(PMATH_SSE)
+		_mm_storeu_ps(Out.data(), V);
+#else
+		Out = { V.f[0], V.f[1], V.f[2], V.f[3] };
+#endif
+		return Out;
+	}
+
+	inline void PStoreFloat4A(float4_a& Out, PVector V)
+	{
+#if defined(PMATH_SSE)
+		_mm_store_ps(Out.data(), V);
+#else
+		Out.x = V.f[0];
+		Out.y = V.f[1];
+		Out.z = V.f[2];
+		Out.w = V.f[3];
+#endif
+	}
+
+
+	// ------------------------------------------------------------------
+	//		Vector Arithmetic.
+	// ------------------------------------------------------------------
+
+	inline PVector PVectorAdd(PVector A, PVector B)
+	{
+#if defined(PMATH_SSE)
+		return _mm_add_ps(A, B);
+#else
+		return { { A.f[0] + B.f[0], A.f[1] + B.f[1], A.f[2] + B.f[2], A.f[3] + B.f[3] } };
+#endif
+	}
+
+	inline PVector PVectorSubtract(PVector A, PVector B)
+	{
+#if defined(PMATH_SSE)
+		return _mm_sub_ps(A, B);
+#else
+		return { { A.f[0] - B.f[0], A.f[1] - B.f[1], A.f[2] - B.f[2], A.f[3] - B.f[3] } };
+#endif
+	}
+
+	inline PVector PVectorMultiply(PVector A, PVector B)
+	{
+#if defined(PMATH_SSE)
+		return _mm_mul_ps(A, B);
+#else
+		return { { A.f[0] * B.f[0], A.f[1] * B.f[1], A.f[2] * B.f[2], A.f[3] * B.f[3] } };
+#endif
+	}
+
+	inline PVector PVectorScale(PVector V, float Scale)
+	{
+		return PVectorMultiply(V, PVectorReplicate(Scale));
+	}
+
+	// Return (A * B) + C. Uses a fused multiply-add when the build has one.
+	inline PVector PVectorMultiplyAdd(PVector A, PVector B, PVector C)
+	{
+#if defined(PMATH_FMA)
+		return _mm_fmadd_ps(A, B, C);
+#elif defined(PMATH_SSE)
+		return _mm_add_ps(_mm_mul_ps(A, B), C);
+#else
+		return { { (A.f[0] * B.f[0]) + C.f[0], (A.f[1] * B.f[1]) + C.f[1], (A.f[2] * B.f[2]) + C.f[2], (A.f[3] * B.f[3]) + C.f[3] } };
+#endif
+	}
+
+	inline PVector PVectorNegate(PVector V)
+	{
+#if defined(PMATH_SSE)
+		return _mm_xor_ps(V, _mm_set1_ps(-0.0f));
+#else
+		return { { -V.f[0], -V.f[1], -V.f[2], -V.f[3] } };
+#endif
+	}
+
+	inline PVector PVectorAbs(PVector V)
+	{
+#if defined(PMATH_SSE)
+		return _mm_andnot_ps(_mm_set1_ps(-0.0f), V);
+#else
+		return { { fabsf(V.f[0]), fabsf(V.f[1]), fabsf(V.f[2]), fabsf(V.f[3]) } };
+#endif
+	}
+
+	inline PVector PVectorMin(PVector A, PVector B)
+	{
+#if defined(PMATH_SSE)
+		return _mm_min_ps(A, B);
+#else
+		return { { fminf(A.f[0], B.f[0]), fminf(A.f[1], B.f[1]), fminf(A.f[2], B.f[2]), fminf(A.f[3], B.f[3]) } };
+#endif
+	}
+
+	inline PVector PVectorMax(PVector A, PVector B)
+	{
+#if defined(PMATH_SSE)
+		return _mm_max_ps(A, B);
+#else
+		return { { fmaxf(A.f[0], B.f[0]), fmaxf(A.f[1], B.f[1]), fmaxf(A.f[2], B.f[2]), fmaxf(A.f[3], B.f[3]) } };
+#endif
+	}
+
+	// Linear interpolation, A + (B - A) * T.
+	inline PVector PVectorLerp(PVector A, PVector B, float T)
+	{
+		return PVectorMultiplyAdd(PVectorSubtract(B, A), PVectorReplicate(T), A);
+	}
+
+	// Dot product of the x, y, and z components.
+	inline float PVector3Dot(PVector A, PVector B)
+	{
+#if defined(PMATH_SSE41)
+		return _mm_cvtss_f32(_mm_dp_ps(A, B, 0x71));
+#elif defined(PMATH_SSE)
+		__m128 Product = _mm_mul_ps(A, B);
+		__m128 Sum = _mm_add_ss(Product, _mm_shuffle_ps(Product, Product, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(_mm_add_ss(Sum, _mm_movehl_ps(Product, Product)));
+#else
+		return (A.f[0] * B.f[0]) + (A.f[1] * B.f[1]) + (A.f[2] * B.f[2]);
+#endif
+	}
+
+	// Dot product of all four components.
+	inline float PVector4Dot(PVector A, PVector B)
+	{
+#if defined(PMATH_SSE41)
+		return _mm_cvtss_f32(_mm_dp_ps(A, B, 0xF1));
+#elif defined(PMATH_SSE)
+		__m128 Product = _mm_mul_ps(A, B);
+		__m128 Pairs = _mm_add_ps(Product, _mm_movehl_ps(Product, Product));
+		return _mm_cvtss_f32(_mm_add_ss(Pairs, _mm_shuffle_ps(Pairs, Pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+#else
+		return (A.f[0] * B.f[0]) + (A.f[1] * B.f[1]) + (A.f[2] * B.f[2]) + (A.f[3] * B.f[3]);
+#endif
+	}
+
+	// Cross product of the x, y, and z components. w is set to 0.
+	inline PVector PVector3Cross(PVector A, PVector B)
+	{
+#if defined(PMATH_SSE)
+		__m128 AYZX = _mm_shuffle_ps(A, A, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 BYZX = _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 Result = _mm_sub_ps(_mm_mul_ps(A, BYZX), _mm_mul_ps(AYZX, B));
+		return _mm_shuffle_ps(Result, Result, _MM_SHUFFLE(3, 0, 2, 1));
+#else
+		return { { (A.f[1] * B.f[2]) - (A.f[2] * B.f[1]), (A.f[2] * B.f[0]) - (A.f[0] * B.f[2]), (A.f[0] * B.f[1]) - (A.f[1] * B.f[0]), 0.0f } };
+#endif
+	}
+
+	inline float PVector3Length(PVector V)
+	{
+		return sqrtf(PVector3Dot(V, V));
+	}
+
+	// Return V scaled to unit length, or zero if V has no length.
+	inline PVector PVector3Normalize(PVector V)
+	{
+		float LengthSq = PVector3Dot(V, V);
+		return (LengthSq > 0.0f) ? PVectorScale(V, (1.0f / sqrtf(LengthSq))) : PVectorZero();
+	}
+
+	// Return V scaled to unit length over all four components, or zero if V has no length.
+	inline PVector PVector4Normalize(PVector V)
+	{
+		float LengthSq = PVector4Dot(V, V);
+		return (LengthSq > 0.0f) ? PVectorScale(V, (1.0f / sqrtf(LengthSq))) : PVectorZero();
+	}
+
+
+	// ------------------------------------------------------------------
+	//		Matrices.
+	// ------------------------------------------------------------------
+
+	inline PMatrix PLoadMatrix(const float4x4_a& In)
+	{
+		return { { PLoadFloat4A(In[0]), PLoadFloat4A(In[1]), PLoadFloat4A(In[2]), PLoadFloat4A(In[3]) } };
+	}
+
+	inline float4x4_a PStoreMatrix(const PMatrix& M)
+	{
+		float4x4_a Out;
+		PStoreFloat4A(Out[0], M.r[0]);
+		PStoreFloat4A(Out[1], M.r[1]);
+		PStoreFloat4A(Out[2], M.r[2]);
+		PStoreFloat4A(Out[3], M.r[3]);
+		return Out;
+	}
+
+	inline PMatrix PMatrixIdentity()
+	{
+		return { { PVectorSet(1.0f, 0.0f, 0.0f, 0.0f), PVectorSet(0.0f, 1.0f, 0.0f, 0.0f), PVectorSet(0.0f, 0.0f, 1.0f, 0.0f), PVectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+
+	inline PMatrix PMatrixTranslation(float x, float y, float z)
+	{
+		PMatrix M = PMatrixIdentity();
+		M.r[3] = PVectorSet(x, y, z, 1.0f);
+		return M;
+	}
+
+	inline PMatrix PMatrixScaling(float x, float y, float z)
+	{
+		return { { PVectorSet(x, 0.0f, 0.0f, 0.0f), PVectorSet(0.0f, y, 0.0f, 0.0f), PVectorSet(0.0f, 0.0f, z, 0.0f), PVectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+
+	inline PMatrix PMatrixTranspose(const PMatrix& M)
+	{
+#if defined(PMATH_SSE)
+		PMatrix Result = M;
+		_MM_TRANSPOSE4_PS(Result.r[0], Result.r[1], Result.r[2], Result.r[3]);
+		return Result;
+#else
+		PMatrix Result;
+		for (int Row = 0; Row < 4; ++Row)
+		{
+			for (int Col = 0; Col < 4; ++Col)
+			{
+				Result.r[Row].f[Col] = M.r[Col].f[Row];
+			}
+		}
+		return Result;
+#endif
+	}
+
+	// Transform a full 4 component vector, V * M.
+	inline PVector PVector4Transform(PVector V, const PMatrix& M)
+	{
+#if defined(PMATH_SSE)
+		PVector Result = _mm_mul_ps(_mm_shuffle_ps(V, V, _MM_SHUFFLE(0, 0, 0, 0)), M.r[0]);
+		Result = PVectorMultiplyAdd(_mm_shuffle_ps(V, V, _MM_SHUFFLE(1, 1, 1, 1)), M.r[1], Result);
+		Result = PVectorMultiplyAdd(_mm_shuffle_ps(V, V, _MM_SHUFFLE(2, 2, 2, 2)), M.r[2], Result);
+		return PVectorMultiplyAdd(_mm_shuffle_ps(V, V, _MM_SHUFFLE(3, 3, 3, 3)), M.r[3], Result);
+#else
+		PVector Result;
+		for (int Col = 0; Col < 4; ++Col)
+		{
+			Result.f[Col] = (V.f[0] * M.r[0].f[Col]) + (V.f[1] * M.r[1].f[Col]) + (V.f[2] * M.r[2].f[Col]) + (V.f[3] * M.r[3].f[Col]);
+		}
+		return Result;
+#endif
+	}
+
+	// Transform a point (w = 1) by an affine matrix. The w of the result is whatever the matrix produces.
+	inline PVector PVector3Transform(PVector V, const PMatrix& M)
+	{
+#if defined(PMATH_SSE)
+		PVector Result = PVectorMultiplyAdd(_mm_shuffle_ps(V, V, _MM_SHUFFLE(0, 0, 0, 0)), M.r[0], M.r[3]);
+		Result = PVectorMultiplyAdd(_mm_shuffle_ps(V, V, _MM_SHUFFLE(1, 1, 1, 1)), M.r[1], Result);
+		return PVectorMultiplyAdd(_mm_shuffle_ps(V, V, _MM_SHUFFLE(2, 2, 2, 2)), M.r[2], Result);
+#else
+		return PVector4Transform(PVectorSet(V.f[0], V.f[1], V.f[2], 1.0f), M);
+#endif
+	}
+
+	// Transform a point (w = 1) and divide the result by its w. Use this with projection matrices.
+	inline PVector PVector3TransformCoord(PVector V, const PMatrix& M)
+	{
+		PVector Result = PVector3Transform(V, M);
+		return PVectorScale(Result, (1.0f / PVectorGet(Result, 3)));
+	}
+
+	// Transform a direction (w = 0), ignoring the translation row.
+	inline PVector PVector3TransformNormal(PVector V, const PMatrix& M)
+	{
+#if defined(PMATH_SSE)
+		PVector Result = _mm_mul_ps(_mm_shuffle_ps(V, V, _MM_SHUFFLE(0, 0, 0, 0)), M.r[0]);
+		Result = PVectorMultiplyAdd(_mm_shuffle_ps(V, V, _MM_SHUFFLE(1, 1, 1, 1)), M.r[1], Result);
+		return PVectorMultiplyAdd(_mm_shuffle_ps(V, V, _MM_SHUFFLE(2, 2, 2, 2)), M.r[2], Result);
+#else
+		return PVector4Transform(PVectorSet(V.f[0], V.f[1], V.f[2], 0.0f), M);
+#endif
+	}
+
+	// Return A * B (A is applied first).
+	inline PMatrix PMatrixMultiply(const PMatrix& A, const PMatrix& B)
+	{
+#if defined(PMATH_AVX2)
+		// Two rows of A per 256 bit register. Every row of B is broadcast to both halves once.
+		__m256 B0 = _mm256_broadcast_ps(&B.r[0]);
+		__m256 B1 = _mm256_broadcast_ps(&B.r[1]);
+		__m256 B2 = _mm256_broadcast_ps(&B.r[2]);
+		__m256 B3 = _mm256_broadcast_ps(&B.r[3]);
+
+		PMatrix Result;
+		for (int Row = 0; Row < 4; Row += 2)
+		{
+			__m256 Rows = _mm256_set_m128(A.r[Row + 1], A.r[Row]);
+
+			__m256 Sum = _mm256_mul_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(0, 0, 0, 0)), B0);
+#if defined(PMATH_FMA)
+			Sum = _mm256_fmadd_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(1, 1, 1, 1)), B1, Sum);
+			Sum = _mm256_fmadd_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(2, 2, 2, 2)), B2, Sum);
+			Sum = _mm256_fmadd_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(3, 3, 3, 3)), B3, Sum);
+#else
+			Sum = _mm256_add_ps(Sum, _mm256_mul_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(1, 1, 1, 1)), B1));
+			Sum = _mm256_add_ps(Sum, _mm256_mul_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(2, 2, 2, 2)), B2));
+			Sum = _mm256_add_ps(Sum, _mm256_mul_ps(_mm256_permute_ps(Rows, _MM_SHUFFLE(3, 3, 3, 3)), B3));
+#endif
+
+			Result.r[Row] = _mm256_castps256_ps128(Sum);
+			Result.r[Row + 1] = _mm256_extractf128_ps(Sum, 1);
+		}
+
+		return Result;
+#else
+		return { { PVector4Transform(A.r[0], B), PVector4Transform(A.r[1], B), PVector4Transform(A.r[2], B), PVector4Transform(A.r[3], B) } };
+#endif
+	}
+
+	// Return the inverse of a general 4x4 matrix. OutDeterminant (optional) receives the determinant. A singular matrix
+	// returns the identity.
+	inline PMatrix PMatrixInverse(const PMatrix& M, float* OutDeterminant = nullptr)
+	{
+		float m[16];
+		for (int Row = 0; Row < 4; ++Row)
+		{
+			float4 Values = PStoreFloat4(M.r[Row]);
+			m[(Row * 4) + 0] = Values.x;
+			m[(Row * 4) + 1] = Values.y;
+			m[(Row * 4) + 2] = Values.z;
+			m[(Row * 4) + 3] = Values.w;
+		}
+
+		// 2x2 sub-determinants of the bottom two rows and top two rows.
+		float s0 = (m[0] * m[5]) - (m[4] * m[1]);
+		float s1 = (m[0] * m[6]) - (m[4] * m[2]);
+		float s2 = (m[0] * m[7]) - (m[4] * m[3]);
+		float s3 = (m[1] * m[6]) - (m[5] * m[2]);
+		float s4 = (m[1] * m[7]) - (m[5] * m[3]);
+		float s5 = (m[2] * m[7]) - (m[6] * m[3]);
+
+		float c5 = (m[10] * m[15]) - (m[14] * m[11]);
+		float c4 = (m[9] * m[15]) - (m[13] * m[11]);
+		float c3 = (m[9] * m[14]) - (m[13] * m[10]);
+		float c2 = (m[8] * m[15]) - (m[12] * m[11]);
+		float c1 = (m[8] * m[14]) - (m[12] * m[10]);
+		float c0 = (m[8] * m[13]) - (m[12] * m[9]);
+
+		float Determinant = (s0 * c5) - (s1 * c4) + (s2 * c3) + (s3 * c2) - (s4 * c1) + (s5 * c0);
+
+		if (OutDeterminant)
+		{
+			*OutDeterminant = Determinant;
+		}
+
+		if (Determinant == 0.0f)
+		{
+			return PMatrixIdentity();
+		}
+
+		float InvDet = (1.0f / Determinant);
+
+		return { {
+			PVectorSet(((m[5] * c5) - (m[6] * c4) + (m[7] * c3)) * InvDet,
+					   ((-m[1] * c5) + (m[2] * c4) - (m[3] * c3)) * InvDet,
+					   ((m[13] * s5) - (m[14] * s4) + (m[15] * s3)) * InvDet,
+					   ((-m[9] * s5) + (m[10] * s4) - (m[11] * s3)) * InvDet),
+			PVectorSet(((-m[4] * c5) + (m[6] * c2) - (m[7] * c1)) * InvDet,
+					   ((m[0] * c5) - (m[2] * c2) + (m[3] * c1)) * InvDet,
+					   ((-m[12] * s5) + (m[14] * s2) - (m[15] * s1)) * InvDet,
+					   ((m[8] * s5) - (m[10] * s2) + (m[11] * s1)) * InvDet),
+			PVectorSet(((m[4] * c4) - (m[5] * c2) + (m[7] * c0)) * InvDet,
+					   ((-m[0] * c4) + (m[1] * c2) - (m[3] * c0)) * InvDet,
+					   ((m[12] * s4) - (m[13] * s2) + (m[15] * s0)) * InvDet,
+					   ((-m[8] * s4) + (m[9] * s2) - (m[11] * s0)) * InvDet),
+			PVectorSet(((-m[4] * c3) + (m[5] * c1) - (m[6] * c0)) * InvDet,
+					   ((m[0] * c3) - (m[1] * c1) + (m[2] * c0)) * InvDet,
+					   ((-m[12] * s3) + (m[13] * s1) - (m[14] * s0)) * InvDet,
+					   ((m[8] * s3) - (m[9] * s1) + (m[10] * s0)) * InvDet)
+		} };
+	}
+
+	// Left handed perspective projection with a 0 to 1 depth range, matching XMMatrixPerspectiveFovLH().
+	inline PMatrix PMatrixPerspectiveFovLH(float FovAngleY, float AspectRatio, float NearZ, float FarZ)
+	{
+		float YScale = (1.0f / tanf(FovAngleY * 0.5f));
+		float XScale = (YScale / AspectRatio);
+		float Range = (FarZ / (FarZ - NearZ));
+
+		return { { PVectorSet(XScale, 0.0f, 0.0f, 0.0f), PVectorSet(0.0f, YScale, 0.0f, 0.0f), PVectorSet(0.0f, 0.0f, Range, 1.0f), PVectorSet(0.0f, 0.0f, (-Range * NearZ), 0.0f) } };
+	}
+
+
+	// ------------------------------------------------------------------
+	//		Quaternions.
+	// ------------------------------------------------------------------
+
+	inline PQuaternion PQuaternionIdentity()
+	{
+		return PVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline PQuaternion PQuaternionConjugate(PQuaternion Q)
+	{
+#if defined(PMATH_SSE)
+		return _mm_xor_ps(Q, _mm_setr_ps(-0.0f, -0.0f, -0.0f, 0.0f));
+#else
+		return { { -Q.f[0], -Q.f[1], -Q.f[2], Q.f[3] } };
+#endif
+	}
+
+	inline PQuaternion PQuaternionNormalize(PQuaternion Q)
+	{
+		return PVector4Normalize(Q);
+	}
+
+	// Return the rotation A followed by B (the Hamilton product B * A), matching XMQuaternionMultiply().
+	inline PQuaternion PQuaternionMultiply(PQuaternion A, PQuaternion B)
+	{
+#if defined(PMATH_SSE)
+		// Expand B * A as B.w * A plus the x, y, and z columns of the product, each a sign flipped shuffle of A.
+		__m128 Result = _mm_mul_ps(_mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 3, 3, 3)), A);
+
+		__m128 AWZYX = _mm_shuffle_ps(A, A, _MM_SHUFFLE(0, 1, 2, 3));
+		__m128 AZWXY = _mm_shuffle_ps(A, A, _MM_SHUFFLE(1, 0, 3, 2));
+		__m128 AYXWZ = _mm_shuffle_ps(A, A, _MM_SHUFFLE(2, 3, 0, 1));
+
+		Result = PVectorMultiplyAdd(_mm_shuffle_ps(B, B, _MM_SHUFFLE(0, 0, 0, 0)), _mm_xor_ps(AWZYX, _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f)), Result);
+		Result = PVectorMultiplyAdd(_mm_shuffle_ps(B, B, _MM_SHUFFLE(1, 1, 1, 1)), _mm_xor_ps(AZWXY, _mm_setr_ps(0.0f, 0.0f, -0.0f, -0.0f)), Result);
+		return PVectorMultiplyAdd(_mm_shuffle_ps(B, B, _MM_SHUFFLE(2, 2, 2, 2)), _mm_xor_ps(AYXWZ, _mm_setr_ps(-0.0f, 0.0f, 0.0f, -0.0f)), Result);
+#else
+		return { {
+			(B.f[3] * A.f[0]) + (B.f[0] * A.f[3]) + (B.f[1] * A.f[2]) - (B.f[2] * A.f[1]),
+			(B.f[3] * A.f[1]) - (B.f[0] * A.f[2]) + (B.f[1] * A.f[3]) + (B.f[2] * A.f[0]),
+			(B.f[3] * A.f[2]) + (B.f[0] * A.f[1]) - (B.f[1] * A.f[0]) + (B.f[2] * A.f[3]),
+			(B.f[3] * A.f[3]) - (B.f[0] * A.f[0]) - (B.f[1] * A.f[1]) - (B.f[2] * A.f[2])
+		} };
+#endif
+	}
+
+	// A rotation of Angle radians around a unit length Axis.
+	inline PQuaternion PQuaternionRotationAxis(PVector Axis, float Angle)
+	{
+		float HalfSin = sinf(Angle * 0.5f);
+		float HalfCos = cosf(Angle * 0.5f);
+
+		float3 A = PStoreFloat3(Axis);
+		return PVectorSet((A.x * HalfSin), (A.y * HalfSin), (A.z * HalfSin), HalfCos);
+	}
+
+	// Normalized linear interpolation along the shortest arc. Cheaper than PQuaternionSlerp() and close enough for
+	// neighbouring animation keys.
+	inline PQuaternion PQuaternionNlerp(PQuaternion A, PQuaternion B, float T)
+	{
+		if (PVector4Dot(A, B) < 0.0f)
+		{
+			B = PVectorNegate(B);
+		}
+
+		return PVector4Normalize(PVectorLerp(A, B, T));
+	}
+
+	// Spherical linear interpolation along the shortest arc.
+	inline PQuaternion PQuaternionSlerp(PQuaternion A, PQuaternion B, float T)
+	{
+		float CosOmega = PVector4Dot(A, B);
+		if (CosOmega < 0.0f)
+		{
+			B = PVectorNegate(B);
+			CosOmega = -CosOmega;
+		}
+
+		// Nearly parallel, the sine below would divide by almost zero.
+		if (CosOmega > 0.9995f)
+		{
+			return PVector4Normalize(PVectorLerp(A, B, T));
+		}
+
+		float Omega = acosf(CosOmega);
+		float InvSinOmega = (1.0f / sinf(Omega));
+		float WeightA = sinf((1.0f - T) * Omega) * InvSinOmega;
+		float WeightB = sinf(T * Omega) * InvSinOmega;
+
+		return PVectorMultiplyAdd(A, PVectorReplicate(WeightA), PVectorScale(B, WeightB));
+	}
+
+	// Rotate the x, y, and z components of V by a unit quaternion.
+	inline PVector PVector3Rotate(PVector V, PQuaternion Q)
+	{
+		// v' = v + w * t + (q x t), where t = 2 * (q x v).
+		PVector T = PVector3Cross(Q, V);
+		T = PVectorAdd(T, T);
+
+		PVector Result = PVectorMultiplyAdd(PVectorReplicate(PVectorGet(Q, 3)), T, V);
+		return PVectorAdd(Result, PVector3Cross(Q, T));
+	}
+
+	// The rotation matrix for a unit quaternion, matching XMMatrixRotationQuaternion().
+	inline PMatrix PMatrixRotationQuaternion(PQuaternion Q)
+	{
+		float4 q = PStoreFloat4(Q);
+
+		float xx = (q.x * q.x), yy = (q.y * q.y), zz = (q.z * q.z);
+		float xy = (q.x * q.y), xz = (q.x * q.z), yz = (q.y * q.z);
+		float wx = (q.w * q.x), wy = (q.w * q.y), wz = (q.w * q.z);
+
+		return { {
+			PVectorSet(1.0f - (2.0f * (yy + zz)), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f),
+			PVectorSet(2.0f * (xy - wz), 1.0f - (2.0f * (xx + zz)), 2.0f * (yz + wx), 0.0f),
+			PVectorSet(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - (2.0f * (xx + yy)), 0.0f),
+			PVectorSet(0.0f, 0.0f, 0.0f, 1.0f)
+		} };
+	}
+
+	// The unit quaternion for the rotation part of M. The upper 3x3 must be a pure rotation (no scale or shear).
+	inline PQuaternion PQuaternionRotationMatrix(const PMatrix& M)
+	{
+		float4 r0 = PStoreFloat4(M.r[0]);
+		float4 r1 = PStoreFloat4(M.r[1]);
+		float4 r2 = PStoreFloat4(M.r[2]);
+
+		float Trace = (r0.x + r1.y + r2.z);
+
+		// Pick the largest of w, x, y, z to divide by so the result stays accurate near 180 degree rotations.
+		if (Trace > 0.0f)
+		{
+			float S = (sqrtf(Trace + 1.0f) * 2.0f);
+			return PQuaternionNormalize(PVectorSet(((r1.z - r2.y) / S), ((r2.x - r0.z) / S), ((r0.y - r1.x) / S), (0.25f * S)));
+		}
+		else if ((r0.x > r1.y) && (r0.x > r2.z))
+		{
+			float S = (sqrtf(1.0f + r0.x - r1.y - r2.z) * 2.0f);
+			return PQuaternionNormalize(PVectorSet((0.25f * S), ((r0.y + r1.x) / S), ((r2.x + r0.z) / S), ((r1.z - r2.y) / S)));
+		}
+		else if (r1.y > r2.z)
+		{
+			float S = (sqrtf(1.0f + r1.y - r0.x - r2.z) * 2.0f);
+			return PQuaternionNormalize(PVectorSet(((r0.y + r1.x) / S), (0.25f * S), ((r1.z + r2.y) / S), ((r2.x - r0.z) / S)));
+		}
+		else
+		{
+			float S = (sqrtf(1.0f + r2.z - r0.x - r1.y) * 2.0f);
+			return PQuaternionNormalize(PVectorSet(((r2.x + r0.z) / S), ((r1.z + r2.y) / S), (0.25f * S), ((r0.y - r1.x) / S)));
+		}
+	}
+
+	// Build Scale * Rotation * Translation, the usual local transform of a node.
+	inline PMatrix PMatrixAffineTransformation(PVector Scale, PQuaternion Rotation, PVector Translation)
+	{
+		PMatrix M = PMatrixRotationQuaternion(Rotation);
+
+#if defined(PMATH_SSE)
+		M.r[0] = _mm_mul_ps(M.r[0], _mm_shuffle_ps(Scale, Scale, _MM_SHUFFLE(0, 0, 0, 0)));
+		M.r[1] = _mm_mul_ps(M.r[1], _mm_shuffle_ps(Scale, Scale, _MM_SHUFFLE(1, 1, 1, 1)));
+		M.r[2] = _mm_mul_ps(M.r[2], _mm_shuffle_ps(Scale, Scale, _MM_SHUFFLE(2, 2, 2, 2)));
+#else
+		for (int Row = 0; Row < 3; ++Row)
+		{
+			for (int Col = 0; Col < 3; ++Col)
+			{
+				M.r[Row].f[Col] *= Scale.f[Row];
+			}
+		}
+#endif
+
+		float3 T = PStoreFloat3(Translation);
+		M.r[3] = PVectorSet(T.x, T.y, T.z, 1.0f);
+
+		return M;
+	}
+
+	// Split an affine Scale * Rotation * Translation matrix back into its parts, matching XMMatrixDecompose(). A
+	// mirrored matrix comes back with a negative x scale. Returns false (with an identity rotation) if any axis has
+	// collapsed to zero length.
+	inline bool PMatrixDecompose(PVector* OutScale, PQuaternion* OutRotation, PVector* OutTranslation, const PMatrix& M)
+	{
+		float3 T = PStoreFloat3(M.r[3]);
+		*OutTranslation = PVectorSet(T.x, T.y, T.z, 0.0f);
+
+		float ScaleX = PVector3Length(M.r[0]);
+		float ScaleY = PVector3Length(M.r[1]);
+		float ScaleZ = PVector3Length(M.r[2]);
+
+		if ((ScaleX < 1.0e-6f) || (ScaleY < 1.0e-6f) || (ScaleZ < 1.0e-6f))
+		{
+			*OutScale = PVectorSet(ScaleX, ScaleY, ScaleZ, 0.0f);
+			*OutRotation = PQuaternionIdentity();
+			return false;
+		}
+
+		PMatrix Rotation = { {
+			PVectorScale(M.r[0], (1.0f / ScaleX)),
+			PVectorScale(M.r[1], (1.0f / ScaleY)),
+			PVectorScale(M.r[2], (1.0f / ScaleZ)),
+			PVectorSet(0.0f, 0.0f, 0.0f, 1.0f)
+		} };
+
+		// A left handed basis means the matrix mirrors, fold that into the x axis.
+		if (PVector3Dot(PVector3Cross(Rotation.r[0], Rotation.r[1]), Rotation.r[2]) < 0.0f)
+		{
+			ScaleX = -ScaleX;
+			Rotation.r[0] = PVectorNegate(Rotation.r[0]);
+		}
+
+		*OutScale = PVectorSet(ScaleX, ScaleY, ScaleZ, 0.0f);
+		*OutRotation = PQuaternionRotationMatrix(Rotation);
+		return true;
+	}
+}
@@ -1,4 +1,5 @@
 #include "PCamera.h"
+#include <cstring>
 
 PCamera::PCamera()
 {
@@ -9,14 +10,14 @@ PCamera::PCamera(std::string DebugName, float FOV, bool bAssignInput)
 {
 	DisplayName = DebugName;
 
-	DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixIdentity();
+	SetWorldMatrix((float4x4_a&)DirectX::XMMatrixIdentity());
 	LocalMatrix = DirectX::XMMatrixIdentity();
 	SetFieldOfView(FOV);
 
 	XMVECTOR EyePosition = XMVectorSet(0.0f, 15.0f, -15.0f, 1.0f);
 	XMVECTOR Focus = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
 	XMVECTOR Up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-	DefaultWorld.ViewMatrix = (PMath::float4x4_a&)XMMatrixInverse(nullptr, XMMatrixLookAtLH(EyePosition, Focus, Up));
+	SetWorldMatrix((PMath::float4x4_a&)XMMatrixInverse(nullptr, XMMatrixLookAtLH(EyePosition, Focus, Up)));
 
 	SetInputEnabled(bAssignInput, bAssignInput, bAssignInput);
 
@@ -126,6 +127,7 @@ void PCamera::EndPlay()
 void PCamera::RefreshAspectRatio(float Aspect, float NearPlane, float FarPlane)
 {
 	DefaultWorld.ProjectionMatrix = (PMath::float4x4_a&)DirectX::XMMatrixPerspectiveFovLH(PDegrees_Radians(Cam_FOV), Aspect, NearPlane, FarPlane);
+	Cam_bViewContextDirty = true;
 }
 
 void PCamera::SetFieldOfView(float FieldOfView)
@@ -183,3 +185,19 @@ float& PCamera::GetFieldOfViewRef()
 {
 	return Cam_FOV;
 }
+
+// Returns this camera's view, projection, and frustum. Only rebuilt when the transform, FOV, or aspect ratio has changed.
+const PMath::PViewContext& PCamera::GetViewContext()
+{
+	// The world matrix is written from many places (input, the inspector, level loading), so compare it against the one the
+	// context was built from instead of relying on every writer to flag the change.
+	const PMath::float4x4_a& WorldMatrix = GetWorld().ViewMatrix;
+
+	if (Cam_bViewContextDirty || (memcmp(&Cam_ViewContext.InverseView, &WorldMatrix, sizeof(PMath::float4x4_a)) != 0))
+	{
+		Cam_ViewContext = PMath::PBuildViewContext(WorldMatrix, DefaultWorld.ProjectionMatrix);
+		Cam_bViewContextDirty = false;
+	}
+
+	return Cam_ViewContext;
+}
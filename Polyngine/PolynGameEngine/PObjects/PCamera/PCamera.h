@@ -12,6 +12,10 @@ private:
 	bool Cam_bIsRendering = false;
 	bool Cam_bActiveOnStart = false;
 
+	// Cached view data for rendering and culling. Rebuilt by GetViewContext() when the camera moves or its projection changes.
+	PMath::PViewContext Cam_ViewContext;
+	bool Cam_bViewContextDirty = true;
+
 public:
 	// Default Constructor requires manual InputManager, Matrix, and BeginPlay() setup and calls.
 	PCamera();
@@ -30,5 +34,8 @@ public:
 	float GetFieldOfView();
 	float& GetFieldOfViewRef();
 	void SetActive(bool bActive);
+
+	// Returns this camera's view, projection, and frustum. Only rebuilt when the transform, FOV, or aspect ratio has changed.
+	const PMath::PViewContext& GetViewContext();
 };
 
@@ -14,7 +14,7 @@ public:
 	{ 
 		Ctrl_bIsVisible = true;
 		Ctrl_bEnableInput = false;
-		DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixIdentity();
+		SetWorldMatrix((float4x4_a&)DirectX::XMMatrixIdentity());
 		LocalMatrix = DirectX::XMMatrixIdentity();
 
 		PObject::BeginPlay();
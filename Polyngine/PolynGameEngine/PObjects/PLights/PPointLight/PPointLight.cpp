@@ -17,7 +17,7 @@ PPointLight::PPointLight(std::string DebugName, float Strength, float Rad, float
 	Ctrl_bEnableInput = false;			// Disable input.
 
 	// World and Local Matrices.
-	DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixIdentity();
+	SetWorldMatrix((float4x4_a&)DirectX::XMMatrixIdentity());
 	LocalMatrix = DirectX::XMMatrixIdentity();
 	ScaleObject(float3{ 1.0f, 1.0f, 1.0f });
 	ScaleObjectLocally(float3{ 1.0f, 1.0f, 1.0f });
@@ -1,4 +1,5 @@
 #include "PObject.h"
+#include "../../PMath/PVectorMath.h"
 
 template<typename T>
 void safe_release(T* t)
@@ -20,7 +21,7 @@ PObject::PObject(std::string DebugName, bool bVisible)
 	Ctrl_bEnableInput = false;			// Disable input.
 
 	// World and Local Matrices.
-	DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixIdentity();
+	SetWorldMatrix((float4x4_a&)DirectX::XMMatrixIdentity());
 	LocalMatrix = DirectX::XMMatrixIdentity();
 	ScaleObject(float3{ 1.0f, 1.0f, 1.0f });
 	ScaleObjectLocally(float3{ 1.0f, 1.0f, 1.0f });
@@ -39,9 +40,6 @@ void PObject::BeginPlay()
 // This is called every frame (when not in-engine).
 void PObject::Update(float DeltaTime)
 {
-	// Update the animation pipeline if need be.
-	Animator.Update(DeltaTime);
-
 	// Child's world matrix, in hierarchy, is equal to (child world = child local * parent word).
 	RefreshLocalLocation();
 }
@@ -75,7 +73,7 @@ void PObject::RefreshLocalLocation()
 	// Child's world matrix, in hierarchy, is equal to (child world = child local * parent word).
 	if (ParentObject != nullptr)
 	{
-		DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixMultiply(LocalMatrix, (DirectX::XMMATRIX&)ParentObject->DefaultWorld.ViewMatrix);
+		SetWorldMatrix((float4x4_a&)DirectX::XMMatrixMultiply(LocalMatrix, (DirectX::XMMATRIX&)ParentObject->GetWorld().ViewMatrix));
 	}
 }
 
@@ -104,12 +102,38 @@ bool PObject::GetHiddenInGame()
 }
 
 // Returns the view_t for this object, containing the World Matrix
-// and the Projection Matrix.
+// and the Projection Matrix. The World Matrix is composed from the
+// stored translation, rotation, and scale if any of them changed.
 view_t& PObject::GetWorld()
 {
+	if (Tr_bWorldDirty)
+	{
+		DefaultWorld.ViewMatrix = PStoreMatrix(PMatrixAffineTransformation(PLoadFloat3(Tr_Scale), PLoadFloat4(Tr_Rotation), PLoadFloat3(Tr_Location)));
+		Tr_bWorldDirty = false;
+	}
+
 	return DefaultWorld;
 }
 
+// Replace the world matrix. It is split into translation, rotation,
+// and scale once here so the getters never have to decompose it.
+void PObject::SetWorldMatrix(const float4x4_a& World)
+{
+	PVector Scale;
+	PQuaternion Rotation;
+	PVector Translation;
+
+	PMatrixDecompose(&Scale, &Rotation, &Translation, PLoadMatrix(World));
+
+	Tr_Scale = PStoreFloat3(Scale);
+	Tr_Rotation = PStoreFloat4(Rotation);
+	Tr_Location = PStoreFloat3(Translation);
+
+	// Keep the exact matrix rather than recomposing it, so sheared or projected matrices survive a round trip.
+	DefaultWorld.ViewMatrix = World;
+	Tr_bWorldDirty = false;
+}
+
 // Returns the Local Matrix for this object.
 DirectX::XMMATRIX& PObject::GetLocal()
 {
@@ -119,10 +143,7 @@ DirectX::XMMATRIX& PObject::GetLocal()
 // Return this object's world location.
 float3 PObject::GetLocation()
 {
-	DirectX::XMMATRIX WorldMatrix = (DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix);
-	DirectX::XMVECTOR LocationVector = WorldMatrix.r[3];
-
-	return float3({ DirectX::XMVectorGetX(LocationVector), DirectX::XMVectorGetY(LocationVector), DirectX::XMVectorGetZ(LocationVector) });
+	return Tr_Location;
 }
 
 float3 PObject::GetLocalLocation()
@@ -132,50 +153,45 @@ float3 PObject::GetLocalLocation()
 	return float3({ DirectX::XMVectorGetX(LocationVector), DirectX::XMVectorGetY(LocationVector), DirectX::XMVectorGetZ(LocationVector) });
 }
 
-// Pitch, yaw, roll.
+// The x, y, and z of the rotation quaternion (the directional light
+// uses these as its direction).
 float3 PObject::GetRotation()
 {
-	XMVECTOR Loc;
-	XMVECTOR Rot;
-	XMVECTOR Sca;
-
-	XMMatrixDecompose(&Sca, &Rot, &Loc, (XMMATRIX&)DefaultWorld.ViewMatrix);
+	return Tr_Rotation.xyz;
+}
 
-	return { Rot.m128_f32[0], Rot.m128_f32[1], Rot.m128_f32[2] };
+// Return this object's rotation as an (x, y, z, w) quaternion.
+float4 PObject::GetRotationQuaternion()
+{
+	return Tr_Rotation;
 }
 
 // Return this object's current Up Vector.
 float3 PObject::GetUpVector()
 {
-	DirectX::XMMATRIX WorldMatrix = (DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix);
-	float3 UpVector = { DirectX::XMVectorGetX(WorldMatrix.r[1]), DirectX::XMVectorGetY(WorldMatrix.r[1]), DirectX::XMVectorGetZ(WorldMatrix.r[1]) };
-
-	return UpVector;
+	return GetWorld().ViewMatrix[1].xyz;
 }
 
 // Return this object's current Right Vector.
 float3 PObject::GetRightVector()
 {
-	DirectX::XMMATRIX WorldMatrix = (DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix);
-	float3 RightVector = { DirectX::XMVectorGetX(WorldMatrix.r[0]), DirectX::XMVectorGetY(WorldMatrix.r[0]), DirectX::XMVectorGetZ(WorldMatrix.r[0]) };
-
-	return RightVector;
+	return GetWorld().ViewMatrix[0].xyz;
 }
 
 // Return this object's current Forward Vector.
 float3 PObject::GetForwardVector()
 {
-	DirectX::XMMATRIX WorldMatrix = (DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix);
-	float3 ForwardVector = { DirectX::XMVectorGetX(WorldMatrix.r[2]), DirectX::XMVectorGetY(WorldMatrix.r[2]), DirectX::XMVectorGetZ(WorldMatrix.r[2]) };
-
-	return ForwardVector;
+	return GetWorld().ViewMatrix[2].xyz;
 }
 
 // Add local movement input in the direction the actor is facing.
 void PObject::AddMovementInput(float3 Direction)
 {
-	DirectX::XMMATRIX TranslationMatrix = DirectX::XMMatrixTranslation(Direction.x, Direction.y, Direction.z);
-	DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixMultiply(TranslationMatrix, (DirectX::XMMATRIX&)DefaultWorld.ViewMatrix);
+	// Same as pre-multiplying a translation: the direction is scaled and rotated into world space.
+	PVector Offset = PVector3Rotate(PVectorMultiply(PLoadFloat3(Direction), PLoadFloat3(Tr_Scale)), PLoadFloat4(Tr_Rotation));
+
+	Tr_Location = PStoreFloat3(PVectorAdd(PLoadFloat3(Tr_Location), Offset));
+	Tr_bWorldDirty = true;
 }
 
 // Add local movement to child objects.
@@ -189,28 +205,17 @@ void PObject::AddLocalMovementInput(float3 Direction)
 // Add local rotation offset in the control direction of the object.
 void PObject::AddRotationInput(float3 Direction)
 {
-	DirectX::XMMATRIX& WorldMatrix = (DirectX::XMMATRIX&)DefaultWorld.ViewMatrix;
+	// Roll and pitch are about the object's own axes and happen before the current rotation, yaw is about the world up
+	// axis and happens after it. The location is left where it is.
+	PQuaternion Roll = PQuaternionRotationAxis(PVectorSet(0.0f, 0.0f, 1.0f, 0.0f), Direction.z);
+	PQuaternion Pitch = PQuaternionRotationAxis(PVectorSet(1.0f, 0.0f, 0.0f, 0.0f), Direction.x);
+	PQuaternion Yaw = PQuaternionRotationAxis(PVectorSet(0.0f, 1.0f, 0.0f, 0.0f), Direction.y);
 
-	float3 StartLocation = GetLocation();
+	PQuaternion Rotation = PQuaternionMultiply(PQuaternionMultiply(Roll, Pitch), PLoadFloat4(Tr_Rotation));
+	Rotation = PQuaternionNormalize(PQuaternionMultiply(Rotation, Yaw));
 
-	DirectX::XMMATRIX RotationMatrix = (DirectX::XMMatrixMultiply(WorldMatrix, DirectX::XMMatrixRotationY(Direction.y)));
-	RotationMatrix.r[3].m128_f32[0] = StartLocation.x;
-	RotationMatrix.r[3].m128_f32[1] = StartLocation.y;
-	RotationMatrix.r[3].m128_f32[2] = StartLocation.z;
-
-	RotationMatrix = (DirectX::XMMatrixMultiply(DirectX::XMMatrixRotationX(Direction.x), RotationMatrix));
-	RotationMatrix.r[3].m128_f32[0] = StartLocation.x;
-	RotationMatrix.r[3].m128_f32[1] = StartLocation.y;
-	RotationMatrix.r[3].m128_f32[2] = StartLocation.z;
-
-	RotationMatrix = (DirectX::XMMatrixMultiply(DirectX::XMMatrixRotationZ(Direction.z), RotationMatrix));
-	RotationMatrix.r[3].m128_f32[0] = StartLocation.x;
-	RotationMatrix.r[3].m128_f32[1] = StartLocation.y;
-	RotationMatrix.r[3].m128_f32[2] = StartLocation.z;
-
-	RefreshLocalLocation();
-
-	DefaultWorld.ViewMatrix = (float4x4_a&)RotationMatrix;
+	Tr_Rotation = PStoreFloat4(Rotation);
+	Tr_bWorldDirty = true;
 }
 
 // Add local rotation to child objects.
@@ -243,11 +248,10 @@ void PObject::AddLocalRotationInput(float3 Direction)
 // Set this object's location to another location.
 DirectX::XMMATRIX PObject::SetLocation(float3 Location)
 {
-	((DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix)).r[3].m128_f32[0] = Location.x;
-	((DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix)).r[3].m128_f32[1] = Location.y;
-	((DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix)).r[3].m128_f32[2] = Location.z;
+	Tr_Location = Location;
+	Tr_bWorldDirty = true;
 
-	return (DirectX::XMMATRIX&)DefaultWorld.ViewMatrix;
+	return (DirectX::XMMATRIX&)GetWorld().ViewMatrix;
 }
 
 DirectX::XMMATRIX PObject::SetLocalLocation(float3 Location)
@@ -261,26 +265,37 @@ DirectX::XMMATRIX PObject::SetLocalLocation(float3 Location)
 	return (DirectX::XMMATRIX&)LocalMatrix;
 }
 
-// Pitch, yaw, roll.
+// Pitch, yaw, roll in radians, applied in the same order as XMMatrixRotationRollPitchYaw().
 DirectX::XMMATRIX PObject::SetRotation(float3 Rotation)
 {
-	/*((DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix)).r[0].m128_f32[0] = Rotation.x;
-	((DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix)).r[1].m128_f32[1] = Rotation.y;
-	((DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix)).r[2].m128_f32[2] = Rotation.z;*/
+	PQuaternion Roll = PQuaternionRotationAxis(PVectorSet(0.0f, 0.0f, 1.0f, 0.0f), Rotation.z);
+	PQuaternion Pitch = PQuaternionRotationAxis(PVectorSet(1.0f, 0.0f, 0.0f, 0.0f), Rotation.x);
+	PQuaternion Yaw = PQuaternionRotationAxis(PVectorSet(0.0f, 1.0f, 0.0f, 0.0f), Rotation.y);
+
+	SetRotationQuaternion(PStoreFloat4(PQuaternionMultiply(PQuaternionMultiply(Roll, Pitch), Yaw)));
 
-	return (DirectX::XMMATRIX&)DefaultWorld.ViewMatrix;
+	return (DirectX::XMMATRIX&)GetWorld().ViewMatrix;
+}
+
+// Set this object's rotation to a unit quaternion.
+void PObject::SetRotationQuaternion(float4 Rotation)
+{
+	Tr_Rotation = Rotation;
+	Tr_bWorldDirty = true;
 }
 
+// Scale the object in world space, which also scales its distance from the origin.
 void PObject::ScaleObject(float3 Scale)
 {
-	DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixMultiply((DirectX::XMMATRIX&)DefaultWorld.ViewMatrix, DirectX::XMMatrixScaling(Scale.x, Scale.y, Scale.z));
+	Tr_Scale *= Scale;
+	Tr_Location *= Scale;
+	Tr_bWorldDirty = true;
 }
 
 void PObject::SetScale(float3 Scale)
 {
-	((DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix)).r[0].m128_f32[0] = Scale.x;
-	((DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix)).r[1].m128_f32[1] = Scale.y;
-	((DirectX::XMMATRIX&)(DefaultWorld.ViewMatrix)).r[2].m128_f32[2] = Scale.z;
+	Tr_Scale = Scale;
+	Tr_bWorldDirty = true;
 }
 
 void PObject::ScaleObjectLocally(float3 Scale)
@@ -291,7 +306,7 @@ void PObject::ScaleObjectLocally(float3 Scale)
 
 float3 PObject::GetScale()
 {
-	return float3{ DefaultWorld.ViewMatrix[0].x, DefaultWorld.ViewMatrix[1].y, DefaultWorld.ViewMatrix[2].z };
+	return Tr_Scale;
 }
 
 float3 PObject::GetLocalScale()
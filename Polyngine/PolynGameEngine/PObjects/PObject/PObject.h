@@ -15,7 +15,8 @@ public:
 	// Debug information only for development. Not to be relayed to the user.
 	std::string DisplayName;
 
-	// Object space handling.
+	// Object space handling. The world matrix in DefaultWorld is a cache composed from the translation, rotation, and
+	// scale below, so read it through GetWorld() and replace it with SetWorldMatrix().
 	view_t DefaultWorld;					// World and Projection matrices.
 	DirectX::XMMATRIX LocalMatrix;			// Local Offset matrix.
 	bool bShowInHierarchy = true;
@@ -67,7 +68,8 @@ public:
 	float3 GetLocalScale();				// Return the current scale in relation to the parent object.
 	float3 GetLocation();				// Return the current location of the object.
 	float3 GetLocalLocation();			// Return the current local location of the object.
-	float3 GetRotation();				// Return the current rotation of this object.
+	float3 GetRotation();				// Return the x, y, and z of the rotation quaternion for this object.
+	float4 GetRotationQuaternion();		// Return the current rotation of this object as a quaternion.
 	view_t& GetWorld();					// Return the current World information (view_t).
 	DirectX::XMMATRIX& GetLocal();		// Return the current Local information (XMMATRIX).
 	float3 GetUpVector();				// Return the current up vector.
@@ -82,7 +84,9 @@ public:
 	void ScaleObjectLocally(float3 Scale);				// Scale the local matrix for the object.
 	DirectX::XMMATRIX SetLocation(float3 Location);		// Set the location of this object.
 	DirectX::XMMATRIX SetLocalLocation(float3 Location);		// Set the location of this object.
-	DirectX::XMMATRIX SetRotation(float3 Rotation);		// Set the rotation of this object.
+	DirectX::XMMATRIX SetRotation(float3 Rotation);		// Set the rotation of this object from pitch, yaw, and roll in radians.
+	void SetRotationQuaternion(float4 Rotation);		// Set the rotation of this object from a quaternion.
+	void SetWorldMatrix(const float4x4_a& World);		// Replace the world matrix, splitting it into translation, rotation, and scale.
 	void SetVisibility(bool bVisible = true);			// Set the visibility of this object.
 	void SetHiddenInGame(bool bVisible = true);			// Set the visibility of this in-game.
 	void SetInputEnabled(bool bEnable = true);			// Set whether input is accepted or not.
@@ -99,5 +103,13 @@ public:
 	//
 	void AttachToObject(PObject* Obj);					// Attach this object to another object.
 	void PossessController(PController* InController, bool bActivate = false);	// Assign a controller to this object. Activate to true if you want the object to have input be enabled as well.
+
+private:
+	// The authoritative world transform. DefaultWorld.ViewMatrix is rebuilt from these on the next GetWorld() after any
+	// of them change.
+	float3 Tr_Location = { 0.0f, 0.0f, 0.0f };
+	float4 Tr_Rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+	float3 Tr_Scale = { 1.0f, 1.0f, 1.0f };
+	bool Tr_bWorldDirty = true;
 };
 
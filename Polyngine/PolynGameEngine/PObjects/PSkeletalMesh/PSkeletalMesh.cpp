@@ -1,6 +1,7 @@
 #include "PSkeletalMesh.h"
 #include "../../PSystem/DDSTextureLoader/DDSTextureLoader.h"
 #include <fstream>
+#include <cstring>
 
 template<typename T>
 void safe_release(T* t)
@@ -22,7 +23,7 @@ PSkeletalMesh::PSkeletalMesh(std::string DebugName, std::vector<Vertex> Verts, s
 	DDSFile = DDSFilePath;
 	
 	// World and Local Matrices.
-	DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixIdentity();
+	SetWorldMatrix((float4x4_a&)DirectX::XMMatrixIdentity());
 	LocalMatrix = DirectX::XMMatrixIdentity();
 
 	if (Parent)
@@ -42,6 +43,8 @@ PSkeletalMesh::PSkeletalMesh(std::string DebugName, std::vector<Vertex> Verts, s
 	// Load the primitive.
 	Indices = Ind;
 	Vertices = Verts;
+	FitBoundsToVertices();
+	PSkinning::ComputeJointSpheres(Vertices.data(), Vertices.size(), JointSpheres);
 
 	D3D11_BUFFER_DESC BufferDesc;
 	D3D11_SUBRESOURCE_DATA SubData;
@@ -75,7 +78,7 @@ PSkeletalMesh::PSkeletalMesh(std::string DebugName, std::string MeshFilePath, st
 	Ctrl_bIsVisible = bVisible;			// Set the initial visibility.
 
 	// World and Local Matrices.
-	DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixIdentity();
+	SetWorldMatrix((float4x4_a&)DirectX::XMMatrixIdentity());
 	LocalMatrix = DirectX::XMMatrixIdentity();
 
 	if (Parent)
@@ -109,6 +112,9 @@ void PSkeletalMesh::Update(float DeltaTime)
 
 void PSkeletalMesh::EndPlay()
 {
+	safe_release(SkinnedVertexBuffer);
+	SkinnedVertexBuffer = nullptr;
+
 	PStaticMesh::EndPlay();
 }
 
@@ -180,6 +186,12 @@ bool PSkeletalMesh::LoadMesh(const char* MeshFileName, ID3D11Device* Dvc, ID3D11
 			}
 
 			ModelFile = MeshFileName;
+			FitBoundsToVertices();
+			PSkinning::ComputeJointSpheres(Vertices.data(), Vertices.size(), JointSpheres);
+
+			// The skinned copy is rebuilt from the new vertices on the next UpdateSkinning().
+			SkinnedVertices.clear();
+			bSkinned = false;
 
 			// Setup a count for triangles.
 			int Tri_Count = (int)(Indices.size() / 3);
@@ -234,6 +246,185 @@ bool PSkeletalMesh::PauseAnimation()
 	return true;
 }
 
+// Choose the animator's level of detail from this mesh's size on screen and whether it was drawn last frame.
+//
+// Returns the chosen level.
+EAnimLODs PSkeletalMesh::UpdateAnimationLOD(const PViewContext* View, bool bWasVisible)
+{
+	float ScreenSize = 1.0f;
+
+	// A sphere of radius R at distance D covers R / (D * tan(FovY / 2)) of the screen's height, and the projection
+	// matrix already holds 1 / tan(FovY / 2).
+	if (View)
+	{
+		float3 ToMesh = (Col_BoundingSphere.Center - View->InverseView[3].xyz);
+		float Distance = sqrtf(dot(ToMesh, ToMesh));
+
+		if (Distance > Col_BoundingSphere.Radius)
+		{
+			ScreenSize = ((Col_BoundingSphere.Radius * View->Projection[1].y) / Distance);
+		}
+	}
+
+	EAnimLODs NewLOD = PAnim::SelectLOD(AnimLOD, ScreenSize, bWasVisible);
+	Animator.SetLOD(NewLOD, AnimLOD);
+
+	return NewLOD;
+}
+
+// Build this frame's skinning palette and deform Vertices into SkinnedVertices.
+//
+// Returns true if SkinnedVertices hold a skinned pose.
+bool PSkeletalMesh::UpdateSkinning(PSimdLevel Level)
+{
+	if (!Animator.GetReady() || Vertices.empty())
+	{
+		bSkinned = false;
+		return false;
+	}
+
+	// Start from a copy of the mesh, so skinning only has to write positions and normals.
+	if (SkinnedVertices.size() != Vertices.size())
+	{
+		SkinnedVertices = Vertices;
+		bSkinned = false;
+	}
+
+	const PAnim::ClipAsset* Clip = Animator.Anim.GetAsset().get();
+
+	// A paused animation, or a pose the level of detail held, has nothing to redo.
+	std::span<const float4x4_a> Pose = Animator.GetPose();
+
+	if (bSkinned && (SkinnedClip == Clip) && (SkinnedPoseVersion == Animator.GetPoseVersion()) && (SkinnedMode == SkinningMode))
+	{
+		return true;
+	}
+
+	// An instanced pose comes with its palette, built once for every mesh in the crowd.
+	const std::shared_ptr<PAnim::SharedPose>& Shared = Animator.GetSharedPose();
+	std::span<const float4x4_a> Palette;
+
+	if (Shared)
+	{
+		Palette = Shared->GetPalette(true, Level);
+	}
+	else
+	{
+		SkinPalette.resize(Pose.size());
+		size_t JointCount = PSkinning::ComputePalette(Clip->InverseBind, Pose, SkinPalette, true, Level);
+		Palette = std::span<const float4x4_a>(SkinPalette.data(), JointCount);
+	}
+
+	// Bound the pose from the joint spheres, so culling stays tight around moving limbs without reading a vertex.
+	if (bAnimatedBounds)
+	{
+		PAABB Bounds;
+		if (PSkinning::ComputePoseBounds(JointSpheres, Palette, Bounds, Level))
+		{
+			SetLocalBounds(Bounds, { Bounds.Center, sqrtf(dot(Bounds.Extents, Bounds.Extents)) });
+		}
+	}
+
+	if (SkinningMode == SKINNING_DUALQUAT)
+	{
+		std::span<const PSkinning::DualQuat> DualQuats;
+
+		if (Shared)
+		{
+			DualQuats = Shared->GetDualQuats(true, Level);
+		}
+		else
+		{
+			SkinDualQuats.resize(Palette.size());
+			PSkinning::ComputeDualQuats(Palette, SkinDualQuats);
+			DualQuats = SkinDualQuats;
+		}
+
+		PSkinning::SkinVerticesDualQuat(Vertices.data(), SkinnedVertices.data(), Vertices.size(), DualQuats, Level);
+	}
+	else
+	{
+		PSkinning::SkinVertices(Vertices.data(), SkinnedVertices.data(), Vertices.size(), Palette, Level);
+	}
+
+	SkinnedClip = Clip;
+	SkinnedPoseVersion = Animator.GetPoseVersion();
+	SkinnedMode = SkinningMode;
+	bSkinned = true;
+	bSkinUploadPending = true;
+
+	return true;
+}
+
+// Upload SkinnedVertices if they changed since the last upload.
+//
+// Returns the vertex buffer to draw.
+ID3D11Buffer* PSkeletalMesh::GetDrawVertexBuffer(ID3D11DeviceContext* Cntxt)
+{
+	if (!bSkinned || !Animator.GetReady())
+	{
+		return VertexBuffer;
+	}
+
+	UINT ByteWidth = (UINT)(sizeof(Vertex) * SkinnedVertices.size());
+
+	// Drop the buffer if a new mesh was loaded with a different vertex count.
+	if (SkinnedVertexBuffer)
+	{
+		D3D11_BUFFER_DESC CurrentDesc;
+		SkinnedVertexBuffer->GetDesc(&CurrentDesc);
+
+		if (CurrentDesc.ByteWidth != ByteWidth)
+		{
+			SkinnedVertexBuffer->Release();
+			SkinnedVertexBuffer = nullptr;
+		}
+	}
+
+	if (!SkinnedVertexBuffer)
+	{
+		ID3D11Device* Dvc = nullptr;
+		Cntxt->GetDevice(&Dvc);
+
+		D3D11_BUFFER_DESC BufferDesc;
+		ZeroMemory(&BufferDesc, sizeof(BufferDesc));
+
+		BufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		BufferDesc.ByteWidth = ByteWidth;
+		BufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		BufferDesc.MiscFlags = 0;
+		BufferDesc.StructureByteStride = 0;
+		BufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+
+		HRESULT hr = Dvc->CreateBuffer(&BufferDesc, nullptr, &SkinnedVertexBuffer);
+		Dvc->Release();
+
+		if (FAILED(hr))
+		{
+			SkinnedVertexBuffer = nullptr;
+			return VertexBuffer;
+		}
+
+		bSkinUploadPending = true;
+	}
+
+	if (bSkinUploadPending)
+	{
+		D3D11_MAPPED_SUBRESOURCE Mapped;
+
+		if (FAILED(Cntxt->Map(SkinnedVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &Mapped)))
+		{
+			return VertexBuffer;
+		}
+
+		memcpy(Mapped.pData, SkinnedVertices.data(), ByteWidth);
+		Cntxt->Unmap(SkinnedVertexBuffer, 0);
+		bSkinUploadPending = false;
+	}
+
+	return SkinnedVertexBuffer;
+}
+
 // Load a texture into this object.
 //
 // Texture Types:
@@ -1,11 +1,22 @@
 #pragma once
 
 #include "../../PObjects/PStaticMesh/PStaticMesh.h"
+#include "../../PSystem/PAnimation/PSkinning/PSkinning.h"
 
 // A Skeletal Mesh is an object that has a 3D model attached to it. On creation, a model and texture must be supplied. The 3D model supplied should be a .mesh generated from a .FBX file.
 class PSkeletalMesh :	public PStaticMesh
 {
 public:
+	// ------------------------------------------------------------------
+	//		Skinning information.
+	// ------------------------------------------------------------------
+	ESkinningModes SkinningMode = SKINNING_LINEAR;				// How the animator's pose deforms the mesh.
+	std::vector<Vertex> SkinnedVertices;						// Vertices deformed by the current pose. Drawn in place of Vertices while an animation is ready.
+	ID3D11Buffer* SkinnedVertexBuffer = nullptr;				// The dynamic DirectX vertex buffer SkinnedVertices are uploaded to.
+	PAnim::LODSettings AnimLOD;									// Thresholds for how much work the animator's pose gets, by size on screen.
+	bool bAnimatedBounds = true;								// Whether the bounds follow the pose (see UpdateSkinning()). When false, the bounds fitted on load or set by hand are kept.
+
+
 	// ------------------------------------------------------------------
 	//		Constructors.
 	// ------------------------------------------------------------------
@@ -62,5 +73,40 @@ public:
 
 	// Pause the currently loaded animation.
 	bool PauseAnimation();
+
+	// Choose the animator's level of detail from how much of the screen this mesh's bounding sphere covers in View, and
+	// whether it was drawn last frame. With no View, the size is taken as full screen.
+	//
+	// Returns the chosen level.
+	EAnimLODs UpdateAnimationLOD(const PViewContext* View, bool bWasVisible);
+
+
+	// ------------------------------------------------------------------
+	//		Skinning.
+	// ------------------------------------------------------------------
+
+	// Build this frame's skinning palette from the animator's pose and deform Vertices into SkinnedVertices. Does nothing
+	// if the pose and mode haven't changed since the last call, which includes frames the animation level of detail
+	// skips. The model space bounds are rebuilt from the palette and JointSpheres, if bAnimatedBounds. Different meshes may
+	// be skinned on different threads.
+	//
+	// Returns true if SkinnedVertices hold a skinned pose.
+	bool UpdateSkinning(PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Upload SkinnedVertices if they changed since the last upload, creating SkinnedVertexBuffer the first time. Call
+	// from the render thread.
+	//
+	// Returns the vertex buffer to draw: SkinnedVertexBuffer while skinned, otherwise VertexBuffer.
+	ID3D11Buffer* GetDrawVertexBuffer(ID3D11DeviceContext* Cntxt);
+
+private:
+	std::vector<float4x4_a> SkinPalette;						// InverseBind * Pose for each joint, rebuilt by UpdateSkinning().
+	std::vector<PSkinning::DualQuat> SkinDualQuats;				// SkinPalette as dual quaternions, for SKINNING_DUALQUAT.
+	std::vector<PSkinning::JointSphere> JointSpheres;			// A sphere around the vertices each joint influences, fitted when the mesh is loaded.
+	const PAnim::ClipAsset* SkinnedClip = nullptr;				// The clip SkinnedVertices were last posed from.
+	uint64_t SkinnedPoseVersion = 0;							// The animator's pose version SkinnedVertices were last posed from.
+	ESkinningModes SkinnedMode = SKINNING_LINEAR;				// The mode SkinnedVertices were last posed with.
+	bool bSkinned = false;										// Whether SkinnedVertices hold a skinned pose.
+	bool bSkinUploadPending = false;							// Set when SkinnedVertices change, cleared once they're uploaded.
 };
 
@@ -1,6 +1,13 @@
 #include "PStaticMesh.h"
-#include "../../PSystem/PObjLoader/OBJ_Loader.h"
+#include "../../PSystem/PObjParser/PObjParser.h"
+#include "../../PSystem/PMeshCache/PMeshCache.h"
+#include "../../PSystem/PVertexWeld/PVertexWeld.h"
 #include "../../PSystem/DDSTextureLoader/DDSTextureLoader.h"
+#include "../../PMath/PVectorMath.h"
+#include <mutex>
+
+// Guards Col_TriangleBVH, which ray-cast workers may ask for at the same time.
+static std::mutex TriangleBVHLock;
 
 template<typename T>
 void safe_release(T* t)
@@ -22,7 +29,7 @@ PStaticMesh::PStaticMesh(std::string DebugName, std::vector<Vertex> Verts, std::
 	DDSFile = DDSFilePath;
 
 	// World and Local Matrices.
-	DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixIdentity();
+	SetWorldMatrix((float4x4_a&)DirectX::XMMatrixIdentity());
 	LocalMatrix = DirectX::XMMatrixIdentity();
 
 	if (Parent)
@@ -42,6 +49,7 @@ PStaticMesh::PStaticMesh(std::string DebugName, std::vector<Vertex> Verts, std::
 	// Load the primitive.
 	Indices = Ind;
 	Vertices = Verts;
+	FitBoundsToVertices();
 
 	D3D11_BUFFER_DESC BufferDesc;
 	D3D11_SUBRESOURCE_DATA SubData;
@@ -75,7 +83,7 @@ PStaticMesh::PStaticMesh(std::string DebugName, std::string ModelFilePath, std::
 	Ctrl_bIsVisible = bVisible;			// Set the initial visibility.
 
 	// World and Local Matrices.
-	DefaultWorld.ViewMatrix = (float4x4_a&)DirectX::XMMatrixIdentity();
+	SetWorldMatrix((float4x4_a&)DirectX::XMMatrixIdentity());
 	LocalMatrix = DirectX::XMMatrixIdentity();
 
 	if (Parent)
@@ -170,32 +178,52 @@ bool PStaticMesh::LoadMesh(const char* MeshFileName, ID3D11Device* Dvc, ID3D11De
 	// Load .obj file type. Ensure it is obj. If it is FBX it should be created as a SkeletalMesh instead of this StaticMesh.
 	if (FileType == ".obj")
 	{
-		objl::Loader ObjLoader;
-
-		if (ObjLoader.LoadFile(PGameplayStatics::GetGameDirectory() + "Assets/" + MeshFileName))
+		// Parsing only happens when the mesh cache has no current entry for the file. The cooked mesh is stored already
+		// conditioned and bounded, so a cache hit is copied straight in.
+		auto CookObj = [](const std::string& SourcePath, PMeshCache::CookedMesh& OutMesh)
 		{
-			Indices = (std::vector<int>&)ObjLoader.LoadedIndices;
-
-			// Resize the Vertices list.
-			Vertices.resize(ObjLoader.LoadedVertices.size());
+			PObjParser::Result Obj;
 
-			// Add the vertices.
-			for (unsigned int i = 0; i < ObjLoader.LoadedVertices.size(); ++i)
+			if (!PObjParser::Load(SourcePath, Obj))
 			{
-				Vertices[i].Position = { ObjLoader.LoadedVertices[i].Position.X, ObjLoader.LoadedVertices[i].Position.Y, ObjLoader.LoadedVertices[i].Position.Z };
-				Vertices[i].Normal = { ObjLoader.LoadedVertices[i].Normal.X, ObjLoader.LoadedVertices[i].Normal.Y, ObjLoader.LoadedVertices[i].Normal.Z };
-				Vertices[i].Texture = { ObjLoader.LoadedVertices[i].TextureCoordinate.X, ObjLoader.LoadedVertices[i].TextureCoordinate.Y };
+				return false;
 			}
 
+			OutMesh.Indices = std::move(Obj.Indices);
+			OutMesh.Vertices = std::move(Obj.Vertices);
+
 			// Condition mesh to fix UV and Normal flip.
-			for (auto& v : Vertices)
+			for (auto& v : OutMesh.Vertices)
 			{
 				//v.Position.x = -v.Position.x;
 				//v.Normal.x = -v.Normal.x;
 				v.Texture.y = 1.0f - v.Texture.y;
 			}
 
+			// The parser gives every face corner its own vertex. Share the ones that are the same.
+			PVertexWeld::Weld(OutMesh.Vertices, OutMesh.Indices);
+
+			OutMesh.Bounds = PComputeAABB(OutMesh.Vertices.data(), OutMesh.Vertices.size());
+			OutMesh.Sphere = PComputeBoundingSphere(OutMesh.Vertices.data(), OutMesh.Vertices.size(), OutMesh.Bounds.Center);
+
+			return true;
+		};
+
+		PMeshCache::CookedMesh Cooked;
+
+		if (PMeshCache::Load(PGameplayStatics::GetGameDirectory() + "Assets/" + MeshFileName, Cooked, CookObj))
+		{
+			Indices = std::move(Cooked.Indices);
+			Vertices = std::move(Cooked.Vertices);
+
 			ModelFile = MeshFileName;
+			SetLocalBounds(Cooked.Bounds, Cooked.Sphere);
+
+			{
+				// The geometry changed, so the triangle hierarchy is rebuilt the next time it is needed.
+				std::lock_guard<std::mutex> Lock(TriangleBVHLock);
+				Col_TriangleBVH.reset();
+			}
 
 			if (PrimitiveType != 0)
 			{
@@ -307,26 +335,101 @@ void PStaticMesh::SetMaterial(PMaterial Mat)
 	Material = Mat;
 }
 
+// Set the extents of the Bounding Box collider for this object, in model space. This overrides the fitted bounds.
 void PStaticMesh::SetBoundingBoxExtents(float3 Ext)
 {
-	Col_BoundingBox.Extents = Ext;
+	Col_LocalBounds.Extents = Ext;
+	Col_LocalSphere = { Col_LocalBounds.Center, sqrtf(dot(Ext, Ext)) };
+	Col_bBoundsDirty = true;
 }
 
-// Set the extents of the Bounding Box collider for this object.
+// Set the offset of the Bounding Box collider from the model origin, in model space. This overrides the fitted bounds.
 void PStaticMesh::SetBoundingBoxOffset(float3 Off)
 {
-	Col_BBOffset = Off;
+	Col_LocalBounds.Center = Off;
+	Col_LocalSphere.Center = Off;
+	Col_bBoundsDirty = true;
 }
 
+// Return the extents of the Bounding Box collider for this object, in model space.
 float3 PStaticMesh::GetBoundingBoxExtents()
 {
-	return Col_BoundingBox.Extents;
+	return Col_LocalBounds.Extents;
 }
 
-// Return the extents of the Bounding Box collider for this object.
+// Return the offset of the Bounding Box collider from the model origin, in model space.
 float3 PStaticMesh::GetBoundingBoxOffset()
 {
-	return Col_BBOffset;
+	return Col_LocalBounds.Center;
+}
+
+// Fit the model space bounding box and sphere tightly around Vertices.
+void PStaticMesh::FitBoundsToVertices()
+{
+	Col_LocalBounds = PComputeAABB(Vertices.data(), Vertices.size());
+	Col_LocalSphere = PComputeBoundingSphere(Vertices.data(), Vertices.size(), Col_LocalBounds.Center);
+	Col_bBoundsDirty = true;
+
+	// The geometry changed, so the triangle hierarchy is rebuilt the next time it is needed.
+	std::lock_guard<std::mutex> Lock(TriangleBVHLock);
+	Col_TriangleBVH.reset();
+}
+
+// Replace the model space bounding box and sphere.
+void PStaticMesh::SetLocalBounds(const PAABB& Bounds, const PSphere& Sphere)
+{
+	Col_LocalBounds = Bounds;
+	Col_LocalSphere = Sphere;
+	Col_bBoundsDirty = true;
+}
+
+// Refresh the world space bounding box and sphere from the model space ones. This only does work when the world matrix
+// has changed since the last refresh (or the model space bounds were changed).
+//
+// Returns true if the bounds were rebuilt.
+bool PStaticMesh::UpdateWorldBounds()
+{
+	const float4x4_a& WorldMatrix = GetWorld().ViewMatrix;
+
+	if (!Col_bBoundsDirty && (memcmp(&Col_BoundsWorld, &WorldMatrix, sizeof(float4x4_a)) == 0))
+	{
+		return false;
+	}
+
+	Col_BoundingBox = PTransformAABB(Col_LocalBounds, WorldMatrix);
+	Col_BoundingSphere = PTransformSphere(Col_LocalSphere, WorldMatrix);
+	Col_BoundsWorld = WorldMatrix;
+	Col_InverseWorld = PStoreMatrix(PMatrixInverse(PLoadMatrix(WorldMatrix)));
+	Col_bBoundsDirty = false;
+
+	return true;
+}
+
+// Return the triangle hierarchy over Vertices and Indices, building it on first use.
+std::shared_ptr<const PMeshBVH> PStaticMesh::GetTriangleBVH()
+{
+	std::lock_guard<std::mutex> Lock(TriangleBVHLock);
+
+	if (!Col_TriangleBVH)
+	{
+		Col_TriangleBVH = PMeshBVH::Acquire(Vertices, Indices);
+	}
+
+	return Col_TriangleBVH;
+}
+
+// Find the nearest triangle hit by a world space ray.
+bool PStaticMesh::RaycastTriangles(const float3& Origin, const float3& Direction, float MaxDistance, PMeshBVH::Hit& OutHit, bool bAnyHit)
+{
+	std::shared_ptr<const PMeshBVH> BVH = GetTriangleBVH();
+
+	// The ray is moved into model space rather than the triangles into world space. An affine transform keeps the ray's
+	// parameter, so distances found in model space are already in world units of Direction.
+	PMatrix InverseWorld = PLoadMatrix(Col_InverseWorld);
+	float3 LocalOrigin = PStoreFloat3(PVector3TransformCoord(PLoadFloat3(Origin), InverseWorld));
+	float3 LocalDirection = PStoreFloat3(PVector3TransformNormal(PLoadFloat3(Direction), InverseWorld));
+
+	return BVH->Raycast(LocalOrigin, LocalDirection, MaxDistance, OutHit, bAnyHit);
 }
 
 void PStaticMesh::RefreshVertexIndexBuffers(ID3D11Device* Dvc, ID3D11DeviceContext* Cntxt, bool Ver, bool Ind)
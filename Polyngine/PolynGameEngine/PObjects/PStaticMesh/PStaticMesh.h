@@ -2,6 +2,7 @@
 
 #include "../PObject/PObject.h"
 #include "../../Shaders/PMaterial/PMaterial.h"
+#include "../../PSystem/PMeshBVH/PMeshBVH.h"
 
 // A static mesh is an object that has a 3D model attached to it. On creation, a model and texture must be supplied.
 class PStaticMesh :	public PObject
@@ -40,6 +41,8 @@ public:
 	//		General Object Information
 	// ------------------------------------------------------------------
 	unsigned int PrimitiveType = 0;								// The type of primitive of this object (ex. Cube, Plane, etc). 0 means not a primitive.
+	bool bIsOccluder = false;									// Should this mesh be rasterized into the CPU occlusion buffer to hide meshes behind it?
+	uint64_t LastDrawnFrame = 0;								// The environment frame (PEnvironment::FrameNumber) this mesh last survived culling and was drawn in.
 
 
 	// ------------------------------------------------------------------
@@ -49,8 +52,11 @@ public:
 	// Should collision be enabled?
 	bool Col_bEnableCollision = true;											// Should collision be enabled?
 
-	float3 Col_BBOffset = { 0.0f, 2.0f, 0.0f };									// Offset of the bounding box from the model origin.
-	PAABB Col_BoundingBox = { { 0.0f, 0.0f, 0.0f }, { 2.0f, 2.0f, 2.0f } };		// Size of the bounding box in the form float2().
+	PAABB Col_LocalBounds = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };		// Bounding box in model space. Fitted to Vertices when a mesh is loaded.
+	PSphere Col_LocalSphere = { { 0.0f, 0.0f, 0.0f }, 1.7320508f };				// Bounding sphere in model space. Fitted to Vertices when a mesh is loaded.
+	PAABB Col_BoundingBox = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };		// Bounding box in world space. Refreshed by UpdateWorldBounds().
+	PSphere Col_BoundingSphere = { { 0.0f, 0.0f, 0.0f }, 1.7320508f };			// Bounding sphere in world space. Refreshed by UpdateWorldBounds().
+	int Col_ProxyId = -1;														// This mesh's proxy in the environment's spatial tree, or -1 if it has none.
 
 
 	// ------------------------------------------------------------------
@@ -109,18 +115,43 @@ public:
 	//		Handle Collision Data
 	// ------------------------------------------------------------------
 
-	// Set the extents of the Bounding Box collider for this object.
+	// Set the extents of the Bounding Box collider for this object, in model space. This overrides the fitted bounds.
 	void SetBoundingBoxExtents(float3 Ext);
 
-	// Set the extents of the Bounding Box collider for this object.
+	// Set the offset of the Bounding Box collider from the model origin, in model space. This overrides the fitted bounds.
 	void SetBoundingBoxOffset(float3 Off);
 
-	// Return the extents of the Bounding Box collider for this object.
+	// Return the extents of the Bounding Box collider for this object, in model space.
 	float3 GetBoundingBoxExtents();
 
-	// Return the extents of the Bounding Box collider for this object.
+	// Return the offset of the Bounding Box collider from the model origin, in model space.
 	float3 GetBoundingBoxOffset();
 
+	// Fit the model space bounding box and sphere tightly around Vertices.
+	void FitBoundsToVertices();
+
+	// Replace the model space bounding box and sphere, such as with ones that follow an animated pose. The world space
+	// bounds pick them up on the next UpdateWorldBounds().
+	void SetLocalBounds(const PAABB& Bounds, const PSphere& Sphere);
+
+	// Refresh the world space bounding box and sphere from the model space ones. This only does work when the world matrix
+	// has changed since the last refresh (or the model space bounds were changed).
+	//
+	// Returns true if the bounds were rebuilt.
+	bool UpdateWorldBounds();
+
+	// Return the triangle hierarchy over Vertices and Indices, building it on first use. Meshes with the same geometry
+	// share one hierarchy. Safe to call from any thread.
+	std::shared_ptr<const PMeshBVH> GetTriangleBVH();
+
+	// Find the nearest triangle hit by the world space ray Origin + (Direction * t) for 0 <= t <= MaxDistance. The mesh is
+	// placed by the world matrix of the last UpdateWorldBounds(), the same one its bounding box was built from, so this is
+	// safe to call from the environment's ray-cast workers. OutHit.Distance is in multiples of the world space Direction.
+	// The triangles are Vertices as loaded, so a skeletal mesh is tested in its bind pose rather than its current one.
+	//
+	// RETURN: True if a triangle was hit.
+	bool RaycastTriangles(const float3& Origin, const float3& Direction, float MaxDistance, PMeshBVH::Hit& OutHit, bool bAnyHit = false);
+
 
 	// ------------------------------------------------------------------
 	//		Update Vertex/Index Buffer Information.
@@ -128,5 +159,11 @@ public:
 
 	// Refresh buffer data for the model and texture.
 	void RefreshVertexIndexBuffers(ID3D11Device* Dvc, ID3D11DeviceContext* Cntxt, bool Ver = true, bool Ind = true);
+
+private:
+	float4x4_a Col_BoundsWorld;													// The world matrix the world space bounds were last built from.
+	bool Col_bBoundsDirty = true;												// Set when the model space bounds change so the next refresh can't be skipped.
+	float4x4_a Col_InverseWorld;												// The inverse of Col_BoundsWorld, to bring rays into model space.
+	std::shared_ptr<const PMeshBVH> Col_TriangleBVH;							// Built by GetTriangleBVH(), dropped when the bounds are refitted.
 };
 
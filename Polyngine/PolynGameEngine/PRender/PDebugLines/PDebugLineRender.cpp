@@ -2,7 +2,10 @@
 #include "../../PObjects/PObject/PObject.h"
 #include "../../PObjects/PSkeletalMesh/PSkeletalMesh.h"
 #include "../../PSystem/PAnimation/PAnim/PAnim.h"
+#include "../../PMath/PTransform.h"
 #include <array>
+#include <cstring>
+#include <vector>
 
 namespace
 {
@@ -10,6 +13,9 @@ namespace
 
 	size_t LineVertCount = 0;
 	std::array<PMath::colored_vertex, MAX_LINE_VERTS> LineVerts;
+
+	// Scratch for AddJoints(). Each joint uses 4 points: its location and the ends of its 3 axis lines.
+	std::vector<PMath::float3> JointPoints;
 }
 
 namespace DebugLines
@@ -66,43 +72,57 @@ namespace DebugLines
 		}
 	}
 
-	void AddJointTransform(float Trans[16])
+	// Draw a skeleton's bones and joint axes, moved into world space by World. Every point is transformed in one batch.
+	// GetTransform(i) returns joint i's matrix and GetParent(i) its parent, so poses and bind poses share this.
+	template<typename TransformFunc, typename ParentFunc>
+	void AddJoints(size_t JointCount, TransformFunc&& GetTransform, ParentFunc&& GetParent, const PMath::float4x4_a& World)
 	{
-		// Get position and directional vectors.
-		float3 Object_Location = { Trans[12], Trans[13], Trans[14] };
-		float3 RightVector = { Trans[0], Trans[1], Trans[2] };
-		float3 UpVector = { Trans[4], Trans[5], Trans[6] };
-		float3 ForwardVector = { Trans[8], Trans[9], Trans[10] };
-
-		// Find point in front of the current local position.
-		float3 XYZ_x = Object_Location + (ForwardVector * 0.1f);
-		float3 XYZ_y = Object_Location + (UpVector * 0.1f);
-		float3 XYZ_z = Object_Location + (RightVector * 0.1f);
-
-		// Draw the three lines.
-		AddLine(Object_Location, XYZ_x, { 1, 0, 0, 1 });
-		AddLine(Object_Location, XYZ_y, { 0, 1, 0, 1 });
-		AddLine(Object_Location, XYZ_z, { 0, 0, 1, 1 });
+		float4 BoneColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+		JointPoints.resize(JointCount * 4);
+
+		for (size_t i = 0; i < JointCount; ++i)
+		{
+			const PMath::float4x4_a& Trans = GetTransform(i);
+
+			float3 Location = Trans[3].xyz;
+			float3 RightVector = Trans[0].xyz;
+			float3 UpVector = Trans[1].xyz;
+			float3 ForwardVector = Trans[2].xyz;
+
+			JointPoints[(i * 4) + 0] = Location;
+			JointPoints[(i * 4) + 1] = Location + (ForwardVector * 0.1f);
+			JointPoints[(i * 4) + 2] = Location + (UpVector * 0.1f);
+			JointPoints[(i * 4) + 3] = Location + (RightVector * 0.1f);
+		}
+
+		PMath::PTransformPoints(JointPoints.data(), JointPoints.data(), JointPoints.size(), World);
+
+		for (size_t i = 0; i < JointCount; ++i)
+		{
+			int Parent = GetParent(i);
+
+			if ((Parent >= 0) && (Parent < (int)JointCount))
+			{
+				const float3* Points = &JointPoints[i * 4];
+
+				AddLine(Points[0], JointPoints[Parent * 4], BoneColor);
+				AddLine(Points[0], Points[1], { 1, 0, 0, 1 });
+				AddLine(Points[0], Points[2], { 0, 1, 0, 1 });
+				AddLine(Points[0], Points[3], { 0, 0, 1, 1 });
+			}
+		}
 	}
 
 	void AddSkeleton(PSkeletalMesh* Object)
 	{
 		if (Object && Object->Animator.GetReady())
 		{
-			float4 BoneColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			// The cached pose, so the skeleton costs nothing extra when something else already sampled this frame.
+			std::span<const PMath::float4x4_a> Pose = Object->Animator.GetPose();
+			std::span<const int> Parents = Object->Animator.GetJointParents();
 
-			std::vector<PAnim::Joint> Joints = Object->Animator.GetLerpKeyframe().Joints;
-
-			for (unsigned int i = 0; i < Joints.size(); ++i)
-			{
-				if (Joints[i].ParentIndex >= 0 && Joints[i].ParentIndex < Joints.size())
-				{
-					float3 StartPos = { Joints[i].Transform[12], Joints[i].Transform[13], Joints[i].Transform[14] };
-					float3 EndPos = { Joints[Joints[i].ParentIndex].Transform[12], Joints[Joints[i].ParentIndex].Transform[13], Joints[Joints[i].ParentIndex].Transform[14] };
-					AddLine(StartPos, EndPos, BoneColor);
-					AddJointTransform(Joints[i].Transform);
-				}
-			}
+			AddJoints(Pose.size(), [&](size_t i) -> const PMath::float4x4_a& { return Pose[i]; }, [&](size_t i) { return Parents[i]; }, Object->GetWorld().ViewMatrix);
 		}
 	}
 
@@ -110,20 +130,14 @@ namespace DebugLines
 	{
 		if (Object && Object->Animator.GetReady())
 		{
-			float4 BoneColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			const std::vector<PAnim::Joint>& Joints = Object->Animator.Anim.GetBindPose().Joints;
+			PMath::float4x4_a Transform;
 
-			std::vector<PAnim::Joint> Joints = Object->Animator.GetBindPose().Joints;
-
-			for (unsigned int i = 0; i < Joints.size(); ++i)
+			AddJoints(Joints.size(), [&](size_t i) -> const PMath::float4x4_a&
 			{
-				if (Joints[i].ParentIndex >= 0 && Joints[i].ParentIndex < Joints.size())
-				{
-					float3 StartPos = { Joints[i].Transform[12], Joints[i].Transform[13], Joints[i].Transform[14] };
-					float3 EndPos = { Joints[Joints[i].ParentIndex].Transform[12], Joints[Joints[i].ParentIndex].Transform[13], Joints[Joints[i].ParentIndex].Transform[14] };
-					AddLine(StartPos, EndPos, BoneColor);
-					AddJointTransform(Joints[i].Transform);
-				}
-			}
+				memcpy(&Transform, Joints[i].Transform, sizeof(Transform));
+				return Transform;
+			}, [&](size_t i) { return Joints[i].ParentIndex; }, Object->GetWorld().ViewMatrix);
 		}
 	}
 
@@ -3,6 +3,10 @@
 #include <sstream>
 #include <iostream>
 #include "../PDebugLines/PDebugLineRender.h"
+#include "../../PSystem/PJobs/PJobSystem.h"
+#include "../../PSystem/PMeshCache/PMeshCache.h"
+#include "../../PSystem/Timer/Timer.h"
+#include <algorithm>
 #include "../GUIToolbox/ImGui/imgui.h"
 #include "../GUIToolbox/ImGui/imgui_impl_win32.h"
 #include "../GUIToolbox/ImGui/imgui_impl_dx11.h"
@@ -57,15 +61,11 @@ void PEnvironment::BeginPlay()
 
 	PSkeletalMesh* NewMesh = CreateSkeletalMesh("Meshes/BattleMage.mesh", "Textures/BattleMage/BattleMage_D.dds", "Textures/BattleMage/BattleMage_S.dds", "Textures/BattleMage/BattleMage_E.dds", true, "BattleMageMesh", nullptr, { 0.85f, 0.85f, 0.85f });
 	NewMesh->AddMovementInput({ 4.5f, 0.0f, 0.0f });
-	NewMesh->SetBoundingBoxOffset({ 0.0f, 3.0f, 0.0f });
-	NewMesh->SetBoundingBoxExtents({ 1.5f, 3.0f, 1.5f });
 	NewMesh->PlayAnimation("Animations/BattleMage/Testing/Idle.anim");
 
 	PStaticMesh* Floor = CreatePrimitive(EPrimitives::PLANE, true, "WorldFloor", nullptr, { 15.0f, 1.0f, 15.0f });
 	Floor->LoadTexture("Textures/OceanTile/OceanTile_D.dds", Device, 0);
 	Floor->LoadTexture("Textures/OceanTile/OceanTile_S.dds", Device, 2);
-	Floor->SetBoundingBoxOffset({ 0.0f, 0.0f, 0.0f });
-	Floor->SetBoundingBoxExtents({ 15.0f, 0.1f, 15.0f });
 
 	PPointLight* NewLight = CreatePointLight(0.78f, 10.0f, { 1.0f, 1.0f, 1.0f, 1.0f }, "WhiteLight");
 	NewLight->AddMovementInput({ 2.81f, 4.0f, 2.5f });
@@ -134,9 +134,19 @@ void PEnvironment::Update(float DeltaTime)
 		GetRenderCamera()->Update(DeltaTime);
 	}
 
+	AnimationPhase.clear();
+	SkinningPhase.clear();
+	++FrameNumber;
+
+	// Animation level of detail is chosen from how large each skeletal mesh is in the active camera, and whether the
+	// renderer drew it last frame.
+	PCamera* ActiveCamera = GetActiveCamera();
+	const PViewContext* ActiveView = ActiveCamera ? &ActiveCamera->GetViewContext() : nullptr;
+
 	// Object updates.
 	//
 	// Objects include: PObject, PCamera, PStaticMesh, PLight, PPointLight, and PDirectionalLight.
+	// Animators are not advanced here. They're gathered and advanced together after every object has updated.
 	// This will run only in multiple modes and has a flow control to decipher which.
 	// It should only run if one of the conditions within the loop is decided to be true ahead of time
 	// to save on cycles if the loop would run and do nothing.
@@ -157,27 +167,37 @@ void PEnvironment::Update(float DeltaTime)
 			{
 				CurrObject->Update(DeltaTime);
 			}
-			else if (CurrentState == ERenderStates::DEBUG)
+
+			if (CurrObject->Animator.GetReady())
 			{
-				CurrObject->Animator.Update(DeltaTime);
+				AnimationPhase.push_back(&CurrObject->Animator);
+
+				PSkeletalMesh* Skeleton = dynamic_cast<PSkeletalMesh*>(CurrObject);
+				if (Skeleton != nullptr)
+				{
+					Skeleton->UpdateAnimationLOD(ActiveView, ((Skeleton->LastDrawnFrame + 1) == FrameNumber));
+					SkinningPhase.push_back(Skeleton);
+				}
 			}
 
 			PStaticMesh* CurrMesh = dynamic_cast<PStaticMesh*>(CurrObject);
 			if (CurrMesh != nullptr)
 			{
-				CurrMesh->Col_BoundingBox.Center = CurrMesh->GetLocation() + CurrMesh->Col_BBOffset;
+				// Keep the spatial tree in step with the mesh. Moving a proxy costs nothing while it stays inside its fat box.
+				if (CurrMesh->Col_ProxyId == PAABBTree::NullNode)
+				{
+					CurrMesh->UpdateWorldBounds();
+					CurrMesh->Col_ProxyId = SpatialTree.CreateProxy(CurrMesh->Col_BoundingBox, CurrMesh);
+				}
+				else if (CurrMesh->UpdateWorldBounds())
+				{
+					SpatialTree.MoveProxy(CurrMesh->Col_ProxyId, CurrMesh->Col_BoundingBox);
+				}
 			}
 
 			// This will only run if the editor setting is set to show the Matrices and the state is not in Ship mode.
 			if (CurrentState != ERenderStates::SHIP)
 			{
-				PSkeletalMesh* Skeleton = dynamic_cast<PSkeletalMesh*>(CurrObject);
-				if (Skeleton && Skeleton->Animator.GetReady())
-				{
-					DebugLines::AddSkeleton(Skeleton);
-					DebugLines::AddBindPoseSkeleton(Skeleton);
-				}
-
 				if (bFlag_ShowDebugMatrices)
 				{
 					// Draw debug matrices and lines for this object based on its type.
@@ -211,6 +231,41 @@ void PEnvironment::Update(float DeltaTime)
 		}
 	}
 
+	// Animation updates.
+	//
+	// Every ready animator is advanced and its pose sampled (blending and forward kinematics) across the job pool. The
+	// poses are all published before anything reads them, so debug drawing and rendering get them from each animator's
+	// cache without sampling again.
+	PAnim::UpdateAll(AnimationPhase, DeltaTime, 0, &AnimationLODStats, &AnimationInstancingStats);
+
+	// Each skeletal mesh builds its palette from the published pose and skins its own copy of its vertices, so they can
+	// all be skinned at once. The renderer uploads them when it draws.
+	PJobs::ParallelFor(SkinningPhase.size(), 1, [&](size_t Begin, size_t End)
+	{
+		for (size_t i = Begin; i < End; ++i)
+		{
+			SkinningPhase[i]->UpdateSkinning();
+		}
+	});
+
+	// Skinning moved the bounds of posed meshes, so their proxies follow now rather than a frame late.
+	for (PSkeletalMesh* Skeleton : SkinningPhase)
+	{
+		if ((Skeleton->Col_ProxyId != PAABBTree::NullNode) && Skeleton->UpdateWorldBounds())
+		{
+			SpatialTree.MoveProxy(Skeleton->Col_ProxyId, Skeleton->Col_BoundingBox);
+		}
+	}
+
+	if (CurrentState != ERenderStates::SHIP)
+	{
+		for (PSkeletalMesh* Skeleton : SkinningPhase)
+		{
+			DebugLines::AddSkeleton(Skeleton);
+			DebugLines::AddBindPoseSkeleton(Skeleton);
+		}
+	}
+
 	// Check for quick keys in renderer.
 	//
 	// When the renderer is in debug mode.
@@ -868,6 +923,7 @@ bool PEnvironment::DestroyObject(PObject* Obj)
 				SelectedObject = nullptr;
 			}
 
+			RemoveFromSpatialTree(WorldObjects[i]);
 			WorldObjects[i]->Destroy();
 			delete WorldObjects[i];
 			WorldObjects.erase(WorldObjects.begin() + i);
@@ -1128,6 +1184,7 @@ void PEnvironment::ClearEnvironment(bool bShutdown, bool bNoLevel)
 	{
 		if (WorldObjects[i] && (!GetActiveCamera() || ((WorldObjects[i]->GetDisplayName() != GetActiveCamera()->GetDisplayName())) || bShutdown))
 		{
+			RemoveFromSpatialTree(WorldObjects[i]);
 			WorldObjects[i]->Destroy();
 			delete WorldObjects[i];
 			WorldObjects.erase(WorldObjects.begin() + i);
@@ -1351,6 +1408,8 @@ void PEnvironment::SaveLevel(std::string FilePath)
 							{
 								LevelStream << " " << std::to_string(SMesh->PrimitiveType);
 							}
+
+							LevelStream << " " << SMesh->bIsOccluder;
 						}
 						else
 						{
@@ -1409,6 +1468,11 @@ void PEnvironment::LoadLevel(std::string FilePath)
 	{
 		std::string LevelName = PGameplayStatics::SplitString(LevelChunks[LevelChunks.size() - 1], '.')[0];
 
+		// Time the load, and count how many meshes came from the mesh cache, so cold and warm loads can be compared.
+		Timer LoadClock;
+		LoadClock.Restart();
+		PMeshCache::Stats CacheBefore = PMeshCache::GetStats();
+
 		ClearEnvironment(false);
 
 		// Print that the level is loading. Also setup the whole filepath.
@@ -1465,6 +1529,7 @@ void PEnvironment::LoadLevel(std::string FilePath)
 						float SpecAddative;
 						PMath::float3 EmissiveAddative;
 						bool bCollisionEnable;
+						bool bOccluder = false;
 						float3 BBExtents;
 						float3 BBOffset;
 
@@ -1517,6 +1582,9 @@ void PEnvironment::LoadLevel(std::string FilePath)
 								BBExtents = { stof(Chunks[49]), stof(Chunks[50]), stof(Chunks[51]) };
 								BBOffset = { stof(Chunks[52]), stof(Chunks[53]), stof(Chunks[54]) };
 
+								// The occluder flag is the last value on the line. Levels saved before it existed don't have it.
+								size_t OccluderChunk = ((Chunks[0] == "PRIMI") ? 56 : 55);
+								bOccluder = ((Chunks.size() > OccluderChunk) && (Chunks[OccluderChunk] == "1"));
 							}
 							if (Chunks[0] == "CAM")
 							{
@@ -1552,6 +1620,7 @@ void PEnvironment::LoadLevel(std::string FilePath)
 							NewStaticMesh->Col_bEnableCollision = bCollisionEnable;
 							NewStaticMesh->SetBoundingBoxExtents(BBExtents);
 							NewStaticMesh->SetBoundingBoxOffset(BBOffset);
+							NewStaticMesh->bIsOccluder = bOccluder;
 							NewStaticMesh->SetMaterial(Material);
 							PrintToConsole("Static Mesh: " + NewStaticMesh->GetDisplayName() + " was created.");
 
@@ -1564,6 +1633,7 @@ void PEnvironment::LoadLevel(std::string FilePath)
 							NewSkeletalMesh->Col_bEnableCollision = bCollisionEnable;
 							NewSkeletalMesh->SetBoundingBoxExtents(BBExtents);
 							NewSkeletalMesh->SetBoundingBoxOffset(BBOffset);
+							NewSkeletalMesh->bIsOccluder = bOccluder;
 							PrintToConsole("Static Mesh: " + NewSkeletalMesh->GetDisplayName() + " was created.");
 
 							CurrObject = NewSkeletalMesh;
@@ -1593,6 +1663,7 @@ void PEnvironment::LoadLevel(std::string FilePath)
 							NewPrimMesh->Col_bEnableCollision = bCollisionEnable;
 							NewPrimMesh->SetBoundingBoxExtents(BBExtents);
 							NewPrimMesh->SetBoundingBoxOffset(BBOffset);
+							NewPrimMesh->bIsOccluder = bOccluder;
 							PrintToConsole("Primitive Mesh: " + NewPrimMesh->GetDisplayName() + " was created.");
 
 							CurrObject = NewPrimMesh;
@@ -1627,7 +1698,7 @@ void PEnvironment::LoadLevel(std::string FilePath)
 								PrintToConsole("Controller created and assigned to: " + CurrObject->GetDisplayName(), 1);
 							}
 
-							CurrObject->DefaultWorld.ViewMatrix = (float4x4_a&)World;
+							CurrObject->SetWorldMatrix((float4x4_a&)World);
 							CurrObject->LocalMatrix = Local;
 							CurrObject->SetVisibility(bIsVisible);
 							CurrObject->SetInputEnabled(bIsInputEnabled);
@@ -1672,6 +1743,9 @@ void PEnvironment::LoadLevel(std::string FilePath)
 
 
 				PrintToConsole("Level: \"" + LevelName + "\" has been loaded from file: \"" + LevelFile + "\"", 1);
+
+				PMeshCache::Stats CacheAfter = PMeshCache::GetStats();
+				PrintToConsole("Level: \"" + LevelName + "\" took " + std::to_string(LoadClock.GetElapsedMiliseconds()) + " ms. Meshes from the cache: " + std::to_string(CacheAfter.Hits - CacheBefore.Hits) + ", cooked: " + std::to_string(CacheAfter.Cooked - CacheBefore.Cooked) + ".", 4);
 			}
 			else
 			{
@@ -1734,30 +1808,285 @@ void PEnvironment::EndPlaytest()
 	GetRenderCamera()->SetMovementEnabled(true);
 }
 
-// Test every PCharacter against every Mesh in the game world with collision enabled to see if the Character is colliding.
+// Test every PCharacter against the Meshes around it in the spatial tree with collision enabled to see if the Character is colliding.
 void PEnvironment::CheckObjectCollisions()
 {
 	std::vector<PCharacter*> Chars = GetCharacters();
-	std::vector<PStaticMesh*> Meshes = GetStaticMeshes();
 
-	if (Chars.size() > 0)
+	for (unsigned int i = 0; i < Chars.size(); ++i)
 	{
-		for (unsigned int i = 0; i < Chars.size(); ++i)
+		PCharacter* CurrChar = Chars[i];
+
+		if (!CurrChar->Col_bEnableCollision)
 		{
-			PCharacter* CurrChar = Chars[i];
+			continue;
+		}
 
-			for (unsigned int j = 0; j < Meshes.size(); ++j)
+		// Only the meshes whose bounds overlap the character's come back from the tree.
+		SpatialTree.QueryBox(CurrChar->Col_BoundingBox, [&](int ProxyId)
+		{
+			PStaticMesh* CurrAntiMesh = static_cast<PStaticMesh*>(SpatialTree.GetUserData(ProxyId));
+
+			// Ensure that you are not testing a mesh against itself, and that the other mesh has collision enabled.
+			if ((CurrAntiMesh != CurrChar) && CurrAntiMesh->Col_bEnableCollision)
 			{
-				PStaticMesh* CurrAntiMesh = Meshes[i];
 
-				// Ensure the Mesh is valid and that you are not testing a mesh against itself.
-				if (Meshes[j] != nullptr && CurrAntiMesh->GetDisplayName() != CurrChar->GetDisplayName())
+			}
+
+			return true;
+		});
+	}
+}
+
+// Remove an object from the spatial tree. Must be called before a mesh is deleted.
+void PEnvironment::RemoveFromSpatialTree(PObject* Obj)
+{
+	PStaticMesh* Mesh = dynamic_cast<PStaticMesh*>(Obj);
+
+	if (Mesh && (Mesh->Col_ProxyId != PAABBTree::NullNode))
+	{
+		SpatialTree.DestroyProxy(Mesh->Col_ProxyId);
+		Mesh->Col_ProxyId = PAABBTree::NullNode;
+	}
+}
+
+// Return the ERaycastTypes bit a mesh belongs to. Only looked up when a query filters by type.
+static unsigned int GetRaycastType(PStaticMesh* Mesh)
+{
+	if (dynamic_cast<PCharacter*>(Mesh))
+	{
+		return RAYCAST_CHARACTER;
+	}
+	else if (dynamic_cast<PSkeletalMesh*>(Mesh))
+	{
+		return RAYCAST_SKELETALMESH;
+	}
+
+	return RAYCAST_STATICMESH;
+}
+
+// Answer a batch of ray queries, 8 rays per walk of the spatial tree.
+size_t PEnvironment::Raycast(const PRaycastQuery* Queries, size_t Count, std::vector<PRaycastResult>& OutResults, std::vector<PRaycastHit>& OutHits)
+{
+	OutResults.assign(Count, PRaycastResult{});
+	OutHits.clear();
+
+	if (Count == 0)
+	{
+		return 0;
+	}
+
+	constexpr uint32_t Width = PRayPacket::Width;
+
+	// Rays heading into the same octant take similar paths through the tree, so packing them together keeps each packet's
+	// walk short. Bucket the queries by the signs of their directions, keeping the submitted order inside each bucket.
+	std::vector<uint32_t> Order(Count);
+	{
+		size_t Offsets[9] = {};
+
+		auto Octant = [&](size_t i)
+		{
+			const float3& Direction = Queries[i].Direction;
+			return ((Direction.x < 0.0f) ? 1 : 0) | ((Direction.y < 0.0f) ? 2 : 0) | ((Direction.z < 0.0f) ? 4 : 0);
+		};
+
+		for (size_t i = 0; i < Count; ++i)
+		{
+			Offsets[Octant(i) + 1]++;
+		}
+		for (int i = 1; i < 9; ++i)
+		{
+			Offsets[i] += Offsets[i - 1];
+		}
+		for (size_t i = 0; i < Count; ++i)
+		{
+			Order[Offsets[Octant(i)]++] = (uint32_t)i;
+		}
+	}
+
+	struct PacketHit
+	{
+		uint32_t Query;
+		PRaycastHit Hit;
+	};
+
+	size_t PacketCount = ((Count + (Width - 1)) / Width);
+	std::vector<std::vector<PacketHit>> PacketHits(PacketCount);
+	bool bInGame = (CurrentState != ERenderStates::DEBUG);
+
+	auto CastPacket = [&](size_t PacketIndex)
+	{
+		const uint32_t* LaneQueries = &Order[PacketIndex * Width];
+		uint32_t LaneCount = (uint32_t)std::min<size_t>(Width, (Count - (PacketIndex * Width)));
+
+		PRayPacket Packet;
+		PRaycastHit Nearest[Width];
+
+		for (uint32_t Lane = 0; Lane < LaneCount; ++Lane)
+		{
+			const PRaycastQuery& Query = Queries[LaneQueries[Lane]];
+			Packet.Add(Query.Origin, Query.Direction, Query.MaxDistance);
+		}
+
+		std::vector<PacketHit>& Hits = PacketHits[PacketIndex];
+
+		SpatialTree.QueryRayPacket(Packet, [&](int ProxyId, uint32_t HitMask)
+		{
+			PStaticMesh* Mesh = static_cast<PStaticMesh*>(SpatialTree.GetUserData(ProxyId));
+
+			// The tree only tested the proxy's fat box, test the mesh's own bounds for the real entry distance.
+			float Near[Width];
+			float3 BoxMin = (Mesh->Col_BoundingBox.Center - Mesh->Col_BoundingBox.Extents);
+			float3 BoxMax = (Mesh->Col_BoundingBox.Center + Mesh->Col_BoundingBox.Extents);
+			HitMask &= PIntersectRayPacketAABB(Packet, BoxMin, BoxMax, Near);
+
+			bool bVisible = (Mesh->GetVisibility() && !(bInGame && Mesh->GetHiddenInGame()));
+			unsigned int MeshType = 0;
+
+			for (; HitMask != 0; HitMask &= (HitMask - 1))
+			{
+				uint32_t Lane = 0;
+				while (((HitMask >> Lane) & 1u) == 0)
 				{
-					
+					++Lane;
+				}
+
+				const PRaycastQuery& Query = Queries[LaneQueries[Lane]];
+
+				if ((Query.bVisibleOnly && !bVisible) || (Mesh == Query.IgnoreObjects[0]) || (Mesh == Query.IgnoreObjects[1]))
+				{
+					continue;
+				}
+
+				if (Query.TypeMask != RAYCAST_ALLTYPES)
+				{
+					MeshType = (MeshType != 0) ? MeshType : GetRaycastType(Mesh);
+
+					if ((Query.TypeMask & MeshType) == 0)
+					{
+						continue;
+					}
+				}
+
+				PRaycastHit Hit = { Mesh, Near[Lane], Query.Origin + (Query.Direction * Near[Lane]) };
+
+				if (Query.bTestTriangles)
+				{
+					MeshType = (MeshType != 0) ? MeshType : GetRaycastType(Mesh);
+				}
+
+				// Skinned meshes are posed away from the bind pose their triangle hierarchy holds, so their box hit stands.
+				if (Query.bTestTriangles && (MeshType == RAYCAST_STATICMESH))
+				{
+					// The box was only the way in. The ray still has to hit a triangle nearer than the lane's current limit.
+					PMeshBVH::Hit TriangleHit;
+					float Limit = (Query.Mode == RAYCAST_ALL) ? Query.MaxDistance : Packet.MaxDistance[Lane];
+
+					if (!Mesh->RaycastTriangles(Query.Origin, Query.Direction, Limit, TriangleHit, (Query.Mode == RAYCAST_ANY)))
+					{
+						continue;
+					}
+
+					Hit.Distance = TriangleHit.Distance;
+					Hit.Location = Query.Origin + (Query.Direction * TriangleHit.Distance);
+					Hit.Triangle = (int)TriangleHit.Triangle;
+				}
+
+				switch (Query.Mode)
+				{
+				case RAYCAST_ALL:
+					Hits.push_back({ LaneQueries[Lane], Hit });
+					break;
+
+				case RAYCAST_ANY:
+					// One hit answers the query, stop testing this lane.
+					Nearest[Lane] = Hit;
+					Packet.MaxDistance[Lane] = -1.0f;
+					break;
+
+				default:
+					// Clip the ray so only nearer boxes are reported from here on.
+					Nearest[Lane] = Hit;
+					Packet.MaxDistance[Lane] = Hit.Distance;
+					break;
 				}
 			}
+		});
+
+		for (uint32_t Lane = 0; Lane < LaneCount; ++Lane)
+		{
+			if (Nearest[Lane].Mesh != nullptr)
+			{
+				Hits.push_back({ LaneQueries[Lane], Nearest[Lane] });
+			}
 		}
+
+		// Group each query's hits together, nearest first.
+		std::sort(Hits.begin(), Hits.end(), [](const PacketHit& A, const PacketHit& B)
+		{
+			return (A.Query != B.Query) ? (A.Query < B.Query) : (A.Hit.Distance < B.Hit.Distance);
+		});
+	};
+
+	// The tree is only read here, so packets can be cast on any thread.
+	PJobs::ParallelFor(PacketCount, 4, [&](size_t Begin, size_t End)
+	{
+		for (size_t PacketIndex = Begin; PacketIndex < End; ++PacketIndex)
+		{
+			CastPacket(PacketIndex);
+		}
+	});
+
+	size_t HitQueries = 0;
+
+	for (const std::vector<PacketHit>& Hits : PacketHits)
+	{
+		for (size_t i = 0; i < Hits.size(); ++i)
+		{
+			PRaycastResult& Result = OutResults[Hits[i].Query];
+
+			if (Result.HitCount == 0)
+			{
+				Result.FirstHit = (unsigned int)OutHits.size();
+				HitQueries++;
+			}
+
+			Result.HitCount++;
+			OutHits.push_back(Hits[i].Hit);
+		}
+	}
+
+	return HitQueries;
+}
+
+// Cast a single ray.
+bool PEnvironment::Raycast(const PRaycastQuery& Query, PRaycastHit& OutHit)
+{
+	PRaycastQuery Single = Query;
+	Single.Mode = (Query.Mode == RAYCAST_ALL) ? RAYCAST_CLOSEST : Query.Mode;
+
+	std::vector<PRaycastResult> Results;
+	std::vector<PRaycastHit> Hits;
+
+	if (Raycast(&Single, 1, Results, Hits) == 0)
+	{
+		return false;
 	}
+
+	OutHit = Hits[Results[0].FirstHit];
+	return true;
+}
+
+// Check whether anything blocks the segment From to To.
+bool PEnvironment::HasLineOfSight(float3 From, float3 To, PObject* IgnoreA, PObject* IgnoreB, unsigned int TypeMask)
+{
+	PRaycastQuery Query = PRaycastQuery::Segment(From, To, RAYCAST_ANY);
+	Query.TypeMask = TypeMask;
+	Query.IgnoreObjects[0] = IgnoreA;
+	Query.IgnoreObjects[1] = IgnoreB;
+
+	PRaycastHit Hit;
+	return !Raycast(Query, Hit);
 }
 
 void PEnvironment::CreateCustomClass(std::string FilePath, EClasses Type)
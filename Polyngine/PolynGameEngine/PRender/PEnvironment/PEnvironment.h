@@ -11,6 +11,8 @@
 #include "../../PSystem/PInputManager/PInputManager.h"
 #include "../../PSystem/PController/PController.h"
 #include "../../PSystem/Timer/PStopwatch/PStopwatch.h"
+#include "../../PSystem/PAABBTree/PAABBTree.h"
+#include <cfloat>
 
 enum ERenderStates
 {
@@ -26,6 +28,63 @@ enum EClasses
 	CONTROLLER
 };
 
+// How a ray query reports what it hits.
+enum ERaycastModes
+{
+	RAYCAST_CLOSEST = 0,		// Only the nearest hit.
+	RAYCAST_ANY = 1,			// The first hit found, which is not always the nearest. The cheapest mode, use it for line-of-sight checks.
+	RAYCAST_ALL = 2				// Every hit, nearest first.
+};
+
+// The kinds of object a ray query can hit. Combine them into a mask.
+enum ERaycastTypes
+{
+	RAYCAST_STATICMESH = (1 << 0),		// Plain PStaticMesh objects.
+	RAYCAST_SKELETALMESH = (1 << 1),	// PSkeletalMesh objects.
+	RAYCAST_CHARACTER = (1 << 2),		// PCharacter objects.
+	RAYCAST_ALLTYPES = 0xFF
+};
+
+// One ray (or segment) to test against the meshes in the world. The ray is Origin + (Direction * t) for 0 <= t <= MaxDistance. Direction does not need to be normalized, hit distances are measured in multiples of it.
+struct PRaycastQuery
+{
+	float3 Origin = { 0.0f, 0.0f, 0.0f };
+	float3 Direction = { 0.0f, 0.0f, 1.0f };
+	float MaxDistance = FLT_MAX;
+	ERaycastModes Mode = RAYCAST_CLOSEST;
+	unsigned int TypeMask = RAYCAST_ALLTYPES;				// ERaycastTypes that can be hit.
+	bool bVisibleOnly = true;								// Skip meshes that are hidden (or hidden in-game while playing).
+	PObject* IgnoreObjects[2] = { nullptr, nullptr };		// Objects the ray passes through, usually the caster and its target.
+	bool bTestTriangles = false;							// Test each static mesh's triangles rather than stopping at its bounding box. Skeletal meshes and characters still answer with their posed box, since their triangle hierarchy only holds the bind pose.
+
+	// A query for the segment From to To. Hit distances run from 0 at From to 1 at To.
+	static PRaycastQuery Segment(float3 From, float3 To, ERaycastModes InMode = RAYCAST_CLOSEST)
+	{
+		PRaycastQuery Query;
+		Query.Origin = From;
+		Query.Direction = (To - From);
+		Query.MaxDistance = 1.0f;
+		Query.Mode = InMode;
+		return Query;
+	}
+};
+
+// Where a ray entered a mesh's bounding box, or hit one of its triangles if the query asked for bTestTriangles and the mesh isn't skinned.
+struct PRaycastHit
+{
+	PStaticMesh* Mesh = nullptr;
+	float Distance = 0.0f;						// In multiples of the query's Direction. 0 if the ray started inside the box.
+	float3 Location = { 0.0f, 0.0f, 0.0f };
+	int Triangle = -1;							// The triangle hit (its first index is Triangle * 3), or -1 for a box hit.
+};
+
+// The hits belonging to one query: OutHits[FirstHit] to OutHits[FirstHit + HitCount - 1].
+struct PRaycastResult
+{
+	unsigned int FirstHit = 0;
+	unsigned int HitCount = 0;
+};
+
 // Used to define primitives.
 enum EPrimitives
 {
@@ -83,6 +142,12 @@ public:
 	std::vector<PController*> WorldControllers;		// All PControllers in the game world.
 	std::vector<PObject*> WorldObjects;				// All PObjects in the game world. This includes Meshes, Lights, and any other PObject derrived class.
 	std::vector<StopwatchCont> WorldStopwatches;	// All PStopwatch objects in the game world.
+	PAABBTree SpatialTree;							// World space bounds of every PStaticMesh (and derrived class) in the game world. The UserData of each proxy is the mesh.
+	std::vector<PAnim*> AnimationPhase;				// The ready animators gathered each Update() to advance and sample together. Reused between frames.
+	std::vector<PSkeletalMesh*> SkinningPhase;		// The skeletal meshes with ready animators, skinned together after AnimationPhase. Reused between frames.
+	PAnim::LODStats AnimationLODStats;				// How many animators ran at each level of detail in the last Update(), and how many were evaluated.
+	PAnim::InstancingStats AnimationInstancingStats;	// How many instanced poses the last Update() was asked for, and how many it evaluated.
+	uint64_t FrameNumber = 0;						// Counts calls to Update(). The renderer stamps each mesh it draws with it (PStaticMesh::LastDrawnFrame).
 	//
 	//
 
@@ -298,6 +363,26 @@ public:
 	// RETURN: No return value.
 	void CheckObjectCollisions();
 
+	// Remove an object from the spatial tree. Must be called before a mesh is deleted.
+	//
+	// RETURN: No return value.
+	void RemoveFromSpatialTree(PObject* Obj);
+
+	// Answer a batch of ray queries against the bounding boxes of the meshes in the spatial tree, or against their triangles for queries with bTestTriangles set. Queries are grouped into packets of 8 rays that walk the tree together, and large batches are split across the job system, so hundreds of queries can be submitted at once each frame. OutResults[i] holds the range of OutHits that answers Queries[i]. Closest and any-hit queries have at most one hit, all-hit queries have theirs sorted nearest first.
+	//
+	// RETURN: The number of queries that hit something.
+	size_t Raycast(const PRaycastQuery* Queries, size_t Count, std::vector<PRaycastResult>& OutResults, std::vector<PRaycastHit>& OutHits);
+
+	// Cast a single ray. An all-hit query reports only its nearest hit here.
+	//
+	// RETURN: True if the ray hit something, with the hit stored in OutHit.
+	bool Raycast(const PRaycastQuery& Query, PRaycastHit& OutHit);
+
+	// Check whether anything blocks the segment From to To. IgnoreA and IgnoreB are passed through, usually the object looking and the object being looked at.
+	//
+	// RETURN: True if the segment is clear.
+	bool HasLineOfSight(float3 From, float3 To, PObject* IgnoreA = nullptr, PObject* IgnoreB = nullptr, unsigned int TypeMask = RAYCAST_ALLTYPES);
+
 	// Create a document for a new custom class.
 	//
 	// RETURN: No return value.
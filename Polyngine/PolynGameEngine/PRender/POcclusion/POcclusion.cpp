@@ -0,0 +1,516 @@
+#include "POcclusion.h"
+#include "../../PSystem/PJobs/PJobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace PMath;
+
+namespace
+{
+	// Vertices closer to the camera plane than this are treated as crossing it.
+	constexpr float NearW = 1e-5f;
+
+	static_assert(((POcclusionCuller::TileWidth % POcclusionCuller::CoarseBlockSize) == 0) && ((POcclusionCuller::TileHeight % POcclusionCuller::CoarseBlockSize) == 0), "Tiles must hold whole coarse blocks.");
+	static_assert((POcclusionCuller::CoarseBlockSize % POcclusionCuller::BlockSize) == 0, "Coarse blocks must hold whole blocks.");
+
+	// Clamp a screen coordinate to [0, Limit]. Converting a float that doesn't fit in an int is undefined, and projected
+	// points close to the camera plane can land far off screen.
+	float ClampToScreen(float Value, int Limit)
+	{
+		return fminf(fmaxf(Value, 0.0f), (float)Limit);
+	}
+
+	// Multiply two row-vector matrices (A then B).
+	float4x4_a Multiply(const float4x4_a& A, const float4x4_a& B)
+	{
+		float4x4_a Result;
+
+		for (int Row = 0; Row < 4; ++Row)
+		{
+			for (int Col = 0; Col < 4; ++Col)
+			{
+				Result[Row][Col] = (A[Row][0] * B[0][Col]) + (A[Row][1] * B[1][Col]) + (A[Row][2] * B[2][Col]) + (A[Row][3] * B[3][Col]);
+			}
+		}
+
+		return Result;
+	}
+
+	// Transform a point (w = 1) by a row-vector matrix.
+	float4 TransformPoint(const float3& Point, const float4x4_a& Matrix)
+	{
+		float4 Result;
+
+		for (int Col = 0; Col < 4; ++Col)
+		{
+			Result[Col] = (Point.x * Matrix[0][Col]) + (Point.y * Matrix[1][Col]) + (Point.z * Matrix[2][Col]) + Matrix[3][Col];
+		}
+
+		return Result;
+	}
+}
+
+POcclusionCuller::POcclusionCuller()
+{
+	Depth.assign((size_t)(Width * Height), 1.0f);
+	BlockMaxDepth.assign((size_t)(BlocksX * BlocksY), 1.0f);
+	CoarseBlockMaxDepth.assign((size_t)(CoarseBlocksX * CoarseBlocksY), 1.0f);
+	Bins.resize((size_t)(TilesX * TilesY));
+}
+
+// Start a new frame. Clears the depth buffer, the queued occluders, and the stats.
+void POcclusionCuller::BeginFrame(const float4x4_a& InViewProjection)
+{
+	ViewProjection = InViewProjection;
+	Occluders.clear();
+	Stats = PStats();
+	bHasOccluders = false;
+}
+
+// Queue an occluder. Positions are in model space and World moves them into world space. The vertex and index data is
+// not copied, so it must stay alive until Rasterize() has returned.
+void POcclusionCuller::AddOccluder(const Vertex* Vertices, const int* Indices, size_t IndexCount, const float4x4_a& World)
+{
+	if (!Vertices || !Indices || (IndexCount < 3))
+	{
+		return;
+	}
+
+	Occluders.push_back({ Vertices, Indices, (IndexCount / 3), Multiply(World, ViewProjection) });
+	++Stats.Occluders;
+}
+
+// Transform, bin, and rasterize every queued occluder, then build the block depths used by IsVisible().
+void POcclusionCuller::Rasterize(PSimdLevel Level)
+{
+	if (Occluders.empty())
+	{
+		return;
+	}
+
+	std::fill(Depth.begin(), Depth.end(), 1.0f);
+	std::fill(BlockMaxDepth.begin(), BlockMaxDepth.end(), 1.0f);
+	std::fill(CoarseBlockMaxDepth.begin(), CoarseBlockMaxDepth.end(), 1.0f);
+
+	// Number every occluder triangle so the setup can be split evenly across threads.
+	OccluderFirstTriangle.resize(Occluders.size() + 1);
+	OccluderFirstTriangle[0] = 0;
+	for (size_t i = 0; i < Occluders.size(); ++i)
+	{
+		OccluderFirstTriangle[i + 1] = (OccluderFirstTriangle[i] + Occluders[i].TriangleCount);
+	}
+
+	Triangles.resize(OccluderFirstTriangle.back());
+
+	PJobs::ParallelFor(Triangles.size(), 256, [this](size_t Begin, size_t End)
+	{
+		size_t OccluderIndex = (std::upper_bound(OccluderFirstTriangle.begin(), OccluderFirstTriangle.end(), Begin) - OccluderFirstTriangle.begin()) - 1;
+
+		for (size_t i = Begin; i < End; ++i)
+		{
+			while (i >= OccluderFirstTriangle[OccluderIndex + 1])
+			{
+				++OccluderIndex;
+			}
+
+			SetupTriangle(Occluders[OccluderIndex], (i - OccluderFirstTriangle[OccluderIndex]), Triangles[i]);
+		}
+	});
+
+	// Bin the triangles into every tile their bounds touch.
+	for (std::vector<unsigned int>& Bin : Bins)
+	{
+		Bin.clear();
+	}
+
+	for (unsigned int i = 0; i < (unsigned int)Triangles.size(); ++i)
+	{
+		const PTriangle& Tri = Triangles[i];
+		if (!Tri.bValid)
+		{
+			continue;
+		}
+
+		++Stats.OccluderTriangles;
+
+		for (int TileY = (Tri.MinY / TileHeight); TileY <= (Tri.MaxY / TileHeight); ++TileY)
+		{
+			for (int TileX = (Tri.MinX / TileWidth); TileX <= (Tri.MaxX / TileWidth); ++TileX)
+			{
+				Bins[(TileY * TilesX) + TileX].push_back(i);
+			}
+		}
+	}
+
+	// Tiles don't share pixels, so each one can be rasterized on its own thread.
+	PJobs::ParallelFor(Bins.size(), 1, [this, Level](size_t Begin, size_t End)
+	{
+		for (size_t i = Begin; i < End; ++i)
+		{
+			RasterizeTile((int)i, Level);
+		}
+	});
+
+	bHasOccluders = true;
+}
+
+// Test a world space box against the rasterized occluders.
+//
+// RETURN: False only if the box is certainly hidden behind the occluders.
+bool POcclusionCuller::IsVisible(const PAABB& Box)
+{
+	++Stats.Tested;
+
+	if (!bHasOccluders)
+	{
+		return true;
+	}
+
+	// Project the 8 corners and find the screen rectangle and nearest depth of the box.
+	float MinX = FLT_MAX;
+	float MinY = FLT_MAX;
+	float MaxX = -FLT_MAX;
+	float MaxY = -FLT_MAX;
+	float MinZ = FLT_MAX;
+
+	for (int Corner = 0; Corner < 8; ++Corner)
+	{
+		float3 Point = { (Box.Center.x + ((Corner & 1) ? Box.Extents.x : -Box.Extents.x)),
+						 (Box.Center.y + ((Corner & 2) ? Box.Extents.y : -Box.Extents.y)),
+						 (Box.Center.z + ((Corner & 4) ? Box.Extents.z : -Box.Extents.z)) };
+
+		float4 Clip = TransformPoint(Point, ViewProjection);
+
+		// Boxes that reach the camera plane can't be tested reliably.
+		if (Clip.w <= NearW)
+		{
+			return true;
+		}
+
+		float InvW = (1.0f / Clip.w);
+		float ScreenX = (((Clip.x * InvW) * 0.5f) + 0.5f) * Width;
+		float ScreenY = (0.5f - ((Clip.y * InvW) * 0.5f)) * Height;
+
+		MinX = fminf(MinX, ScreenX);
+		MaxX = fmaxf(MaxX, ScreenX);
+		MinY = fminf(MinY, ScreenY);
+		MaxY = fmaxf(MaxY, ScreenY);
+		MinZ = fminf(MinZ, (Clip.z * InvW));
+	}
+
+	// Leave boxes that are off screen, or in front of the near plane, to the frustum test.
+	if ((MinZ < 0.0f) || (MaxX < 0.0f) || (MaxY < 0.0f) || (MinX >= Width) || (MinY >= Height))
+	{
+		return true;
+	}
+
+	int BlockX0 = ((int)floorf(ClampToScreen(MinX, (Width - 1))) / BlockSize);
+	int BlockY0 = ((int)floorf(ClampToScreen(MinY, (Height - 1))) / BlockSize);
+	int BlockX1 = ((int)ceilf(ClampToScreen(MaxX, (Width - 1))) / BlockSize);
+	int BlockY1 = ((int)ceilf(ClampToScreen(MaxY, (Height - 1))) / BlockSize);
+
+	// A coarse block the box is farther than hides the box everywhere inside it. Only the others need their blocks read.
+	for (int CoarseY = (BlockY0 / BlocksPerCoarseBlock); CoarseY <= (BlockY1 / BlocksPerCoarseBlock); ++CoarseY)
+	{
+		for (int CoarseX = (BlockX0 / BlocksPerCoarseBlock); CoarseX <= (BlockX1 / BlocksPerCoarseBlock); ++CoarseX)
+		{
+			if (MinZ > CoarseBlockMaxDepth[(CoarseY * CoarseBlocksX) + CoarseX])
+			{
+				continue;
+			}
+
+			int InnerX0 = std::max(BlockX0, (CoarseX * BlocksPerCoarseBlock));
+			int InnerY0 = std::max(BlockY0, (CoarseY * BlocksPerCoarseBlock));
+			int InnerX1 = std::min(BlockX1, (((CoarseX + 1) * BlocksPerCoarseBlock) - 1));
+			int InnerY1 = std::min(BlockY1, (((CoarseY + 1) * BlocksPerCoarseBlock) - 1));
+
+			for (int BlockY = InnerY0; BlockY <= InnerY1; ++BlockY)
+			{
+				for (int BlockX = InnerX0; BlockX <= InnerX1; ++BlockX)
+				{
+					if (MinZ <= BlockMaxDepth[(BlockY * BlocksX) + BlockX])
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	++Stats.Culled;
+	return false;
+}
+
+// Project and set up triangle TriangleIndex of Occluder.
+void POcclusionCuller::SetupTriangle(const POccluder& Occluder, size_t TriangleIndex, PTriangle& Out) const
+{
+	Out.bValid = false;
+
+	const int* Index = (Occluder.Indices + (TriangleIndex * 3));
+
+	float X[3];
+	float Y[3];
+	float Z[3];
+
+	for (int i = 0; i < 3; ++i)
+	{
+		float4 Clip = TransformPoint(Occluder.Vertices[Index[i]].Position, Occluder.WorldViewProjection);
+
+		// Triangles crossing the near plane are dropped. Losing an occluder triangle can only make culling less aggressive.
+		if (Clip.w <= NearW)
+		{
+			return;
+		}
+
+		float InvW = (1.0f / Clip.w);
+		X[i] = (((Clip.x * InvW) * 0.5f) + 0.5f) * Width;
+		Y[i] = (0.5f - ((Clip.y * InvW) * 0.5f)) * Height;
+		Z[i] = (Clip.z * InvW);
+
+		if (Z[i] < 0.0f)
+		{
+			return;
+		}
+	}
+
+	float Area = ((X[1] - X[0]) * (Y[2] - Y[0])) - ((X[2] - X[0]) * (Y[1] - Y[0]));
+	if (fabsf(Area) < 1e-6f)
+	{
+		return;
+	}
+
+	float MinX = fminf(X[0], fminf(X[1], X[2]));
+	float MinY = fminf(Y[0], fminf(Y[1], Y[2]));
+	float MaxX = fmaxf(X[0], fmaxf(X[1], X[2]));
+	float MaxY = fmaxf(Y[0], fmaxf(Y[1], Y[2]));
+
+	if ((MaxX < 0.0f) || (MaxY < 0.0f) || (MinX >= Width) || (MinY >= Height))
+	{
+		return;
+	}
+
+	Out.MinX = (int)floorf(ClampToScreen(MinX, (Width - 1)));
+	Out.MinY = (int)floorf(ClampToScreen(MinY, (Height - 1)));
+	Out.MaxX = (int)ceilf(ClampToScreen(MaxX, (Width - 1)));
+	Out.MaxY = (int)ceilf(ClampToScreen(MaxY, (Height - 1)));
+
+	// Edge i runs from vertex i to vertex i + 1. Flip the signs for clockwise triangles so inside is always positive.
+	float Sign = (Area > 0.0f) ? 1.0f : -1.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		int Next = ((i + 1) % 3);
+
+		Out.EdgeA[i] = Sign * (Y[i] - Y[Next]);
+		Out.EdgeB[i] = Sign * (X[Next] - X[i]);
+		Out.EdgeC[i] = Sign * ((X[i] * Y[Next]) - (X[Next] * Y[i]));
+	}
+
+	// Depth is linear in screen space, so it can be stored as a plane.
+	float InvArea = (1.0f / Area);
+	Out.DepthA = (((Z[1] - Z[0]) * (Y[2] - Y[0])) - ((Z[2] - Z[0]) * (Y[1] - Y[0]))) * InvArea;
+	Out.DepthB = (((X[1] - X[0]) * (Z[2] - Z[0])) - ((X[2] - X[0]) * (Z[1] - Z[0]))) * InvArea;
+	Out.DepthC = Z[0] - (Out.DepthA * X[0]) - (Out.DepthB * Y[0]);
+
+	Out.bValid = true;
+}
+
+// Rasterize every triangle binned into a tile and then refresh the block depths inside it.
+void POcclusionCuller::RasterizeTile(int TileIndex, PSimdLevel Level)
+{
+	const std::vector<unsigned int>& Bin = Bins[TileIndex];
+	if (Bin.empty())
+	{
+		return;
+	}
+
+	int TileX0 = ((TileIndex % TilesX) * TileWidth);
+	int TileY0 = ((TileIndex / TilesX) * TileHeight);
+	int TileX1 = (TileX0 + TileWidth - 1);
+	int TileY1 = (TileY0 + TileHeight - 1);
+
+	const PSimdPath Path = PSelectSimdPath(Level);
+
+	for (unsigned int TriangleIndex : Bin)
+	{
+		const PTriangle& Tri = Triangles[TriangleIndex];
+
+		int X0 = std::max(Tri.MinX, TileX0);
+		int X1 = std::min(Tri.MaxX, TileX1);
+		int Y0 = std::max(Tri.MinY, TileY0);
+		int Y1 = std::min(Tri.MaxY, TileY1);
+
+		switch (Path)
+		{
+#if defined(PMATH_AVX2_KERNELS)
+		case PSimdPath::AVX2:
+			RasterizeTriangleAVX2(Tri, X0, X1, Y0, Y1, Depth.data());
+			break;
+#endif
+#if defined(PMATH_SSE)
+		case PSimdPath::SSE:
+			RasterizeTriangleSSE(Tri, X0, X1, Y0, Y1, Depth.data());
+			break;
+#endif
+		default:
+			RasterizeTriangleScalar(Tri, X0, X1, Y0, Y1, Depth.data());
+			break;
+		}
+	}
+
+	// Keep the farthest depth of each 8x8 block. A box nearer than that is in front of everything in the block.
+	for (int BlockY = (TileY0 / BlockSize); BlockY <= (TileY1 / BlockSize); ++BlockY)
+	{
+		for (int BlockX = (TileX0 / BlockSize); BlockX <= (TileX1 / BlockSize); ++BlockX)
+		{
+			float MaxDepth = 0.0f;
+
+			for (int PixelY = (BlockY * BlockSize); PixelY < ((BlockY + 1) * BlockSize); ++PixelY)
+			{
+				const float* Row = (Depth.data() + (PixelY * Width) + (BlockX * BlockSize));
+
+				for (int PixelX = 0; PixelX < BlockSize; ++PixelX)
+				{
+					MaxDepth = fmaxf(MaxDepth, Row[PixelX]);
+				}
+			}
+
+			BlockMaxDepth[(BlockY * BlocksX) + BlockX] = MaxDepth;
+		}
+	}
+
+	// Then the farthest of each coarse block's blocks. Tiles hold whole coarse blocks, so this stays inside the tile.
+	for (int CoarseY = (TileY0 / CoarseBlockSize); CoarseY <= (TileY1 / CoarseBlockSize); ++CoarseY)
+	{
+		for (int CoarseX = (TileX0 / CoarseBlockSize); CoarseX <= (TileX1 / CoarseBlockSize); ++CoarseX)
+		{
+			float MaxDepth = 0.0f;
+
+			for (int BlockY = (CoarseY * BlocksPerCoarseBlock); BlockY < ((CoarseY + 1) * BlocksPerCoarseBlock); ++BlockY)
+			{
+				for (int BlockX = (CoarseX * BlocksPerCoarseBlock); BlockX < ((CoarseX + 1) * BlocksPerCoarseBlock); ++BlockX)
+				{
+					MaxDepth = fmaxf(MaxDepth, BlockMaxDepth[(BlockY * BlocksX) + BlockX]);
+				}
+			}
+
+			CoarseBlockMaxDepth[(CoarseY * CoarseBlocksX) + CoarseX] = MaxDepth;
+		}
+	}
+}
+
+// Rasterize the part of Tri inside [X0, X1] x [Y0, Y1] into Depth, keeping the nearest depth of each pixel.
+void POcclusionCuller::RasterizeTriangleScalar(const PTriangle& Tri, int X0, int X1, int Y0, int Y1, float* OutDepth)
+{
+	for (int PixelY = Y0; PixelY <= Y1; ++PixelY)
+	{
+		float CenterY = (PixelY + 0.5f);
+		float* Row = (OutDepth + (PixelY * Width));
+
+		for (int PixelX = X0; PixelX <= X1; ++PixelX)
+		{
+			float CenterX = (PixelX + 0.5f);
+
+			if ((((Tri.EdgeA[0] * CenterX) + ((Tri.EdgeB[0] * CenterY) + Tri.EdgeC[0])) >= 0.0f) &&
+				(((Tri.EdgeA[1] * CenterX) + ((Tri.EdgeB[1] * CenterY) + Tri.EdgeC[1])) >= 0.0f) &&
+				(((Tri.EdgeA[2] * CenterX) + ((Tri.EdgeB[2] * CenterY) + Tri.EdgeC[2])) >= 0.0f))
+			{
+				float PixelDepth = ((Tri.DepthA * CenterX) + ((Tri.DepthB * CenterY) + Tri.DepthC));
+				Row[PixelX] = fminf(Row[PixelX], PixelDepth);
+			}
+		}
+	}
+}
+
+#if defined(PMATH_SSE)
+// Rasterize the part of Tri inside [X0, X1] x [Y0, Y1] into Depth, keeping the nearest depth of each pixel.
+void POcclusionCuller::RasterizeTriangleSSE(const PTriangle& Tri, int X0, int X1, int Y0, int Y1, float* OutDepth)
+{
+	// 4 pixels per step. Tile widths are multiples of 4, so an aligned span never leaves the tile.
+	X0 &= ~3;
+
+	const __m128 Offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 A0 = _mm_set1_ps(Tri.EdgeA[0]);
+	const __m128 A1 = _mm_set1_ps(Tri.EdgeA[1]);
+	const __m128 A2 = _mm_set1_ps(Tri.EdgeA[2]);
+	const __m128 DA = _mm_set1_ps(Tri.DepthA);
+
+	for (int PixelY = Y0; PixelY <= Y1; ++PixelY)
+	{
+		float CenterY = (PixelY + 0.5f);
+		__m128 R0 = _mm_set1_ps((Tri.EdgeB[0] * CenterY) + Tri.EdgeC[0]);
+		__m128 R1 = _mm_set1_ps((Tri.EdgeB[1] * CenterY) + Tri.EdgeC[1]);
+		__m128 R2 = _mm_set1_ps((Tri.EdgeB[2] * CenterY) + Tri.EdgeC[2]);
+		__m128 RZ = _mm_set1_ps((Tri.DepthB * CenterY) + Tri.DepthC);
+
+		float* Row = (OutDepth + (PixelY * Width));
+
+		for (int PixelX = X0; PixelX <= X1; PixelX += 4)
+		{
+			__m128 CenterX = _mm_add_ps(_mm_set1_ps((float)PixelX), Offsets);
+
+			__m128 Inside = _mm_and_ps(_mm_and_ps(
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(A0, CenterX), R0), Zero),
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(A1, CenterX), R1), Zero)),
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(A2, CenterX), R2), Zero));
+
+			if (_mm_movemask_ps(Inside) == 0)
+			{
+				continue;
+			}
+
+			__m128 PixelDepth = _mm_add_ps(_mm_mul_ps(DA, CenterX), RZ);
+			__m128 Current = _mm_load_ps(Row + PixelX);
+			__m128 Nearer = _mm_min_ps(Current, PixelDepth);
+			_mm_store_ps((Row + PixelX), _mm_or_ps(_mm_and_ps(Inside, Nearer), _mm_andnot_ps(Inside, Current)));
+		}
+	}
+}
+#endif
+
+#if defined(PMATH_AVX2_KERNELS)
+// Rasterize the part of Tri inside [X0, X1] x [Y0, Y1] into Depth, keeping the nearest depth of each pixel.
+PMATH_AVX2_TARGET void POcclusionCuller::RasterizeTriangleAVX2(const PTriangle& Tri, int X0, int X1, int Y0, int Y1, float* OutDepth)
+{
+	// 8 pixels per step. Tile widths are multiples of 8, so an aligned span never leaves the tile.
+	X0 &= ~7;
+
+	const __m256 Offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 Zero = _mm256_setzero_ps();
+	const __m256 A0 = _mm256_set1_ps(Tri.EdgeA[0]);
+	const __m256 A1 = _mm256_set1_ps(Tri.EdgeA[1]);
+	const __m256 A2 = _mm256_set1_ps(Tri.EdgeA[2]);
+	const __m256 DA = _mm256_set1_ps(Tri.DepthA);
+
+	for (int PixelY = Y0; PixelY <= Y1; ++PixelY)
+	{
+		float CenterY = (PixelY + 0.5f);
+		__m256 R0 = _mm256_set1_ps((Tri.EdgeB[0] * CenterY) + Tri.EdgeC[0]);
+		__m256 R1 = _mm256_set1_ps((Tri.EdgeB[1] * CenterY) + Tri.EdgeC[1]);
+		__m256 R2 = _mm256_set1_ps((Tri.EdgeB[2] * CenterY) + Tri.EdgeC[2]);
+		__m256 RZ = _mm256_set1_ps((Tri.DepthB * CenterY) + Tri.DepthC);
+
+		float* Row = (OutDepth + (PixelY * Width));
+
+		for (int PixelX = X0; PixelX <= X1; PixelX += 8)
+		{
+			__m256 CenterX = _mm256_add_ps(_mm256_set1_ps((float)PixelX), Offsets);
+
+			__m256 Inside = _mm256_and_ps(_mm256_and_ps(
+				_mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(A0, CenterX), R0), Zero, _CMP_GE_OQ),
+				_mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(A1, CenterX), R1), Zero, _CMP_GE_OQ)),
+				_mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(A2, CenterX), R2), Zero, _CMP_GE_OQ));
+
+			if (_mm256_movemask_ps(Inside) == 0)
+			{
+				continue;
+			}
+
+			__m256 PixelDepth = _mm256_add_ps(_mm256_mul_ps(DA, CenterX), RZ);
+			__m256 Current = _mm256_load_ps(Row + PixelX);
+			_mm256_store_ps((Row + PixelX), _mm256_blendv_ps(Current, _mm256_min_ps(Current, PixelDepth), Inside));
+		}
+	}
+}
+#endif
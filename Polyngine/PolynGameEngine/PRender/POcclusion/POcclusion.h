@@ -0,0 +1,125 @@
+#pragma once
+
+#include "../../PMath/PMath.h"
+#include "../../PMath/PSimd.h"
+#include <vector>
+
+// CPU occlusion culling.
+//
+// A small set of designated occluder meshes is rasterized on the CPU into a low resolution depth buffer. The screen is split
+// into tiles, triangles are binned into the tiles they touch, and the tiles are rasterized in parallel with SSE/AVX2. The
+// AVX2 path is chosen at runtime when the CPU has it, as with the PTransform kernels.
+//
+// The buffer keeps a two level depth hierarchy: the farthest depth of each 8x8 block, and the farthest of those in each
+// 32x32 block. Candidate bounds are tested against the 32x32 blocks they cover, and only go down to the 8x8 blocks inside
+// the ones that can't hide them. A box is only culled when it is farther than every block it covers, so the test is
+// conservative.
+//
+// Nothing here touches the GPU, so the culler can be driven and checked without a device or a window.
+class POcclusionCuller
+{
+public:
+	// Depth buffer layout. The tile sizes must be multiples of CoarseBlockSize, which must be a multiple of BlockSize.
+	static constexpr int Width = 256;
+	static constexpr int Height = 128;
+	static constexpr int TileWidth = 64;
+	static constexpr int TileHeight = 32;
+	static constexpr int BlockSize = 8;
+	static constexpr int CoarseBlockSize = 32;
+
+	static constexpr int TilesX = (Width / TileWidth);
+	static constexpr int TilesY = (Height / TileHeight);
+	static constexpr int BlocksX = (Width / BlockSize);
+	static constexpr int BlocksY = (Height / BlockSize);
+	static constexpr int CoarseBlocksX = (Width / CoarseBlockSize);
+	static constexpr int CoarseBlocksY = (Height / CoarseBlockSize);
+	static constexpr int BlocksPerCoarseBlock = (CoarseBlockSize / BlockSize);
+
+	// Counters for the current frame.
+	struct PStats
+	{
+		unsigned int Occluders = 0;				// Occluders added this frame.
+		unsigned int OccluderTriangles = 0;		// Occluder triangles that reached the rasterizer.
+		unsigned int Tested = 0;				// Boxes tested against the depth buffer.
+		unsigned int Culled = 0;				// Boxes found to be hidden.
+	};
+
+	POcclusionCuller();
+
+	// Start a new frame. Clears the depth buffer, the queued occluders, and the stats.
+	void BeginFrame(const PMath::float4x4_a& ViewProjection);
+
+	// Queue an occluder. Positions are in model space and World moves them into world space. The vertex and index data is
+	// not copied, so it must stay alive until Rasterize() has returned.
+	void AddOccluder(const PMath::Vertex* Vertices, const int* Indices, size_t IndexCount, const PMath::float4x4_a& World);
+
+	// Transform, bin, and rasterize every queued occluder, then build the block depths used by IsVisible(). Level lowers
+	// the widest path the rasterizer may use (the benchmarks use it to compare paths), it is never raised above what the
+	// CPU supports.
+	void Rasterize(PMath::PSimdLevel Level = PMath::PSimdLevel::AVX2);
+
+	// Test a world space box against the rasterized occluders.
+	//
+	// RETURN: False only if the box is certainly hidden behind the occluders.
+	bool IsVisible(const PMath::PAABB& Box);
+
+	// Return the counters for the current frame.
+	const PStats& GetStats() const { return Stats; }
+
+	// Return the depth buffer (Width * Height floats, row major, 1.0 is the far plane).
+	const float* GetDepthBuffer() const { return Depth.data(); }
+
+private:
+	struct POccluder
+	{
+		const PMath::Vertex* Vertices;
+		const int* Indices;
+		size_t TriangleCount;
+		PMath::float4x4_a WorldViewProjection;
+	};
+
+	// A screen space triangle ready for rasterization. Each edge function (A * x + B * y + C) is positive inside the
+	// triangle, and the depth is the plane DepthA * x + DepthB * y + DepthC, all in pixel coordinates.
+	struct PTriangle
+	{
+		float EdgeA[3];
+		float EdgeB[3];
+		float EdgeC[3];
+		float DepthA;
+		float DepthB;
+		float DepthC;
+		int MinX;
+		int MinY;
+		int MaxX;
+		int MaxY;
+		bool bValid;
+	};
+
+	PMath::float4x4_a ViewProjection;
+	std::vector<POccluder> Occluders;
+	std::vector<size_t> OccluderFirstTriangle;
+	std::vector<PTriangle> Triangles;
+	std::vector<std::vector<unsigned int>> Bins;
+	std::vector<float, PMath::PAlignedAllocator<float, 32>> Depth;
+	std::vector<float> BlockMaxDepth;
+	std::vector<float> CoarseBlockMaxDepth;
+	bool bHasOccluders = false;
+
+	PStats Stats;
+
+	// Project and set up triangle TriangleIndex of Occluder.
+	void SetupTriangle(const POccluder& Occluder, size_t TriangleIndex, PTriangle& Out) const;
+
+	// Rasterize every triangle binned into a tile and then refresh the block depths inside it.
+	void RasterizeTile(int TileIndex, PMath::PSimdLevel Level);
+
+	// Rasterize the part of Tri inside [X0, X1] x [Y0, Y1] into Depth, keeping the nearest depth of each pixel. The SSE
+	// and AVX2 paths step 4 and 8 pixels at a time from X0 rounded down to their width.
+	static void RasterizeTriangleScalar(const PTriangle& Tri, int X0, int X1, int Y0, int Y1, float* Depth);
+#if defined(PMATH_SSE)
+	static void RasterizeTriangleSSE(const PTriangle& Tri, int X0, int X1, int Y0, int Y1, float* Depth);
+#endif
+#if defined(PMATH_AVX2_KERNELS)
+	PMATH_AVX2_TARGET static void RasterizeTriangleAVX2(const PTriangle& Tri, int X0, int X1, int Y0, int Y1, float* Depth);
+#endif
+};
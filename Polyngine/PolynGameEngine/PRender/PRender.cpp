@@ -1,6 +1,8 @@
 #include "PRender.h"
 #include "wrl/client.h"
 #include "../PStatics/PGameplayStatics/PGameplayStatics.h"
+#include "../PSystem/PBenchmark/PBenchmark.h"
+#include "../PSystem/PAnimation/PAnimFile/PAnimFile.h"
 #include <sstream>
 
 #define IDM_NEW 100
@@ -94,14 +96,12 @@ namespace Renderer
 			DrawGrid(500, GUI_Color_DebugGrid);
 		}
 
-		std::vector<PObject*> WorldObjects = Environment.WorldObjects;
-
 		PCamera* ActiveCamera = Environment.GetActiveCamera();
 
 		// Only draw objects if a render camera is present.
 		if (ActiveCamera)
 		{
-			PMath::view_t View = ActiveCamera->GetWorld();
+			const PViewContext& ViewContext = ActiveCamera->GetViewContext();
 
 			const PMath::float4 Black{ 0.0f, 0.0f, 0.0f, 1.0f };
 
@@ -123,8 +123,8 @@ namespace Renderer
 			ZeroMemory(&MVP, sizeof(MVP));
 
 			MVP.Model = XMMatrixTranspose(XMMatrixIdentity());
-			MVP.Projection = XMMatrixTranspose((XMMATRIX&)View.ProjectionMatrix);
-			MVP.View = XMMatrixTranspose(XMMatrixInverse(nullptr, (XMMATRIX&)View.ViewMatrix));
+			MVP.Projection = XMMatrixTranspose((const XMMATRIX&)ViewContext.Projection);
+			MVP.View = XMMatrixTranspose((const XMMATRIX&)ViewContext.View);
 			MVP.DirLightIntensity = Sunlight ? Sunlight->GetIntensity() : 0.0f;
 			MVP.DirLightDir = Sunlight ? Sunlight->GetRotation() : float3{ 0.0f, 0.0f, 0.0f };
 			MVP.DirLightClr = Sunlight ? Sunlight->GetColor() : float4{ 0.0f, 0.0f, 0.0f, 0.0f };
@@ -174,58 +174,99 @@ namespace Renderer
 			Context->IASetInputLayout(InputLayout_GeneralShaders);
 			Context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-			// Draw the world objects that exist.
-			for (unsigned int i = 0; i < Environment.WorldObjects.size(); ++i)
+			// Ask the spatial tree for the drawable static meshes whose (fattened) bounds touch the frustum, then cull their tight
+			// bounds in one batch.
+			CullBounds.Clear();
+			CullMeshes.clear();
+
+			Environment.SpatialTree.QueryFrustum(ViewContext.Frustum, [&](int ProxyId)
 			{
-				if (Environment.WorldObjects[i] && Environment.WorldObjects[i]->GetVisibility() && ((Environment.CurrentState == ERenderStates::DEBUG) || (!Environment.WorldObjects[i]->GetHiddenInGame())))
+				PStaticMesh* SMesh = static_cast<PStaticMesh*>(Environment.SpatialTree.GetUserData(ProxyId));
+
+				if (SMesh->GetVisibility() && ((Environment.CurrentState == ERenderStates::DEBUG) || (!SMesh->GetHiddenInGame())))
 				{
-					// Ensure the World Object is able to cast to a StaticMesh.
-					PStaticMesh* SMesh = dynamic_cast<PStaticMesh*>(Environment.WorldObjects[i]);
+					CullBounds.Add(SMesh->Col_BoundingBox);
+					CullMeshes.push_back(SMesh);
+				}
+
+				return true;
+			});
 
-					// Ensure the World Object has been casted and is not nullptr before setting up and drawing it.
-					if (SMesh)
+			CullVisible.resize(CullMeshes.size());
+			size_t VisibleCount = PCullAABBsToFrustumIndices(CullBounds, ViewContext.Frustum, CullVisible.data());
+
+			// Rasterize the visible occluders on the CPU and drop every other mesh that is hidden behind them.
+			if (bFlag_OcclusionCulling)
+			{
+				OcclusionCuller.BeginFrame(ViewContext.ViewProjection);
+
+				for (size_t i = 0; i < VisibleCount; ++i)
+				{
+					PStaticMesh* SMesh = CullMeshes[CullVisible[i]];
+
+					if (SMesh->bIsOccluder)
 					{
-						RECT ClientRectangle;
-						GetClientRect(hwnd, &ClientRectangle);
+						OcclusionCuller.AddOccluder(SMesh->Vertices.data(), SMesh->Indices.data(), SMesh->Indices.size(), SMesh->GetWorld().ViewMatrix);
+					}
+				}
 
-						XMMATRIX Proj_Mat = DirectX::XMMatrixPerspectiveFovLH(PDegrees_Radians(ActiveCamera->GetFieldOfView()), ((float)ClientRectangle.right / (float)ClientRectangle.bottom), 1.0f, 1000.0f);
+				OcclusionCuller.Rasterize();
 
-						view_t NewView = View;
-						NewView.ProjectionMatrix = (float4x4_a&)Proj_Mat;
-						NewView.ViewMatrix = (float4x4_a&)(XMMatrixInverse(0, (XMMATRIX&)View.ViewMatrix));
+				size_t Kept = 0;
+				for (size_t i = 0; i < VisibleCount; ++i)
+				{
+					PStaticMesh* SMesh = CullMeshes[CullVisible[i]];
 
-						if (PAABBToFrustum(SMesh->Col_BoundingBox, PCalculateFrustum(NewView, ClientRectangle.right, ClientRectangle.bottom)))
-						{
-							MeshStrides = sizeof(Vertex);
-							Offset = 0;
-							Context->IASetVertexBuffers(0, 1, { &SMesh->VertexBuffer }, &MeshStrides, &Offset);
-							Context->IASetIndexBuffer(SMesh->IndexBuffer, DXGI_FORMAT_R32_UINT, 0);
-
-							MVP.Model = (XMMATRIX&)Environment.WorldObjects[i]->GetWorld().ViewMatrix;
-							MVP.View = XMMatrixInverse(0, (XMMATRIX&)View.ViewMatrix);
-							MVP.Projection = (XMMATRIX&)View.ProjectionMatrix;
-							MVP.ObjSelected = (((Environment.SelectedObject != nullptr) && (Environment.SelectedObject->GetDisplayName() == WorldObjects[i]->GetDisplayName()) && (Environment.CurrentState == ERenderStates::DEBUG)) ? 1.0f : 0.0f);
-							MVP.HighlightedObjClr = GUI_Color_SeletedObjectHighlight;
-							MVP.BaseSpecular = { SMesh->Material.Specular[0], SMesh->Material.Specular[0], SMesh->Material.Specular[0], SMesh->Material.Specular[0] };
-							MVP.BaseEmissive = { SMesh->Material.Emissive[0], SMesh->Material.Emissive[1], SMesh->Material.Emissive[2], SMesh->Material.Emissive[3] };
-							MVP.bHasEmissiveTex = SMesh->Emissive_DDSFile != "" ? 1.0f : 0.0f;
-							MVP.bHasSpecularTex = SMesh->Specular_DDSFile != "" ? 1.0f : 0.0f;
-
-							Context->UpdateSubresource(ConstantBuffer, 0, NULL, &MVP, 0, 0);
-
-							Context->VSSetShader(VS_ShadedGeneral, nullptr, 0);
-							Context->VSSetConstantBuffers(0, 1, &ConstantBuffer);
-							Context->PSSetShader(PS_ShadedGeneral, nullptr, 0);
-							Context->PSSetConstantBuffers(0, 1, &ConstantBuffer);
-							Context->PSSetSamplers(0, 1, &LinearSamplerState);
-							Context->PSSetShaderResources(0, 1, &SMesh->D_ShaderResourceView);
-							Context->PSSetShaderResources(1, 1, &SMesh->E_ShaderResourceView);
-							Context->PSSetShaderResources(2, 1, &SMesh->S_ShaderResourceView);
-
-							Context->DrawIndexed(SMesh->Indices.size(), 0, 0);
-						}
+					if (SMesh->bIsOccluder || OcclusionCuller.IsVisible(SMesh->Col_BoundingBox))
+					{
+						CullVisible[Kept++] = CullVisible[i];
 					}
 				}
+
+				VisibleCount = Kept;
+			}
+
+			// Draw the world objects that survived culling.
+			for (size_t i = 0; i < VisibleCount; ++i)
+			{
+				PStaticMesh* SMesh = CullMeshes[CullVisible[i]];
+				SMesh->LastDrawnFrame = Environment.FrameNumber;
+
+				// Skeletal meshes draw their skinned copy of the mesh while an animation is ready.
+				ID3D11Buffer* MeshVertexBuffer = SMesh->VertexBuffer;
+				PSkeletalMesh* SkelMesh = dynamic_cast<PSkeletalMesh*>(SMesh);
+				if (SkelMesh != nullptr)
+				{
+					MeshVertexBuffer = SkelMesh->GetDrawVertexBuffer(Context);
+				}
+
+				MeshStrides = sizeof(Vertex);
+				Offset = 0;
+				Context->IASetVertexBuffers(0, 1, &MeshVertexBuffer, &MeshStrides, &Offset);
+				Context->IASetIndexBuffer(SMesh->IndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+				MVP.Model = (XMMATRIX&)SMesh->GetWorld().ViewMatrix;
+				MVP.View = (const XMMATRIX&)ViewContext.View;
+				MVP.Projection = (const XMMATRIX&)ViewContext.Projection;
+				MVP.ObjSelected = (((Environment.SelectedObject != nullptr) && (Environment.SelectedObject->GetDisplayName() == SMesh->GetDisplayName()) && (Environment.CurrentState == ERenderStates::DEBUG)) ? 1.0f : 0.0f);
+				MVP.HighlightedObjClr = GUI_Color_SeletedObjectHighlight;
+				MVP.BaseSpecular = { SMesh->Material.Specular[0], SMesh->Material.Specular[0], SMesh->Material.Specular[0], SMesh->Material.Specular[0] };
+				MVP.BaseEmissive = { SMesh->Material.Emissive[0], SMesh->Material.Emissive[1], SMesh->Material.Emissive[2], SMesh->Material.Emissive[3] };
+				MVP.bHasEmissiveTex = SMesh->Emissive_DDSFile != "" ? 1.0f : 0.0f;
+				MVP.bHasSpecularTex = SMesh->Specular_DDSFile != "" ? 1.0f : 0.0f;
+
+				Context->UpdateSubresource(ConstantBuffer, 0, NULL, &MVP, 0, 0);
+
+				Context->VSSetShader(VS_ShadedGeneral, nullptr, 0);
+				Context->VSSetConstantBuffers(0, 1, &ConstantBuffer);
+				Context->PSSetShader(PS_ShadedGeneral, nullptr, 0);
+				Context->PSSetConstantBuffers(0, 1, &ConstantBuffer);
+				Context->PSSetSamplers(0, 1, &LinearSamplerState);
+				Context->PSSetShaderResources(0, 1, &SMesh->D_ShaderResourceView);
+				Context->PSSetShaderResources(1, 1, &SMesh->E_ShaderResourceView);
+				Context->PSSetShaderResources(2, 1, &SMesh->S_ShaderResourceView);
+
+				Context->DrawIndexed(SMesh->Indices.size(), 0, 0);
 			}
 		}
 		else
@@ -245,14 +286,44 @@ namespace Renderer
 
 	void PRender::Draw()
 	{
-		if (GUI_Pref_UnselectOnHover && Environment.InputManager->IsInputDown(PInputManager::PInputMap::PIN_MOUSE_L) && ((Environment.CurrentState == ERenderStates::SHIP) || !(ImGui::GetIO().WantCaptureKeyboard || ImGui::GetIO().WantCaptureMouse)))
+		if (Environment.InputManager->IsInputDown(PInputManager::PInputMap::PIN_MOUSE_L) && ((Environment.CurrentState == ERenderStates::SHIP) || !(ImGui::GetIO().WantCaptureKeyboard || ImGui::GetIO().WantCaptureMouse)))
 		{
-			Environment.SelectedObject = nullptr;
+			// In the editor, clicking the viewport selects the mesh under the cursor.
+			PObject* Picked = (Environment.CurrentState == ERenderStates::DEBUG) ? PickObject(ImGui::GetIO().MousePos.x, ImGui::GetIO().MousePos.y) : nullptr;
+
+			if (Picked)
+			{
+				Environment.SelectedObject = Picked;
+			}
+			else if (GUI_Pref_UnselectOnHover)
+			{
+				Environment.SelectedObject = nullptr;
+			}
 		}
 
 		DrawView();
 	}
 
+	// Cast a ray from the active camera through a pixel of the viewport and return the nearest visible mesh it hits.
+	PObject* PRender::PickObject(float x, float y)
+	{
+		PCamera* ActiveCamera = Environment.GetActiveCamera();
+
+		if (!ActiveCamera || (Viewport.Width <= 0.0f) || (Viewport.Height <= 0.0f))
+		{
+			return nullptr;
+		}
+
+		PRaycastQuery Query;
+		Query.Mode = RAYCAST_CLOSEST;
+		Query.MaxDistance = 1.0f;
+		Query.bTestTriangles = true;
+		PScreenPointToRay(x, y, (int)Viewport.Width, (int)Viewport.Height, ActiveCamera->GetViewContext().ViewProjection, Query.Origin, Query.Direction);
+
+		PRaycastHit Hit;
+		return Environment.Raycast(Query, Hit) ? Hit.Mesh : nullptr;
+	}
+
 	// Print some text to the output log. OutString is the string that will be printed and Status will decide the
 	// color and type of the string to print.
 	//
@@ -840,6 +911,15 @@ namespace Renderer
 						ImGui::SetTooltip("Import Animations from a .FBX file and store them in the project directory as a .ANIM file.");
 					}
 
+					if (ImGui::MenuItem("Upgrade .ANIM Files"))
+					{
+						PAnimFile::ConvertDirectory(PGameplayStatics::GetGameDirectory() + "Assets/");
+					}
+					if (ImGui::IsItemHovered())
+					{
+						ImGui::SetTooltip("Rewrite every older .ANIM file in the project's Assets folder in the current format, compressed once, which loads without unpacking or compressing.");
+					}
+
 					ImGui::EndMenu();
 				}
 
@@ -974,6 +1054,92 @@ namespace Renderer
 					Environment.RefreshCameraAspectRatios(WindowSize.right / WindowSize.bottom);
 				}
 
+				if (ImGui::Selectable("Occlusion Culling", bFlag_OcclusionCulling))
+				{
+					bFlag_OcclusionCulling = !bFlag_OcclusionCulling;
+					PrintToConsole("Occlusion Culling flag has been " + std::string(bFlag_OcclusionCulling ? "enabled" : "disabled") + ".");
+				}
+
+				ImGui::EndMenu();
+			}
+
+			if (ImGui::BeginMenu("Benchmarks"))
+			{
+				if (ImGui::Selectable("Frustum Culling"))
+				{
+					PBenchmark::RunCullingBenchmark();
+				}
+
+				if (ImGui::Selectable("Spatial Tree"))
+				{
+					PBenchmark::RunSpatialTreeBenchmark();
+				}
+
+				if (ImGui::Selectable("Transforms"))
+				{
+					PBenchmark::RunTransformBenchmark();
+				}
+
+				if (ImGui::Selectable("Raycasts"))
+				{
+					PBenchmark::RunRaycastBenchmark();
+				}
+
+				if (ImGui::Selectable("Mesh BVH"))
+				{
+					PBenchmark::RunMeshBVHBenchmark();
+				}
+
+				if (ImGui::Selectable("Animation"))
+				{
+					PBenchmark::RunAnimationBenchmark();
+				}
+
+				if (ImGui::Selectable("Animation Phase"))
+				{
+					PBenchmark::RunAnimationPhaseBenchmark();
+				}
+
+				if (ImGui::Selectable("Skinning"))
+				{
+					PBenchmark::RunSkinningBenchmark();
+				}
+
+				if (ImGui::Selectable("Animation Loading"))
+				{
+					PBenchmark::RunAnimationLoadBenchmark();
+				}
+
+				if (ImGui::Selectable("Animation Blending"))
+				{
+					PBenchmark::RunAnimationBlendBenchmark();
+				}
+
+				if (ImGui::Selectable("Animation Instancing"))
+				{
+					PBenchmark::RunAnimationInstancingBenchmark();
+				}
+
+				if (ImGui::Selectable("OBJ Loading"))
+				{
+					PBenchmark::RunObjLoadBenchmark();
+				}
+
+				if (ImGui::Selectable("Vertex Welding"))
+				{
+					PBenchmark::RunVertexWeldBenchmark();
+				}
+
+				if (ImGui::Selectable("Mesh Cache"))
+				{
+					PBenchmark::RunMeshCacheBenchmark();
+				}
+
+				if (ImGui::Selectable("Occlusion Culling"))
+				{
+					PBenchmark::RunOcclusionBenchmark();
+				}
+
 				ImGui::EndMenu();
 			}
 			
@@ -1012,6 +1178,34 @@ namespace Renderer
 		sprintf(FPSBuf, "%.0f", TempFPS);
 		ImGui::Text(FPSBuf);
 
+		if (bFlag_OcclusionCulling)
+		{
+			ImGui::SameLine();
+
+			const POcclusionCuller::PStats& OcclusionStats = OcclusionCuller.GetStats();
+			ImGui::Text("Occluded: %u/%u", OcclusionStats.Culled, OcclusionStats.Tested);
+		}
+
+		// Skeletons evaluated out of those at each animation level of detail.
+		const PAnim::LODStats& AnimStats = Environment.AnimationLODStats;
+		if ((AnimStats.Animators[ANIMLOD_FULL] + AnimStats.Animators[ANIMLOD_REDUCED] + AnimStats.Animators[ANIMLOD_DISTANT] + AnimStats.Animators[ANIMLOD_OFFSCREEN]) > 0)
+		{
+			ImGui::SameLine();
+
+			ImGui::Text("Anim LOD: %u/%u full, %u/%u reduced, %u/%u distant, %u off-screen", AnimStats.Evaluated[ANIMLOD_FULL], AnimStats.Animators[ANIMLOD_FULL],
+				AnimStats.Evaluated[ANIMLOD_REDUCED], AnimStats.Animators[ANIMLOD_REDUCED], AnimStats.Evaluated[ANIMLOD_DISTANT], AnimStats.Animators[ANIMLOD_DISTANT],
+				AnimStats.Animators[ANIMLOD_OFFSCREEN]);
+		}
+
+		// Poses evaluated for the animators sharing them.
+		const PAnim::InstancingStats& InstanceStats = Environment.AnimationInstancingStats;
+		if (InstanceStats.Requests > 0)
+		{
+			ImGui::SameLine();
+
+			ImGui::Text("Anim Instancing: %u poses for %u (%.0f%% shared)", InstanceStats.Evaluations, InstanceStats.Requests, (InstanceStats.GetHitRate() * 100.0f));
+		}
+
 		// Set the font scale in the window.
 		ImGui::SetWindowFontScale(1.0f);
 
@@ -1128,15 +1322,23 @@ namespace Renderer
 							}
 
 
-							XMVECTOR XMRotation;
-							XMVECTOR XMScale;
-							XMVECTOR XMTrans;
+							// Unparented objects already store their translation, rotation, and scale. Only the local matrix of an attached object needs splitting.
+							float3 ObjPos = CurrObj->GetLocation();
+							float3 ObjRot = CurrObj->GetRotation();
+							float3 ObjScale = CurrObj->GetScale();
 
-							XMMatrixDecompose(&XMScale, &XMRotation, &XMTrans, CurrObj->ParentObject ? (XMMATRIX&)CurrObj->GetLocal() : (XMMATRIX&)CurrObj->GetWorld().ViewMatrix);
+							if (CurrObj->ParentObject)
+							{
+								XMVECTOR XMRotation;
+								XMVECTOR XMScale;
+								XMVECTOR XMTrans;
+
+								XMMatrixDecompose(&XMScale, &XMRotation, &XMTrans, CurrObj->GetLocal());
 
-							float3 ObjPos = { XMVectorGetX(XMTrans), XMVectorGetY(XMTrans), XMVectorGetZ(XMTrans) };
-							float3 ObjRot = { XMVectorGetX(XMRotation), XMVectorGetY(XMRotation), XMVectorGetZ(XMRotation) };
-							float3 ObjScale = { XMVectorGetX(XMScale), XMVectorGetY(XMScale), XMVectorGetZ(XMScale) };
+								ObjPos = { XMVectorGetX(XMTrans), XMVectorGetY(XMTrans), XMVectorGetZ(XMTrans) };
+								ObjRot = { XMVectorGetX(XMRotation), XMVectorGetY(XMRotation), XMVectorGetZ(XMRotation) };
+								ObjScale = { XMVectorGetX(XMScale), XMVectorGetY(XMScale), XMVectorGetZ(XMScale) };
+							}
 
 							float ObjPosVec[4] = { ObjPos.x, ObjPos.y, ObjPos.z, 1.0f };
 							float ObjRotVec[4] = { ObjRot.x, ObjRot.y, ObjRot.z, 1.0f };
@@ -1468,6 +1670,12 @@ namespace Renderer
 									ImGui::SetTooltip("This will enable or disable collision with other objects in the world. When off, this will not interact with anything and vice versa.");
 								}
 
+								ImGui::Checkbox("Occluder", &TestMesh->bIsOccluder);
+								if (ImGui::IsItemHovered())
+								{
+									ImGui::SetTooltip("When on, this object hides the objects behind it from the renderer. Best used on large, solid, low poly objects like walls and terrain.");
+								}
+
 								if (ImGui::DragFloat3("Extents", ObjBBExtVec, 0.065f, 0.1f, 5000.0f, "%.2f"))
 								{
 									TestMesh->SetBoundingBoxExtents({ ObjBBExtVec[0], ObjBBExtVec[1], ObjBBExtVec[2] });
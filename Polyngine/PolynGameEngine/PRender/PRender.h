@@ -16,6 +16,8 @@
 #include "GUIToolbox/ImGui/imgui_impl_win32.h"
 #include "GUIToolbox/ImGui/imgui_impl_dx11.h"
 #include "../PSystem/FBX/FBXExporter/FBXExporter.h"
+#include "../PMath/PCulling.h"
+#include "POcclusion/POcclusion.h"
 
 #define SC_REFRESHRATE	144
 #define SC_MSAA_COUNT	GetPrivateProfileInt("Renderer.Scalability", "MSAA.Quality", 0, "../Configurations/Engine.ini")
@@ -74,6 +76,9 @@ namespace Renderer
 	private:
 		void DrawView();
 
+		// Return the visible mesh under pixel (x, y) of the viewport, or nullptr if there is none.
+		PObject* PickObject(float x, float y);
+
 		// Print some text to the output log (the console window behind the renderer). Status: 0) Text, 1) Success, 2) Error, 3) Warning.
 		void PrintToConsole(std::string OutString, int Status = 0);
 
@@ -119,6 +124,14 @@ namespace Renderer
 		bool bGUITool_Inspector = false;
 		bool bGUITool_OutputLog = false;
 
+		// Frame scratch used by DrawView() to batch cull static meshes. Kept as members so the arrays are reused every frame.
+		PMath::PBoundsTable CullBounds;
+		std::vector<PStaticMesh*> CullMeshes;
+		std::vector<uint32_t> CullVisible;
+
+		// CPU depth rasterizer used by DrawView() to skip meshes hidden behind occluders.
+		POcclusionCuller OcclusionCuller;
+
 		// This tracks how many lines are in the output vector for the output log. When the number is different than the current amount, this is updated and the output log scrolls to the most recent ouput.
 		unsigned int OutputLine = 0;
 
@@ -169,6 +182,7 @@ namespace Renderer
 		bool bFlag_ShowGrid = true;
 		bool bFlag_ShowLighting = true;
 		bool bFlag_ImmersiveMode = false;
+		bool bFlag_OcclusionCulling = true;
 
 		// Renderer quality settings options.
 		int		Render_Set_LightingQuality				= 1;
@@ -1,4 +1,7 @@
 #include "FBXExporter.h"
+#include "../../PAnimation/PAnimCompression/PAnimCompression.h"
+#include "../../PAnimation/PAnimFile/PAnimFile.h"
+#include "../../PVertexWeld/PVertexWeld.h"
 #include <assert.h>
 #include <stdio.h>
 
@@ -294,11 +297,12 @@ void FBXExporter::Unindex(FbxMesh* Mesh, std::vector<DirectX::XMFLOAT2> UVInform
 		VertexListExpanded[i].Tex.x = UVInformation[i].x;
 		VertexListExpanded[i].Tex.y = UVInformation[i].y;
 
-		VertexListExpanded[i].Weights = simpleMesh.VertexList[i].Weights;
-		VertexListExpanded[i].Joints[0] = simpleMesh.VertexList[i].Joints[0];
-		VertexListExpanded[i].Joints[1] = simpleMesh.VertexList[i].Joints[1];
-		VertexListExpanded[i].Joints[2] = simpleMesh.VertexList[i].Joints[2];
-		VertexListExpanded[i].Joints[3] = simpleMesh.VertexList[i].Joints[3];
+		// Skin data belongs to the control point, like the position.
+		VertexListExpanded[i].Weights = simpleMesh.VertexList[simpleMesh.IndicesList[i]].Weights;
+		VertexListExpanded[i].Joints[0] = simpleMesh.VertexList[simpleMesh.IndicesList[i]].Joints[0];
+		VertexListExpanded[i].Joints[1] = simpleMesh.VertexList[simpleMesh.IndicesList[i]].Joints[1];
+		VertexListExpanded[i].Joints[2] = simpleMesh.VertexList[simpleMesh.IndicesList[i]].Joints[2];
+		VertexListExpanded[i].Joints[3] = simpleMesh.VertexList[simpleMesh.IndicesList[i]].Joints[3];
 	}
 
 	// Make new indices to match the new vertex(2) array.
@@ -322,35 +326,40 @@ void FBXExporter::Unindex(FbxMesh* Mesh, std::vector<DirectX::XMFLOAT2> UVInform
 //--------------------------------------------------------------------------------------
 void FBXExporter::Compactify()
 {
-	vector<SimpleVertex> CompactVertices;
-	vector<int> CompactIndices;
+	// Weld with PVertexWeld, which only compares vertices that hash to nearby cells instead of every pair.
+	vector<Vertex> WeldVertices(simpleMesh.VertexList.size());
 
-	for (int i = 0; i < simpleMesh.IndicesList.size(); ++i)
+	for (size_t i = 0; i < simpleMesh.VertexList.size(); ++i)
 	{
-		bool MatchFound = false;
+		const SimpleVertex& Source = simpleMesh.VertexList[i];
 
-		for (int j = 0; j < CompactVertices.size(); ++j)
-		{
-			if (abs(simpleMesh.VertexList[i].Pos.x - CompactVertices[j].Pos.x) <= Epsilon &&
-				abs(simpleMesh.VertexList[i].Pos.y - CompactVertices[j].Pos.y) <= Epsilon &&
-				abs(simpleMesh.VertexList[i].Pos.z - CompactVertices[j].Pos.z) <= Epsilon &&
-				abs(simpleMesh.VertexList[i].Normal.x - CompactVertices[j].Normal.x) <= Epsilon &&
-				abs(simpleMesh.VertexList[i].Normal.y - CompactVertices[j].Normal.y) <= Epsilon &&
-				abs(simpleMesh.VertexList[i].Normal.z - CompactVertices[j].Normal.z) <= Epsilon &&
-				abs(simpleMesh.VertexList[i].Tex.x - CompactVertices[j].Tex.x) <= Epsilon &&
-				abs(simpleMesh.VertexList[i].Tex.y - CompactVertices[j].Tex.y) <= Epsilon)
-			{
-				MatchFound = true;
-				CompactIndices.push_back(j);
-				break;
-			}
-		}
+		WeldVertices[i].Position = { Source.Pos.x, Source.Pos.y, Source.Pos.z };
+		WeldVertices[i].Normal = { Source.Normal.x, Source.Normal.y, Source.Normal.z };
+		WeldVertices[i].Texture = { Source.Tex.x, Source.Tex.y };
+		WeldVertices[i].Weights = Source.Weights;
+		memcpy(WeldVertices[i].JointIndices, Source.Joints, sizeof(Source.Joints));
+	}
 
-		if (!MatchFound)
-		{
-			CompactVertices.push_back((SimpleVertex&)simpleMesh.VertexList[i]);
-			CompactIndices.push_back(CompactVertices.size() - 1);
-		}
+	// Vertices with different skinning stay apart, or welding a seam would pull one side to the other's joints.
+	PVertexWeld::Settings Weld;
+	Weld.Tolerance = Epsilon;
+	Weld.bCompareSkin = true;
+
+	vector<int> Remap;
+	vector<int> Kept;
+	PVertexWeld::BuildRemap(WeldVertices.data(), WeldVertices.size(), Remap, Kept, Weld);
+
+	vector<SimpleVertex> CompactVertices(Kept.size());
+	vector<int> CompactIndices(simpleMesh.IndicesList.size());
+
+	for (size_t i = 0; i < Kept.size(); ++i)
+	{
+		CompactVertices[i] = simpleMesh.VertexList[Kept[i]];
+	}
+
+	for (size_t i = 0; i < simpleMesh.IndicesList.size(); ++i)
+	{
+		CompactIndices[i] = Remap[simpleMesh.IndicesList[i]];
 	}
 
 	// Copy the working data into the global SimpleMesh.
@@ -473,40 +482,18 @@ void FBXExporter::SaveMaterial(FbxScene* InScene)
 // Animation information extraction.
 //--------------------------------------------------------------------------------------
 
-// Save animation and bind post information for a .FBX mesh.
+// Save animation and bind post information for a .FBX mesh, as a compressed .anim file (see PAnimFile).
 void FBXExporter::SaveAnimation(const char* AnimName)
 {
-	// Open a file using binary truncation.
-	ofstream file(AnimName, ios::trunc | ios::binary | ios::out);
-
-	// Ensure the file was opened properly.
-	assert(file.is_open());
-
-	// Make holder for number of joints in the bind pose.
-	int NumBindJoints = BindPoses[0].Joints.size();
-
-	// Write out the bind pose for the animation.
-	file.write((const char*)&NumBindJoints, sizeof(uint32_t));
-	file.write((const char*)BindPoses[0].Joints.data(), sizeof(PAnim::Joint) * NumBindJoints);
-
-	// Setup holders for the count of animation storage variables.
-	int NumFrames = AnimClips[0].Frames.size();
+	// Pack every keyframe, from the first, into the local keys the engine plays.
+	PAnim::PackedClip Clip = PAnim::PackedClip::FromClip(AnimClips[0]);
 
-	// Write all appropriate data to the new file and overwrite the old data.
-	file.write((const char*)&AnimClips[0].Duration, sizeof(double));
-	file.write((const char*)&NumFrames, sizeof(uint32_t));
-
-	for (unsigned int i = 1; i < NumFrames; ++i)
-	{
-		int NumJoints = AnimClips[0].Frames[i].Joints.size();
+	// Compress here, once, so the game doesn't on every load.
+	PAnim::CompressionSettings Compression;
+	PAnimCompression::Compress(Clip, Compression);
 
-		file.write((const char*)&AnimClips[0].Frames[i].Time, sizeof(double));
-		file.write((const char*)&NumJoints, sizeof(uint32_t));
-		file.write((const char*)AnimClips[0].Frames[i].Joints.data(), sizeof(PAnim::Joint) * NumJoints);// *NumJoints);
-	}
-
-	// Close the file.
-	file.close();
+	// Write the clip and the bind pose, overwriting the old file. Failures are printed to the console.
+	PAnimFile::Save(AnimName, Clip, BindPoses[0], Compression);
 }
 
 // Read the animation data for the joint animation.
@@ -0,0 +1,414 @@
+#include "PAABBTree.h"
+
+namespace
+{
+	// Surface area of a box. Used as the insertion cost, since the chance of a query hitting a box grows with its area.
+	float SurfaceArea(const PMath::float3& Min, const PMath::float3& Max)
+	{
+		PMath::float3 Size = (Max - Min);
+		return (2.0f * ((Size.x * Size.y) + (Size.y * Size.z) + (Size.z * Size.x)));
+	}
+
+	PMath::float3 Min3(const PMath::float3& A, const PMath::float3& B)
+	{
+		return { fminf(A.x, B.x), fminf(A.y, B.y), fminf(A.z, B.z) };
+	}
+
+	PMath::float3 Max3(const PMath::float3& A, const PMath::float3& B)
+	{
+		return { fmaxf(A.x, B.x), fmaxf(A.y, B.y), fmaxf(A.z, B.z) };
+	}
+}
+
+// Add a proxy with the given world space bounds. UserData is stored with the proxy and can be read back with GetUserData().
+//
+// RETURN: The id of the new proxy.
+int PAABBTree::CreateProxy(const PMath::PAABB& Bounds, void* UserData)
+{
+	int ProxyId = AllocateNode();
+
+	SetFatBounds(ProxyId, Bounds);
+	Nodes[ProxyId].UserData = UserData;
+	Nodes[ProxyId].Height = 0;
+
+	InsertLeaf(ProxyId);
+	++ProxyCount;
+
+	return ProxyId;
+}
+
+// Remove a proxy from the tree.
+void PAABBTree::DestroyProxy(int ProxyId)
+{
+	if ((ProxyId < 0) || (ProxyId >= (int)Nodes.size()) || !Nodes[ProxyId].IsLeaf() || (Nodes[ProxyId].Height != 0))
+	{
+		return;
+	}
+
+	RemoveLeaf(ProxyId);
+	FreeNode(ProxyId);
+	--ProxyCount;
+}
+
+// Update the bounds of a proxy. The tree is only changed when the new bounds leave the proxy's fat box.
+//
+// RETURN: True if the proxy had to be reinserted.
+bool PAABBTree::MoveProxy(int ProxyId, const PMath::PAABB& Bounds)
+{
+	Node& Leaf = Nodes[ProxyId];
+
+	PMath::float3 Min = Bounds.Center - Bounds.Extents;
+	PMath::float3 Max = Bounds.Center + Bounds.Extents;
+
+	if ((Leaf.Min.x <= Min.x) && (Leaf.Min.y <= Min.y) && (Leaf.Min.z <= Min.z) &&
+		(Leaf.Max.x >= Max.x) && (Leaf.Max.y >= Max.y) && (Leaf.Max.z >= Max.z))
+	{
+		return false;
+	}
+
+	RemoveLeaf(ProxyId);
+	SetFatBounds(ProxyId, Bounds);
+	InsertLeaf(ProxyId);
+
+	return true;
+}
+
+// Return the UserData a proxy was created with.
+void* PAABBTree::GetUserData(int ProxyId) const
+{
+	return Nodes[ProxyId].UserData;
+}
+
+// Return the fattened box stored for a proxy.
+PMath::PAABB PAABBTree::GetFatBounds(int ProxyId) const
+{
+	const Node& Leaf = Nodes[ProxyId];
+	return { ((Leaf.Min + Leaf.Max) * 0.5f), ((Leaf.Max - Leaf.Min) * 0.5f) };
+}
+
+// Remove every proxy from the tree.
+void PAABBTree::Clear()
+{
+	Nodes.clear();
+	Root = NullNode;
+	FreeList = NullNode;
+	ProxyCount = 0;
+}
+
+// Return the height of the tree. An empty tree or a single leaf has a height of 0.
+int PAABBTree::GetHeight() const
+{
+	return ((Root == NullNode) ? 0 : Nodes[Root].Height);
+}
+
+int PAABBTree::AllocateNode()
+{
+	int NodeId;
+
+	if (FreeList != NullNode)
+	{
+		NodeId = FreeList;
+		FreeList = Nodes[NodeId].Parent;
+	}
+	else
+	{
+		NodeId = (int)Nodes.size();
+		Nodes.emplace_back();
+	}
+
+	Node& NewNode = Nodes[NodeId];
+	NewNode.UserData = nullptr;
+	NewNode.Parent = NullNode;
+	NewNode.Child1 = NullNode;
+	NewNode.Child2 = NullNode;
+	NewNode.Height = 0;
+
+	return NodeId;
+}
+
+void PAABBTree::FreeNode(int NodeId)
+{
+	Nodes[NodeId].UserData = nullptr;
+	Nodes[NodeId].Child1 = NullNode;
+	Nodes[NodeId].Child2 = NullNode;
+	Nodes[NodeId].Height = -1;
+	Nodes[NodeId].Parent = FreeList;
+	FreeList = NodeId;
+}
+
+// Grow Leaf's box by FatMargin around Bounds.
+void PAABBTree::SetFatBounds(int Leaf, const PMath::PAABB& Bounds)
+{
+	PMath::float3 Margin = { FatMargin, FatMargin, FatMargin };
+
+	Nodes[Leaf].Min = (Bounds.Center - Bounds.Extents) - Margin;
+	Nodes[Leaf].Max = (Bounds.Center + Bounds.Extents) + Margin;
+}
+
+// Recompute an internal node's box and height from its children.
+void PAABBTree::Refit(int NodeId)
+{
+	Node& Current = Nodes[NodeId];
+	const Node& Child1 = Nodes[Current.Child1];
+	const Node& Child2 = Nodes[Current.Child2];
+
+	Current.Min = Min3(Child1.Min, Child2.Min);
+	Current.Max = Max3(Child1.Max, Child2.Max);
+	Current.Height = (1 + ((Child1.Height > Child2.Height) ? Child1.Height : Child2.Height));
+}
+
+void PAABBTree::InsertLeaf(int Leaf)
+{
+	if (Root == NullNode)
+	{
+		Root = Leaf;
+		Nodes[Root].Parent = NullNode;
+		return;
+	}
+
+	// Walk down the tree looking for the cheapest sibling for the new leaf. The cost of pairing with a node is the area of
+	// the new parent plus the area every ancestor grows by to contain the leaf.
+	PMath::float3 LeafMin = Nodes[Leaf].Min;
+	PMath::float3 LeafMax = Nodes[Leaf].Max;
+
+	int Index = Root;
+	while (!Nodes[Index].IsLeaf())
+	{
+		const Node& Current = Nodes[Index];
+
+		float Area = SurfaceArea(Current.Min, Current.Max);
+		float CombinedArea = SurfaceArea(Min3(Current.Min, LeafMin), Max3(Current.Max, LeafMax));
+
+		// Cost of creating a new parent for this node and the new leaf.
+		float Cost = (2.0f * CombinedArea);
+
+		// Minimum cost of pushing the leaf further down the tree.
+		float InheritanceCost = (2.0f * (CombinedArea - Area));
+
+		auto DescendCost = [&](int ChildId) -> float
+		{
+			const Node& Child = Nodes[ChildId];
+			float ChildCombined = SurfaceArea(Min3(Child.Min, LeafMin), Max3(Child.Max, LeafMax));
+
+			return (Child.IsLeaf() ? ChildCombined : (ChildCombined - SurfaceArea(Child.Min, Child.Max))) + InheritanceCost;
+		};
+
+		float Cost1 = DescendCost(Current.Child1);
+		float Cost2 = DescendCost(Current.Child2);
+
+		if ((Cost < Cost1) && (Cost < Cost2))
+		{
+			break;
+		}
+
+		Index = ((Cost1 < Cost2) ? Current.Child1 : Current.Child2);
+	}
+
+	int Sibling = Index;
+
+	// Create a new parent for the sibling and the leaf. AllocateNode() can grow Nodes, so no references are held across it.
+	int OldParent = Nodes[Sibling].Parent;
+	int NewParent = AllocateNode();
+
+	Nodes[NewParent].Parent = OldParent;
+	Nodes[NewParent].Min = Min3(LeafMin, Nodes[Sibling].Min);
+	Nodes[NewParent].Max = Max3(LeafMax, Nodes[Sibling].Max);
+	Nodes[NewParent].Height = (Nodes[Sibling].Height + 1);
+	Nodes[NewParent].Child1 = Sibling;
+	Nodes[NewParent].Child2 = Leaf;
+	Nodes[Sibling].Parent = NewParent;
+	Nodes[Leaf].Parent = NewParent;
+
+	if (OldParent != NullNode)
+	{
+		if (Nodes[OldParent].Child1 == Sibling)
+		{
+			Nodes[OldParent].Child1 = NewParent;
+		}
+		else
+		{
+			Nodes[OldParent].Child2 = NewParent;
+		}
+	}
+	else
+	{
+		Root = NewParent;
+	}
+
+	// Walk back up, balancing and refitting every ancestor.
+	Index = Nodes[Leaf].Parent;
+	while (Index != NullNode)
+	{
+		Index = Balance(Index);
+		Refit(Index);
+
+		Index = Nodes[Index].Parent;
+	}
+}
+
+void PAABBTree::RemoveLeaf(int Leaf)
+{
+	if (Leaf == Root)
+	{
+		Root = NullNode;
+		return;
+	}
+
+	int Parent = Nodes[Leaf].Parent;
+	int GrandParent = Nodes[Parent].Parent;
+	int Sibling = ((Nodes[Parent].Child1 == Leaf) ? Nodes[Parent].Child2 : Nodes[Parent].Child1);
+
+	if (GrandParent != NullNode)
+	{
+		// Replace the parent with the sibling and refit the ancestors.
+		if (Nodes[GrandParent].Child1 == Parent)
+		{
+			Nodes[GrandParent].Child1 = Sibling;
+		}
+		else
+		{
+			Nodes[GrandParent].Child2 = Sibling;
+		}
+
+		Nodes[Sibling].Parent = GrandParent;
+		FreeNode(Parent);
+
+		int Index = GrandParent;
+		while (Index != NullNode)
+		{
+			Index = Balance(Index);
+			Refit(Index);
+
+			Index = Nodes[Index].Parent;
+		}
+	}
+	else
+	{
+		Root = Sibling;
+		Nodes[Sibling].Parent = NullNode;
+		FreeNode(Parent);
+	}
+
+	Nodes[Leaf].Parent = NullNode;
+}
+
+// Perform a left or right rotation if node A is imbalanced.
+//
+// RETURN: The node that now sits where A was.
+int PAABBTree::Balance(int IndexA)
+{
+	Node& A = Nodes[IndexA];
+	if (A.IsLeaf() || (A.Height < 2))
+	{
+		return IndexA;
+	}
+
+	int IndexB = A.Child1;
+	int IndexC = A.Child2;
+	Node& B = Nodes[IndexB];
+	Node& C = Nodes[IndexC];
+
+	int Balance = (C.Height - B.Height);
+
+	// Rotate C up.
+	if (Balance > 1)
+	{
+		int IndexF = C.Child1;
+		int IndexG = C.Child2;
+		Node& F = Nodes[IndexF];
+		Node& G = Nodes[IndexG];
+
+		// Swap A and C.
+		C.Child1 = IndexA;
+		C.Parent = A.Parent;
+		A.Parent = IndexC;
+
+		// A's old parent should point to C.
+		if (C.Parent != NullNode)
+		{
+			if (Nodes[C.Parent].Child1 == IndexA)
+			{
+				Nodes[C.Parent].Child1 = IndexC;
+			}
+			else
+			{
+				Nodes[C.Parent].Child2 = IndexC;
+			}
+		}
+		else
+		{
+			Root = IndexC;
+		}
+
+		// Keep the taller of F and G under C.
+		if (F.Height > G.Height)
+		{
+			C.Child2 = IndexF;
+			A.Child2 = IndexG;
+			G.Parent = IndexA;
+		}
+		else
+		{
+			C.Child2 = IndexG;
+			A.Child2 = IndexF;
+			F.Parent = IndexA;
+		}
+
+		Refit(IndexA);
+		Refit(IndexC);
+
+		return IndexC;
+	}
+
+	// Rotate B up.
+	if (Balance < -1)
+	{
+		int IndexD = B.Child1;
+		int IndexE = B.Child2;
+		Node& D = Nodes[IndexD];
+		Node& E = Nodes[IndexE];
+
+		// Swap A and B.
+		B.Child1 = IndexA;
+		B.Parent = A.Parent;
+		A.Parent = IndexB;
+
+		// A's old parent should point to B.
+		if (B.Parent != NullNode)
+		{
+			if (Nodes[B.Parent].Child1 == IndexA)
+			{
+				Nodes[B.Parent].Child1 = IndexB;
+			}
+			else
+			{
+				Nodes[B.Parent].Child2 = IndexB;
+			}
+		}
+		else
+		{
+			Root = IndexB;
+		}
+
+		// Keep the taller of D and E under B.
+		if (D.Height > E.Height)
+		{
+			B.Child2 = IndexD;
+			A.Child1 = IndexE;
+			E.Parent = IndexA;
+		}
+		else
+		{
+			B.Child2 = IndexE;
+			A.Child1 = IndexD;
+			D.Parent = IndexA;
+		}
+
+		Refit(IndexA);
+		Refit(IndexB);
+
+		return IndexB;
+	}
+
+	return IndexA;
+}
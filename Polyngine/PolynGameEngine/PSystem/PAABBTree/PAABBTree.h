@@ -0,0 +1,410 @@
+#pragma once
+
+#include "../../PMath/PMath.h"
+#include "../../PMath/PRaycast.h"
+#include <cmath>
+#include <vector>
+
+// A dynamic bounding volume tree used to answer spatial questions about the world without walking every object.
+//
+// Each proxy lives in a leaf whose box is enlarged ("fattened") by FatMargin, so small movements don't touch the tree at all.
+// Inserts choose the sibling with the lowest surface area cost, and tree rotations keep the tree balanced as proxies are added,
+// moved, and removed. Queries cost O(log n + results) instead of O(n).
+class PAABBTree
+{
+public:
+	static constexpr int NullNode = -1;
+
+	// How far, in world units, each leaf box is enlarged past the bounds it was given.
+	float FatMargin = 0.1f;
+
+	// ------------------------------------------------------------------
+	//		Proxies.
+	// ------------------------------------------------------------------
+
+	// Add a proxy with the given world space bounds. UserData is stored with the proxy and can be read back with GetUserData().
+	//
+	// RETURN: The id of the new proxy.
+	int CreateProxy(const PMath::PAABB& Bounds, void* UserData);
+
+	// Remove a proxy from the tree.
+	void DestroyProxy(int ProxyId);
+
+	// Update the bounds of a proxy. The tree is only changed when the new bounds leave the proxy's fat box.
+	//
+	// RETURN: True if the proxy had to be reinserted.
+	bool MoveProxy(int ProxyId, const PMath::PAABB& Bounds);
+
+	// Return the UserData a proxy was created with.
+	void* GetUserData(int ProxyId) const;
+
+	// Return the fattened box stored for a proxy.
+	PMath::PAABB GetFatBounds(int ProxyId) const;
+
+	// Remove every proxy from the tree.
+	void Clear();
+
+	// Return the height of the tree. An empty tree or a single leaf has a height of 0.
+	int GetHeight() const;
+
+	// Return the number of proxies in the tree.
+	size_t GetProxyCount() const { return ProxyCount; }
+
+
+	// ------------------------------------------------------------------
+	//		Queries.
+	// ------------------------------------------------------------------
+	//
+	// Visit is called with the id of each proxy whose fat box passes the test. Returning false from Visit stops the query.
+
+	// Find every proxy whose box is at least partially inside the frustum.
+	template<typename Callback>
+	void QueryFrustum(const PMath::PFrustum& Frustum, Callback&& Visit) const;
+
+	// Find every proxy whose box overlaps Box.
+	template<typename Callback>
+	void QueryBox(const PMath::PAABB& Box, Callback&& Visit) const;
+
+	// Find every proxy whose box overlaps Sphere.
+	template<typename Callback>
+	void QuerySphere(const PMath::PSphere& Sphere, Callback&& Visit) const;
+
+	// Find every proxy whose box is hit by the ray Origin + (Direction * t) for 0 <= t <= MaxDistance. Direction does not
+	// need to be normalized, distances are measured in multiples of it.
+	//
+	// Visit(ProxyId, MaxDistance) returns the new MaxDistance. Return MaxDistance to keep going, a smaller value (the
+	// distance of a confirmed hit) to clip the ray, or 0 to stop.
+	template<typename Callback>
+	void QueryRay(const PMath::float3& Origin, const PMath::float3& Direction, float MaxDistance, Callback&& Visit) const;
+
+	// Find the proxies hit by each ray of a packet. The tree is walked once for the whole packet, and a node is only skipped
+	// when none of the packet's rays hit it.
+	//
+	// Visit(ProxyId, HitMask) is called with the lanes whose rays hit the proxy's fat box. It may lower a lane's MaxDistance
+	// to clip the ray, or make it negative to stop testing that ray. The query ends when no lanes are left.
+	template<typename Callback>
+	void QueryRayPacket(PMath::PRayPacket& Packet, Callback&& Visit) const;
+
+private:
+	struct Node
+	{
+		PMath::float3 Min;
+		PMath::float3 Max;
+		void* UserData = nullptr;
+		int Parent = NullNode;				// The next free node while this node is on the free list.
+		int Child1 = NullNode;
+		int Child2 = NullNode;
+		int Height = 0;						// 0 for leaves, -1 for free nodes.
+
+		bool IsLeaf() const { return (Child1 == NullNode); }
+	};
+
+	// A traversal stack that lives on the program stack and only allocates for unusually deep trees.
+	class TraversalStack
+	{
+	public:
+		void Push(int NodeId)
+		{
+			if (Count < InlineSize)
+			{
+				Inline[Count++] = NodeId;
+			}
+			else
+			{
+				Spill.push_back(NodeId);
+			}
+		}
+
+		int Pop()
+		{
+			if (!Spill.empty())
+			{
+				int NodeId = Spill.back();
+				Spill.pop_back();
+				return NodeId;
+			}
+
+			return Inline[--Count];
+		}
+
+		bool Empty() const { return ((Count == 0) && Spill.empty()); }
+
+	private:
+		static constexpr int InlineSize = 128;
+
+		int Inline[InlineSize];
+		int Count = 0;
+		std::vector<int> Spill;
+	};
+
+	std::vector<Node> Nodes;
+	int Root = NullNode;
+	int FreeList = NullNode;
+	size_t ProxyCount = 0;
+
+	int AllocateNode();
+	void FreeNode(int NodeId);
+	void InsertLeaf(int Leaf);
+	void RemoveLeaf(int Leaf);
+	int Balance(int NodeId);
+
+	// Grow Leaf's box by FatMargin around Bounds.
+	void SetFatBounds(int Leaf, const PMath::PAABB& Bounds);
+
+	// Recompute an internal node's box and height from its children.
+	void Refit(int NodeId);
+};
+
+
+// ------------------------------------------------------------------
+//		Query implementations.
+// ------------------------------------------------------------------
+
+template<typename Callback>
+void PAABBTree::QueryFrustum(const PMath::PFrustum& Frustum, Callback&& Visit) const
+{
+	if (Root == NullNode)
+	{
+		return;
+	}
+
+	// Nodes fully inside the frustum are pushed with this bit set, so their subtrees are reported without any more plane tests.
+	constexpr int InsideBit = (1 << 30);
+
+	TraversalStack Stack;
+	Stack.Push(Root);
+
+	while (!Stack.Empty())
+	{
+		int Entry = Stack.Pop();
+		bool bInside = ((Entry & InsideBit) != 0);
+		const Node& Current = Nodes[Entry & ~InsideBit];
+
+		if (!bInside)
+		{
+			PMath::float3 Center = (Current.Min + Current.Max) * 0.5f;
+			PMath::float3 Extents = (Current.Max - Current.Min) * 0.5f;
+
+			bool bOutside = false;
+			bInside = true;
+
+			for (const PMath::PPlane& Plane : Frustum.Planes)
+			{
+				float Radius = (Extents.x * fabsf(Plane.Normal.x)) + (Extents.y * fabsf(Plane.Normal.y)) + (Extents.z * fabsf(Plane.Normal.z));
+				float SignedDistance = (dot(Center, Plane.Normal) - Plane.Offset);
+
+				if (SignedDistance < -Radius)
+				{
+					bOutside = true;
+					break;
+				}
+				else if (SignedDistance <= Radius)
+				{
+					bInside = false;
+				}
+			}
+
+			if (bOutside)
+			{
+				continue;
+			}
+		}
+
+		if (Current.IsLeaf())
+		{
+			if (!Visit(Entry & ~InsideBit))
+			{
+				return;
+			}
+		}
+		else
+		{
+			Stack.Push(Current.Child1 | (bInside ? InsideBit : 0));
+			Stack.Push(Current.Child2 | (bInside ? InsideBit : 0));
+		}
+	}
+}
+
+template<typename Callback>
+void PAABBTree::QueryBox(const PMath::PAABB& Box, Callback&& Visit) const
+{
+	if (Root == NullNode)
+	{
+		return;
+	}
+
+	PMath::float3 Min = Box.Center - Box.Extents;
+	PMath::float3 Max = Box.Center + Box.Extents;
+
+	TraversalStack Stack;
+	Stack.Push(Root);
+
+	while (!Stack.Empty())
+	{
+		int NodeId = Stack.Pop();
+		const Node& Current = Nodes[NodeId];
+
+		if ((Current.Max.x < Min.x) || (Current.Min.x > Max.x) ||
+			(Current.Max.y < Min.y) || (Current.Min.y > Max.y) ||
+			(Current.Max.z < Min.z) || (Current.Min.z > Max.z))
+		{
+			continue;
+		}
+
+		if (Current.IsLeaf())
+		{
+			if (!Visit(NodeId))
+			{
+				return;
+			}
+		}
+		else
+		{
+			Stack.Push(Current.Child1);
+			Stack.Push(Current.Child2);
+		}
+	}
+}
+
+template<typename Callback>
+void PAABBTree::QuerySphere(const PMath::PSphere& Sphere, Callback&& Visit) const
+{
+	if (Root == NullNode)
+	{
+		return;
+	}
+
+	float RadiusSq = (Sphere.Radius * Sphere.Radius);
+
+	TraversalStack Stack;
+	Stack.Push(Root);
+
+	while (!Stack.Empty())
+	{
+		int NodeId = Stack.Pop();
+		const Node& Current = Nodes[NodeId];
+
+		// Distance from the sphere center to the closest point on the box.
+		float DistanceSq = 0.0f;
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			float Closest = PMath::fclamp(Sphere.Center[Axis], Current.Min[Axis], Current.Max[Axis]);
+			float Delta = (Sphere.Center[Axis] - Closest);
+			DistanceSq += (Delta * Delta);
+		}
+
+		if (DistanceSq > RadiusSq)
+		{
+			continue;
+		}
+
+		if (Current.IsLeaf())
+		{
+			if (!Visit(NodeId))
+			{
+				return;
+			}
+		}
+		else
+		{
+			Stack.Push(Current.Child1);
+			Stack.Push(Current.Child2);
+		}
+	}
+}
+
+template<typename Callback>
+void PAABBTree::QueryRay(const PMath::float3& Origin, const PMath::float3& Direction, float MaxDistance, Callback&& Visit) const
+{
+	if (Root == NullNode)
+	{
+		return;
+	}
+
+	// Division by a zero component gives +/- infinity, which the slab test below handles correctly.
+	PMath::float3 InvDirection = { (1.0f / Direction.x), (1.0f / Direction.y), (1.0f / Direction.z) };
+
+	TraversalStack Stack;
+	Stack.Push(Root);
+
+	while (!Stack.Empty())
+	{
+		int NodeId = Stack.Pop();
+		const Node& Current = Nodes[NodeId];
+
+		// Slab test against the node's box.
+		float Near = 0.0f;
+		float Far = MaxDistance;
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			float T1 = ((Current.Min[Axis] - Origin[Axis]) * InvDirection[Axis]);
+			float T2 = ((Current.Max[Axis] - Origin[Axis]) * InvDirection[Axis]);
+
+			Near = fmaxf(Near, fminf(T1, T2));
+			Far = fminf(Far, fmaxf(T1, T2));
+		}
+
+		if (Near > Far)
+		{
+			continue;
+		}
+
+		if (Current.IsLeaf())
+		{
+			MaxDistance = Visit(NodeId, MaxDistance);
+
+			if (MaxDistance <= 0.0f)
+			{
+				return;
+			}
+		}
+		else
+		{
+			Stack.Push(Current.Child1);
+			Stack.Push(Current.Child2);
+		}
+	}
+}
+
+template<typename Callback>
+void PAABBTree::QueryRayPacket(PMath::PRayPacket& Packet, Callback&& Visit) const
+{
+	uint32_t ActiveMask = Packet.ActiveMask();
+
+	if ((Root == NullNode) || (ActiveMask == 0))
+	{
+		return;
+	}
+
+	TraversalStack Stack;
+	Stack.Push(Root);
+
+	while (!Stack.Empty())
+	{
+		int NodeId = Stack.Pop();
+		const Node& Current = Nodes[NodeId];
+
+		// Lanes that were stopped have a negative MaxDistance, so the slab test never reports them.
+		uint32_t HitMask = PMath::PIntersectRayPacketAABB(Packet, Current.Min, Current.Max);
+
+		if (HitMask == 0)
+		{
+			continue;
+		}
+
+		if (Current.IsLeaf())
+		{
+			Visit(NodeId, HitMask);
+
+			if (Packet.ActiveMask() == 0)
+			{
+				return;
+			}
+		}
+		else
+		{
+			Stack.Push(Current.Child1);
+			Stack.Push(Current.Child2);
+		}
+	}
+}
@@ -1,25 +1,1227 @@
 #include "PAnim.h"
 #include "../../../PMath/PMath.h"
 #include "../../../PStatics/PGameplayStatics/PGameplayStatics.h"
-#include <fstream>
+#include "../../../PMath/PTransform.h"
+#include "../../../PMath/PVectorMath.h"
+#include "../PAnimCompression/PAnimCompression.h"
+#include "../PAnimFile/PAnimFile.h"
+#include "../PSkinning/PSkinning.h"
+#include "../../PJobs/PJobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+
+namespace
+{
+	// Every clip an animator holds, by GetClipKey(). Entries expire when the last animator playing the clip lets go of it.
+	std::mutex ClipCacheLock;
+	std::unordered_map<std::string, std::weak_ptr<const PAnim::ClipAsset>> ClipCache;
+
+	// Return the key a clip is shared under: its file path and how it was compressed.
+	std::string GetClipKey(const std::string& AnimFilePath, const PAnim::CompressionSettings& Settings)
+	{
+		if (!Settings.bEnabled)
+		{
+			return (AnimFilePath + "|raw");
+		}
+
+		// Hex floats, so settings that differ in the last bit still get separate keys.
+		char Suffix[64];
+		snprintf(Suffix, sizeof(Suffix), "|%a|%a", Settings.MaxError, Settings.TipDistance);
+
+		return (AnimFilePath + Suffix);
+	}
+
+	// Per thread scratch for PackedClip::Sample(). It grows to the largest skeleton sampled on the thread and stays.
+	struct SampleScratch
+	{
+		std::vector<float, PAlignedAllocator<float, 64>> Keys;		// The blended keys, in joint order.
+		std::vector<float4x4_a> Locals;								// Each joint's matrix relative to its parent, in solve order.
+		std::vector<float4x4_a> ParentGlobals;						// Each joint's parent's model space matrix, in solve order.
+		std::vector<float4x4_a> Globals;							// Each joint's model space matrix, in solve order.
+	};
+
+	thread_local SampleScratch Scratch;
+
+	// Counts the allocations made while evaluating poses. See PAnim::GetPoseAllocationCount().
+	std::atomic<uint64_t> PoseAllocations{ 0 };
+
+	// The buffers each thread has lent out through PAnim::PoseBuffer and been given back.
+	thread_local std::vector<std::vector<float, PAlignedAllocator<float, 64>>> FreePoseBuffers;
+
+	// An instanced animator due a pose, keyed by what its pose depends on.
+	struct SharedPoseRequest
+	{
+		const PAnim::ClipAsset* Asset;
+		float TimeStep;
+		int64_t Tick;				// The animation time in TimeSteps, rounded.
+		EAnimRotationBlends Blend;
+		PAnim* Animator;
+
+		bool SameKey(const SharedPoseRequest& Other) const
+		{
+			return (Asset == Other.Asset) && (TimeStep == Other.TimeStep) && (Tick == Other.Tick) && (Blend == Other.Blend);
+		}
+	};
+
+	// Scratch for PAnim::EvaluateSharedPoses(), kept between frames so steady state allocates nothing.
+	struct SharedPoseScratch
+	{
+		std::vector<SharedPoseRequest> Requests;
+		std::vector<std::shared_ptr<PAnim::SharedPose>> Pool;	// Every shared pose made. Those only the pool holds are free.
+		std::vector<size_t> FreeSlots;
+		std::vector<PAnim::SharedPose*> Evaluate;				// The shared poses to sample this call.
+	};
+
+	thread_local SharedPoseScratch SharedScratch;
+
+	// Resize Storage to Count, counting it in PoseAllocations if it has to grow.
+	template<typename Vector>
+	void GrowTo(Vector& Storage, size_t Count)
+	{
+		if (Count > Storage.capacity())
+		{
+			PoseAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		Storage.resize(Count);
+	}
+
+	// Smallest three rotations: every component but the largest is within +-1/sqrt(2). Scaling by sqrt(2) maps them to +-1.
+	constexpr float SmallestThreeScale = 1.41421356f;
+
+	// Where the three stored components of a smallest three rotation go, by which component was dropped.
+	constexpr uint8_t SmallestThreeSlots[4][3] = { { 1, 2, 3 }, { 0, 2, 3 }, { 0, 1, 3 }, { 0, 1, 2 } };
+
+	// Load 16 packed floats as a matrix.
+	PMatrix LoadMatrix16(const float* Source)
+	{
+		float4x4_a Matrix;
+		memcpy(&Matrix, Source, sizeof(Matrix));
+		return PLoadMatrix(Matrix);
+	}
+}
+
+// Blend the keys around SampleTime and solve the hierarchy into OutPose.
+void PAnim::PackedClip::Sample(float SampleTime, std::span<float4x4_a> OutPose, EAnimRotationBlends RotationBlend, PSimdLevel Level) const
+{
+	if (Times.empty() || (JointCount == 0) || (OutPose.size() < JointCount))
+	{
+		return;
+	}
+
+	SampleScratch& Work = Scratch;
+	GrowTo(Work.Keys, (JointCount * KeyStride));
+
+	SampleKeys(SampleTime, RotationBlend, Level, Work.Keys.data());
+	Solve(Work.Keys.data(), KeyStride, OutPose, Level);
+}
+
+// Blend the keys around SampleTime into OutKeys, LocalStride floats per joint.
+void PAnim::PackedClip::SampleLocal(float SampleTime, std::span<float> OutKeys, EAnimRotationBlends RotationBlend, PSimdLevel Level) const
+{
+	if (Times.empty() || (JointCount == 0) || (OutKeys.size() < ((size_t)JointCount * LocalStride)))
+	{
+		return;
+	}
+
+	SampleKeys(SampleTime, RotationBlend, Level, OutKeys.data());
+
+	// Spread the keys out to LocalStride from the last joint down, so no joint is overwritten before it has moved.
+	for (uint32_t Joint = JointCount; Joint-- > 0;)
+	{
+		float* Dest = (OutKeys.data() + ((size_t)Joint * LocalStride));
+		memmove(Dest, (OutKeys.data() + ((size_t)Joint * KeyStride)), (sizeof(float) * KeyStride));
+
+		if (!HasScale())
+		{
+			Dest[ScaleOffset] = Dest[ScaleOffset + 1] = Dest[ScaleOffset + 2] = 1.0f;
+		}
+
+		float4 Rotation = PStoreFloat4(PVector4Normalize(PVectorSet(Dest[0], Dest[1], Dest[2], Dest[3])));
+		memcpy((Dest + RotationOffset), &Rotation, sizeof(Rotation));
+	}
+}
+
+// Blend Source over Dest, both LocalStride floats per joint.
+void PAnim::PackedClip::BlendLocal(std::span<float> Dest, std::span<const float> Source, float Weight, std::span<const float> JointWeights)
+{
+	size_t Count = (std::min(Dest.size(), Source.size()) / LocalStride);
+
+	for (size_t Joint = 0; Joint < Count; ++Joint)
+	{
+		float Alpha = (Joint < JointWeights.size()) ? (Weight * JointWeights[Joint]) : (JointWeights.empty() ? Weight : 0.0f);
+
+		if (Alpha <= 0.0f)
+		{
+			continue;
+		}
+
+		float* To = (Dest.data() + (Joint * LocalStride));
+		const float* From = (Source.data() + (Joint * LocalStride));
+
+		if (Alpha >= 1.0f)
+		{
+			memcpy(To, From, (sizeof(float) * LocalStride));
+			continue;
+		}
+
+		// Take the short way round, then nlerp.
+		float Sign = (((To[0] * From[0]) + (To[1] * From[1]) + (To[2] * From[2]) + (To[3] * From[3])) < 0.0f) ? -1.0f : 1.0f;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			To[i] += (((From[i] * Sign) - To[i]) * Alpha);
+		}
+
+		float4 Rotation = PStoreFloat4(PVector4Normalize(PVectorSet(To[0], To[1], To[2], To[3])));
+		memcpy((To + RotationOffset), &Rotation, sizeof(Rotation));
+
+		for (uint32_t i = TranslationOffset; i < LocalStride; ++i)
+		{
+			To[i] += ((From[i] - To[i]) * Alpha);
+		}
+	}
+}
+
+// Solve local keys of Stride floats per joint into model space matrices.
+void PAnim::PackedClip::SolveLocal(std::span<const float> LocalKeys, std::span<float4x4_a> OutPose, PSimdLevel Level) const
+{
+	if ((JointCount == 0) || (OutPose.size() < JointCount) || (LocalKeys.size() < ((size_t)JointCount * LocalStride)))
+	{
+		return;
+	}
+
+	Solve(LocalKeys.data(), LocalStride, OutPose, Level);
+}
+
+// Blend the keys around SampleTime into OutKeys, laid out like one keyframe of Keys.
+void PAnim::PackedClip::SampleKeys(float SampleTime, EAnimRotationBlends RotationBlend, PSimdLevel Level, float* OutKeys) const
+{
+	// Find the last keyframe at or before SampleTime. Times before the first keyframe or after the last hold the end pose.
+	size_t After = (size_t)(std::upper_bound(Times.begin(), Times.end(), (double)SampleTime) - Times.begin());
+	size_t NextIndex = std::min(After, (Times.size() - 1));
+	size_t CurrIndex = (After == 0) ? 0 : (After - 1);
+
+	double Span = (Times[NextIndex] - Times[CurrIndex]);
+	float Alpha = (Span > 0.0) ? fclamp((float)((SampleTime - Times[CurrIndex]) / Span), 0.0f, 1.0f) : 0.0f;
+
+	if (RotationBlend == ANIMBLEND_NEAREST)
+	{
+		CurrIndex = (Alpha >= 0.5f) ? NextIndex : CurrIndex;
+		Alpha = 0.0f;
+	}
+
+	// Both keyframes are contiguous, so every component of every joint is blended in one pass. Rotations only need
+	// normalizing afterwards to finish the nlerp. Compressed clips blend each track's own kept keys instead.
+	if (IsCompressed())
+	{
+		DecompressKeys(CurrIndex, Alpha, RotationBlend, OutKeys);
+		return;
+	}
+
+	const float* From = GetFrame(CurrIndex);
+	const float* To = GetFrame(NextIndex);
+
+	if (Alpha <= 0.0f)
+	{
+		memcpy(OutKeys, From, (JointCount * KeyStride * sizeof(float)));
+		return;
+	}
+
+	PLerpFloats(From, To, OutKeys, (JointCount * KeyStride), Alpha, Level);
+
+	if (RotationBlend == ANIMBLEND_SLERP)
+	{
+		for (uint32_t Joint = 0; Joint < JointCount; ++Joint)
+		{
+			const float* A = (From + (Joint * KeyStride) + RotationOffset);
+			const float* B = (To + (Joint * KeyStride) + RotationOffset);
+			float4 Rotation = PStoreFloat4(PQuaternionSlerp(PVectorSet(A[0], A[1], A[2], A[3]), PVectorSet(B[0], B[1], B[2], B[3]), Alpha));
+
+			memcpy((OutKeys + (Joint * KeyStride) + RotationOffset), &Rotation, sizeof(Rotation));
+		}
+	}
+}
+
+// Build each joint's local matrix from Keys (Stride floats per joint) and solve the hierarchy into OutPose.
+void PAnim::PackedClip::Solve(const float* LocalKeys, uint32_t Stride, std::span<float4x4_a> OutPose, PSimdLevel Level) const
+{
+	SampleScratch& Work = Scratch;
+	GrowTo(Work.Locals, JointCount);
+	GrowTo(Work.ParentGlobals, JointCount);
+	GrowTo(Work.Globals, JointCount);
+
+	const bool bScaled = (Stride > ScaleOffset);
+
+	for (uint32_t Slot = 0; Slot < JointCount; ++Slot)
+	{
+		uint32_t Joint = SolveOrder[Slot];
+		const float* Key = (LocalKeys + (Joint * Stride));
+
+		const float* Q = (Key + RotationOffset);
+		PQuaternion Rotation = PVector4Normalize(PVectorSet(Q[0], Q[1], Q[2], Q[3]));
+
+		const float* T = (Key + TranslationOffset);
+		PVector Translation = PVectorSet(T[0], T[1], T[2], 0.0f);
+		PVector Scale = bScaled ? PVectorSet(Key[ScaleOffset], Key[ScaleOffset + 1], Key[ScaleOffset + 2], 0.0f) : PVectorReplicate(1.0f);
+
+		Work.Locals[Slot] = PStoreMatrix(PMatrixAffineTransformation(Scale, Rotation, Translation));
+	}
+
+	// Roots are already in model space. Every deeper level is one batch: gather the parents' matrices beside the
+	// children's, then multiply all the pairs at once.
+	for (uint32_t Slot = 0; Slot < LevelStarts[1]; ++Slot)
+	{
+		Work.Globals[Slot] = Work.Locals[Slot];
+	}
+
+	for (size_t Depth = 1; (Depth + 1) < LevelStarts.size(); ++Depth)
+	{
+		uint32_t Begin = LevelStarts[Depth];
+		uint32_t End = LevelStarts[Depth + 1];
+
+		for (uint32_t Slot = Begin; Slot < End; ++Slot)
+		{
+			Work.ParentGlobals[Slot] = Work.Globals[SolveParents[Slot]];
+		}
+
+		PMultiplyMatricesPairwiseA((Work.Locals.data() + Begin), (Work.ParentGlobals.data() + Begin), (Work.Globals.data() + Begin), (End - Begin), Level);
+	}
+
+	for (uint32_t Slot = 0; Slot < JointCount; ++Slot)
+	{
+		OutPose[SolveOrder[Slot]] = Work.Globals[Slot];
+	}
+}
+
+// Copy keyframe Frame out into a Keyframe struct of model space matrices.
+PAnim::Keyframe PAnim::PackedClip::GetKeyframe(size_t Frame) const
+{
+	Keyframe Result;
+	Result.Time = Times[Frame];
+	Result.Joints.resize(JointCount);
+
+	std::vector<float4x4_a> Pose(JointCount);
+	Sample((float)Times[Frame], Pose);
+
+	for (size_t i = 0; i < JointCount; ++i)
+	{
+		memcpy(Result.Joints[i].Transform, &Pose[i], sizeof(Result.Joints[i].Transform));
+		Result.Joints[i].ParentIndex = Parents[i];
+	}
+
+	return Result;
+}
+
+// Return the memory used by the clip, in bytes.
+size_t PAnim::PackedClip::GetMemoryBytes() const
+{
+	size_t HierarchyBytes = (Parents.capacity() * sizeof(int)) + ((SolveOrder.capacity() + SolveParents.capacity() + LevelStarts.capacity()) * sizeof(uint32_t));
+
+	size_t TrackBytes = (Tracks.capacity() * sizeof(Track)) + ((KeyFrames.capacity() + QuantizedData.capacity()) * sizeof(uint16_t)) + (FloatData.capacity() * sizeof(float));
+
+	// Mapped keys are paged in from the file as they're read, but count them the same as keys held in memory.
+	size_t KeyBytes = MappedKeys ? (Times.size() * JointCount * KeyStride * sizeof(float)) : (Keys.capacity() * sizeof(float));
+
+	return sizeof(PackedClip) + (Times.capacity() * sizeof(double)) + HierarchyBytes + KeyBytes + TrackBytes;
+}
+
+// Quantize a unit quaternion to 3 words: the three smallest components at 15 bits, and which one was dropped.
+void PAnim::PackedClip::QuantizeRotation(const float* Rotation, uint16_t* OutWords)
+{
+	uint32_t Largest = 0;
+	for (uint32_t i = 1; i < 4; ++i)
+	{
+		if (fabsf(Rotation[i]) > fabsf(Rotation[Largest]))
+		{
+			Largest = i;
+		}
+	}
+
+	// Negating the whole quaternion keeps the rotation and makes the dropped component positive, so it can be rebuilt
+	// from the other three.
+	float Sign = (Rotation[Largest] < 0.0f) ? -1.0f : 1.0f;
+	uint32_t Word = 0;
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		if (i != Largest)
+		{
+			float Unit = fclamp(((Rotation[i] * Sign * SmallestThreeScale) * 0.5f) + 0.5f, 0.0f, 1.0f);
+			OutWords[Word++] = (uint16_t)lrintf(Unit * 32767.0f);
+		}
+	}
+
+	OutWords[0] |= (uint16_t)((Largest & 1) << 15);
+	OutWords[1] |= (uint16_t)((Largest >> 1) << 15);
+}
+
+// Expand 3 words written by QuantizeRotation().
+void PAnim::PackedClip::DequantizeRotation(const uint16_t* Words, float* OutRotation)
+{
+	uint32_t Largest = ((Words[0] >> 15) | ((Words[1] >> 15) << 1));
+	float LengthSq = 0.0f;
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		float Component = ((((Words[i] & 0x7FFF) * (2.0f / 32767.0f)) - 1.0f) * (1.0f / SmallestThreeScale));
+		OutRotation[SmallestThreeSlots[Largest][i]] = Component;
+		LengthSq += (Component * Component);
+	}
+
+	OutRotation[Largest] = sqrtf(std::max(0.0f, (1.0f - LengthSq)));
+}
+
+// Quantize a translation or scale to 16 bits per component within a track's range.
+void PAnim::PackedClip::QuantizeVector(const float* Vector, const Track& Range, uint16_t* OutWords)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		float Unit = (Range.Extent[i] > 0.0f) ? fclamp(((Vector[i] - Range.Min[i]) / Range.Extent[i]), 0.0f, 1.0f) : 0.0f;
+		OutWords[i] = (uint16_t)lrintf(Unit * 65535.0f);
+	}
+}
+
+// Expand 3 words written by QuantizeVector().
+void PAnim::PackedClip::DequantizeVector(const uint16_t* Words, const Track& Range, float* OutVector)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		OutVector[i] = Range.Min[i] + ((Words[i] * (1.0f / 65535.0f)) * Range.Extent[i]);
+	}
+}
+
+// Read one key of a compressed track into OutValue.
+void PAnim::PackedClip::ReadTrackKey(const Track& Source, uint32_t Channel, uint32_t Key, float* OutValue) const
+{
+	uint32_t Width = (Channel == 0) ? 4 : 3;
+
+	if (Source.bFloat)
+	{
+		memcpy(OutValue, (FloatData.data() + Source.DataOffset + (Key * Width)), (sizeof(float) * Width));
+	}
+	else
+	{
+		const uint16_t* Words = (QuantizedData.data() + Source.DataOffset + (Key * 3));
+
+		if (Channel == 0)
+		{
+			DequantizeRotation(Words, OutValue);
+		}
+		else
+		{
+			DequantizeVector(Words, Source, OutValue);
+		}
+	}
+}
+
+// Decode every compressed track at Frame + Alpha into OutKeys.
+void PAnim::PackedClip::DecompressKeys(size_t Frame, float Alpha, EAnimRotationBlends RotationBlend, float* OutKeys) const
+{
+	const uint32_t ChannelOffsets[3] = { RotationOffset, TranslationOffset, ScaleOffset };
+	const uint32_t TracksPerJoint = GetTracksPerJoint();
+	const float FramePosition = ((float)Frame + Alpha);
+
+	for (uint32_t Joint = 0; Joint < JointCount; ++Joint)
+	{
+		for (uint32_t Channel = 0; Channel < TracksPerJoint; ++Channel)
+		{
+			const Track& Source = Tracks[(Joint * TracksPerJoint) + Channel];
+			float* Out = (OutKeys + (Joint * KeyStride) + ChannelOffsets[Channel]);
+			uint32_t Width = (Channel == 0) ? 4 : 3;
+
+			if (Source.KeyCount == 1)
+			{
+				memcpy(Out, (FloatData.data() + Source.DataOffset), (sizeof(float) * Width));
+				continue;
+			}
+
+			// Find the last kept key at or before the frame. Every track keeps frame 0. The search has no branches on the
+			// keys, so it costs the same wherever the frame lands instead of a mispredict per step.
+			const uint16_t* First = (KeyFrames.data() + Source.FirstKey);
+			const uint16_t* Search = First;
+			for (uint32_t Length = Source.KeyCount; Length > 1;)
+			{
+				uint32_t Half = (Length / 2);
+				Search = (Search[Half] <= Frame) ? (Search + Half) : Search;
+				Length -= Half;
+			}
+
+			// Blend the kept keys either side of the frame.
+			uint32_t Key = std::min((uint32_t)(Search - First), (Source.KeyCount - 2));
+			float T = fclamp(((FramePosition - First[Key]) / (float)(First[Key + 1] - First[Key])), 0.0f, 1.0f);
+
+			float A[4];
+			float B[4];
+			ReadTrackKey(Source, Channel, Key, A);
+			ReadTrackKey(Source, Channel, (Key + 1), B);
+
+			if (Channel == 0)
+			{
+				// Quantizing drops each key's sign, so put the pair back on one side of the sphere.
+				if (((A[0] * B[0]) + (A[1] * B[1]) + (A[2] * B[2]) + (A[3] * B[3])) < 0.0f)
+				{
+					B[0] = -B[0];
+					B[1] = -B[1];
+					B[2] = -B[2];
+					B[3] = -B[3];
+				}
+
+				if (RotationBlend == ANIMBLEND_SLERP)
+				{
+					float4 Blended = PStoreFloat4(PQuaternionSlerp(PVectorSet(A[0], A[1], A[2], A[3]), PVectorSet(B[0], B[1], B[2], B[3]), T));
+					memcpy(Out, &Blended, sizeof(Blended));
+					continue;
+				}
+			}
+
+			for (uint32_t i = 0; i < Width; ++i)
+			{
+				Out[i] = A[i] + ((B[i] - A[i]) * T);
+			}
+		}
+	}
+}
+
+// Pack a clip from the model space matrix of every joint at every keyframe.
+PAnim::PackedClip PAnim::PackedClip::FromModelMatrices(double Duration, std::vector<double> Times, std::vector<int> Parents, const float* Matrices)
+{
+	PackedClip Packed;
+	Packed.Duration = Duration;
+	Packed.JointCount = (uint32_t)Parents.size();
+	Packed.Times = std::move(Times);
+	Packed.Parents = std::move(Parents);
+	Packed.BuildSolveOrder();
+
+	size_t FrameCount = Packed.Times.size();
+	uint32_t JointCount = Packed.JointCount;
+
+	// Split every key at full width first, then drop the scales if no joint ever scales.
+	constexpr uint32_t FullStride = 10;
+	std::vector<float> FullKeys(FrameCount * JointCount * FullStride);
+	bool bScaled = false;
+
+	for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+	{
+		const float* FrameMatrices = (Matrices + (Frame * JointCount * 16));
+
+		for (uint32_t Slot = 0; Slot < JointCount; ++Slot)
+		{
+			uint32_t Joint = Packed.SolveOrder[Slot];
+			PMatrix Model = LoadMatrix16(FrameMatrices + (Joint * 16));
+
+			// Model = Local * ParentModel, so the local matrix is Model * inverse(ParentModel).
+			if (Slot >= Packed.LevelStarts[1])
+			{
+				uint32_t ParentJoint = Packed.SolveOrder[Packed.SolveParents[Slot]];
+				Model = PMatrixMultiply(Model, PMatrixInverse(LoadMatrix16(FrameMatrices + (ParentJoint * 16))));
+			}
+
+			PVector Scale, Translation;
+			PQuaternion Rotation;
+			PMatrixDecompose(&Scale, &Rotation, &Translation, Model);
+
+			float* Key = (FullKeys.data() + (((Frame * JointCount) + Joint) * FullStride));
+
+			// Keep the rotation on the same side of the sphere as the joint's previous key, so lerping the two takes the short way round.
+			if (Frame > 0)
+			{
+				const float* Previous = (Key - (JointCount * FullStride));
+				if (PVector4Dot(Rotation, PVectorSet(Previous[0], Previous[1], Previous[2], Previous[3])) < 0.0f)
+				{
+					Rotation = PVectorNegate(Rotation);
+				}
+			}
+
+			float4 Q = PStoreFloat4(Rotation);
+			float3 T = PStoreFloat3(Translation);
+			float3 S = PStoreFloat3(Scale);
+
+			float Values[FullStride] = { Q.x, Q.y, Q.z, Q.w, T.x, T.y, T.z, S.x, S.y, S.z };
+			memcpy(Key, Values, sizeof(Values));
+
+			bScaled |= ((fabsf(S.x - 1.0f) > 1.0e-4f) || (fabsf(S.y - 1.0f) > 1.0e-4f) || (fabsf(S.z - 1.0f) > 1.0e-4f));
+		}
+	}
+
+	Packed.KeyStride = bScaled ? 10 : 7;
+	Packed.Keys.resize(FrameCount * JointCount * Packed.KeyStride);
+
+	for (size_t Key = 0; Key < (FrameCount * JointCount); ++Key)
+	{
+		memcpy((Packed.Keys.data() + (Key * Packed.KeyStride)), (FullKeys.data() + (Key * FullStride)), (sizeof(float) * Packed.KeyStride));
+	}
+
+	return Packed;
+}
+
+// Pack a clip of separate keyframes.
+PAnim::PackedClip PAnim::PackedClip::FromClip(const AnimClip& Clip)
+{
+	if (Clip.Frames.empty())
+	{
+		return FromModelMatrices(Clip.Duration, {}, {}, nullptr);
+	}
+
+	const std::vector<Joint>& FirstJoints = Clip.Frames[0].Joints;
+	size_t JointCount = FirstJoints.size();
+
+	std::vector<int> Parents(JointCount);
+	for (size_t i = 0; i < JointCount; ++i)
+	{
+		Parents[i] = FirstJoints[i].ParentIndex;
+	}
+
+	std::vector<double> Times(Clip.Frames.size());
+	std::vector<float> Matrices(Clip.Frames.size() * JointCount * 16);
+
+	for (size_t Frame = 0; Frame < Clip.Frames.size(); ++Frame)
+	{
+		const Keyframe& Source = Clip.Frames[Frame];
+		float* Dest = (Matrices.data() + (Frame * JointCount * 16));
+
+		Times[Frame] = Source.Time;
+
+		for (size_t i = 0; i < JointCount; ++i)
+		{
+			for (int x = 0; x < 16; ++x)
+			{
+				Dest[(i * 16) + x] = (i < Source.Joints.size()) ? Source.Joints[i].Transform[x] : ((x % 5 == 0) ? 1.0f : 0.0f);
+			}
+		}
+	}
+
+	return FromModelMatrices(Clip.Duration, std::move(Times), std::move(Parents), Matrices.data());
+}
+
+// Pack a clip around local keys already laid out like Keys, using them in place in File rather than copying them.
+PAnim::PackedClip PAnim::PackedClip::FromMappedKeys(double Duration, std::vector<double> Times, std::vector<int> Parents, uint32_t KeyStride, std::shared_ptr<const PFileMap> File, const float* Keys)
+{
+	PackedClip Packed;
+	Packed.Duration = Duration;
+	Packed.JointCount = (uint32_t)Parents.size();
+	Packed.KeyStride = KeyStride;
+	Packed.Times = std::move(Times);
+	Packed.Parents = std::move(Parents);
+	Packed.MappedKeys = Keys;
+	Packed.KeyFile = std::move(File);
+	Packed.BuildSolveOrder();
+
+	return Packed;
+}
+
+// Pack a clip around compressed tracks already laid out like Tracks, KeyFrames, QuantizedData, and FloatData.
+PAnim::PackedClip PAnim::PackedClip::FromTracks(double Duration, std::vector<double> Times, std::vector<int> Parents, uint32_t KeyStride, std::vector<Track> Tracks, std::vector<uint16_t> KeyFrames, std::vector<uint16_t> QuantizedData, std::vector<float> FloatData)
+{
+	PackedClip Packed;
+	Packed.Duration = Duration;
+	Packed.JointCount = (uint32_t)Parents.size();
+	Packed.KeyStride = KeyStride;
+	Packed.Times = std::move(Times);
+	Packed.Parents = std::move(Parents);
+	Packed.Tracks = std::move(Tracks);
+	Packed.KeyFrames = std::move(KeyFrames);
+	Packed.QuantizedData = std::move(QuantizedData);
+	Packed.FloatData = std::move(FloatData);
+	Packed.BuildSolveOrder();
+
+	return Packed;
+}
+
+// Fill SolveOrder, SolveParents, and LevelStarts from Parents.
+void PAnim::PackedClip::BuildSolveOrder()
+{
+	std::vector<int> Valid(JointCount);
+	for (uint32_t i = 0; i < JointCount; ++i)
+	{
+		int Parent = Parents[i];
+		Valid[i] = ((Parent >= 0) && ((uint32_t)Parent < JointCount) && ((uint32_t)Parent != i)) ? Parent : -1;
+	}
+
+	// A joint whose chain of parents never reaches a root is in (or under) a cycle. Cut it loose.
+	std::vector<uint32_t> Depths(JointCount, 0);
+	uint32_t MaxDepth = 0;
+
+	for (uint32_t i = 0; i < JointCount; ++i)
+	{
+		uint32_t Depth = 0;
+		for (int Parent = Valid[i]; Parent >= 0; Parent = Valid[Parent])
+		{
+			if (++Depth > JointCount)
+			{
+				Valid[i] = -1;
+				Depth = 0;
+				break;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < JointCount; ++i)
+	{
+		for (int Parent = Valid[i]; Parent >= 0; Parent = Valid[Parent])
+		{
+			Depths[i]++;
+		}
+
+		MaxDepth = std::max(MaxDepth, Depths[i]);
+	}
+
+	// Counting sort by depth, keeping joint order within each level.
+	LevelStarts.assign(MaxDepth + 2, 0);
+	for (uint32_t i = 0; i < JointCount; ++i)
+	{
+		LevelStarts[Depths[i] + 1]++;
+	}
+	for (size_t Depth = 1; Depth < LevelStarts.size(); ++Depth)
+	{
+		LevelStarts[Depth] += LevelStarts[Depth - 1];
+	}
+
+	std::vector<uint32_t> Slots(JointCount);
+	std::vector<uint32_t> Next(LevelStarts.begin(), (LevelStarts.end() - 1));
+
+	SolveOrder.resize(JointCount);
+	for (uint32_t i = 0; i < JointCount; ++i)
+	{
+		Slots[i] = Next[Depths[i]]++;
+		SolveOrder[Slots[i]] = i;
+	}
+
+	SolveParents.resize(JointCount);
+	for (uint32_t Slot = 0; Slot < JointCount; ++Slot)
+	{
+		int Parent = Valid[SolveOrder[Slot]];
+		SolveParents[Slot] = (Parent >= 0) ? Slots[Parent] : Slot;
+	}
+}
 
 // Called once per frame change.
 //
 // No return value.
-void PAnim::Update(float DeltaTime)
+void PAnim::Update(float DeltaTime)
+{
+	Anim.Advance(DeltaTime);
+
+	if (!Layers.empty())
+	{
+		UpdateLayers(DeltaTime);
+	}
+}
+
+// Advance every layer and its weight, and retire the layers that are done.
+//
+// No return value.
+void PAnim::UpdateLayers(float DeltaTime)
+{
+	for (AnimLayer& Layer : Layers)
+	{
+		Layer.Anim.Advance(DeltaTime);
+
+		if (Layer.WeightSpeed > 0.0f)
+		{
+			float Step = (Layer.WeightSpeed * DeltaTime);
+			float Remaining = (Layer.TargetWeight - Layer.Weight);
+
+			if (fabsf(Remaining) <= Step)
+			{
+				Layer.Weight = Layer.TargetWeight;
+				Layer.WeightSpeed = 0.0f;
+			}
+			else
+			{
+				Layer.Weight += ((Remaining > 0.0f) ? Step : -Step);
+			}
+		}
+	}
+
+	Layers.erase(std::remove_if(Layers.begin(), Layers.end(), [](const AnimLayer& Layer) { return (Layer.bRemoveWhenFaded && (Layer.Weight <= 0.0f)); }), Layers.end());
+
+	// A finished crossfade hides the base and any crossfade under it, so it takes the base's place.
+	for (size_t i = Layers.size(); i-- > 0;)
+	{
+		if (Layers[i].bReplacesBase && (Layers[i].Weight >= 1.0f))
+		{
+			Anim = Layers[i].Anim;
+			Layers.erase(Layers.begin(), (Layers.begin() + i + 1));
+			break;
+		}
+	}
+}
+
+// Blend Asset over the current pose.
+//
+// Returns the index of the new layer in Layers, or -1 if it could not be added.
+int PAnim::AddLayer(std::shared_ptr<const ClipAsset> Asset, float Weight, float BlendTime, std::span<const float> JointWeights)
+{
+	if (!GetReady() || !Asset || (Asset->Clip.JointCount != Anim.GetClip().JointCount))
+	{
+		PGameplayStatics::PrintToConsole(("Animation layer " + (Asset ? Asset->FilePath : std::string("(none)")) + " needs a playing animation with the same skeleton."), 3, "Animation");
+		return -1;
+	}
+
+	AnimLayer Layer;
+	Layer.Anim.Set(std::move(Asset), 0.0, false);
+	Layer.JointWeights.assign(JointWeights.begin(), JointWeights.end());
+
+	// A layer that fades in starts from nothing.
+	Layer.Weight = (BlendTime > 0.0f) ? 0.0f : Weight;
+
+	Layers.push_back(std::move(Layer));
+	FadeLayer((Layers.size() - 1), Weight, BlendTime);
+
+	return (int)(Layers.size() - 1);
+}
+
+// Blend the clip at AnimFilePath over the current pose.
+//
+// Returns the index of the new layer in Layers, or -1 if it could not be added.
+int PAnim::AddLayer(const char* AnimFilePath, float Weight, float BlendTime, std::span<const float> JointWeights)
+{
+	std::shared_ptr<const ClipAsset> Asset = AcquireClip(AnimFilePath, Compression);
+
+	return Asset ? AddLayer(std::move(Asset), Weight, BlendTime, JointWeights) : -1;
+}
+
+// Fade layer Layer to Weight over BlendTime seconds.
+//
+// No return value.
+void PAnim::FadeLayer(size_t Layer, float Weight, float BlendTime, bool bRemove)
+{
+	if (Layer >= Layers.size())
+	{
+		return;
+	}
+
+	AnimLayer& Fading = Layers[Layer];
+	Fading.TargetWeight = fclamp(Weight, 0.0f, 1.0f);
+	Fading.bRemoveWhenFaded = bRemove;
+
+	if (BlendTime > 0.0f)
+	{
+		Fading.WeightSpeed = (fabsf(Fading.TargetWeight - Fading.Weight) / BlendTime);
+	}
+	else
+	{
+		Fading.Weight = Fading.TargetWeight;
+		Fading.WeightSpeed = 0.0f;
+	}
+}
+
+// Blend from the current animation to the clip at AnimFilePath over BlendTime seconds.
+//
+// Returns true if the clip was loaded.
+bool PAnim::CrossfadeTo(const char* AnimFilePath, float BlendTime)
+{
+	std::shared_ptr<const ClipAsset> Asset = AcquireClip(AnimFilePath, Compression);
+
+	if (!Asset)
+	{
+		return false;
+	}
+
+	if (!GetReady() || (BlendTime <= 0.0f) || (Asset->Clip.JointCount != Anim.GetClip().JointCount))
+	{
+		bPoseCacheValid = false;
+		Anim.Set(std::move(Asset), 0.0, false);
+		return true;
+	}
+
+	// Crossfades sit under the layers added with AddLayer(), above any crossfade still running.
+	size_t Below = 0;
+	while ((Below < Layers.size()) && Layers[Below].bReplacesBase)
+	{
+		++Below;
+	}
+
+	AnimLayer Layer;
+	Layer.Anim.Set(std::move(Asset), 0.0, false);
+	Layer.Weight = 0.0f;
+	Layer.bReplacesBase = true;
+
+	Layers.insert((Layers.begin() + Below), std::move(Layer));
+	FadeLayer(Below, 1.0f, BlendTime);
+
+	return true;
+}
+
+// Fill OutWeights with 1 for joint Root and every joint under it and 0 for the rest.
+//
+// No return value.
+void PAnim::BuildJointMask(std::span<const int> Parents, int Root, std::vector<float>& OutWeights)
+{
+	OutWeights.assign(Parents.size(), 0.0f);
+
+	// Walk each joint up to a root. Chains longer than the skeleton are cycles, and left out.
+	for (size_t i = 0; i < Parents.size(); ++i)
+	{
+		int Joint = (int)i;
+
+		for (size_t Steps = 0; (Joint >= 0) && ((size_t)Joint < Parents.size()) && (Steps <= Parents.size()); ++Steps)
+		{
+			if (Joint == Root)
+			{
+				OutWeights[i] = 1.0f;
+				break;
+			}
+
+			Joint = Parents[Joint];
+		}
+	}
+}
+
+// Return how many times evaluating poses has had to allocate, on any thread.
+//
+// Returns the count.
+uint64_t PAnim::GetPoseAllocationCount()
+{
+	return PoseAllocations.load(std::memory_order_relaxed);
+}
+
+// Borrow a buffer of FloatCount floats from the calling thread's pool.
+PAnim::PoseBuffer::PoseBuffer(size_t FloatCount)
+{
+	auto& Free = FreePoseBuffers;
+
+	if (!Free.empty())
+	{
+		Data = std::move(Free.back());
+		Free.pop_back();
+	}
+
+	GrowTo(Data, FloatCount);
+}
+
+// Give the buffer back to the pool of the thread it's destroyed on.
+PAnim::PoseBuffer::~PoseBuffer()
+{
+	auto& Free = FreePoseBuffers;
+
+	if (Free.size() == Free.capacity())
+	{
+		PoseAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Free.push_back(std::move(Data));
+}
+
+// Advance and sample every animator in Animators across the job pool.
+//
+// No return value.
+void PAnim::UpdateAll(std::span<PAnim*> Animators, float DeltaTime, size_t BatchCount, LODStats* OutStats, InstancingStats* OutInstancing)
+{
+	// Group animators by clip, so a batch reads one clip's hierarchy and keys rather than a different clip per animator.
+	std::sort(Animators.begin(), Animators.end(), [](const PAnim* A, const PAnim* B)
+	{
+		return (A->Anim.GetAsset().get() < B->Anim.GetAsset().get());
+	});
+
+	// A few batches per thread lets threads that finish early pick up the rest.
+	if (BatchCount == 0)
+	{
+		BatchCount = ((size_t)PJobs::GetWorkerCount() + 1) * 4;
+	}
+
+	size_t Grain = std::max<size_t>(1, ((Animators.size() + BatchCount - 1) / BatchCount));
+
+	PJobs::ParallelFor(Animators.size(), Grain, [&](size_t Begin, size_t End)
+	{
+		for (size_t i = Begin; i < End; ++i)
+		{
+			PAnim* Animator = Animators[i];
+
+			if (Animator->GetReady())
+			{
+				Animator->Update(DeltaTime);
+
+				// Skipped frames keep the last pose, for anything that reads it before the next due frame.
+				uint32_t Count = Animator->UpdateCount++;
+				Animator->bPoseDue = (Animator->PoseInterval != 0) && (Animator->bPoseOverdue || ((Count % Animator->PoseInterval) == 0));
+
+				if (Animator->bPoseDue)
+				{
+					Animator->bPoseOverdue = false;
+
+					// Instanced poses are evaluated together once every animator has advanced.
+					if (Animator->Instancing.bEnabled && (Animator->Instancing.TimeStep > 0.0f) && Animator->Layers.empty())
+					{
+						Animator->bSharePending = true;
+					}
+					else
+					{
+						// PoseCache may be stale or empty while a shared pose stood in for it, so leaving instancing resamples.
+						if (Animator->SharedFrame)
+						{
+							Animator->SharedFrame.reset();
+							Animator->bPoseCacheValid = false;
+						}
+
+						Animator->GetPose();
+					}
+				}
+			}
+		}
+	});
+
+	EvaluateSharedPoses(Animators, OutInstancing);
+
+	if (OutStats)
+	{
+		*OutStats = LODStats();
+
+		for (const PAnim* Animator : Animators)
+		{
+			OutStats->Animators[Animator->LOD] += 1;
+			OutStats->Evaluated[Animator->LOD] += (Animator->bPoseDue ? 1 : 0);
+		}
+	}
+}
+
+// Give every animator marked bSharePending a shared pose, evaluating one per clip, rounded time, and blend.
+//
+// No return value.
+void PAnim::EvaluateSharedPoses(std::span<PAnim*> Animators, InstancingStats* OutStats)
 {
-	if (!Anim.GetPaused())
+	SharedPoseScratch& Work = SharedScratch;
+	Work.Requests.clear();
+	Work.Evaluate.clear();
+
+	for (PAnim* Animator : Animators)
+	{
+		if (!Animator->bSharePending)
+		{
+			continue;
+		}
+
+		Animator->bSharePending = false;
+
+		float TimeStep = Animator->Instancing.TimeStep;
+		int64_t Tick = (int64_t)std::llround(Animator->Anim.Time / (double)TimeStep);
+		EAnimRotationBlends Blend = (Animator->bInterpolatePose ? Animator->RotationBlend : ANIMBLEND_NEAREST);
+
+		Work.Requests.push_back({ Animator->Anim.GetAsset().get(), TimeStep, Tick, Blend, Animator });
+	}
+
+	if (OutStats)
+	{
+		*OutStats = InstancingStats();
+		OutStats->Requests = (uint32_t)Work.Requests.size();
+	}
+
+	if (Work.Requests.empty())
+	{
+		return;
+	}
+
+	std::sort(Work.Requests.begin(), Work.Requests.end(), [](const SharedPoseRequest& A, const SharedPoseRequest& B)
+	{
+		if (A.Asset != B.Asset) return (A.Asset < B.Asset);
+		if (A.TimeStep != B.TimeStep) return (A.TimeStep < B.TimeStep);
+		if (A.Tick != B.Tick) return (A.Tick < B.Tick);
+		return (A.Blend < B.Blend);
+	});
+
+	// Drop the shared poses the requesting animators held last frame, so they can be reused for this one.
+	for (const SharedPoseRequest& Request : Work.Requests)
 	{
-		Anim.Time += DeltaTime;
+		Request.Animator->SharedFrame.reset();
+	}
+
+	Work.FreeSlots.clear();
+
+	for (size_t i = 0; i < Work.Pool.size(); ++i)
+	{
+		if (Work.Pool[i].use_count() == 1)
+		{
+			Work.FreeSlots.push_back(i);
+		}
+	}
+
+	size_t NextFree = 0;
+
+	for (size_t First = 0; First < Work.Requests.size();)
+	{
+		const SharedPoseRequest& Key = Work.Requests[First];
+
+		std::shared_ptr<SharedPose> Shared;
+
+		if (NextFree < Work.FreeSlots.size())
+		{
+			Shared = Work.Pool[Work.FreeSlots[NextFree++]];
+		}
+		else
+		{
+			PoseAllocations.fetch_add(1, std::memory_order_relaxed);
+			Shared = std::make_shared<SharedPose>();
+			Work.Pool.push_back(Shared);
+		}
 
-		if (Anim.Time > Anim.GetDuration())
+		const PackedClip& Clip = Key.Asset->Clip;
+		float SampleTime = (float)std::clamp((double)Key.Tick * (double)Key.TimeStep, 0.0, Clip.Duration);
+
+		Shared->Asset = Key.Animator->Anim.GetAsset();
+		Shared->SampleTime = SampleTime;
+		Shared->Blend = Key.Blend;
+		Shared->ResetPalettes();
+		Work.Evaluate.push_back(Shared.get());
+
+		size_t Last = First;
+
+		for (; (Last < Work.Requests.size()) && Work.Requests[Last].SameKey(Key); ++Last)
+		{
+			PAnim* Animator = Work.Requests[Last].Animator;
+
+			Animator->SharedFrame = Shared;
+			Animator->PoseCacheTime = Animator->Anim.Time;
+			Animator->bPoseCacheValid = true;
+			++Animator->PoseVersion;
+		}
+
+		First = Last;
+	}
+
+	PJobs::ParallelFor(Work.Evaluate.size(), 1, [&](size_t Begin, size_t End)
+	{
+		for (size_t i = Begin; i < End; ++i)
 		{
-			Anim.Time = 0.0f;
+			SharedPose* Shared = Work.Evaluate[i];
+			const PackedClip& Clip = Shared->Asset->Clip;
+
+			GrowTo(Shared->Pose, Clip.JointCount);
+			Clip.Sample(Shared->SampleTime, Shared->Pose, Shared->Blend);
 		}
+	});
+
+	if (OutStats)
+	{
+		OutStats->Evaluations = (uint32_t)Work.Evaluate.size();
+	}
+}
+
+// Return the skinning palette for this pose, building it the first time it's asked for.
+//
+// Returns a view of the palette.
+std::span<const float4x4_a> PAnim::SharedPose::GetPalette(bool bMirrorX, PSimdLevel Level)
+{
+	std::lock_guard<std::mutex> Lock(PaletteLock);
+
+	std::vector<float4x4_a>& Palette = Palettes[bMirrorX ? 1 : 0];
+
+	if (!bPaletteReady[bMirrorX ? 1 : 0])
+	{
+		GrowTo(Palette, Pose.size());
+		Palette.resize(PSkinning::ComputePalette(Asset->InverseBind, Pose, Palette, bMirrorX, Level));
+		bPaletteReady[bMirrorX ? 1 : 0] = true;
+	}
+
+	return Palette;
+}
+
+// Return the palette as dual quaternions, building it the first time it's asked for.
+//
+// Returns a view of the dual quaternions.
+std::span<const PSkinning::DualQuat> PAnim::SharedPose::GetDualQuats(bool bMirrorX, PSimdLevel Level)
+{
+	std::span<const float4x4_a> Palette = GetPalette(bMirrorX, Level);
+
+	std::lock_guard<std::mutex> Lock(PaletteLock);
+
+	std::vector<PSkinning::DualQuat>& Quats = DualQuats[bMirrorX ? 1 : 0];
+
+	if (!bDualQuatsReady[bMirrorX ? 1 : 0])
+	{
+		GrowTo(Quats, Palette.size());
+		PSkinning::ComputeDualQuats(Palette, Quats);
+		bDualQuatsReady[bMirrorX ? 1 : 0] = true;
+	}
+
+	return Quats;
+}
+
+// Clear the palettes, for a pose that has just been sampled again.
+//
+// No return value.
+void PAnim::SharedPose::ResetPalettes()
+{
+	bPaletteReady[0] = bPaletteReady[1] = false;
+	bDualQuatsReady[0] = bDualQuatsReady[1] = false;
+}
+
+// Return the level of detail for an animated mesh that covers ScreenSize of the screen's height.
+//
+// Returns the level.
+EAnimLODs PAnim::SelectLOD(const LODSettings& Settings, float ScreenSize, bool bVisible)
+{
+	if (!Settings.bEnabled)
+	{
+		return ANIMLOD_FULL;
+	}
+
+	if (!bVisible)
+	{
+		return ANIMLOD_OFFSCREEN;
+	}
+
+	if (ScreenSize < Settings.DistantScreenSize)
+	{
+		return ANIMLOD_DISTANT;
+	}
+
+	if (ScreenSize < Settings.ReducedScreenSize)
+	{
+		return ANIMLOD_REDUCED;
+	}
+
+	return ANIMLOD_FULL;
+}
+
+// Set this animator's level of detail.
+//
+// No return value.
+void PAnim::SetLOD(EAnimLODs NewLOD, const LODSettings& Settings)
+{
+	EAnimLODs OldLOD = LOD;
+
+	LOD = NewLOD;
+	bInterpolatePose = (NewLOD != ANIMLOD_DISTANT);
+
+	switch (NewLOD)
+	{
+	case ANIMLOD_REDUCED:
+		PoseInterval = std::max<uint32_t>(Settings.ReducedInterval, 1);
+		break;
+	case ANIMLOD_DISTANT:
+		PoseInterval = std::max<uint32_t>(Settings.DistantInterval, 1);
+		break;
+	case ANIMLOD_OFFSCREEN:
+		PoseInterval = 0;
+		break;
+	default:
+		PoseInterval = 1;
+		break;
+	}
+
+	// Coming back on screen evaluates on the next update rather than showing the pose it left with for a whole interval.
+	if ((OldLOD == ANIMLOD_OFFSCREEN) && (NewLOD != ANIMLOD_OFFSCREEN))
+	{
+		bPoseOverdue = true;
 	}
 }
 
+// Return a different starting UpdateCount for each animator created.
+//
+// Returns the count.
+uint32_t PAnim::NextPoseStagger()
+{
+	static std::atomic<uint32_t> Next{ 0 };
+
+	return Next.fetch_add(1, std::memory_order_relaxed);
+}
+
 // Play an animation if it exists at the input file path. If no path is supplied, it will attempt to play any loaded animation.
 //
 // Returns true if the animation was loaded and played, false otherwise.
@@ -107,7 +1309,7 @@ double PAnim::GetDuration()
 // Returns a keyframe struct.
 PAnim::Keyframe PAnim::GetKeyframe()
 {
-	return Anim.GetClip().Frames[Anim.GetFrameAtTime()];
+	return Anim.GetClip().GetKeyframe(Anim.GetFrameAtTime());
 }
 
 // Return the current Keyframe that the animation is on.
@@ -115,7 +1317,7 @@ PAnim::Keyframe PAnim::GetKeyframe()
 // Returns a keyframe struct.
 PAnim::Keyframe PAnim::GetKeyframe(float InTime)
 {
-	return Anim.GetClip().Frames[Anim.GetFrameAtTime(InTime)];
+	return Anim.GetClip().GetKeyframe(Anim.GetFrameAtTime(InTime));
 }
 
 // Return the keyframe from the current animation at index Frame.
@@ -123,7 +1325,7 @@ PAnim::Keyframe PAnim::GetKeyframe(float InTime)
 // Returns a keyframe struct.
 PAnim::Keyframe PAnim::GetKeyframeAt(int FrameNum)
 {
-	return Anim.GetClip().Frames[FrameNum];
+	return Anim.GetClip().GetKeyframe(FrameNum);
 }
 
 // Return the next Keyframe that the animation is will move to.
@@ -141,7 +1343,7 @@ PAnim::Keyframe PAnim::GetNextKeyframe(PAnim::Keyframe StartFrame)
 {
 	// This is broken.
 	int NextFrame = Anim.GetFrameAtTime(StartFrame.Time) + 1;
-	int MaxSize = Anim.GetClip().Frames.size();
+	int MaxSize = Anim.GetClip().GetFrameCount();
 
 	if ((NextFrame < MaxSize) && (NextFrame >= 0))
 	{
@@ -159,37 +1361,155 @@ PAnim::Keyframe PAnim::GetNextKeyframe(PAnim::Keyframe StartFrame)
 // time to get the blended frame for.
 PAnim::Keyframe PAnim::GetLerpKeyframe(float CheckTime)
 {
-	Keyframe CurrFrame = (CheckTime < 0.0f) ? GetKeyframe(Anim.GetTime()) : GetKeyframe(CheckTime);
-	Keyframe NextFrame = GetNextKeyframe(CurrFrame);
-
 	Keyframe Blended;
 	Blended.Time = (CheckTime < 0.0f) ? Anim.Time : CheckTime;
-	Blended.Joints.resize(CurrFrame.Joints.size());
 
-	float CurrTime = abs(Blended.Time - CurrFrame.Time);
-	float MaxTime = (NextFrame.Time >= CurrFrame.Time) ? abs(NextFrame.Time - CurrFrame.Time) : (abs(GetDuration() - CurrFrame.Time));
+	std::vector<float4x4_a> Pose(GetJointCount());
+	if (!SamplePose((float)Blended.Time, Pose))
+	{
+		return Blended;
+	}
 
-	float LerpTime = fclamp(1 - (CurrTime/MaxTime), 0.f, 1.f);
+	Blended.Joints.resize(Pose.size());
 
-	for (unsigned int i = 0; i < CurrFrame.Joints.size(); ++i)
+	for (size_t i = 0; i < Pose.size(); ++i)
 	{
-		Blended.Joints[i].ParentIndex = CurrFrame.Joints[i].ParentIndex;
+		Blended.Joints[i].ParentIndex = Anim.GetClip().Parents[i];
 
-		for (unsigned int x = 0; x < 16; ++x)
+		for (int Row = 0; Row < 4; ++Row)
 		{
-			Blended.Joints[i].Transform[x] = std::lerp(CurrFrame.Joints[i].Transform[x], NextFrame.Joints[i].Transform[x], LerpTime);
+			for (int Col = 0; Col < 4; ++Col)
+			{
+				Blended.Joints[i].Transform[(Row * 4) + Col] = Pose[i][Row][Col];
+			}
 		}
 	}
 
 	return Blended;
 }
 
+// Return the number of joints in each pose of the loaded animation.
+//
+// Returns 0 if no animation is loaded.
+size_t PAnim::GetJointCount()
+{
+	return GetReady() ? Anim.GetClip().JointCount : 0;
+}
+
+// Return the parent of every joint in the loaded animation, -1 for root joints.
+//
+// Returns a view of the parent indices, valid until another animation is loaded.
+std::span<const int> PAnim::GetJointParents()
+{
+	return Anim.GetClip().Parents;
+}
+
+// Blend the two keyframes around SampleTime and write each joint's model space matrix into OutPose.
+//
+// Returns true if a pose was written.
+bool PAnim::SamplePose(float SampleTime, std::span<float4x4_a> OutPose)
+{
+	const PackedClip& Clip = Anim.GetClip();
+	size_t JointCount = GetJointCount();
+
+	if (Clip.Times.empty() || (JointCount == 0) || (OutPose.size() < JointCount))
+	{
+		return false;
+	}
+
+	Clip.Sample(SampleTime, OutPose, RotationBlend);
+
+	return true;
+}
+
+// Return the pose at the current animation time, sampling it only if the time has changed since the last call.
+//
+// Returns a view of the cached pose. Empty if no animation is ready.
+std::span<const float4x4_a> PAnim::GetPose()
+{
+	if (!GetReady())
+	{
+		return {};
+	}
+
+	// A shared pose stands in for PoseCache until this animator needs one of its own: a new animation, new time, or layers.
+	if (SharedFrame)
+	{
+		if (bPoseCacheValid && Layers.empty() && (!bPoseDue || (PoseCacheTime == Anim.Time)))
+		{
+			return SharedFrame->GetPose();
+		}
+
+		SharedFrame.reset();
+		bPoseCacheValid = false;
+	}
+
+	if (!bPoseCacheValid || (bPoseDue && ((PoseCacheTime != Anim.Time) || !Layers.empty())))
+	{
+		const PackedClip& Clip = Anim.GetClip();
+		GrowTo(PoseCache, GetJointCount());
+
+		if (Clip.Times.empty() || PoseCache.empty())
+		{
+			return {};
+		}
+
+		EAnimRotationBlends Blend = (bInterpolatePose ? RotationBlend : ANIMBLEND_NEAREST);
+
+		if (Layers.empty())
+		{
+			Clip.Sample((float)Anim.Time, PoseCache, Blend);
+		}
+		else
+		{
+			EvaluateLayers(Blend);
+		}
+
+		PoseCacheTime = Anim.Time;
+		bPoseCacheValid = true;
+		++PoseVersion;
+	}
+
+	return PoseCache;
+}
+
+// Sample Anim and every layer as local poses, blend them, and solve the result into PoseCache.
+//
+// No return value.
+void PAnim::EvaluateLayers(EAnimRotationBlends Blend)
+{
+	const PackedClip& Clip = Anim.GetClip();
+	size_t FloatCount = ((size_t)Clip.JointCount * PackedClip::LocalStride);
+
+	PoseBuffer Blended(FloatCount);
+	PoseBuffer Layer(FloatCount);
+
+	Clip.SampleLocal((float)Anim.Time, Blended.Get(), Blend);
+
+	for (const AnimLayer& Over : Layers)
+	{
+		const PackedClip& OverClip = Over.Anim.GetClip();
+
+		// Layers left behind by a change of skeleton are skipped.
+		if ((Over.Weight <= 0.0f) || (OverClip.JointCount != Clip.JointCount) || OverClip.Times.empty())
+		{
+			continue;
+		}
+
+		OverClip.SampleLocal((float)Over.Anim.Time, Layer.Get(), Blend);
+		PackedClip::BlendLocal(Blended.Get(), Layer.Get(), Over.Weight, Over.JointWeights);
+	}
+
+	Clip.SolveLocal(Blended.Get(), PoseCache);
+}
+
 // Jump the current frame ahead or behind by Num number of frames, if possible.
 //
 // No return value.
 void PAnim::FrameJump(int Num)
 {
 	Anim.FrameJump(Num);
+	MarkSeek();
 }
 
 // Set the current time to this keyframe, if an animation exists.
@@ -198,6 +1518,7 @@ void PAnim::FrameJump(int Num)
 void PAnim::FrameSet(int Frame)
 {
 	Anim.FrameSet(Frame);
+	MarkSeek();
 }
 
 // Set the current time to this keyframe, if an animation exists.
@@ -206,6 +1527,17 @@ void PAnim::FrameSet(int Frame)
 void PAnim::TimeSet(float pTime)
 {
 	Anim.TimeSet(pTime);
+	MarkSeek();
+}
+
+// Honour an explicit seek even while the level of detail is skipping this animator or it is off screen.
+//
+// No return value.
+void PAnim::MarkSeek()
+{
+	// GetPose resamples straight away, and the next update evaluates whatever the interval.
+	bPoseCacheValid = false;
+	bPoseOverdue = true;
 }
 
 // Get the filepath for the currently loaded animation.
@@ -229,66 +1561,104 @@ bool PAnim::GetReady()
 // Returns true if the animation was loaded successfully, otherwise false.
 bool PAnim::LoadAnimation(const char* AnimFilePath)
 {
-	// Open the file (mesh) in binary input mode.
-	std::fstream file{ (PGameplayStatics::GetGameDirectory() + "Assets/" + AnimFilePath), std::ios_base::in | std::ios_base::binary };
+	std::shared_ptr<const ClipAsset> Asset = AcquireClip(AnimFilePath, Compression);
 
-	// Ensure the file opened correctly.
-	if (file.is_open())
+	if (!Asset)
 	{
-		// Setup index count for the mesh.
-		AnimClip	NewClip;
-		BindPose	NewBind;
+		return false;
+	}
 
-		int			NumFrames;
-		int			NumBindJoints;
+	bPoseCacheValid = false;
 
-		file.read((char*)&NumBindJoints, sizeof(uint32_t));
-		//NewBind.Joints.resize(NumBindJoints);
+	Anim.Set(std::move(Asset));
 
-		for (unsigned int i = 0; i < NumBindJoints; ++i)
-		{
-			Joint NewJoint;
+	return true;
+}
 
-			file.read((char*)&NewJoint, sizeof(PAnim::Joint));
+// Return the shared clip loaded from AnimFilePath and compressed with Settings, loading it if no animator holds it.
+//
+// Returns nullptr if the file could not be loaded.
+std::shared_ptr<const PAnim::ClipAsset> PAnim::AcquireClip(const std::string& AnimFilePath, const CompressionSettings& Settings)
+{
+	const std::string Key = GetClipKey(AnimFilePath, Settings);
+	std::unique_lock<std::mutex> Lock(ClipCacheLock);
 
-			NewBind.Joints.push_back(NewJoint);
-		}
+	std::shared_ptr<const ClipAsset> Shared = ClipCache[Key].lock();
+	if (Shared)
+	{
+		return Shared;
+	}
 
-		Anim.GetBindPose() = NewBind;
+	// Load without holding the lock, so animators loading other clips aren't held up behind this one.
+	Lock.unlock();
+	std::shared_ptr<const ClipAsset> Loaded = LoadClipAsset(AnimFilePath, Settings);
+	Lock.lock();
 
-		file.read((char*)&NewClip.Duration, sizeof(double));
-		file.read((char*)&NumFrames, sizeof(uint32_t));
+	// Forget clips that every animator has let go of.
+	for (auto It = ClipCache.begin(); It != ClipCache.end();)
+	{
+		It = It->second.expired() ? ClipCache.erase(It) : std::next(It);
+	}
 
-		for (unsigned int i = 0; i < NumFrames; ++i)
-		{
-			PAnim::Keyframe NewFrame;
+	// Another animator may have loaded the same file meanwhile. Everyone shares the first copy.
+	Shared = ClipCache[Key].lock();
+	if (!Shared && Loaded)
+	{
+		Shared = Loaded;
+		ClipCache[Key] = Shared;
+	}
 
-			file.read((char*)&NewFrame.Time, sizeof(double));
+	return Shared;
+}
 
-			int NumJoints;
-			file.read((char*)&NumJoints, sizeof(uint32_t));
+// Return the number of clips loaded and shared.
+size_t PAnim::GetLoadedClipCount()
+{
+	std::lock_guard<std::mutex> Lock(ClipCacheLock);
 
-			for (unsigned int j = 0; j < NumJoints; ++j)
-			{
-				PAnim::Joint NewJoint;
+	size_t Count = 0;
+	for (const auto& Entry : ClipCache)
+	{
+		Count += Entry.second.expired() ? 0 : 1;
+	}
 
-				file.read((char*)&NewJoint, sizeof(PAnim::Joint));
+	return Count;
+}
 
-				NewFrame.Joints.push_back(NewJoint);
-			}
+// Read and pack the clip and bind pose in an .anim file.
+//
+// Returns nullptr if the file could not be loaded.
+std::shared_ptr<const PAnim::ClipAsset> PAnim::LoadClipAsset(const std::string& AnimFilePath, const CompressionSettings& Settings)
+{
+	std::shared_ptr<ClipAsset> Asset = PAnimFile::Load(PGameplayStatics::GetGameDirectory() + "Assets/" + AnimFilePath);
 
-			NewClip.Frames.push_back(NewFrame);
-		}
+	if (!Asset)
+	{
+		return nullptr;
+	}
+
+	Asset->FilePath = AnimFilePath;
 
-		// Close the file.
-		file.close();
+	// Files compressed when they were upgraded are used as stored. Compressing is lossy, so they can't be redone here.
+	if (Asset->Compression.bEnabled)
+	{
+		bool bSameSettings = Settings.bEnabled && (Settings.MaxError == Asset->Compression.MaxError) && (Settings.TipDistance == Asset->Compression.TipDistance);
+
+		if (!bSameSettings)
+		{
+			PGameplayStatics::PrintToConsole((AnimFilePath + " was compressed with a max error of " + std::to_string(Asset->Compression.MaxError) + " when it was upgraded, so this animator's compression settings don't apply. Re-export it to change them."), 3, "Animation");
+		}
 
-		Anim.Set(AnimFilePath, NewClip);
+		return Asset;
 	}
-	else
+
+	// Anything else is compressed on every load. Upgrading the file (PAnimFile::Convert()) does it once instead.
+	PAnimCompression::Report CompressionReport;
+	if (Settings.bEnabled && PAnimCompression::Compress(Asset->Clip, Settings, &CompressionReport))
 	{
-		return false;
+		Asset->Compression = Settings;
+		PGameplayStatics::PrintToConsole(("Compressed " + AnimFilePath + " on load: " + PAnimCompression::FormatReport(CompressionReport) + " Upgrade it to compress it once."), 0, "Animation");
 	}
 
-	return true;
+	return Asset;
 }
@@ -2,11 +2,37 @@
 
 #include <vector>
 #include <string>
+#include <span>
+#include <memory>
+#include <mutex>
+#include <algorithm>
 
 #include "../../../PStatics/PGameplayStatics/PGameplayStatics.h"
+#include "../../../PMath/PSimd.h"
+#include "../PSkinning/PSkinning.h"
 
 using namespace PMath;
 
+class PFileMap;
+
+// How the rotations of two keyframes are blended.
+enum EAnimRotationBlends
+{
+	ANIMBLEND_NLERP = 0,		// Normalized lerp. Cheap, and within a fraction of a degree of slerp between neighbouring keys.
+	ANIMBLEND_SLERP = 1,		// Spherical lerp. Constant angular speed, for widely spaced keys.
+	ANIMBLEND_NEAREST = 2		// No blending. Snaps to the nearest keyframe, for animators too small on screen to show it.
+};
+
+// How much work an animator's pose gets each frame, from most to least. See PAnim::LODSettings.
+enum EAnimLODs
+{
+	ANIMLOD_FULL = 0,			// The pose is evaluated every frame.
+	ANIMLOD_REDUCED = 1,		// The pose is evaluated every few frames.
+	ANIMLOD_DISTANT = 2,		// The pose is evaluated every few more frames, snapped to the nearest keyframe.
+	ANIMLOD_OFFSCREEN = 3,		// Only the time advances. The last pose is kept.
+	ANIMLOD_COUNT = 4
+};
+
 class PAnim
 {
 public:
@@ -18,7 +44,7 @@ public:
 
 		bool operator==(const Joint& Input) const
 		{
-			return ((Transform == Input.Transform) && (ParentIndex == Input.ParentIndex));
+			return (std::equal(std::begin(Transform), std::end(Transform), std::begin(Input.Transform)) && (ParentIndex == Input.ParentIndex));
 		}
 	};
 
@@ -63,6 +89,187 @@ public:
 		}
 	};
 
+	// An animation clip packed into one block of memory for playback.
+	//
+	// Each joint is keyed in its parent's space as a rotation quaternion, a translation, and (only if some joint in the
+	// clip scales) a scale: 7 or 10 floats instead of a 16 float matrix. Keys are laid out [frame][joint][component], so
+	// one keyframe is JointCount * KeyStride contiguous floats and blending two keyframes is a single pass over two arrays.
+	// Each joint's rotations are kept on the same side of the quaternion sphere as its previous key, so that blend is a
+	// valid nlerp once the result is normalized. The hierarchy is stored once, with the order forward kinematics solves it.
+	//
+	// A clip can be compressed (see PAnimCompression), which replaces Keys with one track per joint per channel (rotation,
+	// translation, scale). A track is either a single constant value or a list of the keyframes it keeps, and sampling
+	// blends a track's two kept keys around the sample time, so decompression is two key reads per track.
+	struct PackedClip
+	{
+		// Floats in each key. The rotation is first (x, y, z, w), then the translation, then the scale if HasScale().
+		static constexpr uint32_t RotationOffset = 0;
+		static constexpr uint32_t TranslationOffset = 4;
+		static constexpr uint32_t ScaleOffset = 7;
+
+		// Floats per joint in a local pose (see SampleLocal()): the rotation, translation, and scale, scaled or not.
+		static constexpr uint32_t LocalStride = 10;
+
+		// One channel of one joint in a compressed clip. Quantized rotations are 3 words (smallest three), quantized
+		// translations and scales are 3 words within the track's range. Constant tracks always hold floats.
+		struct Track
+		{
+			uint32_t KeyCount = 0;			// The number of kept keys, 1 for a constant track.
+			uint32_t FirstKey = 0;			// Where the track's frame numbers start in KeyFrames.
+			uint32_t DataOffset = 0;		// Where the track's values start in FloatData if bFloat, otherwise in QuantizedData.
+			uint32_t bFloat = 0;			// Whether values are stored as floats rather than quantized.
+			float Min[3] = {};				// Quantized translations and scales: the smallest value of each component.
+			float Extent[3] = {};			// Quantized translations and scales: the range of each component.
+		};
+
+		double Duration = 0.0;
+		uint32_t JointCount = 0;
+		uint32_t KeyStride = 7;											// Floats per joint key, 7 without scale or 10 with it.
+		std::vector<double> Times;										// The time of each keyframe.
+		std::vector<int> Parents;										// The parent of each joint, -1 for root joints.
+		std::vector<float, PAlignedAllocator<float, 64>> Keys;			// KeyStride floats per joint, JointCount joints per keyframe.
+		const float* MappedKeys = nullptr;								// Clips loaded from .anim files: the keys, used in place in KeyFile instead of Keys.
+		std::shared_ptr<const PFileMap> KeyFile;						// The mapped file MappedKeys points into, kept open while the clip uses it.
+
+		std::vector<uint32_t> SolveOrder;								// Joints sorted by depth, parents before children.
+		std::vector<uint32_t> SolveParents;								// The SolveOrder position of each SolveOrder joint's parent.
+		std::vector<uint32_t> LevelStarts;								// Where each depth starts in SolveOrder, then the joint count.
+
+		std::vector<Track> Tracks;										// Compressed clips: GetTracksPerJoint() tracks per joint, in joint order.
+		std::vector<uint16_t> KeyFrames;								// Compressed clips: the frame number of each kept key, ascending per track.
+		std::vector<uint16_t> QuantizedData;							// Compressed clips: 3 words per quantized key.
+		std::vector<float> FloatData;									// Compressed clips: 4 (rotation) or 3 floats per float key.
+
+		// Return the number of keyframes.
+		size_t GetFrameCount() const { return Times.size(); }
+
+		// Return whether keys carry a scale.
+		bool HasScale() const { return (KeyStride == 10); }
+
+		// Return the first float of keyframe Frame. Only valid for clips that are not compressed.
+		const float* GetFrame(size_t Frame) const { return ((MappedKeys ? MappedKeys : Keys.data()) + (Frame * JointCount * KeyStride)); }
+
+		// Return whether the clip holds compressed tracks instead of Keys.
+		bool IsCompressed() const { return !Tracks.empty(); }
+
+		// Return the number of tracks per joint of a compressed clip: rotation, translation, and scale if HasScale().
+		uint32_t GetTracksPerJoint() const { return (HasScale() ? 3 : 2); }
+
+		// Blend the keys around SampleTime and solve the hierarchy, writing each joint's model space matrix into OutPose
+		// (which must hold JointCount matrices). Times outside the keys hold the end pose. Scratch space is kept per
+		// thread, so nothing is allocated once a thread has sampled its largest skeleton.
+		void Sample(float SampleTime, std::span<float4x4_a> OutPose, EAnimRotationBlends RotationBlend = ANIMBLEND_NLERP, PSimdLevel Level = PSimdLevel::AVX2) const;
+
+		// Blend the keys around SampleTime into OutKeys as a local pose: LocalStride floats per joint in joint order, with
+		// rotations normalized and a scale of 1 if the clip has none. OutKeys must hold JointCount * LocalStride floats.
+		// Local poses of clips on the same skeleton can be blended (BlendLocal()) and then solved once (SolveLocal()).
+		void SampleLocal(float SampleTime, std::span<float> OutKeys, EAnimRotationBlends RotationBlend = ANIMBLEND_NLERP, PSimdLevel Level = PSimdLevel::AVX2) const;
+
+		// Solve a local pose of this clip's skeleton into each joint's model space matrix, as Sample() does.
+		void SolveLocal(std::span<const float> LocalKeys, std::span<float4x4_a> OutPose, PSimdLevel Level = PSimdLevel::AVX2) const;
+
+		// Blend the local pose Source over Dest by Weight, which is scaled per joint by JointWeights if it isn't empty
+		// (joints past its end aren't blended). Rotations are nlerped the short way round.
+		static void BlendLocal(std::span<float> Dest, std::span<const float> Source, float Weight, std::span<const float> JointWeights = {});
+
+		// Copy keyframe Frame out into a Keyframe struct of model space matrices.
+		Keyframe GetKeyframe(size_t Frame) const;
+
+		// Return the memory used by the clip, in bytes.
+		size_t GetMemoryBytes() const;
+
+		// Pack a clip from the model space matrix of every joint at every keyframe, laid out [frame][joint][16 floats], as
+		// the exporter writes them. Each matrix is made relative to its parent and split into rotation, translation, and
+		// scale. Shear from non uniform scale on a parent is not kept.
+		static PackedClip FromModelMatrices(double Duration, std::vector<double> Times, std::vector<int> Parents, const float* Matrices);
+
+		// Pack a clip of separate keyframes, as the FBX exporter builds them. The first keyframe decides the joint count
+		// and hierarchy, joints missing from later keyframes are left at identity.
+		static PackedClip FromClip(const AnimClip& Clip);
+
+		// Pack a clip around local keys already laid out like Keys, using them in place in File rather than copying them.
+		// Keys must hold Times.size() * Parents.size() * KeyStride floats and stay inside File.
+		static PackedClip FromMappedKeys(double Duration, std::vector<double> Times, std::vector<int> Parents, uint32_t KeyStride, std::shared_ptr<const PFileMap> File, const float* Keys);
+
+		// Pack a clip around compressed tracks already laid out like Tracks, KeyFrames, QuantizedData, and FloatData, as
+		// PAnimCompression builds them. The tracks are trusted, so check them first if they came from a file.
+		static PackedClip FromTracks(double Duration, std::vector<double> Times, std::vector<int> Parents, uint32_t KeyStride, std::vector<Track> Tracks, std::vector<uint16_t> KeyFrames, std::vector<uint16_t> QuantizedData, std::vector<float> FloatData);
+
+		// Quantize a unit quaternion to 3 words: the three smallest components at 15 bits, and which one was dropped.
+		static void QuantizeRotation(const float* Rotation, uint16_t* OutWords);
+
+		// Expand 3 words written by QuantizeRotation(). The result may be the negated quaternion, the same rotation.
+		static void DequantizeRotation(const uint16_t* Words, float* OutRotation);
+
+		// Quantize a translation or scale to 16 bits per component within a track's range.
+		static void QuantizeVector(const float* Vector, const Track& Range, uint16_t* OutWords);
+
+		// Expand 3 words written by QuantizeVector().
+		static void DequantizeVector(const uint16_t* Words, const Track& Range, float* OutVector);
+
+		// Read key Key of a compressed track of channel Channel (0 rotation, 1 translation, 2 scale) into OutValue.
+		void ReadTrackKey(const Track& Source, uint32_t Channel, uint32_t Key, float* OutValue) const;
+
+	private:
+		// Fill SolveOrder, SolveParents, and LevelStarts from Parents. Parents out of range, and cycles, become roots.
+		void BuildSolveOrder();
+
+		// Blend the keys around SampleTime into OutKeys, laid out like one keyframe of Keys.
+		void SampleKeys(float SampleTime, EAnimRotationBlends RotationBlend, PSimdLevel Level, float* OutKeys) const;
+
+		// Build each joint's local matrix from LocalKeys (Stride floats per joint) and solve the hierarchy into OutPose.
+		void Solve(const float* LocalKeys, uint32_t Stride, std::span<float4x4_a> OutPose, PSimdLevel Level) const;
+
+		// Decode every compressed track at Frame + Alpha into OutKeys, laid out like one keyframe of Keys.
+		void DecompressKeys(size_t Frame, float Alpha, EAnimRotationBlends RotationBlend, float* OutKeys) const;
+	};
+
+	// How clips are compressed when they're loaded. See PAnimCompression.
+	struct CompressionSettings
+	{
+		bool bEnabled = true;			// Whether LoadAnimation() compresses clips.
+		float MaxError = 0.01f;			// The furthest any joint or joint tip may move from the source pose, in model units.
+		float TipDistance = 10.0f;		// How far each joint's virtual tips sit from it along its X and Y axes, in model units.
+	};
+
+	// Thresholds for choosing an animator's level of detail. Screen sizes are the share of the screen's height covered by
+	// the bounding sphere of the mesh being animated.
+	struct LODSettings
+	{
+		bool bEnabled = true;				// When false the animator always runs at ANIMLOD_FULL.
+		float ReducedScreenSize = 0.2f;		// Below this size, ANIMLOD_REDUCED.
+		float DistantScreenSize = 0.05f;	// Below this size, ANIMLOD_DISTANT.
+		uint32_t ReducedInterval = 2;		// ANIMLOD_REDUCED evaluates the pose once every this many frames.
+		uint32_t DistantInterval = 4;		// ANIMLOD_DISTANT evaluates the pose once every this many frames.
+	};
+
+	// Opt in to sharing poses with other animators. UpdateAll() rounds the time of each animator that opts in to the
+	// nearest multiple of TimeStep, and evaluates one pose for all of those playing the same clip at the same rounded time
+	// and blend, which skinning then turns into one palette (see SharedPose). Animators with layers never share.
+	struct InstancingSettings
+	{
+		bool bEnabled = false;				// Whether UpdateAll() shares this animator's pose.
+		float TimeStep = 1.0f / 30.0f;		// Shared poses are sampled at multiples of this many seconds. Larger steps share more poses and step more visibly.
+	};
+
+	// How many animators UpdateAll() found at each level of detail, and how many of those had their pose evaluated.
+	struct LODStats
+	{
+		uint32_t Animators[ANIMLOD_COUNT] = {};
+		uint32_t Evaluated[ANIMLOD_COUNT] = {};
+	};
+
+	// How many of the poses UpdateAll() evaluated were shared. Requests counts animators that opted in to instancing and
+	// were due a pose, Evaluations the distinct poses evaluated for them.
+	struct InstancingStats
+	{
+		uint32_t Requests = 0;
+		uint32_t Evaluations = 0;
+
+		// Return the share of requests that reused another animator's pose, from 0 to 1.
+		float GetHitRate() const { return ((Requests > 0) ? (1.0f - ((float)Evaluations / (float)Requests)) : 0.0f); }
+	};
+
 	// A bind pose holds the Joint information for a bind pose.
 	struct BindPose
 	{
@@ -84,16 +291,25 @@ public:
 		}
 	};
 
-	// An animation holds an AnimClip, and extra information about it.
+	// A loaded clip and the bind pose it was exported with. Each file is loaded once and shared, read only, by every
+	// animator playing it (see AcquireClip()).
+	struct ClipAsset
+	{
+		std::string			FilePath;					// The file the clip was loaded from, relative to the Assets folder.
+		PAnim::PackedClip	Clip;						// The keyframes.
+		PAnim::BindPose		Bind;						// The bind pose.
+		std::vector<float4x4_a>	InverseBind;			// The inverse of each bind pose joint, to build skinning palettes from (see PSkinning).
+		CompressionSettings	Compression = { false };	// The settings Clip went through compression with, offline or on load. bEnabled is false if it never did.
+	};
+
+	// An animation holds a shared clip, and this animator's playback of it.
 	struct Animation
 	{
 	private:
 		// Information about the current animation.
 		//
 
-		std::string			FilePath = "";				// The location of the animation that is playing.
-		PAnim::AnimClip		CurrentAnim;				// The current AnimClip that is loaded, holding the duration and frames.
-		PAnim::BindPose		Bind;						// The current bind pose for the animation.
+		std::shared_ptr<const ClipAsset> Asset;			// The clip that is loaded, shared with every animator playing it.
 
 		// Information about the current animation clip.
 		//
@@ -106,21 +322,17 @@ public:
 		//
 
 		double				Time = 0.0;					// The current time in the animation playback.
+		double				Speed = 1.0;				// How fast playback runs, 1 for the clip's own speed. Negative plays backwards.
 
 		// Setup a new animation to play through this Animation container.
 		//
-		// Filepath and AnimClip inputs are required.
-		void Set(std::string File, PAnim::AnimClip Clip, double CurrTime = 0.0f, bool bShouldPause = true)
+		// A loaded clip is required.
+		void Set(std::shared_ptr<const ClipAsset> NewAsset, double CurrTime = 0.0f, bool bShouldPause = true)
 		{
-			FilePath = File;
-			CurrentAnim = Clip;
+			Asset = std::move(NewAsset);
 			Time = CurrTime;
 			bPaused = bShouldPause;
-
-			if (FilePath != "")
-			{
-				bReady = true;
-			}
+			bReady = (Asset != nullptr);
 		}
 
 
@@ -131,28 +343,30 @@ public:
 		// Returns whether this component is ready to play animations.
 		bool GetReady()
 		{
-			return (FilePath != "" && bReady);
+			return (Asset && bReady);
 		}
 
 		// Returns the filepath of the loaded animation.
 		std::string GetFile()
 		{
-			return FilePath;
+			return Asset ? Asset->FilePath : "";
 		}
 
 		// Returns the current clip of this animation.
-		AnimClip GetClip()
+		const PackedClip& GetClip() const
 		{
-			return CurrentAnim;
+			static const PackedClip Empty;
+
+			return Asset ? Asset->Clip : Empty;
 		}
 
 		// Returns the frame number for a given Keyframe object. Returns -1 if not found.
 		// This is broken.
 		int GetFrame(Keyframe InFrame)
 		{
-			for (unsigned int i = 0; i < CurrentAnim.Frames.size(); ++i)
+			for (unsigned int i = 0; i < GetClip().GetFrameCount(); ++i)
 			{
-				if (CurrentAnim.Frames[i] == InFrame)
+				if (GetClip().GetKeyframe(i) == InFrame)
 				{
 					return i;
 				}
@@ -164,19 +378,19 @@ public:
 		// Returns the current frame number of this animation based on the current playtime.
 		unsigned int GetFrameAtTime()
 		{
-			return (int)(fclamp(((float)Time / (float)CurrentAnim.Duration) * (float)CurrentAnim.Frames.size(), 0.0f, (float)CurrentAnim.Frames.size() - 1));
+			return (int)(fclamp(((float)Time / (float)GetClip().Duration) * (float)GetClip().GetFrameCount(), 0.0f, (float)GetClip().GetFrameCount() - 1));
 		}
 
 		// Returns the current frame number of this animation based on the input pTime.
 		unsigned int GetFrameAtTime(float pTime)
 		{
-			return (int)(fclamp(floorf((pTime / (float)CurrentAnim.Duration) * (float)CurrentAnim.Frames.size()), 0.0f, (float)CurrentAnim.Frames.size() - 1));
+			return (int)(fclamp(floorf((pTime / (float)GetClip().Duration) * (float)GetClip().GetFrameCount()), 0.0f, (float)GetClip().GetFrameCount() - 1));
 		}
 
 		// Returns the current timestamp of this animation based on the input Frame.
 		float GetTimeAtFrame(int Frame)
 		{
-			return (float)(fclamp(((float)Frame / (float)(GetClip().Frames.size() - 1)) * (float)GetDuration(), 0.0f, (float)GetDuration()));
+			return (float)(fclamp(((float)Frame / (float)(GetClip().GetFrameCount() - 1)) * (float)GetDuration(), 0.0f, (float)GetDuration()));
 		}
 
 		// Jump the current frame ahead or behind by Num number of frames, if possible.
@@ -187,9 +401,9 @@ public:
 				unsigned int CurrFrame = GetFrameAtTime();
 				unsigned int NextFrame = CurrFrame + Num;
 
-				if (((NextFrame) <= CurrentAnim.Frames.size()) && ((NextFrame) >= 0))
+				if (((NextFrame) < GetClip().GetFrameCount()) && ((NextFrame) >= 0))
 				{
-					Time = CurrentAnim.Frames[NextFrame].Time;
+					Time = GetClip().Times[NextFrame];
 				}
 			}
 		}
@@ -197,16 +411,16 @@ public:
 		// Set the current frame of animation to clip number Frame.
 		void FrameSet(int Frame)
 		{
-			if (GetReady() && (Frame <= CurrentAnim.Frames.size()) && (Frame >= 0))
+			if (GetReady() && (Frame <= GetClip().GetFrameCount()) && (Frame >= 0))
 			{
-				Time = ((Frame / CurrentAnim.Frames.size()) * GetDuration());
+				Time = ((Frame / GetClip().GetFrameCount()) * GetDuration());
 			}
 		}
 
 		// Set the current time to this keyframe, if an animation exists.
 		void TimeSet(float pTime)
 		{
-			if (GetReady() && (pTime <= CurrentAnim.Frames[CurrentAnim.Frames.size() - 1].Time) && (pTime >= 0))
+			if (GetReady() && !GetClip().Times.empty() && (pTime <= GetClip().Times.back()) && (pTime >= 0))
 			{
 				Time = (fclamp(pTime, 0.0f, GetDuration()));
 			}
@@ -215,9 +429,9 @@ public:
 		// Returns the duration of the loaded animation.
 		double GetDuration()
 		{
-			if (FilePath != "")
+			if (Asset)
 			{
-				return CurrentAnim.Duration;
+				return GetClip().Duration;
 			}
 			else
 			{
@@ -228,7 +442,7 @@ public:
 		// Returns the current timestamp of the animation.
 		double GetTime()
 		{
-			if (FilePath != "")
+			if (Asset)
 			{
 				return Time;
 			}
@@ -245,15 +459,17 @@ public:
 		}
 
 		// Returns the currently loaded Bind Pose.
-		PAnim::BindPose GetBindPose() const
+		const PAnim::BindPose& GetBindPose() const
 		{
-			return Bind;
+			static const PAnim::BindPose Empty;
+
+			return Asset ? Asset->Bind : Empty;
 		}
 
-		// Returns the currently loaded Bind Pose.
-		PAnim::BindPose& GetBindPose()
+		// Returns the shared clip that is loaded, if any.
+		const std::shared_ptr<const ClipAsset>& GetAsset() const
 		{
-			return Bind;
+			return Asset;
 		}
 
 
@@ -278,11 +494,105 @@ public:
 				bPaused = true;
 			}
 		}
+
+		// Move the time on by DeltaTime at Speed, looping at either end, unless paused.
+		void Advance(float DeltaTime)
+		{
+			if (!bPaused)
+			{
+				Time += (DeltaTime * Speed);
+
+				if (Time > GetDuration())
+				{
+					Time = 0.0f;
+				}
+				else if (Time < 0.0)
+				{
+					Time = GetDuration();
+				}
+			}
+		}
+	};
+
+	// A clip blended over the animation below it. Layers are blended in order over Anim, each replacing Weight of the pose
+	// so far, so crossfades and clips that only drive part of the skeleton (see BuildJointMask()) stack freely.
+	struct AnimLayer
+	{
+		Animation Anim;							// The clip and its playback. Each layer keeps its own time.
+		float Weight = 1.0f;					// How much of the pose below it the layer replaces, 0 to 1.
+		float TargetWeight = 1.0f;				// Weight moves toward this by WeightSpeed per second.
+		float WeightSpeed = 0.0f;				// How far Weight moves per second. 0 holds it.
+		std::vector<float> JointWeights;		// A scale on Weight per joint. Empty applies the layer to every joint.
+		bool bRemoveWhenFaded = false;			// Whether the layer is removed once Weight reaches 0.
+		bool bReplacesBase = false;				// Whether the layer becomes Anim once Weight reaches 1 (see CrossfadeTo()).
+	};
+
+	// A pose sized buffer borrowed from the calling thread's pool, and given back when it's destroyed. Each thread's pool
+	// keeps every buffer it has lent, so evaluating poses stops allocating once each thread has evaluated its largest.
+	class PoseBuffer
+	{
+	public:
+		// Borrow a buffer of FloatCount floats, 64 byte aligned. Its contents are left over from its last use.
+		explicit PoseBuffer(size_t FloatCount);
+		~PoseBuffer();
+
+		PoseBuffer(const PoseBuffer&) = delete;
+		PoseBuffer& operator=(const PoseBuffer&) = delete;
+
+		// Returns the floats.
+		std::span<float> Get() { return { Data.data(), Data.size() }; }
+
+	private:
+		std::vector<float, PAlignedAllocator<float, 64>> Data;
+	};
+
+	// A pose UpdateAll() evaluated once for every instanced animator on the same clip, rounded time, and blend, along with
+	// the skinning palettes built from it. Each palette is built by whichever mesh asks for it first in a frame, and the
+	// rest of the crowd reads it. Shared poses are pooled and reused once no animator holds them.
+	class SharedPose
+	{
+	public:
+		// Returns the pose.
+		std::span<const float4x4_a> GetPose() const { return Pose; }
+
+		// Return the skinning palette for this pose (see PSkinning::ComputePalette()), building it the first time it's
+		// asked for. Safe to call from several threads at once.
+		//
+		// Returns a view of the palette, valid while the shared pose is held.
+		std::span<const float4x4_a> GetPalette(bool bMirrorX, PSimdLevel Level = PSimdLevel::AVX2);
+
+		// Return the palette as dual quaternions (see PSkinning::ComputeDualQuats()), building it the first time it's
+		// asked for. Safe to call from several threads at once.
+		//
+		// Returns a view of the dual quaternions, valid while the shared pose is held.
+		std::span<const PSkinning::DualQuat> GetDualQuats(bool bMirrorX, PSimdLevel Level = PSimdLevel::AVX2);
+
+	private:
+		friend class PAnim;
+
+		std::shared_ptr<const ClipAsset> Asset;					// The clip the pose was sampled from.
+		float SampleTime = 0.0f;								// The rounded time it was sampled at.
+		EAnimRotationBlends Blend = ANIMBLEND_NLERP;			// How its rotations were blended.
+		std::vector<float4x4_a> Pose;
+
+		std::mutex PaletteLock;									// Held while a palette is built.
+		std::vector<float4x4_a> Palettes[2];					// Indexed by bMirrorX.
+		std::vector<PSkinning::DualQuat> DualQuats[2];			// Indexed by bMirrorX.
+		bool bPaletteReady[2] = {};
+		bool bDualQuatsReady[2] = {};
+
+		// Clear the palettes, for a pose that has just been sampled again.
+		//
+		// No return value.
+		void ResetPalettes();
 	};
 
 	// This is the current animation's information. It holds not only the loaded frames for animation, but also information about the animation that is currently loaded, if one is.
 	Animation Anim;
 
+	// The layers blended over Anim, bottom first. See AddLayer() and CrossfadeTo().
+	std::vector<AnimLayer> Layers;
+
 
 	// ------------------------------------------------------------------
 	//		Animation Playback Controls.
@@ -345,8 +655,107 @@ public:
 	// two other frames. Essentially blends two keyframes that exist into a new keyframe 
 	// containing a new frame that would exist between frame A and B. CheckTime is the 
 	// time to get the blended frame for. Leave CheckTime at -1 to use the current time.
+	//
+	// NOTE: This allocates a new keyframe on every call. Use SamplePose() or GetPose() every frame instead.
 	Keyframe GetLerpKeyframe(float CheckTime = -1.0f);
 
+	// Return the number of joints in each pose of the loaded animation.
+	//
+	// Returns 0 if no animation is loaded.
+	size_t GetJointCount();
+
+	// Return the parent of every joint in the loaded animation, -1 for root joints. Joints are in the same order as the
+	// matrices written by SamplePose().
+	//
+	// Returns a view of the parent indices, valid until another animation is loaded.
+	std::span<const int> GetJointParents();
+
+	// Blend the two keyframes around SampleTime and write each joint's model space matrix into OutPose. OutPose must hold at
+	// least GetJointCount() matrices. Nothing is copied out of the clip and nothing is allocated.
+	//
+	// Returns true if a pose was written.
+	bool SamplePose(float SampleTime, std::span<float4x4_a> OutPose);
+
+	// Return the pose at the current animation time, with Layers blended over it. It is sampled the first time it's asked
+	// for after the time changes (every time while there are layers), so every consumer in a frame (skinning, debug
+	// lines, bounds) shares one sample. On frames the level of detail skips (see SetLOD()), the last pose is returned as
+	// it was. Blending borrows PoseBuffers, so it allocates nothing once the thread has blended this many joints.
+	//
+	// Returns a view of the cached pose, valid until the next call that samples a new one. Empty if no animation is ready.
+	std::span<const float4x4_a> GetPose();
+
+	// Return the shared pose GetPose() is returning, so consumers can reuse what was built from it, such as the skinning
+	// palette. Call it after GetPose().
+	//
+	// Returns nullptr when the pose is this animator's own.
+	const std::shared_ptr<SharedPose>& GetSharedPose() const { return SharedFrame; }
+
+	// Return a count that goes up each time GetPose() samples a new pose, so consumers can tell a held pose from a new one.
+	//
+	// Returns the count.
+	uint64_t GetPoseVersion() const { return PoseVersion; }
+
+	// Advance every animator in Animators by DeltaTime and sample its pose into its cache (see GetPose()), spread across
+	// the job pool. Animators are reordered so those sharing a clip are in the same batch, and its keys stay in cache.
+	// Animators that aren't ready are skipped, and so is the pose of any the level of detail skips this frame. Animators
+	// that opt in to instancing share one pose per clip, rounded time, and blend (see InstancingSettings). Each
+	// animator may only appear once. BatchCount splits the work into that many batches, so at most that many threads
+	// take part. Leave it at 0 to split for the pool. OutStats and OutInstancing, if given, are filled with counts for
+	// this call.
+	//
+	// No return value.
+	static void UpdateAll(std::span<PAnim*> Animators, float DeltaTime, size_t BatchCount = 0, LODStats* OutStats = nullptr, InstancingStats* OutInstancing = nullptr);
+
+	// Blend Asset over the current pose at Weight, fading in over BlendTime seconds if it's more than 0, and only over
+	// the joints JointWeights gives weight to if it isn't empty. The clip must have the same skeleton as Anim's, and it
+	// starts playing from its first keyframe.
+	//
+	// Returns the index of the new layer in Layers, or -1 if no animation is ready or the skeletons differ.
+	int AddLayer(std::shared_ptr<const ClipAsset> Asset, float Weight = 1.0f, float BlendTime = 0.0f, std::span<const float> JointWeights = {});
+
+	// Blend the clip at AnimFilePath (relative to the Assets folder) over the current pose, as above.
+	//
+	// Returns the index of the new layer in Layers, or -1 if it could not be added.
+	int AddLayer(const char* AnimFilePath, float Weight = 1.0f, float BlendTime = 0.0f, std::span<const float> JointWeights = {});
+
+	// Fade layer Layer to Weight over BlendTime seconds. If bRemove, the layer is removed once it reaches 0, and the
+	// layers above it move down one.
+	//
+	// No return value.
+	void FadeLayer(size_t Layer, float Weight, float BlendTime, bool bRemove = false);
+
+	// Blend from the current animation to the clip at AnimFilePath over BlendTime seconds, after which it becomes Anim.
+	// Layers added with AddLayer() stay over it. Without a ready animation, or a BlendTime of 0 or less, it plays at once.
+	//
+	// Returns true if the clip was loaded.
+	bool CrossfadeTo(const char* AnimFilePath, float BlendTime);
+
+	// Fill OutWeights with 1 for joint Root and every joint under it and 0 for the rest, for a layer that only drives part
+	// of the skeleton, such as the upper body from the spine up.
+	//
+	// No return value.
+	static void BuildJointMask(std::span<const int> Parents, int Root, std::vector<float>& OutWeights);
+
+	// Return how many times evaluating poses has had to allocate, on any thread: growing sampling scratch, a pose cache,
+	// or a PoseBuffer. The count stops rising once every thread has evaluated its largest pose and blend.
+	//
+	// Returns the count.
+	static uint64_t GetPoseAllocationCount();
+
+	// Return the level of detail for an animated mesh that covers ScreenSize of the screen's height, and was drawn last
+	// frame if bVisible.
+	//
+	// Returns the level.
+	static EAnimLODs SelectLOD(const LODSettings& Settings, float ScreenSize, bool bVisible);
+
+	// Set this animator's level of detail, and with it how often and how carefully UpdateAll() evaluates its pose.
+	//
+	// No return value.
+	void SetLOD(EAnimLODs NewLOD, const LODSettings& Settings);
+
+	// Returns the current level of detail.
+	EAnimLODs GetLOD() const { return LOD; }
+
 	// Jump the current frame ahead or behind by Num number of frames, if possible.
 	//
 	// No return value.
@@ -372,9 +781,76 @@ public:
 	// Returns true if the animation is ready to be played.
 	bool GetReady();
 
+	// How SamplePose() and GetPose() blend rotations.
+	EAnimRotationBlends RotationBlend = ANIMBLEND_NLERP;
+
+	// How LoadAnimation() compresses the clips it loads. Animators asking for different settings get their own copy.
+	CompressionSettings Compression;
+
+	// Whether UpdateAll() shares this animator's pose with others on the same clip.
+	InstancingSettings Instancing;
+
+	// Return the shared clip loaded from AnimFilePath (relative to the Assets folder) and compressed with Settings, loading
+	// it if no animator holds it. Clips are shared by path and settings, so the same file compressed differently is a
+	// separate clip. Clips are unloaded when the last holder lets go. Safe to call from any thread.
+	//
+	// Returns nullptr if the file could not be loaded.
+	static std::shared_ptr<const ClipAsset> AcquireClip(const std::string& AnimFilePath, const CompressionSettings& Settings);
+
+	// Return the number of clips loaded and shared.
+	//
+	// Returns the count of clips that at least one holder still holds.
+	static size_t GetLoadedClipCount();
+
 private:
-	// Load an animation into the current Animation variable.
+	std::vector<float4x4_a> PoseCache;			// The pose returned by GetPose().
+	double PoseCacheTime = 0.0;					// The animation time PoseCache was sampled at.
+	bool bPoseCacheValid = false;				// Cleared when a new animation is loaded.
+	uint64_t PoseVersion = 0;					// Counts the poses sampled into PoseCache.
+
+	EAnimLODs LOD = ANIMLOD_FULL;				// The level of detail set by SetLOD().
+	uint32_t PoseInterval = 1;					// UpdateAll() evaluates the pose every this many updates. 0 never does.
+	bool bInterpolatePose = true;				// When false, poses snap to the nearest keyframe.
+	uint32_t UpdateCount = NextPoseStagger();	// Counts UpdateAll() updates. Starts at a different value per animator, so a crowd at one level spreads its poses over the interval.
+	bool bPoseDue = true;						// Whether GetPose() may sample a new pose. Cleared on frames the level of detail skips.
+	bool bPoseOverdue = false;					// Set when coming back on screen or seeking, so the next update evaluates whatever the interval.
+	bool bSharePending = false;					// Set by UpdateAll() for an instanced animator due a pose, until it's given a shared one.
+	std::shared_ptr<SharedPose> SharedFrame;	// The shared pose GetPose() returns in place of PoseCache, if any.
+
+	// Return a different starting UpdateCount for each animator created.
+	//
+	// Returns the count.
+	static uint32_t NextPoseStagger();
+
+	// Give every animator in Animators marked bSharePending a shared pose, evaluating one per clip, rounded time, and
+	// blend across the job pool.
+	//
+	// No return value.
+	static void EvaluateSharedPoses(std::span<PAnim*> Animators, InstancingStats* OutStats);
+
+	// Advance every layer and its weight by DeltaTime, remove those that have faded out, and make a crossfade that has
+	// finished the base animation.
+	//
+	// No return value.
+	void UpdateLayers(float DeltaTime);
+
+	// Sample Anim and every layer as local poses, blend them, and solve the result into PoseCache.
+	//
+	// No return value.
+	void EvaluateLayers(EAnimRotationBlends Blend);
+
+	// Honour an explicit seek even while the level of detail is skipping this animator or it is off screen.
+	//
+	// No return value.
+	void MarkSeek();
+
+	// Load an animation into the current Animation variable, sharing it if another animator already loaded it.
 	//
 	// Returns true if the animation was loaded successfully, otherwise false.
 	bool LoadAnimation(const char* AnimFilePath);
+
+	// Read and pack the clip and bind pose in an .anim file.
+	//
+	// Returns nullptr if the file could not be opened.
+	static std::shared_ptr<const ClipAsset> LoadClipAsset(const std::string& AnimFilePath, const CompressionSettings& Settings);
 };
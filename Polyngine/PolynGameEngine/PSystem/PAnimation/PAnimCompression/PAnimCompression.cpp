@@ -0,0 +1,541 @@
+#include "PAnimCompression.h"
+#include "../../../PMath/PVectorMath.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+using namespace PMath;
+
+namespace PAnimCompression
+{
+	namespace
+	{
+		// Segments between kept keys are never longer than this, which bounds the search for the next key to keep.
+		constexpr uint32_t MaxKeyGap = 256;
+
+		// Each joint is measured at its origin and at its two virtual tips.
+		constexpr uint32_t PointsPerJoint = 3;
+
+		// Where each channel starts in a key, and how many floats it has.
+		constexpr uint32_t ChannelOffsets[3] = { PAnim::PackedClip::RotationOffset, PAnim::PackedClip::TranslationOffset, PAnim::PackedClip::ScaleOffset };
+		constexpr uint32_t ChannelWidths[3] = { 4, 3, 3 };
+
+		// Everything the compressor measures against while it works through one clip.
+		struct ClipState
+		{
+			const PAnim::PackedClip* Clip = nullptr;
+			uint32_t JointCount = 0;
+			size_t FrameCount = 0;
+			float MaxErrorSq = 0.0f;
+
+			std::vector<int> ParentOf;							// Each joint's parent as the clip solves it, -1 for roots.
+			std::vector<std::vector<uint32_t>> Subtrees;		// Each joint and every joint below it.
+			std::vector<float3> SourcePoints;					// [frame][joint][point] in model space, from the source keys.
+			std::vector<float4x4_a> SourceInverses;				// [frame][joint] the inverse of the source model space matrix.
+			std::vector<float4x4_a> LossyGlobals;				// [frame][joint] the model space matrix from compressed keys, once the joint is done.
+		};
+
+		// The tracks and key data of a clip being compressed.
+		struct TrackOutput
+		{
+			std::vector<PAnim::PackedClip::Track> Tracks;
+			std::vector<uint16_t> KeyFrames;
+			std::vector<uint16_t> QuantizedData;
+			std::vector<float> FloatData;
+		};
+
+		// Build a joint's matrix relative to its parent from one key.
+		PMatrix MakeLocal(const float* Key, bool bScale)
+		{
+			PQuaternion Rotation = PVector4Normalize(PVectorSet(Key[0], Key[1], Key[2], Key[3]));
+			PVector Translation = PVectorSet(Key[4], Key[5], Key[6], 0.0f);
+			PVector Scale = bScale ? PVectorSet(Key[7], Key[8], Key[9], 0.0f) : PVectorReplicate(1.0f);
+
+			return PMatrixAffineTransformation(Scale, Rotation, Translation);
+		}
+
+		// Store the model space points a joint is measured at: its origin, then its tips along X and Y.
+		void StorePoints(const PMatrix& Global, float TipDistance, float3* OutPoints)
+		{
+			OutPoints[0] = PStoreFloat3(Global.r[3]);
+			OutPoints[1] = PStoreFloat3(PVectorMultiplyAdd(Global.r[0], PVectorReplicate(TipDistance), Global.r[3]));
+			OutPoints[2] = PStoreFloat3(PVectorMultiplyAdd(Global.r[1], PVectorReplicate(TipDistance), Global.r[3]));
+		}
+
+		// Solve the source pose of every keyframe and keep what the error checks measure against.
+		void Prepare(ClipState& State, const PAnim::PackedClip& Clip, const PAnim::CompressionSettings& Settings)
+		{
+			const uint32_t JointCount = Clip.JointCount;
+
+			State.Clip = &Clip;
+			State.JointCount = JointCount;
+			State.FrameCount = Clip.GetFrameCount();
+			State.MaxErrorSq = (Settings.MaxError * Settings.MaxError);
+
+			State.ParentOf.assign(JointCount, -1);
+			for (uint32_t Slot = Clip.LevelStarts[1]; Slot < JointCount; ++Slot)
+			{
+				State.ParentOf[Clip.SolveOrder[Slot]] = (int)Clip.SolveOrder[Clip.SolveParents[Slot]];
+			}
+
+			State.Subtrees.assign(JointCount, {});
+			for (uint32_t Joint = 0; Joint < JointCount; ++Joint)
+			{
+				State.Subtrees[Joint].push_back(Joint);
+
+				for (int Parent = State.ParentOf[Joint]; Parent >= 0; Parent = State.ParentOf[Parent])
+				{
+					State.Subtrees[Parent].push_back(Joint);
+				}
+			}
+
+			State.SourcePoints.resize(State.FrameCount * JointCount * PointsPerJoint);
+			State.SourceInverses.resize(State.FrameCount * JointCount);
+			State.LossyGlobals.resize(State.FrameCount * JointCount);
+
+			std::vector<PMatrix> Globals(JointCount);
+
+			for (size_t Frame = 0; Frame < State.FrameCount; ++Frame)
+			{
+				const float* FrameKeys = Clip.GetFrame(Frame);
+				size_t Base = (Frame * JointCount);
+
+				for (uint32_t Slot = 0; Slot < JointCount; ++Slot)
+				{
+					uint32_t Joint = Clip.SolveOrder[Slot];
+					int Parent = State.ParentOf[Joint];
+
+					PMatrix Local = MakeLocal((FrameKeys + (Joint * Clip.KeyStride)), Clip.HasScale());
+					Globals[Joint] = (Parent >= 0) ? PMatrixMultiply(Local, Globals[Parent]) : Local;
+
+					State.SourceInverses[Base + Joint] = PStoreMatrix(PMatrixInverse(Globals[Joint]));
+					StorePoints(Globals[Joint], Settings.TipDistance, &State.SourcePoints[(Base + Joint) * PointsPerJoint]);
+				}
+			}
+		}
+
+		// Return whether giving Joint the local key Key at Frame keeps it, its tips, and everything below it within
+		// MaxError of the source. Its parents are taken as compressed, and the joints below it as not yet compressed.
+		bool WithinError(const ClipState& State, uint32_t Joint, size_t Frame, const float* Key)
+		{
+			size_t Base = (Frame * State.JointCount);
+			int Parent = State.ParentOf[Joint];
+
+			PMatrix Lossy = MakeLocal(Key, State.Clip->HasScale());
+			if (Parent >= 0)
+			{
+				Lossy = PMatrixMultiply(Lossy, PLoadMatrix(State.LossyGlobals[Base + Parent]));
+			}
+
+			// Everything below the joint moves rigidly with it, from where the source put the joint to where the key does.
+			PMatrix Delta = PMatrixMultiply(PLoadMatrix(State.SourceInverses[Base + Joint]), Lossy);
+
+			for (uint32_t Below : State.Subtrees[Joint])
+			{
+				const float3* Points = &State.SourcePoints[(Base + Below) * PointsPerJoint];
+
+				for (uint32_t i = 0; i < PointsPerJoint; ++i)
+				{
+					PVector Source = PLoadFloat3(Points[i]);
+					PVector Offset = PVectorSubtract(PVector3Transform(Source, Delta), Source);
+
+					if (PVector3Dot(Offset, Offset) > State.MaxErrorSq)
+					{
+						return false;
+					}
+				}
+			}
+
+			return true;
+		}
+
+		// Compress one channel of one joint into Output. Values holds the joint's keys, [frame][KeyStride], with channels
+		// already compressed holding what they decode to. This channel's values are updated the same way on return.
+		void CompressChannel(const ClipState& State, uint32_t Joint, uint32_t Channel, std::vector<float>& Values, TrackOutput& Output, Report& Stats)
+		{
+			const PAnim::PackedClip& Clip = *State.Clip;
+			const uint32_t Stride = Clip.KeyStride;
+			const uint32_t Offset = ChannelOffsets[Channel];
+			const uint32_t Width = ChannelWidths[Channel];
+			const size_t FrameCount = State.FrameCount;
+
+			auto SourceValue = [&](size_t Frame) { return (Clip.GetFrame(Frame) + (Joint * Stride) + Offset); };
+
+			// Whether the joint stays within error for frames [Begin, End) when Candidate(Frame, Out) gives this channel.
+			std::vector<float> Key(Stride);
+			auto Holds = [&](size_t Begin, size_t End, auto&& Candidate)
+			{
+				for (size_t Frame = Begin; Frame < End; ++Frame)
+				{
+					memcpy(Key.data(), &Values[Frame * Stride], (sizeof(float) * Stride));
+					Candidate(Frame, (Key.data() + Offset));
+
+					if (!WithinError(State, Joint, Frame, Key.data()))
+					{
+						return false;
+					}
+				}
+
+				return true;
+			};
+
+			PAnim::PackedClip::Track Result;
+
+			if (Channel != 0)
+			{
+				for (uint32_t i = 0; i < 3; ++i)
+				{
+					float Min = SourceValue(0)[i];
+					float Max = Min;
+
+					for (size_t Frame = 1; Frame < FrameCount; ++Frame)
+					{
+						Min = std::min(Min, SourceValue(Frame)[i]);
+						Max = std::max(Max, SourceValue(Frame)[i]);
+					}
+
+					Result.Min[i] = Min;
+					Result.Extent[i] = (Max - Min);
+				}
+			}
+
+			// What every frame decodes to if it's kept. Quantized rotations come back on the source's side of the sphere.
+			std::vector<float> Encoded(FrameCount * Width);
+			for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+			{
+				const float* Source = SourceValue(Frame);
+				float* Decoded = &Encoded[Frame * Width];
+				uint16_t Words[3];
+
+				if (Channel == 0)
+				{
+					PAnim::PackedClip::QuantizeRotation(Source, Words);
+					PAnim::PackedClip::DequantizeRotation(Words, Decoded);
+
+					if (((Source[0] * Decoded[0]) + (Source[1] * Decoded[1]) + (Source[2] * Decoded[2]) + (Source[3] * Decoded[3])) < 0.0f)
+					{
+						for (uint32_t i = 0; i < 4; ++i)
+						{
+							Decoded[i] = -Decoded[i];
+						}
+					}
+				}
+				else
+				{
+					PAnim::PackedClip::QuantizeVector(Source, Result, Words);
+					PAnim::PackedClip::DequantizeVector(Words, Result, Decoded);
+				}
+			}
+
+			bool bQuantized = Holds(0, FrameCount, [&](size_t Frame, float* Out) { memcpy(Out, &Encoded[Frame * Width], (sizeof(float) * Width)); });
+			if (!bQuantized)
+			{
+				for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+				{
+					memcpy(&Encoded[Frame * Width], SourceValue(Frame), (sizeof(float) * Width));
+				}
+			}
+
+			// Blend two kept keys the way PackedClip::DecompressKeys() does.
+			auto Blend = [&](size_t A, size_t B, size_t Frame, float* Out)
+			{
+				const float* From = &Encoded[A * Width];
+				const float* To = &Encoded[B * Width];
+				float T = ((float)(Frame - A) / (float)(B - A));
+				float Sign = 1.0f;
+
+				if ((Channel == 0) && (((From[0] * To[0]) + (From[1] * To[1]) + (From[2] * To[2]) + (From[3] * To[3])) < 0.0f))
+				{
+					Sign = -1.0f;
+				}
+
+				for (uint32_t i = 0; i < Width; ++i)
+				{
+					Out[i] = From[i] + (((To[i] * Sign) - From[i]) * T);
+				}
+			};
+
+			auto SegmentHolds = [&](size_t A, size_t B)
+			{
+				return Holds((A + 1), B, [&](size_t Frame, float* Out) { Blend(A, B, Frame, Out); });
+			};
+
+			const float* FirstValue = SourceValue(0);
+			bool bConstant = (FrameCount == 1) || Holds(0, FrameCount, [&](size_t, float* Out) { memcpy(Out, FirstValue, (sizeof(float) * Width)); });
+
+			std::vector<uint32_t> Kept;
+
+			if (bConstant)
+			{
+				Kept.push_back(0);
+			}
+			else if (SegmentHolds(0, (FrameCount - 1)))
+			{
+				Kept = { 0, (uint32_t)(FrameCount - 1) };
+			}
+			else
+			{
+				// Stretch each segment as far as it holds: double it until it breaks, then bisect between the longest
+				// segment that held and the shortest that broke.
+				Kept.push_back(0);
+
+				for (size_t A = 0; A < (FrameCount - 1);)
+				{
+					size_t Limit = std::min((FrameCount - 1), (A + MaxKeyGap));
+					size_t Good = (A + 1);
+					size_t Bad = (Limit + 1);
+
+					for (size_t Gap = 2; (A + Gap) < Limit; Gap *= 2)
+					{
+						if (!SegmentHolds(A, (A + Gap)))
+						{
+							Bad = (A + Gap);
+							break;
+						}
+
+						Good = (A + Gap);
+					}
+
+					if (Bad > Limit)
+					{
+						if (SegmentHolds(A, Limit))
+						{
+							Good = Limit;
+						}
+						else
+						{
+							Bad = Limit;
+						}
+					}
+
+					while ((Bad - Good) > 1)
+					{
+						size_t Middle = (Good + ((Bad - Good) / 2));
+
+						if (SegmentHolds(A, Middle))
+						{
+							Good = Middle;
+						}
+						else
+						{
+							Bad = Middle;
+						}
+					}
+
+					Kept.push_back((uint32_t)Good);
+					A = Good;
+				}
+			}
+
+			// Leave the channel at what it decodes to, for the channels and children compressed after it.
+			if (bConstant)
+			{
+				for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+				{
+					memcpy(&Values[(Frame * Stride) + Offset], FirstValue, (sizeof(float) * Width));
+				}
+			}
+			else
+			{
+				for (size_t Segment = 0; (Segment + 1) < Kept.size(); ++Segment)
+				{
+					for (size_t Frame = Kept[Segment]; Frame <= Kept[Segment + 1]; ++Frame)
+					{
+						Blend(Kept[Segment], Kept[Segment + 1], Frame, &Values[(Frame * Stride) + Offset]);
+					}
+				}
+			}
+
+			Result.KeyCount = (uint32_t)Kept.size();
+			Result.FirstKey = (uint32_t)Output.KeyFrames.size();
+			Result.bFloat = (bConstant || !bQuantized) ? 1 : 0;
+			Result.DataOffset = Result.bFloat ? (uint32_t)Output.FloatData.size() : (uint32_t)Output.QuantizedData.size();
+
+			for (uint32_t Frame : Kept)
+			{
+				if (!bConstant)
+				{
+					Output.KeyFrames.push_back((uint16_t)Frame);
+				}
+
+				if (Result.bFloat)
+				{
+					Output.FloatData.insert(Output.FloatData.end(), SourceValue(Frame), (SourceValue(Frame) + Width));
+				}
+				else
+				{
+					uint16_t Words[3];
+
+					if (Channel == 0)
+					{
+						PAnim::PackedClip::QuantizeRotation(SourceValue(Frame), Words);
+					}
+					else
+					{
+						PAnim::PackedClip::QuantizeVector(SourceValue(Frame), Result, Words);
+					}
+
+					Output.QuantizedData.insert(Output.QuantizedData.end(), Words, (Words + 3));
+				}
+			}
+
+			Output.Tracks[(Joint * Clip.GetTracksPerJoint()) + Channel] = Result;
+
+			Stats.SourceKeys += FrameCount;
+			Stats.KeptKeys += Kept.size();
+
+			if (bConstant)
+			{
+				Stats.ConstantTracks++;
+			}
+			else if (Kept.size() == 2)
+			{
+				Stats.LinearTracks++;
+			}
+			else
+			{
+				Stats.KeyedTracks++;
+			}
+
+			if (!bConstant && !bQuantized)
+			{
+				Stats.FloatTracks++;
+			}
+		}
+	}
+
+	// Compress a clip in place, replacing its Keys with tracks.
+	bool Compress(PAnim::PackedClip& Clip, const PAnim::CompressionSettings& Settings, Report* OutReport)
+	{
+		const size_t FrameCount = Clip.GetFrameCount();
+		const uint32_t JointCount = Clip.JointCount;
+
+		if (Clip.IsCompressed() || (JointCount == 0) || (FrameCount == 0) || (FrameCount > 65536) || !(Settings.MaxError > 0.0f))
+		{
+			return false;
+		}
+
+		Report Stats;
+		Stats.RawBytes = Clip.GetMemoryBytes();
+
+		ClipState State;
+		Prepare(State, Clip, Settings);
+
+		TrackOutput Output;
+		Output.Tracks.resize(JointCount * Clip.GetTracksPerJoint());
+
+		// Parents first, so every joint is measured against where its compressed parents really put it.
+		const uint32_t Stride = Clip.KeyStride;
+		std::vector<float> Values(FrameCount * Stride);
+
+		for (uint32_t Slot = 0; Slot < JointCount; ++Slot)
+		{
+			uint32_t Joint = Clip.SolveOrder[Slot];
+			int Parent = State.ParentOf[Joint];
+
+			for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+			{
+				memcpy(&Values[Frame * Stride], (Clip.GetFrame(Frame) + (Joint * Stride)), (sizeof(float) * Stride));
+			}
+
+			for (uint32_t Channel = 0; Channel < Clip.GetTracksPerJoint(); ++Channel)
+			{
+				CompressChannel(State, Joint, Channel, Values, Output, Stats);
+			}
+
+			for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+			{
+				size_t Base = (Frame * JointCount);
+				PMatrix Lossy = MakeLocal(&Values[Frame * Stride], Clip.HasScale());
+
+				if (Parent >= 0)
+				{
+					Lossy = PMatrixMultiply(Lossy, PLoadMatrix(State.LossyGlobals[Base + Parent]));
+				}
+
+				State.LossyGlobals[Base + Joint] = PStoreMatrix(Lossy);
+			}
+		}
+
+		decltype(Clip.Keys) SourceKeys;
+		SourceKeys.swap(Clip.Keys);
+		const float* SourceMappedKeys = Clip.MappedKeys;
+		Clip.MappedKeys = nullptr;
+
+		Clip.Tracks = std::move(Output.Tracks);
+		Clip.KeyFrames = std::move(Output.KeyFrames);
+		Clip.QuantizedData = std::move(Output.QuantizedData);
+		Clip.FloatData = std::move(Output.FloatData);
+
+		Stats.CompressedBytes = Clip.GetMemoryBytes();
+
+		// Noisy clips can keep nearly every key, which costs more than the plain keys once each carries a frame number.
+		if (Stats.CompressedBytes >= Stats.RawBytes)
+		{
+			Clip.Keys.swap(SourceKeys);
+			Clip.MappedKeys = SourceMappedKeys;
+			Clip.Tracks = {};
+			Clip.KeyFrames = {};
+			Clip.QuantizedData = {};
+			Clip.FloatData = {};
+
+			if (OutReport)
+			{
+				*OutReport = Stats;
+			}
+
+			return false;
+		}
+
+		// Measure what playback really produces, through the same sampling every animator uses.
+		std::vector<float4x4_a> Pose(JointCount);
+		float3 Points[PointsPerJoint];
+		float MaxErrorSq = 0.0f;
+
+		for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+		{
+			Clip.Sample((float)Clip.Times[Frame], Pose);
+
+			for (uint32_t Joint = 0; Joint < JointCount; ++Joint)
+			{
+				StorePoints(PLoadMatrix(Pose[Joint]), Settings.TipDistance, Points);
+
+				for (uint32_t i = 0; i < PointsPerJoint; ++i)
+				{
+					PVector Offset = PVectorSubtract(PLoadFloat3(Points[i]), PLoadFloat3(State.SourcePoints[(((Frame * JointCount) + Joint) * PointsPerJoint) + i]));
+					float ErrorSq = PVector3Dot(Offset, Offset);
+
+					if (ErrorSq > MaxErrorSq)
+					{
+						MaxErrorSq = ErrorSq;
+						Stats.MaxErrorJoint = (int)Joint;
+						Stats.MaxErrorFrame = Frame;
+					}
+				}
+			}
+		}
+
+		Stats.MaxError = sqrtf(MaxErrorSq);
+
+		// The tracks replace keys that were used in place from a file, so the file can be let go.
+		Clip.KeyFile.reset();
+
+		if (OutReport)
+		{
+			*OutReport = Stats;
+		}
+
+		return true;
+	}
+
+	// Return a report as one line for the console.
+	std::string FormatReport(const Report& InReport)
+	{
+		char Line[320];
+		snprintf(Line, sizeof(Line), "%.1f KB to %.1f KB (%.2f:1), max error %g at joint %d, keyframe %zu. Tracks: %u constant, %u linear, %u keyed (%u float). Keys kept: %zu of %zu.",
+			(InReport.RawBytes / 1024.0), (InReport.CompressedBytes / 1024.0), InReport.GetRatio(), InReport.MaxError, InReport.MaxErrorJoint, InReport.MaxErrorFrame,
+			InReport.ConstantTracks, InReport.LinearTracks, InReport.KeyedTracks, InReport.FloatTracks, InReport.KeptKeys, InReport.SourceKeys);
+
+		return Line;
+	}
+}
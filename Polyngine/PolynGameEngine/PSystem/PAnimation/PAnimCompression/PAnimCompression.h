@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../PAnim/PAnim.h"
+#include <string>
+
+// Error bounded compression of packed animation clips.
+//
+// Every joint's rotation, translation, and scale become separate tracks. A track that never changes is kept as one
+// value, and the rest keep only the keyframes that can't be rebuilt by blending their neighbours. Kept rotations are
+// quantized to 48 bits (smallest three), and kept translations and scales to 16 bits per component within the track's
+// range, unless that alone moves a joint too far, in which case the track stays as floats.
+//
+// Error is measured in model space, on each joint and on two virtual tips TipDistance along its X and Y axes, so a small
+// rotation error on a hip is judged by how far it moves the hand. Joints are compressed parents first, and each joint's
+// error includes the error its parents already spent, so no joint or tip ends up further than MaxError from the source
+// (give or take float rounding in the solve).
+//
+// Sampling a compressed clip searches and blends each track's own keys, which costs more than blending two plain
+// keyframes. Sample poses once per frame (PAnim::GetPose()) rather than per consumer.
+namespace PAnimCompression
+{
+	// What compressing a clip achieved.
+	struct Report
+	{
+		size_t RawBytes = 0;				// Memory of the clip before compression.
+		size_t CompressedBytes = 0;			// Memory of the clip after compression.
+		float MaxError = 0.0f;				// The furthest any joint or tip moved from the source, at any keyframe.
+		int MaxErrorJoint = -1;				// The joint that moved furthest.
+		size_t MaxErrorFrame = 0;			// The keyframe at which it moved furthest.
+		uint32_t ConstantTracks = 0;		// Tracks reduced to one value.
+		uint32_t LinearTracks = 0;			// Tracks reduced to their first and last keys.
+		uint32_t KeyedTracks = 0;			// Tracks that keep more keys.
+		uint32_t FloatTracks = 0;			// Tracks of more than one key that could not be quantized.
+		size_t KeptKeys = 0;				// Keys kept, over every track.
+		size_t SourceKeys = 0;				// Keys before compression, over every track.
+
+		// Return how many times smaller the clip became.
+		float GetRatio() const { return (CompressedBytes > 0) ? ((float)RawBytes / (float)CompressedBytes) : 0.0f; }
+	};
+
+	// Compress a clip in place, replacing its Keys with tracks. Clips that are already compressed, have more than 65536
+	// keyframes, or get a MaxError of 0 or less are left alone, as are clips that would not get smaller.
+	//
+	// RETURN: True if the clip was compressed, with what it achieved stored in OutReport if given.
+	bool Compress(PAnim::PackedClip& Clip, const PAnim::CompressionSettings& Settings, Report* OutReport = nullptr);
+
+	// Return a report as one line for the console.
+	std::string FormatReport(const Report& InReport);
+}
@@ -0,0 +1,611 @@
+#include "PAnimFile.h"
+#include "../PAnimCompression/PAnimCompression.h"
+#include "../../PFileMap/PFileMap.h"
+#include "../../../PMath/PVectorMath.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace PAnimFile
+{
+	namespace
+	{
+		static_assert(sizeof(PAnim::PackedClip::Track) == 40, "Compressed tracks are written as they are, so their layout is part of the file format.");
+
+		// Print why FilePath could not be loaded or written.
+		void Fail(const std::string& FilePath, const std::string& Reason)
+		{
+			PGameplayStatics::PrintToConsole(("Animation file " + FilePath + " " + Reason), 2, "Animation");
+		}
+
+		// Return the bytes a section of Count items of Stride bytes takes.
+		uint64_t SectionBytes(uint64_t Count, uint64_t Stride)
+		{
+			return (Count * Stride);
+		}
+
+		// Round Offset up to the next section boundary.
+		uint64_t AlignSection(uint64_t Offset)
+		{
+			return ((Offset + (SectionAlignment - 1)) & ~(SectionAlignment - 1));
+		}
+
+		// Return the inverse of each bind pose joint.
+		std::vector<float4x4_a> InvertBind(const std::vector<PAnim::Joint>& Joints)
+		{
+			std::vector<float4x4_a> Inverse(Joints.size());
+
+			for (size_t i = 0; i < Joints.size(); ++i)
+			{
+				float4x4_a Matrix;
+				memcpy(&Matrix, Joints[i].Transform, sizeof(Matrix));
+				Inverse[i] = PStoreMatrix(PMatrixInverse(PLoadMatrix(Matrix)));
+			}
+
+			return Inverse;
+		}
+
+		// Return the tracks per joint of a clip with KeyStride floats per key.
+		uint32_t GetTracksPerJoint(uint32_t KeyStride)
+		{
+			return ((KeyStride == 10) ? 3 : 2);
+		}
+
+		// Check that every compressed track reads only inside the sections it points into, keeps frame 0, and keeps its
+		// frames in order within the clip, which is all sampling relies on.
+		//
+		// Returns an empty string if they do, otherwise what's wrong.
+		std::string CheckTracks(const Header& Head, const PAnim::PackedClip::Track* Tracks, size_t TrackCount, const uint16_t* KeyFrames, size_t KeyFrameCount, size_t QuantizedCount, size_t FloatCount)
+		{
+			const uint32_t TracksPerJoint = GetTracksPerJoint(Head.KeyStride);
+
+			for (size_t i = 0; i < TrackCount; ++i)
+			{
+				const PAnim::PackedClip::Track& Source = Tracks[i];
+				const uint64_t Width = ((i % TracksPerJoint) == 0) ? 4 : 3;
+				const std::string Name = ("Track " + std::to_string(i));
+
+				if (Source.KeyCount == 0)
+				{
+					return (Name + " has no keys.");
+				}
+
+				// Constant tracks are always one float value.
+				if (Source.KeyCount == 1)
+				{
+					if (((uint64_t)Source.DataOffset + Width) > FloatCount)
+					{
+						return (Name + " reads past the float data.");
+					}
+
+					continue;
+				}
+
+				if (((uint64_t)Source.FirstKey + Source.KeyCount) > KeyFrameCount)
+				{
+					return (Name + " reads past the kept frames.");
+				}
+
+				uint64_t DataEnd = ((uint64_t)Source.DataOffset + ((uint64_t)Source.KeyCount * (Source.bFloat ? Width : 3)));
+				if (DataEnd > (Source.bFloat ? FloatCount : QuantizedCount))
+				{
+					return (Name + " reads past its key data.");
+				}
+
+				const uint16_t* Frames = (KeyFrames + Source.FirstKey);
+				if ((Frames[0] != 0) || (Frames[Source.KeyCount - 1] >= Head.FrameCount))
+				{
+					return (Name + " doesn't span the clip's keyframes.");
+				}
+
+				for (uint32_t Key = 1; Key < Source.KeyCount; ++Key)
+				{
+					if (Frames[Key] <= Frames[Key - 1])
+					{
+						return (Name + " keeps its frames out of order.");
+					}
+				}
+			}
+
+			return "";
+		}
+
+		// Load a version 2 or 3 file from its mapping, using uncompressed keys in place.
+		std::shared_ptr<PAnim::ClipAsset> LoadHeadered(const std::shared_ptr<const PFileMap>& File)
+		{
+			const std::string& FilePath = File->GetPath();
+			const uint8_t* Data = File->GetData();
+
+			if (File->GetSize() < Version2HeaderSize)
+			{
+				Fail(FilePath, "is too short for its header.");
+				return nullptr;
+			}
+
+			// A version 2 header is the start of a version 3 one. What it lacks stays empty.
+			Header Head;
+			memcpy(&Head, Data, Version2HeaderSize);
+
+			if ((Head.Version < 2) || (Head.Version > Version))
+			{
+				Fail(FilePath, ("is version " + std::to_string(Head.Version) + ", which this build can't read."));
+				return nullptr;
+			}
+
+			const uint32_t HeaderSize = (Head.Version == 2) ? Version2HeaderSize : (uint32_t)sizeof(Header);
+			const uint32_t SectionCount = (Head.Version == 2) ? Version2SectionCount : (uint32_t)ANIMSECTION_COUNT;
+
+			if ((Head.HeaderSize != HeaderSize) || (Head.FileSize != File->GetSize()) || (File->GetSize() < HeaderSize))
+			{
+				Fail(FilePath, "is damaged or truncated. Its header doesn't match its size.");
+				return nullptr;
+			}
+
+			memcpy(&Head, Data, HeaderSize);
+
+			if ((Head.KeyStride != 7) && (Head.KeyStride != 10))
+			{
+				Fail(FilePath, ("has " + std::to_string(Head.KeyStride) + " floats per key. Only 7 and 10 are valid."));
+				return nullptr;
+			}
+
+			const uint64_t TrackCount = ((uint64_t)Head.JointCount * GetTracksPerJoint(Head.KeyStride));
+			const bool bCompressed = (Head.Sections[ANIMSECTION_TRACKS].Size != 0);
+
+			// Compressed sections hold as many items as the compressor kept. Only their item size is known.
+			const uint64_t Expected[ANIMSECTION_COUNT] =
+			{
+				SectionBytes(Head.BindJointCount, sizeof(PAnim::Joint)),
+				SectionBytes(Head.BindJointCount, sizeof(float4x4_a)),
+				SectionBytes(Head.FrameCount, sizeof(double)),
+				SectionBytes(Head.JointCount, sizeof(int)),
+				bCompressed ? 0 : SectionBytes(((uint64_t)Head.FrameCount * Head.JointCount), (Head.KeyStride * sizeof(float))),
+				bCompressed ? SectionBytes(TrackCount, sizeof(PAnim::PackedClip::Track)) : 0,
+				sizeof(uint16_t),
+				sizeof(uint16_t),
+				sizeof(float)
+			};
+
+			for (uint32_t i = 0; i < SectionCount; ++i)
+			{
+				const Section& Part = Head.Sections[i];
+
+				bool bInside = (Part.Offset >= HeaderSize) && (Part.Size <= Head.FileSize) && (Part.Offset <= (Head.FileSize - Part.Size));
+				bool bSized = (i < ANIMSECTION_TRACKKEYS) ? (Part.Size == Expected[i]) : (((Part.Size % Expected[i]) == 0) && (bCompressed || (Part.Size == 0)));
+
+				if (!bInside || ((Part.Offset % SectionAlignment) != 0) || !bSized)
+				{
+					Fail(FilePath, ("is damaged. Section " + std::to_string(i) + " is misplaced or the wrong size."));
+					return nullptr;
+				}
+			}
+
+			// Sampling searches the times, so they must be in order. Parents out of range become roots when the clip is packed.
+			const double* Times = (const double*)(Data + Head.Sections[ANIMSECTION_TIMES].Offset);
+
+			for (uint32_t i = 0; i < Head.FrameCount; ++i)
+			{
+				if (!std::isfinite(Times[i]) || ((i > 0) && (Times[i] < Times[i - 1])))
+				{
+					Fail(FilePath, ("is damaged. Keyframe " + std::to_string(i) + " is out of order."));
+					return nullptr;
+				}
+			}
+
+			const int* Parents = (const int*)(Data + Head.Sections[ANIMSECTION_PARENTS].Offset);
+			const float4x4_a* InverseBind = (const float4x4_a*)(Data + Head.Sections[ANIMSECTION_INVERSEBIND].Offset);
+
+			std::shared_ptr<PAnim::ClipAsset> Asset = std::make_shared<PAnim::ClipAsset>();
+			Asset->FilePath = FilePath;
+
+			const PAnim::Joint* BindJoints = (const PAnim::Joint*)(Data + Head.Sections[ANIMSECTION_BIND].Offset);
+			Asset->Bind.Joints.assign(BindJoints, (BindJoints + Head.BindJointCount));
+			Asset->InverseBind.assign(InverseBind, (InverseBind + Head.BindJointCount));
+
+			if (Head.CompressionMaxError > 0.0f)
+			{
+				Asset->Compression.bEnabled = true;
+				Asset->Compression.MaxError = Head.CompressionMaxError;
+				Asset->Compression.TipDistance = Head.CompressionTipDistance;
+			}
+
+			if (!bCompressed)
+			{
+				const float* Keys = (const float*)(Data + Head.Sections[ANIMSECTION_KEYS].Offset);
+				Asset->Clip = PAnim::PackedClip::FromMappedKeys(Head.Duration, std::vector<double>(Times, (Times + Head.FrameCount)), std::vector<int>(Parents, (Parents + Head.JointCount)), Head.KeyStride, File, Keys);
+
+				return Asset;
+			}
+
+			const PAnim::PackedClip::Track* Tracks = (const PAnim::PackedClip::Track*)(Data + Head.Sections[ANIMSECTION_TRACKS].Offset);
+			const uint16_t* KeyFrames = (const uint16_t*)(Data + Head.Sections[ANIMSECTION_TRACKKEYS].Offset);
+			const uint16_t* Quantized = (const uint16_t*)(Data + Head.Sections[ANIMSECTION_QUANTIZED].Offset);
+			const float* Floats = (const float*)(Data + Head.Sections[ANIMSECTION_FLOATS].Offset);
+
+			const size_t KeyFrameCount = (size_t)(Head.Sections[ANIMSECTION_TRACKKEYS].Size / sizeof(uint16_t));
+			const size_t QuantizedCount = (size_t)(Head.Sections[ANIMSECTION_QUANTIZED].Size / sizeof(uint16_t));
+			const size_t FloatCount = (size_t)(Head.Sections[ANIMSECTION_FLOATS].Size / sizeof(float));
+
+			std::string Problem = CheckTracks(Head, Tracks, (size_t)TrackCount, KeyFrames, KeyFrameCount, QuantizedCount, FloatCount);
+			if (!Problem.empty())
+			{
+				Fail(FilePath, ("is damaged. " + Problem));
+				return nullptr;
+			}
+
+			// The tracks are a fraction of the keys they replace, so they're copied out and the file is let go.
+			Asset->Clip = PAnim::PackedClip::FromTracks(Head.Duration, std::vector<double>(Times, (Times + Head.FrameCount)), std::vector<int>(Parents, (Parents + Head.JointCount)), Head.KeyStride,
+				std::vector<PAnim::PackedClip::Track>(Tracks, (Tracks + TrackCount)), std::vector<uint16_t>(KeyFrames, (KeyFrames + KeyFrameCount)),
+				std::vector<uint16_t>(Quantized, (Quantized + QuantizedCount)), std::vector<float>(Floats, (Floats + FloatCount)));
+
+			return Asset;
+		}
+
+		// Load a version 1 file from its mapping. The model space matrices are copied out a keyframe at a time and packed
+		// into local keys.
+		std::shared_ptr<PAnim::ClipAsset> LoadVersion1(const std::shared_ptr<const PFileMap>& File)
+		{
+			const std::string& FilePath = File->GetPath();
+			const uint8_t* Data = File->GetData();
+			const size_t Size = File->GetSize();
+			size_t Cursor = 0;
+
+			auto Read = [&](void* Out, size_t Bytes)
+			{
+				if (Bytes > (Size - Cursor))
+				{
+					return false;
+				}
+
+				memcpy(Out, (Data + Cursor), Bytes);
+				Cursor += Bytes;
+
+				return true;
+			};
+
+			uint32_t BindJointCount = 0;
+			if (!Read(&BindJointCount, sizeof(uint32_t)) || (((uint64_t)BindJointCount * sizeof(PAnim::Joint)) > (Size - Cursor)))
+			{
+				Fail(FilePath, "is too short for its bind pose.");
+				return nullptr;
+			}
+
+			std::shared_ptr<PAnim::ClipAsset> Asset = std::make_shared<PAnim::ClipAsset>();
+			Asset->FilePath = FilePath;
+
+			Asset->Bind.Joints.resize(BindJointCount);
+			Read(Asset->Bind.Joints.data(), (BindJointCount * sizeof(PAnim::Joint)));
+			Asset->InverseBind = InvertBind(Asset->Bind.Joints);
+
+			double Duration = 0.0;
+			uint32_t FrameCount = 0;
+
+			if (!Read(&Duration, sizeof(double)) || !Read(&FrameCount, sizeof(uint32_t)))
+			{
+				Fail(FilePath, "is too short for its keyframe count.");
+				return nullptr;
+			}
+
+			std::vector<double> Times;
+			std::vector<int> Parents;
+			std::vector<float> Matrices;
+			uint32_t JointCount = 0;
+
+			for (uint32_t Frame = 0; Frame < FrameCount; ++Frame)
+			{
+				double Time = 0.0;
+				uint32_t FrameJoints = 0;
+
+				if (!Read(&Time, sizeof(double)) || !Read(&FrameJoints, sizeof(uint32_t)) || (((uint64_t)FrameJoints * sizeof(PAnim::Joint)) > (Size - Cursor)))
+				{
+					break;
+				}
+
+				// The first keyframe sets the joint count and the hierarchy, which is the same in every keyframe. Reserve
+				// no more than the rest of the file could hold, in case the count is damaged.
+				if (Frame == 0)
+				{
+					JointCount = FrameJoints;
+					Parents.resize(JointCount);
+
+					size_t FrameBytes = (sizeof(double) + sizeof(uint32_t) + ((size_t)JointCount * sizeof(PAnim::Joint)));
+					size_t MostFrames = std::min<size_t>(FrameCount, (1 + ((Size - Cursor) / FrameBytes)));
+
+					Times.reserve(MostFrames);
+					Matrices.reserve(MostFrames * JointCount * 16);
+				}
+
+				const uint8_t* Joints = (Data + Cursor);
+				Cursor += ((size_t)FrameJoints * sizeof(PAnim::Joint));
+
+				Times.push_back(Time);
+				Matrices.resize(Times.size() * JointCount * 16);
+				float* FrameTransforms = (Matrices.data() + ((Times.size() - 1) * JointCount * 16));
+
+				for (uint32_t j = 0; j < JointCount; ++j)
+				{
+					if (j < FrameJoints)
+					{
+						const uint8_t* Source = (Joints + (j * sizeof(PAnim::Joint)));
+						memcpy((FrameTransforms + (j * 16)), (Source + offsetof(PAnim::Joint, Transform)), (sizeof(float) * 16));
+
+						if (Frame == 0)
+						{
+							memcpy(&Parents[j], (Source + offsetof(PAnim::Joint, ParentIndex)), sizeof(int));
+						}
+					}
+					else
+					{
+						// A keyframe missing joints leaves them at rest.
+						for (int x = 0; x < 16; ++x)
+						{
+							FrameTransforms[(j * 16) + x] = ((x % 5 == 0) ? 1.0f : 0.0f);
+						}
+					}
+				}
+			}
+
+			if (Times.size() < FrameCount)
+			{
+				PGameplayStatics::PrintToConsole(("Animation file " + FilePath + " holds " + std::to_string(Times.size()) + " of its " + std::to_string(FrameCount) + " keyframes. Files from older exporters are one short; re-export it for the first keyframe."), 3, "Animation");
+			}
+
+			// The exporter writes model space matrices. Store them as local keys.
+			Asset->Clip = PAnim::PackedClip::FromModelMatrices(Duration, std::move(Times), std::move(Parents), Matrices.data());
+
+			return Asset;
+		}
+	}
+
+	// Return the version of the .anim file at FilePath: Version, 1 for files without a header, or 0 if it can't be read.
+	uint32_t GetVersion(const std::string& FilePath)
+	{
+		std::ifstream File(FilePath, std::ios_base::in | std::ios_base::binary);
+
+		uint32_t Words[2] = {};
+		if (!File.read((char*)Words, sizeof(Words)))
+		{
+			return 0;
+		}
+
+		return (Words[0] == Magic) ? Words[1] : 1;
+	}
+
+	// Load the .anim file at FilePath, of any version.
+	//
+	// Returns nullptr if the file could not be loaded.
+	std::shared_ptr<PAnim::ClipAsset> Load(const std::string& FilePath)
+	{
+		std::shared_ptr<PFileMap> File = std::make_shared<PFileMap>();
+
+		if (!File->Open(FilePath))
+		{
+			Fail(FilePath, "could not be opened.");
+			return nullptr;
+		}
+
+		uint32_t FirstWord = 0;
+		memcpy(&FirstWord, File->GetData(), std::min<size_t>(File->GetSize(), sizeof(uint32_t)));
+
+		// Version 1 files start with their bind joint count, which would need over a billion joints to read as the magic.
+		return (FirstWord == Magic) ? LoadHeadered(File) : LoadVersion1(File);
+	}
+
+	// Write Clip and Bind to FilePath as a version 3 file.
+	//
+	// Returns true if the file was written.
+	bool Save(const std::string& FilePath, const PAnim::PackedClip& Clip, const PAnim::BindPose& Bind, const PAnim::CompressionSettings& Compression)
+	{
+		const bool bCompressed = Clip.IsCompressed();
+
+		Header Head;
+		Head.KeyStride = Clip.KeyStride;
+		Head.Duration = Clip.Duration;
+		Head.BindJointCount = (uint32_t)Bind.Joints.size();
+		Head.JointCount = Clip.JointCount;
+		Head.FrameCount = (uint32_t)Clip.GetFrameCount();
+
+		if (Compression.bEnabled && (Compression.MaxError > 0.0f))
+		{
+			Head.CompressionMaxError = Compression.MaxError;
+			Head.CompressionTipDistance = Compression.TipDistance;
+		}
+
+		std::vector<float4x4_a> InverseBind = InvertBind(Bind.Joints);
+
+		const void* Sources[ANIMSECTION_COUNT] =
+		{
+			Bind.Joints.data(), InverseBind.data(), Clip.Times.data(), Clip.Parents.data(), (bCompressed ? nullptr : Clip.GetFrame(0)),
+			Clip.Tracks.data(), Clip.KeyFrames.data(), Clip.QuantizedData.data(), Clip.FloatData.data()
+		};
+
+		const uint64_t Sizes[ANIMSECTION_COUNT] =
+		{
+			SectionBytes(Head.BindJointCount, sizeof(PAnim::Joint)),
+			SectionBytes(Head.BindJointCount, sizeof(float4x4_a)),
+			SectionBytes(Head.FrameCount, sizeof(double)),
+			SectionBytes(Head.JointCount, sizeof(int)),
+			bCompressed ? 0 : SectionBytes(((uint64_t)Head.FrameCount * Head.JointCount), (Head.KeyStride * sizeof(float))),
+			SectionBytes(Clip.Tracks.size(), sizeof(PAnim::PackedClip::Track)),
+			SectionBytes(Clip.KeyFrames.size(), sizeof(uint16_t)),
+			SectionBytes(Clip.QuantizedData.size(), sizeof(uint16_t)),
+			SectionBytes(Clip.FloatData.size(), sizeof(float))
+		};
+
+		uint64_t Offset = sizeof(Header);
+		for (int i = 0; i < ANIMSECTION_COUNT; ++i)
+		{
+			Offset = AlignSection(Offset);
+			Head.Sections[i] = { Offset, Sizes[i] };
+			Offset += Sizes[i];
+		}
+
+		Head.FileSize = Offset;
+
+		std::ofstream File(FilePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		if (!File.is_open())
+		{
+			Fail(FilePath, "could not be opened for writing.");
+			return false;
+		}
+
+		File.write((const char*)&Head, sizeof(Header));
+
+		const char Padding[SectionAlignment] = {};
+		uint64_t Written = sizeof(Header);
+
+		for (int i = 0; i < ANIMSECTION_COUNT; ++i)
+		{
+			File.write(Padding, (std::streamsize)(Head.Sections[i].Offset - Written));
+
+			if (Sizes[i] > 0)
+			{
+				File.write((const char*)Sources[i], (std::streamsize)Sizes[i]);
+			}
+
+			Written = (Head.Sections[i].Offset + Sizes[i]);
+		}
+
+		File.close();
+
+		if (!File)
+		{
+			Fail(FilePath, "could not be written.");
+			return false;
+		}
+
+		return true;
+	}
+
+	// Return whether the file at FilePath is already the current version, compressed with Compression if its bEnabled is
+	// set.
+	bool IsCurrent(const std::string& FilePath, const PAnim::CompressionSettings& Compression)
+	{
+		std::ifstream File(FilePath, std::ios_base::in | std::ios_base::binary);
+
+		Header Head;
+		if (!File.read((char*)&Head, sizeof(Header)) || (Head.Magic != Magic) || (Head.Version != Version))
+		{
+			return false;
+		}
+
+		if (!Compression.bEnabled || !(Compression.MaxError > 0.0f))
+		{
+			return true;
+		}
+
+		return (Head.CompressionMaxError == Compression.MaxError) && (Head.CompressionTipDistance == Compression.TipDistance);
+	}
+
+	// Upgrade the file at FilePath to version 3 in place, compressing its clip with Compression if its bEnabled is set.
+	//
+	// Returns true if the file is current afterwards.
+	bool Convert(const std::string& FilePath, const PAnim::CompressionSettings& Compression)
+	{
+		if (IsCurrent(FilePath, Compression))
+		{
+			return true;
+		}
+
+		std::shared_ptr<PAnim::ClipAsset> Asset = Load(FilePath);
+		if (!Asset)
+		{
+			return false;
+		}
+
+		// Compressing is lossy, so a clip compressed with other settings is rebuilt from its keys rather than compressed
+		// again. Only a file holding keys can be.
+		if (Asset->Clip.IsCompressed())
+		{
+			Fail(FilePath, "is already compressed with other settings, and its keys are gone. Re-export it to compress it differently.");
+			return false;
+		}
+
+		// Clips that compression wouldn't shrink keep their keys, but the settings are recorded so they aren't tried again.
+		if (Compression.bEnabled)
+		{
+			PAnimCompression::Report CompressionReport;
+
+			if (PAnimCompression::Compress(Asset->Clip, Compression, &CompressionReport))
+			{
+				PGameplayStatics::PrintToConsole(("Compressed " + FilePath + ": " + PAnimCompression::FormatReport(CompressionReport)), 0, "Animation");
+			}
+		}
+
+		// Write beside the old file and swap it in, so a failed write doesn't lose the original.
+		std::string TempPath = (FilePath + ".tmp");
+		if (!Save(TempPath, Asset->Clip, Asset->Bind, Compression))
+		{
+			return false;
+		}
+
+		// The old file's keys may still be mapped by the clip. Let go of them before replacing it.
+		Asset.reset();
+
+		std::error_code Error;
+		std::filesystem::rename(TempPath, FilePath, Error);
+
+		if (Error)
+		{
+			std::filesystem::remove(TempPath, Error);
+			Fail(FilePath, "could not be replaced. Is it in use?");
+			return false;
+		}
+
+		return true;
+	}
+
+	// Upgrade every .anim file in Directory and its subfolders that isn't current.
+	//
+	// Returns the number of files upgraded.
+	size_t ConvertDirectory(const std::string& Directory, size_t* OutFailed, const PAnim::CompressionSettings& Compression)
+	{
+		size_t Converted = 0;
+		size_t Failed = 0;
+		size_t Current = 0;
+
+		std::error_code Error;
+		for (const auto& Entry : std::filesystem::recursive_directory_iterator(Directory, Error))
+		{
+			std::string Extension = Entry.path().extension().string();
+			for (char& Letter : Extension)
+			{
+				Letter = (char)tolower((unsigned char)Letter);
+			}
+
+			if (!Entry.is_regular_file() || (Extension != ".anim"))
+			{
+				continue;
+			}
+
+			std::string FilePath = Entry.path().string();
+
+			if (IsCurrent(FilePath, Compression))
+			{
+				++Current;
+			}
+			else if (Convert(FilePath, Compression))
+			{
+				++Converted;
+			}
+			else
+			{
+				++Failed;
+			}
+		}
+
+		PGameplayStatics::PrintToConsole(("Upgraded " + std::to_string(Converted) + " .anim files to version " + std::to_string(Version) + ". " + std::to_string(Current) + " were already current, " + std::to_string(Failed) + " failed."), (Failed > 0) ? 3 : 1, "Animation");
+
+		if (OutFailed)
+		{
+			*OutFailed = Failed;
+		}
+
+		return Converted;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../PAnim/PAnim.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Reading and writing .anim files.
+//
+// Version 2 and 3 files start with a Header, followed by sections at the offsets it gives. Each section starts on a
+// SectionAlignment boundary and holds exactly what a loaded clip keeps, so loading maps the file (see PFileMap), checks
+// the header and sections against each other and the file size, and uses the keys in place (see
+// PAnim::PackedClip::FromMappedKeys()). Only the bind pose, times, and parents are copied out. Values are little endian.
+//
+// Version 3 adds the compressed tracks (see PAnimCompression). Convert() compresses clips once, offline, and a file
+// stored compressed has an empty key section and its tracks copied out on load, which is a few memcpys of data already a
+// fraction of the keys' size. Its tracks are checked to read only inside their sections, so a damaged file fails to load
+// rather than being sampled out of bounds. Version 2 files are version 3 files without the track sections or the
+// compression settings, and still load.
+//
+// Version 1 files have no header. They hold a joint count and that many bind pose PAnim::Joints, the duration, a
+// keyframe count, then per keyframe its time, a joint count, and that many PAnim::Joints of model space matrices. Older
+// exporters wrote one keyframe fewer than the count, starting from the second. Version 1 files still load, but every
+// load rebuilds the local keys from the matrices; Convert() upgrades them.
+namespace PAnimFile
+{
+	constexpr uint32_t Magic = 0x4D4E4150;					// "PANM" as a little endian word.
+	constexpr uint32_t Version = 3;							// The version Save() writes.
+	constexpr uint64_t SectionAlignment = 64;				// Every section starts on a multiple of this many bytes.
+
+	// The sections of a version 3 file, in the order they're written. Version 2 files have the first 5.
+	enum EAnimFileSections
+	{
+		ANIMSECTION_BIND = 0,			// BindJointCount PAnim::Joints, the bind pose.
+		ANIMSECTION_INVERSEBIND = 1,	// BindJointCount float4x4_a, the inverse of each bind pose joint.
+		ANIMSECTION_TIMES = 2,			// FrameCount doubles, the time of each keyframe, ascending.
+		ANIMSECTION_PARENTS = 3,		// JointCount ints, the parent of each joint, -1 for root joints.
+		ANIMSECTION_KEYS = 4,			// FrameCount * JointCount * KeyStride floats, laid out like PAnim::PackedClip::Keys. Empty if compressed.
+		ANIMSECTION_TRACKS = 5,			// Compressed clips: JointCount * GetTracksPerJoint() PAnim::PackedClip::Tracks. Empty otherwise.
+		ANIMSECTION_TRACKKEYS = 6,		// Compressed clips: PAnim::PackedClip::KeyFrames.
+		ANIMSECTION_QUANTIZED = 7,		// Compressed clips: PAnim::PackedClip::QuantizedData.
+		ANIMSECTION_FLOATS = 8,			// Compressed clips: PAnim::PackedClip::FloatData.
+		ANIMSECTION_COUNT = 9
+	};
+
+	constexpr uint32_t Version2SectionCount = 5;			// Version 2 files end their header after the key section.
+
+	// Where a section is in the file, in bytes.
+	struct Section
+	{
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+	};
+
+	// The start of a version 3 file. A version 2 header is its first Version2HeaderSize bytes.
+	struct Header
+	{
+		uint32_t Magic = PAnimFile::Magic;
+		uint32_t Version = PAnimFile::Version;
+		uint32_t HeaderSize = sizeof(Header);				// Lets a reader tell a header it doesn't know from a damaged one.
+		uint32_t KeyStride = 7;								// Floats per joint key, 7 without scale or 10 with it.
+		uint64_t FileSize = 0;								// The size of the whole file, to catch truncated copies.
+		double Duration = 0.0;
+		uint32_t BindJointCount = 0;
+		uint32_t JointCount = 0;
+		uint32_t FrameCount = 0;
+		uint32_t Reserved = 0;
+		Section Sections[ANIMSECTION_COUNT];
+		float CompressionMaxError = 0.0f;					// The settings the clip was compressed with, 0 if it never was. A clip
+		float CompressionTipDistance = 0.0f;				// compression didn't shrink is stored uncompressed, with these still set.
+	};
+
+	static_assert(sizeof(Header) == 200, "The .anim header layout is part of the file format.");
+	constexpr uint32_t Version2HeaderSize = 128;			// Version 2 headers stop after their 5 sections.
+
+	// Return the version of the .anim file at FilePath: Version, 1 for files without a header, or 0 if it can't be read.
+	uint32_t GetVersion(const std::string& FilePath);
+
+	// Load the .anim file at FilePath, of any version. Clips stored compressed load compressed, with the settings they were
+	// compressed with in the asset's Compression. Why a file could not be loaded is printed to the console.
+	//
+	// Returns nullptr if the file could not be loaded.
+	std::shared_ptr<PAnim::ClipAsset> Load(const std::string& FilePath);
+
+	// Write Clip and Bind to FilePath as a version 3 file. Compression is recorded as the settings the clip was compressed
+	// with, if its bEnabled is set, whether or not Clip ended up compressed.
+	//
+	// Returns true if the file was written.
+	bool Save(const std::string& FilePath, const PAnim::PackedClip& Clip, const PAnim::BindPose& Bind, const PAnim::CompressionSettings& Compression = { false });
+
+	// Return whether the file at FilePath is already the current version, compressed with Compression if its bEnabled is
+	// set. Files that aren't need Convert().
+	bool IsCurrent(const std::string& FilePath, const PAnim::CompressionSettings& Compression = PAnim::CompressionSettings());
+
+	// Upgrade the file at FilePath to version 3 in place, compressing its clip with Compression if its bEnabled is set.
+	// Files that are already current are left alone.
+	//
+	// Returns true if the file is current afterwards.
+	bool Convert(const std::string& FilePath, const PAnim::CompressionSettings& Compression = PAnim::CompressionSettings());
+
+	// Upgrade every .anim file in Directory and its subfolders that isn't current, and print how many were upgraded.
+	//
+	// Returns the number of files upgraded. Files that failed are counted in OutFailed, if given.
+	size_t ConvertDirectory(const std::string& Directory, size_t* OutFailed = nullptr, const PAnim::CompressionSettings& Compression = PAnim::CompressionSettings());
+}
@@ -0,0 +1,761 @@
+#include "PSkinning.h"
+#include "../../../PMath/PTransform.h"
+#include "../../../PMath/PVectorMath.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+
+namespace PSkinning
+{
+	namespace
+	{
+		// The kernels write a vertex's position and normal as 6 contiguous floats.
+		static_assert(offsetof(Vertex, Normal) == (offsetof(Vertex, Position) + sizeof(float3)), "Vertex position and normal must be contiguous.");
+
+		// Read a vertex's 4 influences. Joints out of range get weight 0 and point at joint 0, so every path can read them
+		// without a branch.
+		//
+		// Returns the weight missing from 1, which stays at the bind pose.
+		inline float ResolveInfluences(const Vertex& V, size_t JointCount, uint32_t (&OutJoints)[4], float (&OutWeights)[4])
+		{
+			float Residual = 1.0f;
+
+			for (int k = 0; k < 4; ++k)
+			{
+				uint32_t Joint = (uint32_t)V.JointIndices[k];
+				bool bValid = (Joint < JointCount);
+
+				OutJoints[k] = bValid ? Joint : 0;
+				OutWeights[k] = bValid ? V.Weights[k] : 0.0f;
+				Residual -= OutWeights[k];
+			}
+
+			return Residual;
+		}
+
+		// Pick the heaviest influence. Dual quaternions are sign aligned to it before blending, so the blend takes the short
+		// way around between every pair.
+		//
+		// Returns the index of the influence, 0 to 3.
+		inline int HeaviestInfluence(const float (&Weights)[4])
+		{
+			int Pivot = 0;
+
+			for (int k = 1; k < 4; ++k)
+			{
+				if (Weights[k] > Weights[Pivot])
+				{
+					Pivot = k;
+				}
+			}
+
+			return Pivot;
+		}
+
+		// Flip the weights of dual quaternions on the other side of the pivot's, and return the sign the bind pose (an
+		// identity) takes for the missing weight.
+		inline float AlignDualQuatWeights(const DualQuat* Palette, const uint32_t (&Joints)[4], float (&Weights)[4])
+		{
+			const float4_a& Pivot = Palette[Joints[HeaviestInfluence(Weights)]].Real;
+
+			for (int k = 0; k < 4; ++k)
+			{
+				const float4_a& Real = Palette[Joints[k]].Real;
+
+				if (((Real.x * Pivot.x) + (Real.y * Pivot.y) + (Real.z * Pivot.z) + (Real.w * Pivot.w)) < 0.0f)
+				{
+					Weights[k] = -Weights[k];
+				}
+			}
+
+			return (Pivot.w < 0.0f) ? -1.0f : 1.0f;
+		}
+
+
+		// Return where sphere Index of Spheres sits under Palette, and its radius there. Spheres past the end of the
+		// palette, and the last one, stay at the bind pose.
+		inline void PoseSphereScalar(const JointSphere* Spheres, size_t Index, size_t SphereCount, const float4x4_a* Palette, size_t JointCount, float (&OutCenter)[3], float& OutRadius)
+		{
+			const JointSphere& Sphere = Spheres[Index];
+
+			if ((Index + 1 == SphereCount) || (Index >= JointCount))
+			{
+				OutCenter[0] = Sphere.Center.x;
+				OutCenter[1] = Sphere.Center.y;
+				OutCenter[2] = Sphere.Center.z;
+				OutRadius = Sphere.Radius;
+				return;
+			}
+
+			const float4x4_a& M = Palette[Index];
+			float ScaleSq = 0.0f;
+
+			for (int Row = 0; Row < 3; ++Row)
+			{
+				ScaleSq = std::max(ScaleSq, ((M[Row].x * M[Row].x) + (M[Row].y * M[Row].y) + (M[Row].z * M[Row].z)));
+			}
+
+			OutCenter[0] = (Sphere.Center.x * M[0].x) + (Sphere.Center.y * M[1].x) + (Sphere.Center.z * M[2].x) + M[3].x;
+			OutCenter[1] = (Sphere.Center.x * M[0].y) + (Sphere.Center.y * M[1].y) + (Sphere.Center.z * M[2].y) + M[3].y;
+			OutCenter[2] = (Sphere.Center.x * M[0].z) + (Sphere.Center.y * M[1].z) + (Sphere.Center.z * M[2].z) + M[3].z;
+			OutRadius = Sphere.Radius * sqrtf(ScaleSq);
+		}
+
+
+		// ------------------------------------------------------------------
+		//		Scalar Kernels.
+		// ------------------------------------------------------------------
+
+		bool PoseBoundsScalar(const JointSphere* Spheres, size_t SphereCount, const float4x4_a* Palette, size_t JointCount, PAABB& OutBounds)
+		{
+			float Min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float Max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			bool bAny = false;
+
+			for (size_t i = 0; i < SphereCount; ++i)
+			{
+				if (Spheres[i].Radius < 0.0f)
+				{
+					continue;
+				}
+
+				float Center[3];
+				float Radius;
+				PoseSphereScalar(Spheres, i, SphereCount, Palette, JointCount, Center, Radius);
+
+				for (int x = 0; x < 3; ++x)
+				{
+					Min[x] = std::min(Min[x], (Center[x] - Radius));
+					Max[x] = std::max(Max[x], (Center[x] + Radius));
+				}
+
+				bAny = true;
+			}
+
+			if (bAny)
+			{
+				OutBounds.Center = { ((Min[0] + Max[0]) * 0.5f), ((Min[1] + Max[1]) * 0.5f), ((Min[2] + Max[2]) * 0.5f) };
+				OutBounds.Extents = { ((Max[0] - Min[0]) * 0.5f), ((Max[1] - Min[1]) * 0.5f), ((Max[2] - Min[2]) * 0.5f) };
+			}
+
+			return bAny;
+		}
+
+		void SkinLinearScalar(const Vertex* In, Vertex* Out, size_t Count, const float4x4_a* Palette, size_t JointCount)
+		{
+			for (size_t i = 0; i < Count; ++i)
+			{
+				const Vertex& V = In[i];
+
+				uint32_t Joints[4];
+				float Weights[4];
+				float Residual = ResolveInfluences(V, JointCount, Joints, Weights);
+
+				// The blended matrix, as rows 0 to 3 of xyz.
+				float M[12] = {};
+
+				for (int k = 0; k < 4; ++k)
+				{
+					const float* Joint = &Palette[Joints[k]][0].x;
+
+					for (int Row = 0; Row < 4; ++Row)
+					{
+						for (int Col = 0; Col < 3; ++Col)
+						{
+							M[(Row * 3) + Col] += (Weights[k] * Joint[(Row * 4) + Col]);
+						}
+					}
+				}
+
+				M[0] += Residual;
+				M[4] += Residual;
+				M[8] += Residual;
+
+				const float3& P = V.Position;
+				const float3& N = V.Normal;
+
+				Out[i].Position = { (P.x * M[0]) + (P.y * M[3]) + (P.z * M[6]) + M[9],
+									(P.x * M[1]) + (P.y * M[4]) + (P.z * M[7]) + M[10],
+									(P.x * M[2]) + (P.y * M[5]) + (P.z * M[8]) + M[11] };
+
+				float3 Normal = { (N.x * M[0]) + (N.y * M[3]) + (N.z * M[6]),
+								  (N.x * M[1]) + (N.y * M[4]) + (N.z * M[7]),
+								  (N.x * M[2]) + (N.y * M[5]) + (N.z * M[8]) };
+
+				float LengthSq = dot(Normal, Normal);
+				Out[i].Normal = (LengthSq > 0.0f) ? (Normal * (1.0f / sqrtf(LengthSq))) : float3{ 0.0f, 0.0f, 0.0f };
+			}
+		}
+
+		void SkinDualQuatScalar(const Vertex* In, Vertex* Out, size_t Count, const DualQuat* Palette, size_t JointCount)
+		{
+			for (size_t i = 0; i < Count; ++i)
+			{
+				const Vertex& V = In[i];
+
+				uint32_t Joints[4];
+				float Weights[4];
+				float Residual = ResolveInfluences(V, JointCount, Joints, Weights);
+				Residual *= AlignDualQuatWeights(Palette, Joints, Weights);
+
+				float Real[4] = { 0.0f, 0.0f, 0.0f, Residual };
+				float Dual[4] = {};
+
+				for (int k = 0; k < 4; ++k)
+				{
+					const DualQuat& Joint = Palette[Joints[k]];
+
+					for (int x = 0; x < 4; ++x)
+					{
+						Real[x] += (Weights[k] * Joint.Real[x]);
+						Dual[x] += (Weights[k] * Joint.Dual[x]);
+					}
+				}
+
+				float LengthSq = (Real[0] * Real[0]) + (Real[1] * Real[1]) + (Real[2] * Real[2]) + (Real[3] * Real[3]);
+				if (LengthSq <= 0.0f)
+				{
+					Out[i].Position = V.Position;
+					Out[i].Normal = V.Normal;
+					continue;
+				}
+
+				float InvLength = (1.0f / sqrtf(LengthSq));
+				float3 U = { Real[0] * InvLength, Real[1] * InvLength, Real[2] * InvLength };
+				float W = (Real[3] * InvLength);
+				float3 D = { Dual[0] * InvLength, Dual[1] * InvLength, Dual[2] * InvLength };
+				float DW = (Dual[3] * InvLength);
+
+				// v' = v + 2u x (u x v + wv), and the translation is 2(w d - dw u + u x d).
+				float3 Translation = ((D * W) - (U * DW) + cross(U, D)) * 2.0f;
+				float3 P = V.Position;
+				float3 N = V.Normal;
+
+				Out[i].Position = P + (cross(U, (cross(U, P) + (P * W))) * 2.0f) + Translation;
+				Out[i].Normal = N + (cross(U, (cross(U, N) + (N * W))) * 2.0f);
+			}
+		}
+
+
+		// ------------------------------------------------------------------
+		//		SSE Kernels.
+		// ------------------------------------------------------------------
+
+#if defined(PMATH_SSE)
+		// The 3 component dot product of A and B in every lane.
+		inline __m128 Dot3SSE(__m128 A, __m128 B)
+		{
+			__m128 M = _mm_mul_ps(A, B);
+			__m128 X = _mm_shuffle_ps(M, M, _MM_SHUFFLE(0, 0, 0, 0));
+			__m128 Y = _mm_shuffle_ps(M, M, _MM_SHUFFLE(1, 1, 1, 1));
+			__m128 Z = _mm_shuffle_ps(M, M, _MM_SHUFFLE(2, 2, 2, 2));
+
+			return _mm_add_ps(_mm_add_ps(X, Y), Z);
+		}
+
+		// The 4 component dot product of A and B in every lane.
+		inline __m128 Dot4SSE(__m128 A, __m128 B)
+		{
+			__m128 M = _mm_mul_ps(A, B);
+			M = _mm_add_ps(M, _mm_shuffle_ps(M, M, _MM_SHUFFLE(2, 3, 0, 1)));
+
+			return _mm_add_ps(M, _mm_shuffle_ps(M, M, _MM_SHUFFLE(1, 0, 3, 2)));
+		}
+
+		// A x B in xyz. w is 0.
+		inline __m128 Cross3SSE(__m128 A, __m128 B)
+		{
+			__m128 AYZX = _mm_shuffle_ps(A, A, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 AZXY = _mm_shuffle_ps(A, A, _MM_SHUFFLE(3, 1, 0, 2));
+			__m128 BYZX = _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 BZXY = _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 1, 0, 2));
+
+			return _mm_sub_ps(_mm_mul_ps(AYZX, BZXY), _mm_mul_ps(AZXY, BYZX));
+		}
+
+		// Scale xyz to unit length. Zero length directions stay zero.
+		inline __m128 Normalize3SSE(__m128 V)
+		{
+			__m128 LengthSq = Dot3SSE(V, V);
+			__m128 bNonZero = _mm_cmpgt_ps(LengthSq, _mm_setzero_ps());
+
+			return _mm_and_ps(_mm_div_ps(V, _mm_sqrt_ps(LengthSq)), bNonZero);
+		}
+
+		// Write the xyz of P and N to a vertex's position and normal, without touching the texture coordinates after them.
+		inline void StorePositionNormal(Vertex& Out, __m128 P, __m128 N)
+		{
+			__m128 ZX = _mm_shuffle_ps(P, N, _MM_SHUFFLE(0, 0, 2, 2));
+
+			_mm_storeu_ps(&Out.Position.x, _mm_shuffle_ps(P, ZX, _MM_SHUFFLE(2, 0, 1, 0)));
+			_mm_storel_pi((__m64*)&Out.Normal.y, _mm_shuffle_ps(N, N, _MM_SHUFFLE(3, 3, 2, 1)));
+		}
+
+		inline __m128 LoadFloat3SSE(const float3& V)
+		{
+			return _mm_setr_ps(V.x, V.y, V.z, 0.0f);
+		}
+
+		// Rotate V by the unit quaternion Real, and add Translation.
+		inline __m128 DualQuatTransformSSE(__m128 V, __m128 Real, __m128 Translation)
+		{
+			__m128 W = _mm_shuffle_ps(Real, Real, _MM_SHUFFLE(3, 3, 3, 3));
+			__m128 T = _mm_add_ps(Cross3SSE(Real, V), _mm_mul_ps(V, W));
+
+			return _mm_add_ps(_mm_add_ps(V, _mm_add_ps(Cross3SSE(Real, T), Cross3SSE(Real, T))), Translation);
+		}
+
+		// Normalize a blended dual quaternion and transform V's position and normal by it.
+		inline void DualQuatSkinSSE(const Vertex& V, Vertex& Out, __m128 Real, __m128 Dual)
+		{
+			__m128 LengthSq = Dot4SSE(Real, Real);
+
+			if (_mm_cvtss_f32(LengthSq) <= 0.0f)
+			{
+				Out.Position = V.Position;
+				Out.Normal = V.Normal;
+				return;
+			}
+
+			__m128 InvLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(LengthSq));
+			Real = _mm_mul_ps(Real, InvLength);
+			Dual = _mm_mul_ps(Dual, InvLength);
+
+			// 2(w d - dw u + u x d)
+			__m128 W = _mm_shuffle_ps(Real, Real, _MM_SHUFFLE(3, 3, 3, 3));
+			__m128 DW = _mm_shuffle_ps(Dual, Dual, _MM_SHUFFLE(3, 3, 3, 3));
+			__m128 Translation = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(Dual, W), _mm_mul_ps(Real, DW)), Cross3SSE(Real, Dual));
+			Translation = _mm_add_ps(Translation, Translation);
+
+			__m128 P = DualQuatTransformSSE(LoadFloat3SSE(V.Position), Real, Translation);
+			__m128 N = DualQuatTransformSSE(LoadFloat3SSE(V.Normal), Real, _mm_setzero_ps());
+
+			StorePositionNormal(Out, P, N);
+		}
+
+		void SkinLinearSSE(const Vertex* In, Vertex* Out, size_t Count, const float4x4_a* Palette, size_t JointCount)
+		{
+			for (size_t i = 0; i < Count; ++i)
+			{
+				const Vertex& V = In[i];
+
+				uint32_t Joints[4];
+				float Weights[4];
+				float Residual = ResolveInfluences(V, JointCount, Joints, Weights);
+
+				__m128 Row0 = _mm_setr_ps(Residual, 0.0f, 0.0f, 0.0f);
+				__m128 Row1 = _mm_setr_ps(0.0f, Residual, 0.0f, 0.0f);
+				__m128 Row2 = _mm_setr_ps(0.0f, 0.0f, Residual, 0.0f);
+				__m128 Row3 = _mm_setzero_ps();
+
+				for (int k = 0; k < 4; ++k)
+				{
+					const float* Joint = &Palette[Joints[k]][0].x;
+					__m128 Weight = _mm_set1_ps(Weights[k]);
+
+					Row0 = _mm_add_ps(Row0, _mm_mul_ps(Weight, _mm_load_ps(Joint)));
+					Row1 = _mm_add_ps(Row1, _mm_mul_ps(Weight, _mm_load_ps(Joint + 4)));
+					Row2 = _mm_add_ps(Row2, _mm_mul_ps(Weight, _mm_load_ps(Joint + 8)));
+					Row3 = _mm_add_ps(Row3, _mm_mul_ps(Weight, _mm_load_ps(Joint + 12)));
+				}
+
+				__m128 N = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(V.Normal.x), Row0), _mm_mul_ps(_mm_set1_ps(V.Normal.y), Row1)), _mm_mul_ps(_mm_set1_ps(V.Normal.z), Row2));
+				__m128 P = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(V.Position.x), Row0), _mm_mul_ps(_mm_set1_ps(V.Position.y), Row1)), _mm_mul_ps(_mm_set1_ps(V.Position.z), Row2));
+				P = _mm_add_ps(P, Row3);
+
+				StorePositionNormal(Out[i], P, Normalize3SSE(N));
+			}
+		}
+
+		void SkinDualQuatSSE(const Vertex* In, Vertex* Out, size_t Count, const DualQuat* Palette, size_t JointCount)
+		{
+			for (size_t i = 0; i < Count; ++i)
+			{
+				const Vertex& V = In[i];
+
+				uint32_t Joints[4];
+				float Weights[4];
+				float Residual = ResolveInfluences(V, JointCount, Joints, Weights);
+				Residual *= AlignDualQuatWeights(Palette, Joints, Weights);
+
+				__m128 Real = _mm_setr_ps(0.0f, 0.0f, 0.0f, Residual);
+				__m128 Dual = _mm_setzero_ps();
+
+				for (int k = 0; k < 4; ++k)
+				{
+					const DualQuat& Joint = Palette[Joints[k]];
+					__m128 Weight = _mm_set1_ps(Weights[k]);
+
+					Real = _mm_add_ps(Real, _mm_mul_ps(Weight, _mm_load_ps(&Joint.Real.x)));
+					Dual = _mm_add_ps(Dual, _mm_mul_ps(Weight, _mm_load_ps(&Joint.Dual.x)));
+				}
+
+				DualQuatSkinSSE(V, Out[i], Real, Dual);
+			}
+		}
+
+		// One sphere per register. Each sphere is only a few instructions, too little for 8 wide to pay for the shuffles,
+		// so the AVX2 level runs this too.
+		bool PoseBoundsSSE(const JointSphere* Spheres, size_t SphereCount, const float4x4_a* Palette, size_t JointCount, PAABB& OutBounds)
+		{
+			__m128 Min = _mm_set1_ps(FLT_MAX);
+			__m128 Max = _mm_set1_ps(-FLT_MAX);
+			bool bAny = false;
+
+			// The last sphere, and any past the palette, stay at the bind pose.
+			size_t Posed = std::min(JointCount, (SphereCount - 1));
+
+			for (size_t i = 0; i < Posed; ++i)
+			{
+				const JointSphere& Sphere = Spheres[i];
+
+				if (Sphere.Radius < 0.0f)
+				{
+					continue;
+				}
+
+				const float4x4_a& M = Palette[i];
+				__m128 Row0 = _mm_load_ps(&M[0].x);
+				__m128 Row1 = _mm_load_ps(&M[1].x);
+				__m128 Row2 = _mm_load_ps(&M[2].x);
+
+				__m128 Center = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Sphere.Center.x), Row0), _mm_mul_ps(_mm_set1_ps(Sphere.Center.y), Row1)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Sphere.Center.z), Row2), _mm_load_ps(&M[3].x)));
+
+				// Sum each row's squares across, so lanes 0 to 2 hold the squared length of rows 0 to 2, and take the largest.
+				__m128 Sq0 = _mm_mul_ps(Row0, Row0);
+				__m128 Sq1 = _mm_mul_ps(Row1, Row1);
+				__m128 Sq2 = _mm_mul_ps(Row2, Row2);
+				__m128 Sq3 = _mm_setzero_ps();
+				_MM_TRANSPOSE4_PS(Sq0, Sq1, Sq2, Sq3);
+
+				__m128 LengthSq = _mm_add_ps(_mm_add_ps(Sq0, Sq1), Sq2);
+				LengthSq = _mm_max_ps(LengthSq, _mm_shuffle_ps(LengthSq, LengthSq, _MM_SHUFFLE(3, 0, 2, 1)));
+				LengthSq = _mm_max_ps(LengthSq, _mm_shuffle_ps(LengthSq, LengthSq, _MM_SHUFFLE(3, 1, 0, 2)));
+
+				__m128 Radius = _mm_mul_ps(_mm_set1_ps(Sphere.Radius), _mm_sqrt_ps(_mm_shuffle_ps(LengthSq, LengthSq, _MM_SHUFFLE(0, 0, 0, 0))));
+
+				Min = _mm_min_ps(Min, _mm_sub_ps(Center, Radius));
+				Max = _mm_max_ps(Max, _mm_add_ps(Center, Radius));
+				bAny = true;
+			}
+
+			for (size_t i = Posed; i < SphereCount; ++i)
+			{
+				const JointSphere& Sphere = Spheres[i];
+
+				if (Sphere.Radius < 0.0f)
+				{
+					continue;
+				}
+
+				__m128 Center = _mm_setr_ps(Sphere.Center.x, Sphere.Center.y, Sphere.Center.z, 0.0f);
+				__m128 Radius = _mm_set1_ps(Sphere.Radius);
+
+				Min = _mm_min_ps(Min, _mm_sub_ps(Center, Radius));
+				Max = _mm_max_ps(Max, _mm_add_ps(Center, Radius));
+				bAny = true;
+			}
+
+			if (bAny)
+			{
+				alignas(16) float Center[4];
+				alignas(16) float Extents[4];
+				_mm_store_ps(Center, _mm_mul_ps(_mm_add_ps(Min, Max), _mm_set1_ps(0.5f)));
+				_mm_store_ps(Extents, _mm_mul_ps(_mm_sub_ps(Max, Min), _mm_set1_ps(0.5f)));
+
+				OutBounds.Center = { Center[0], Center[1], Center[2] };
+				OutBounds.Extents = { Extents[0], Extents[1], Extents[2] };
+			}
+
+			return bAny;
+		}
+#endif
+
+
+		// ------------------------------------------------------------------
+		//		AVX2 Kernels.
+		// ------------------------------------------------------------------
+
+#if defined(PMATH_AVX2_KERNELS)
+		// One vertex per iteration, two matrix rows per register, so each influence is two fused multiply-adds. The position
+		// and normal are transformed together: the low lane holds the position and the high lane the normal, which skips
+		// the translation row.
+		PMATH_AVX2_TARGET void SkinLinearAVX2(const Vertex* In, Vertex* Out, size_t Count, const float4x4_a* Palette, size_t JointCount)
+		{
+			const __m256 Identity01 = _mm256_setr_ps(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+			const __m256 Identity23 = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+			for (size_t i = 0; i < Count; ++i)
+			{
+				const Vertex& V = In[i];
+
+				uint32_t Joints[4];
+				float Weights[4];
+				float Residual = ResolveInfluences(V, JointCount, Joints, Weights);
+
+				__m256 Rows01 = _mm256_mul_ps(_mm256_set1_ps(Residual), Identity01);
+				__m256 Rows23 = _mm256_mul_ps(_mm256_set1_ps(Residual), Identity23);
+
+				for (int k = 0; k < 4; ++k)
+				{
+					const float* Joint = &Palette[Joints[k]][0].x;
+					__m256 Weight = _mm256_set1_ps(Weights[k]);
+
+					Rows01 = _mm256_fmadd_ps(Weight, _mm256_loadu_ps(Joint), Rows01);
+					Rows23 = _mm256_fmadd_ps(Weight, _mm256_loadu_ps(Joint + 8), Rows23);
+				}
+
+				__m256 Row0 = _mm256_permute2f128_ps(Rows01, Rows01, 0x00);
+				__m256 Row1 = _mm256_permute2f128_ps(Rows01, Rows01, 0x11);
+				__m256 Row2 = _mm256_permute2f128_ps(Rows23, Rows23, 0x00);
+				__m256 Row3 = _mm256_permute2f128_ps(Rows23, Rows23, 0x81);
+
+				__m256 X = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(V.Position.x)), _mm_set1_ps(V.Normal.x), 1);
+				__m256 Y = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(V.Position.y)), _mm_set1_ps(V.Normal.y), 1);
+				__m256 Z = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(V.Position.z)), _mm_set1_ps(V.Normal.z), 1);
+
+				__m256 Result = _mm256_fmadd_ps(X, Row0, _mm256_fmadd_ps(Y, Row1, _mm256_fmadd_ps(Z, Row2, Row3)));
+
+				StorePositionNormal(Out[i], _mm256_castps256_ps128(Result), Normalize3SSE(_mm256_extractf128_ps(Result, 1)));
+			}
+		}
+
+		// One vertex per iteration, with a joint's whole dual quaternion in one register.
+		PMATH_AVX2_TARGET void SkinDualQuatAVX2(const Vertex* In, Vertex* Out, size_t Count, const DualQuat* Palette, size_t JointCount)
+		{
+			const __m256 Identity = _mm256_setr_ps(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+			for (size_t i = 0; i < Count; ++i)
+			{
+				const Vertex& V = In[i];
+
+				uint32_t Joints[4];
+				float Weights[4];
+				float Residual = ResolveInfluences(V, JointCount, Joints, Weights);
+				Residual *= AlignDualQuatWeights(Palette, Joints, Weights);
+
+				__m256 Blend = _mm256_mul_ps(_mm256_set1_ps(Residual), Identity);
+
+				for (int k = 0; k < 4; ++k)
+				{
+					Blend = _mm256_fmadd_ps(_mm256_set1_ps(Weights[k]), _mm256_loadu_ps(&Palette[Joints[k]].Real.x), Blend);
+				}
+
+				DualQuatSkinSSE(V, Out[i], _mm256_castps256_ps128(Blend), _mm256_extractf128_ps(Blend, 1));
+			}
+		}
+#endif
+	}
+
+	// Build the palette: OutPalette[j] = InverseBind[j] * Pose[j].
+	size_t ComputePalette(std::span<const float4x4_a> InverseBind, std::span<const float4x4_a> Pose, std::span<float4x4_a> OutPalette, bool bMirrorX, PSimdLevel Level)
+	{
+		size_t Count = std::min({ InverseBind.size(), Pose.size(), OutPalette.size() });
+
+		PMultiplyMatricesPairwiseA(InverseBind.data(), Pose.data(), OutPalette.data(), Count, Level);
+
+		// Mirror * M * Mirror, where Mirror negates X, flips the sign of everything that mixes X with Y, Z, or W.
+		if (bMirrorX)
+		{
+			for (size_t i = 0; i < Count; ++i)
+			{
+				float4x4_a& M = OutPalette[i];
+
+				M[0].y = -M[0].y;
+				M[0].z = -M[0].z;
+				M[0].w = -M[0].w;
+				M[1].x = -M[1].x;
+				M[2].x = -M[2].x;
+				M[3].x = -M[3].x;
+			}
+		}
+
+		return Count;
+	}
+
+	// Convert palette matrices to dual quaternions.
+	void ComputeDualQuats(std::span<const float4x4_a> Palette, std::span<DualQuat> OutPalette)
+	{
+		size_t Count = std::min(Palette.size(), OutPalette.size());
+
+		for (size_t i = 0; i < Count; ++i)
+		{
+			PVector Scale;
+			PQuaternion Rotation;
+			PVector Translation;
+			PMatrixDecompose(&Scale, &Rotation, &Translation, PLoadMatrix(Palette[i]));
+
+			float4 Q = PStoreFloat4(Rotation);
+			float3 U = { Q.x, Q.y, Q.z };
+			float3 T = PStoreFloat3(Translation);
+
+			// Dual = 0.5 * (T, 0) * Real.
+			float3 D = ((T * Q.w) + cross(T, U)) * 0.5f;
+
+			OutPalette[i].Real = { Q.x, Q.y, Q.z, Q.w };
+			OutPalette[i].Dual = { D.x, D.y, D.z, (-0.5f * dot(T, U)) };
+		}
+	}
+
+	// Deform Count vertices with linear blend skinning.
+	void SkinVertices(const Vertex* In, Vertex* Out, size_t Count, std::span<const float4x4_a> Palette, PSimdLevel Level)
+	{
+		// With no palette every vertex stays at the bind pose.
+		if (Palette.empty())
+		{
+			for (size_t i = 0; i < Count; ++i)
+			{
+				Out[i].Position = In[i].Position;
+				Out[i].Normal = In[i].Normal;
+			}
+			return;
+		}
+
+		switch (PSelectSimdPath(Level))
+		{
+#if defined(PMATH_AVX2_KERNELS)
+		case PSimdPath::AVX2:
+			SkinLinearAVX2(In, Out, Count, Palette.data(), Palette.size());
+			return;
+#endif
+#if defined(PMATH_SSE)
+		case PSimdPath::SSE:
+			SkinLinearSSE(In, Out, Count, Palette.data(), Palette.size());
+			return;
+#endif
+		default:
+			SkinLinearScalar(In, Out, Count, Palette.data(), Palette.size());
+			return;
+		}
+	}
+
+	// Deform Count vertices with dual quaternion skinning.
+	void SkinVerticesDualQuat(const Vertex* In, Vertex* Out, size_t Count, std::span<const DualQuat> Palette, PSimdLevel Level)
+	{
+		if (Palette.empty())
+		{
+			for (size_t i = 0; i < Count; ++i)
+			{
+				Out[i].Position = In[i].Position;
+				Out[i].Normal = In[i].Normal;
+			}
+			return;
+		}
+
+		switch (PSelectSimdPath(Level))
+		{
+#if defined(PMATH_AVX2_KERNELS)
+		case PSimdPath::AVX2:
+			SkinDualQuatAVX2(In, Out, Count, Palette.data(), Palette.size());
+			return;
+#endif
+#if defined(PMATH_SSE)
+		case PSimdPath::SSE:
+			SkinDualQuatSSE(In, Out, Count, Palette.data(), Palette.size());
+			return;
+#endif
+		default:
+			SkinDualQuatScalar(In, Out, Count, Palette.data(), Palette.size());
+			return;
+		}
+	}
+
+	// Fit a sphere around the vertices each joint influences, and one around those that keep part of the bind pose.
+	void ComputeJointSpheres(const Vertex* Vertices, size_t Count, std::vector<JointSphere>& OutSpheres)
+	{
+		int MaxJoint = -1;
+
+		for (size_t i = 0; i < Count; ++i)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				if (Vertices[i].Weights[k] > 0.0f)
+				{
+					MaxJoint = std::max(MaxJoint, Vertices[i].JointIndices[k]);
+				}
+			}
+		}
+
+		// Each sphere is centred on the box around its vertices, then grown to reach the furthest of them.
+		size_t SphereCount = (size_t)(MaxJoint + 2);
+		std::vector<PAABB> Boxes(SphereCount, PAABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } });
+		std::vector<uint8_t> bUsed(SphereCount, 0);
+
+		auto ForEachSphere = [&](const Vertex& V, auto&& Function)
+		{
+			float Residual = 1.0f;
+
+			for (int k = 0; k < 4; ++k)
+			{
+				if ((V.Weights[k] > 0.0f) && (V.JointIndices[k] >= 0))
+				{
+					Function((size_t)V.JointIndices[k]);
+					Residual -= V.Weights[k];
+				}
+			}
+
+			if (Residual > 1e-4f)
+			{
+				Function(SphereCount - 1);
+			}
+		};
+
+		// Boxes hold the minimum in Center and the maximum in Extents until every vertex is in.
+		for (size_t i = 0; i < Count; ++i)
+		{
+			const float3& P = Vertices[i].Position;
+
+			ForEachSphere(Vertices[i], [&](size_t Sphere)
+			{
+				PAABB& Box = Boxes[Sphere];
+				Box.Center = { std::min(Box.Center.x, P.x), std::min(Box.Center.y, P.y), std::min(Box.Center.z, P.z) };
+				Box.Extents = { std::max(Box.Extents.x, P.x), std::max(Box.Extents.y, P.y), std::max(Box.Extents.z, P.z) };
+				bUsed[Sphere] = 1;
+			});
+		}
+
+		OutSpheres.assign(SphereCount, JointSphere());
+
+		for (size_t i = 0; i < SphereCount; ++i)
+		{
+			if (bUsed[i])
+			{
+				OutSpheres[i].Center = (Boxes[i].Center + Boxes[i].Extents) * 0.5f;
+				OutSpheres[i].Radius = 0.0f;
+			}
+		}
+
+		for (size_t i = 0; i < Count; ++i)
+		{
+			const float3& P = Vertices[i].Position;
+
+			ForEachSphere(Vertices[i], [&](size_t Sphere)
+			{
+				float3 Offset = (P - OutSpheres[Sphere].Center);
+				OutSpheres[Sphere].Radius = std::max(OutSpheres[Sphere].Radius, sqrtf(dot(Offset, Offset)));
+			});
+		}
+	}
+
+	// Bound a mesh posed by Palette from its joint spheres.
+	bool ComputePoseBounds(std::span<const JointSphere> Spheres, std::span<const float4x4_a> Palette, PAABB& OutBounds, PSimdLevel Level)
+	{
+		if (Spheres.empty())
+		{
+			return false;
+		}
+
+		switch (PSelectSimdPath(Level))
+		{
+#if defined(PMATH_SSE)
+		case PSimdPath::AVX2:
+		case PSimdPath::SSE:
+			return PoseBoundsSSE(Spheres.data(), Spheres.size(), Palette.data(), Palette.size(), OutBounds);
+#endif
+		default:
+			return PoseBoundsScalar(Spheres.data(), Spheres.size(), Palette.data(), Palette.size(), OutBounds);
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../../../PMath/PMath.h"
+#include "../../../PMath/PSimd.h"
+#include <span>
+#include <vector>
+
+using namespace PMath;
+
+// How a pose deforms a skinned mesh.
+enum ESkinningModes
+{
+	SKINNING_LINEAR = 0,		// Linear blend skinning. Blends each vertex's joint matrices. Cheapest, but joints that twist lose volume.
+	SKINNING_DUALQUAT = 1		// Dual quaternion skinning. Blends rotations and translations as dual quaternions, which keeps volume
+								// around twisting joints. Scale in the palette is dropped.
+};
+
+// CPU skinning.
+//
+// A pose becomes a skinning palette once per instance per frame: Palette[j] = InverseBind[j] * Pose[j], taking a bind
+// pose vertex into joint j's space and back out at its posed location. Each vertex then blends up to 4 palette entries
+// by its Weights and JointIndices. An influence whose joint is out of range counts as weight 0, and whatever weight is
+// missing from 1 stays at the bind pose, so unweighted vertices don't move.
+//
+// Each kernel has a scalar, SSE, and AVX2 path, picked the same way as the PTransform kernels. The scalar path is the
+// reference the others are checked against (see PBenchmark::RunSkinningBenchmark()).
+namespace PSkinning
+{
+	// A joint's palette entry as a unit dual quaternion. Real is the rotation, Dual holds the translation.
+	struct DualQuat
+	{
+		float4_a Real;
+		float4_a Dual;
+	};
+
+	// A sphere around the bind pose vertices one joint influences, in mesh space.
+	struct JointSphere
+	{
+		float3 Center = { 0.0f, 0.0f, 0.0f };
+		float Radius = -1.0f;		// Below 0 when the joint influences no vertex.
+	};
+
+	// Build the palette: OutPalette[j] = InverseBind[j] * Pose[j], for as many joints as all three hold. Meshes loaded
+	// from .mesh files are mirrored in X on load while their animations are not (see PSkeletalMesh::LoadMesh()), so
+	// bMirrorX mirrors each palette entry the same way.
+	//
+	// Returns the number of entries written.
+	size_t ComputePalette(std::span<const float4x4_a> InverseBind, std::span<const float4x4_a> Pose, std::span<float4x4_a> OutPalette, bool bMirrorX, PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Convert palette matrices to dual quaternions for SkinVerticesDualQuat(). OutPalette must hold as many entries as
+	// Palette.
+	//
+	// No return value.
+	void ComputeDualQuats(std::span<const float4x4_a> Palette, std::span<DualQuat> OutPalette);
+
+	// Deform Count vertices of In by Palette with linear blend skinning. Only the Position and Normal of Out are written;
+	// it should already hold a copy of In for everything else. Normals are renormalized.
+	//
+	// No return value.
+	void SkinVertices(const Vertex* In, Vertex* Out, size_t Count, std::span<const float4x4_a> Palette, PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Deform Count vertices of In by Palette with dual quaternion skinning. Only the Position and Normal of Out are
+	// written, as in SkinVertices().
+	//
+	// No return value.
+	void SkinVerticesDualQuat(const Vertex* In, Vertex* Out, size_t Count, std::span<const DualQuat> Palette, PSimdLevel Level = PSimdLevel::AVX2);
+
+	// Fit a sphere around the vertices each joint influences with any weight, indexed by joint, followed by one more around
+	// the vertices whose weights fall short of 1, which keep part of the bind pose. Done once per mesh, so its bounds can
+	// follow a pose without touching its vertices (see ComputePoseBounds()).
+	//
+	// No return value.
+	void ComputeJointSpheres(const Vertex* Vertices, size_t Count, std::vector<JointSphere>& OutSpheres);
+
+	// Bound a mesh posed by Palette from the spheres ComputeJointSpheres() fitted to it. Each joint's sphere is moved by
+	// its palette entry and grown by the entry's largest scale, and the results are reduced to one box. A linear blend
+	// skinned vertex is a weighted average of where each of its joints would put it, so it lies inside the box; dual
+	// quaternion blends stay within a hair of it. Spheres of joints past the end of Palette, and the last sphere, stay at
+	// the bind pose, as their vertices do.
+	//
+	// Returns false, leaving OutBounds as it was, if no sphere holds a vertex.
+	bool ComputePoseBounds(std::span<const JointSphere> Spheres, std::span<const float4x4_a> Palette, PAABB& OutBounds, PSimdLevel Level = PSimdLevel::AVX2);
+}
@@ -0,0 +1,1933 @@
+#include "PBenchmark.h"
+#include "../Timer/Timer.h"
+#include "../../PMath/PCulling.h"
+#include "../../PMath/PVectorMath.h"
+#include "../../PMath/PTransform.h"
+#include "../../PMath/PRaycast.h"
+#include "../PAABBTree/PAABBTree.h"
+#include "../PMeshBVH/PMeshBVH.h"
+#include "../PAnimation/PAnim/PAnim.h"
+#include "../PAnimation/PAnimCompression/PAnimCompression.h"
+#include "../PAnimation/PAnimFile/PAnimFile.h"
+#include "../PAnimation/PSkinning/PSkinning.h"
+#include "../PJobs/PJobSystem.h"
+#include "../PObjLoader/OBJ_Loader.h"
+#include "../PObjParser/PObjParser.h"
+#include "../PMeshCache/PMeshCache.h"
+#include "../PVertexWeld/PVertexWeld.h"
+#include "../../PRender/POcclusion/POcclusion.h"
+#include "../../PStatics/PGameplayStatics/PGameplayStatics.h"
+#include <random>
+#include <cstdio>
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+	#include <malloc.h>
+#endif
+
+using namespace PMath;
+
+// ------------------------------------------------------------------
+//		Allocation Counting.
+// ------------------------------------------------------------------
+//
+// The global allocation functions are replaced so a benchmark can count every heap allocation made while it measures,
+// on any thread, not just the ones a module counts itself. Counting is off unless a benchmark turns it on, and then costs
+// one relaxed atomic add per allocation. The array, sized, and nothrow forms forward to these four in both MSVC's and
+// libstdc++'s runtimes.
+
+namespace
+{
+	std::atomic<bool> bCountAllocations{ false };
+	std::atomic<uint64_t> AllocationCount{ 0 };
+
+	void CountAllocation()
+	{
+		if (bCountAllocations.load(std::memory_order_relaxed))
+		{
+			AllocationCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+void* operator new(std::size_t Size)
+{
+	CountAllocation();
+
+	void* Memory = std::malloc((Size != 0) ? Size : 1);
+	if (!Memory)
+	{
+		throw std::bad_alloc();
+	}
+
+	return Memory;
+}
+
+void operator delete(void* Memory) noexcept
+{
+	std::free(Memory);
+}
+
+void* operator new(std::size_t Size, std::align_val_t Alignment)
+{
+	CountAllocation();
+
+	size_t Align = (size_t)Alignment;
+	size_t Rounded = (((Size != 0) ? Size : 1) + (Align - 1)) & ~(Align - 1);
+
+#if defined(_MSC_VER)
+	void* Memory = _aligned_malloc(Rounded, Align);
+#else
+	void* Memory = std::aligned_alloc(Align, Rounded);
+#endif
+	if (!Memory)
+	{
+		throw std::bad_alloc();
+	}
+
+	return Memory;
+}
+
+void operator delete(void* Memory, std::align_val_t) noexcept
+{
+#if defined(_MSC_VER)
+	_aligned_free(Memory);
+#else
+	std::free(Memory);
+#endif
+}
+
+namespace PBenchmark
+{
+	namespace
+	{
+		// How many times each case is repeated. The fastest run is reported to keep scheduler noise out of the numbers.
+		constexpr int BenchmarkRuns = 16;
+
+		// Print a benchmark result to the output log.
+		void Report(const std::string& OutString, int Status = 4)
+		{
+			PGameplayStatics::PrintToConsole(OutString, Status, "Benchmark");
+		}
+
+		// Run Func Runs times and return the fastest run in miliseconds.
+		template<typename Func>
+		double TimeBest(Func&& Function, int Runs = BenchmarkRuns)
+		{
+			Timer Clock;
+			double Best = 0.0;
+
+			for (int Run = 0; Run < Runs; ++Run)
+			{
+				Clock.Restart();
+				Function();
+				Clock.Stop();
+
+				double Elapsed = Clock.GetElapsedMiliseconds();
+				if ((Run == 0) || (Elapsed < Best))
+				{
+					Best = Elapsed;
+				}
+			}
+
+			return Best;
+		}
+
+		// Build a frustum looking down +Z from the origin, roughly what the editor camera sees.
+		PFrustum CreateBenchmarkFrustum()
+		{
+			view_t View;
+			View.ProjectionMatrix = PStoreMatrix(PMatrixPerspectiveFovLH(PDegrees_Radians(75.0f), (1920.0f / 1080.0f), 1.0f, 1000.0f));
+			View.ViewMatrix = PStoreMatrix(PMatrixIdentity());
+
+			return PCalculateFrustum(View, 1920, 1080);
+		}
+
+		// Scatter Count boxes through a 2000 unit cube around the camera. The seed is fixed so every run culls the same scene.
+		std::vector<PAABB> CreateBenchmarkBoxes(size_t Count)
+		{
+			std::mt19937 Generator(1337);
+			std::uniform_real_distribution<float> Position(-1000.0f, 1000.0f);
+			std::uniform_real_distribution<float> Size(0.5f, 8.0f);
+
+			std::vector<PAABB> Boxes(Count);
+			for (PAABB& Box : Boxes)
+			{
+				Box.Center = { Position(Generator), Position(Generator), Position(Generator) };
+				Box.Extents = { Size(Generator), Size(Generator), Size(Generator) };
+			}
+
+			return Boxes;
+		}
+
+		// Time Kernel(Level) on every instruction set the machine supports and report the throughput of each as one line.
+		template<typename Func>
+		void ReportTransformKernel(const char* Name, size_t Count, Func&& Kernel)
+		{
+			const PSimdLevel Levels[] = { PSimdLevel::SCALAR, PSimdLevel::SSE2, PSimdLevel::AVX2 };
+
+			char Line[256];
+			snprintf(Line, sizeof(Line), "%s, %zu elements", Name, Count);
+			std::string Result = Line;
+
+			double ScalarMs = 0.0;
+			for (PSimdLevel Level : Levels)
+			{
+				if (Level > PGetTransformSimdLevel())
+				{
+					continue;
+				}
+
+				double Ms = TimeBest([&]() { Kernel(Level); });
+				if (Level == PSimdLevel::SCALAR)
+				{
+					ScalarMs = Ms;
+				}
+
+				snprintf(Line, sizeof(Line), " | %s: %.3f ms, %.3f el/ns (%.2fx)", PGetSimdLevelName(Level), Ms, (Ms > 0.0) ? (Count / (Ms * 1000000.0)) : 0.0, (Ms > 0.0) ? (ScalarMs / Ms) : 0.0);
+				Result += Line;
+			}
+
+			Report(Result);
+		}
+
+		// Build a clip of a chain of JointCount joints, each swinging about its own axis a bone's length from its parent,
+		// sampled at 24 frames per second.
+		PAnim::AnimClip CreateBenchmarkClip(uint32_t JointCount, size_t FrameCount)
+		{
+			PAnim::AnimClip Clip;
+			Clip.Duration = (FrameCount / 24.0);
+			Clip.Frames.resize(FrameCount);
+
+			for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+			{
+				Clip.Frames[Frame].Time = (Frame / 24.0);
+				Clip.Frames[Frame].Joints.resize(JointCount);
+
+				// The exporter writes model space matrices, so compose them down the chain.
+				PMatrix Parent = PMatrixIdentity();
+
+				for (uint32_t i = 0; i < JointCount; ++i)
+				{
+					PVector Axis = PVector3Normalize(PVectorSet(sinf(i * 1.7f), cosf(i * 0.9f), sinf(i * 2.3f) + 0.5f, 0.0f));
+					float Angle = sinf((Frame * 0.05f) + i) * 0.75f;
+
+					PMatrix Local = PMatrixAffineTransformation(PVectorReplicate(1.0f), PQuaternionRotationAxis(Axis, Angle), PVectorSet(0.0f, 0.25f, 0.05f * sinf((Frame * 0.1f) + i), 0.0f));
+					Parent = PMatrixMultiply(Local, Parent);
+
+					float4x4_a Model = PStoreMatrix(Parent);
+					memcpy(Clip.Frames[Frame].Joints[i].Transform, &Model, sizeof(Model));
+					Clip.Frames[Frame].Joints[i].ParentIndex = ((int)i - 1);
+				}
+			}
+
+			return Clip;
+		}
+
+		// Write Clip and Bind to FilePath in the version 1 .anim layout, which has no header and stores model space
+		// matrices per keyframe (see PAnimFile).
+		bool WriteVersion1Anim(const std::string& FilePath, const PAnim::AnimClip& Clip, const PAnim::BindPose& Bind)
+		{
+			std::ofstream File(FilePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+
+			uint32_t BindJointCount = (uint32_t)Bind.Joints.size();
+			uint32_t FrameCount = (uint32_t)Clip.Frames.size();
+
+			File.write((const char*)&BindJointCount, sizeof(uint32_t));
+			File.write((const char*)Bind.Joints.data(), (sizeof(PAnim::Joint) * BindJointCount));
+			File.write((const char*)&Clip.Duration, sizeof(double));
+			File.write((const char*)&FrameCount, sizeof(uint32_t));
+
+			for (const PAnim::Keyframe& Frame : Clip.Frames)
+			{
+				uint32_t JointCount = (uint32_t)Frame.Joints.size();
+
+				File.write((const char*)&Frame.Time, sizeof(double));
+				File.write((const char*)&JointCount, sizeof(uint32_t));
+				File.write((const char*)Frame.Joints.data(), (sizeof(PAnim::Joint) * JointCount));
+			}
+
+			return (bool)File;
+		}
+
+		// Build an unindexed GridSize by GridSize grid, six corners to a cell, as an importer hands it over before welding.
+		// Every sixteenth column starts a hard edge with its own normals, joints change every 32 columns, and when bJitter
+		// every other corner is moved by less than the welding tolerance.
+		std::vector<Vertex> CreateWeldCorners(size_t GridSize, bool bJitter)
+		{
+			std::vector<Vertex> Corners;
+			Corners.reserve((GridSize - 1) * (GridSize - 1) * 6);
+
+			std::mt19937 Random(23);
+			std::uniform_real_distribution<float> Jitter(-0.001f, 0.001f);
+
+			for (size_t y = 0; (y + 1) < GridSize; ++y)
+			{
+				for (size_t x = 0; (x + 1) < GridSize; ++x)
+				{
+					const size_t CellCorners[6][2] = { { x, y }, { x + 1, y }, { x + 1, y + 1 }, { x, y }, { x + 1, y + 1 }, { x, y + 1 } };
+
+					for (const size_t (&Corner)[2] : CellCorners)
+					{
+						float cx = (float)Corner[0];
+						float cy = (float)Corner[1];
+
+						// Corners on a hard edge take the normal of the cell they belong to, not their neighbour's.
+						float Tilt = (((x / 16) % 2) == 0) ? 0.3f : -0.3f;
+
+						Vertex V;
+						V.Position = { (cx * 0.05f), (sinf(cx * 0.21f) * cosf(cy * 0.17f)), (cy * 0.05f) };
+						V.Normal = { Tilt, 0.95f, 0.0f };
+						V.Texture = { (cx / GridSize), (cy / GridSize) };
+						V.Weights = { 1.0f, 0.0f, 0.0f, 0.0f };
+						V.JointIndices[0] = (int)(x / 32);
+
+						if (bJitter && ((Corners.size() % 2) == 1))
+						{
+							V.Position.x += Jitter(Random);
+							V.Position.y += Jitter(Random);
+							V.Texture.x += (Jitter(Random) * 0.5f);
+						}
+
+						Corners.push_back(V);
+					}
+				}
+			}
+
+			return Corners;
+		}
+
+		// Write a GridSize by GridSize grid of vertices to FilePath as an .obj, with a texture coordinate and normal for
+		// each. Cells alternate by row between one quad and two triangles, and every eighth row counts its indices back
+		// from the end of the lists.
+		bool WriteBenchmarkObj(const std::string& FilePath, size_t GridSize)
+		{
+			std::ofstream File(FilePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+			char Line[256];
+
+			for (size_t y = 0; y < GridSize; ++y)
+			{
+				for (size_t x = 0; x < GridSize; ++x)
+				{
+					float Height = (sinf(x * 0.37f) * cosf(y * 0.23f));
+					File.write(Line, snprintf(Line, sizeof(Line), "v %.6f %.6f %.6f\n", (x * 0.1f), Height, (y * 0.1f)));
+				}
+			}
+
+			for (size_t y = 0; y < GridSize; ++y)
+			{
+				for (size_t x = 0; x < GridSize; ++x)
+				{
+					File.write(Line, snprintf(Line, sizeof(Line), "vt %.6f %.6f\n", ((float)x / GridSize), ((float)y / GridSize)));
+				}
+			}
+
+			for (size_t y = 0; y < GridSize; ++y)
+			{
+				for (size_t x = 0; x < GridSize; ++x)
+				{
+					File.write(Line, snprintf(Line, sizeof(Line), "vn %.6f %.6f %.6f\n", (sinf(x * 0.37f) * 0.1f), 0.99f, (cosf(y * 0.23f) * 0.1f)));
+				}
+			}
+
+			long long Count = (long long)(GridSize * GridSize);
+
+			for (size_t y = 0; (y + 1) < GridSize; ++y)
+			{
+				for (size_t x = 0; (x + 1) < GridSize; ++x)
+				{
+					long long Corner[4] = { (long long)((y * GridSize) + x + 1), (long long)((y * GridSize) + x + 2), (long long)(((y + 1) * GridSize) + x + 2), (long long)(((y + 1) * GridSize) + x + 1) };
+
+					if ((y % 8) == 7)
+					{
+						for (long long& Index : Corner)
+						{
+							Index -= (Count + 1);
+						}
+					}
+
+					if ((y % 2) == 0)
+					{
+						File.write(Line, snprintf(Line, sizeof(Line), "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n", Corner[0], Corner[0], Corner[0], Corner[1], Corner[1], Corner[1],
+							Corner[2], Corner[2], Corner[2], Corner[3], Corner[3], Corner[3]));
+					}
+					else
+					{
+						File.write(Line, snprintf(Line, sizeof(Line), "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n", Corner[0], Corner[0], Corner[0], Corner[1], Corner[1], Corner[1], Corner[2], Corner[2], Corner[2]));
+						File.write(Line, snprintf(Line, sizeof(Line), "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n", Corner[0], Corner[0], Corner[0], Corner[2], Corner[2], Corner[2], Corner[3], Corner[3], Corner[3]));
+					}
+				}
+			}
+
+			return (bool)File;
+		}
+	}
+
+	// Compare the per-object PAABBToFrustum() path against the batched scalar, SSE, and AVX2 culling kernels
+	// with 1k, 10k, and 100k boxes.
+	void RunCullingBenchmark()
+	{
+		const size_t BoxCounts[] = { 1000, 10000, 100000 };
+		const PCullBackend Backends[] = { PCullBackend::SCALAR, PCullBackend::SSE, PCullBackend::AVX2 };
+
+		PFrustum Frustum = CreateBenchmarkFrustum();
+
+		Report("Frustum culling benchmark. Widest kernel in this build: " + std::string(PGetCullBackendName(PGetCullBackend())) + ", CPU supports: " + std::string(PGetSimdLevelName(PGetCpuSimdLevel())) + ".");
+
+		for (size_t Count : BoxCounts)
+		{
+			std::vector<PAABB> Boxes = CreateBenchmarkBoxes(Count);
+
+			PBoundsTable Bounds;
+			Bounds.Reserve(Count);
+			for (const PAABB& Box : Boxes)
+			{
+				Bounds.Add(Box);
+			}
+
+			std::vector<uint32_t> Indices(Count);
+
+			// The path DrawView() used before batching: one PAABBToFrustum() call per object.
+			size_t ObjectVisible = 0;
+			double ObjectMs = TimeBest([&]()
+			{
+				ObjectVisible = 0;
+				for (const PAABB& Box : Boxes)
+				{
+					if (PAABBToFrustum(Box, Frustum))
+					{
+						Indices[ObjectVisible++] = (uint32_t)(&Box - Boxes.data());
+					}
+				}
+			});
+
+			char Line[256];
+			snprintf(Line, sizeof(Line), "%zu boxes, %zu visible | Per-Object: %.3f ms (%.2f ns/box)", Count, ObjectVisible, ObjectMs, (ObjectMs * 1000000.0) / Count);
+			std::string Result = Line;
+
+			for (PCullBackend Backend : Backends)
+			{
+				// Kernels this build was not compiled with fall back to a narrower one, so skip them instead of reporting a duplicate.
+				if (Backend > PGetCullBackend())
+				{
+					continue;
+				}
+
+				size_t BatchVisible = 0;
+				double BatchMs = TimeBest([&]()
+				{
+					BatchVisible = PCullAABBsToFrustumIndices(Bounds, Frustum, Indices.data(), Backend);
+				});
+
+				snprintf(Line, sizeof(Line), " | %s: %.3f ms (%.2fx)", PGetCullBackendName(Backend), BatchMs, (BatchMs > 0.0) ? (ObjectMs / BatchMs) : 0.0);
+				Result += Line;
+
+				if (BatchVisible != ObjectVisible)
+				{
+					Report(std::string(PGetCullBackendName(Backend)) + " kernel disagrees with PAABBToFrustum() (" + std::to_string(BatchVisible) + " visible, expected " + std::to_string(ObjectVisible) + ").", 2);
+				}
+			}
+
+			Report(Result);
+		}
+	}
+
+	// Compare PAABBTree frustum and box queries against a linear scan over every object with 10k, 50k, and 200k objects.
+	void RunSpatialTreeBenchmark()
+	{
+		const size_t ObjectCounts[] = { 10000, 50000, 200000 };
+		const int BoxQueries = 1000;
+
+		PFrustum Frustum = CreateBenchmarkFrustum();
+
+		Report("Spatial tree benchmark.");
+
+		for (size_t Count : ObjectCounts)
+		{
+			std::vector<PAABB> Boxes = CreateBenchmarkBoxes(Count);
+			std::vector<PAABB> QueryBoxes = CreateBenchmarkBoxes(BoxQueries);
+			for (PAABB& Box : QueryBoxes)
+			{
+				Box.Extents = { 25.0f, 25.0f, 25.0f };
+			}
+
+			PAABBTree Tree;
+			Timer Clock;
+			Clock.Restart();
+			for (size_t i = 0; i < Count; ++i)
+			{
+				Tree.CreateProxy(Boxes[i], nullptr);
+			}
+			Clock.Stop();
+			double BuildMs = Clock.GetElapsedMiliseconds();
+
+			// Frustum queries. The tree tests fat boxes, so it reports a few more candidates than the exact linear scan.
+			size_t LinearVisible = 0;
+			double LinearFrustumMs = TimeBest([&]()
+			{
+				LinearVisible = 0;
+				for (const PAABB& Box : Boxes)
+				{
+					LinearVisible += PAABBToFrustum(Box, Frustum) ? 1 : 0;
+				}
+			});
+
+			size_t TreeVisible = 0;
+			double TreeFrustumMs = TimeBest([&]()
+			{
+				TreeVisible = 0;
+				Tree.QueryFrustum(Frustum, [&](int) { ++TreeVisible; return true; });
+			});
+
+			// Box queries, as used by collision.
+			size_t LinearHits = 0;
+			double LinearBoxMs = TimeBest([&]()
+			{
+				LinearHits = 0;
+				for (const PAABB& Query : QueryBoxes)
+				{
+					for (const PAABB& Box : Boxes)
+					{
+						bool bOverlap = (fabsf(Box.Center.x - Query.Center.x) <= (Box.Extents.x + Query.Extents.x)) &&
+							(fabsf(Box.Center.y - Query.Center.y) <= (Box.Extents.y + Query.Extents.y)) &&
+							(fabsf(Box.Center.z - Query.Center.z) <= (Box.Extents.z + Query.Extents.z));
+
+						LinearHits += bOverlap ? 1 : 0;
+					}
+				}
+			});
+
+			size_t TreeHits = 0;
+			double TreeBoxMs = TimeBest([&]()
+			{
+				TreeHits = 0;
+				for (const PAABB& Query : QueryBoxes)
+				{
+					Tree.QueryBox(Query, [&](int) { ++TreeHits; return true; });
+				}
+			});
+
+			char Line[512];
+			snprintf(Line, sizeof(Line), "%zu objects (build %.2f ms, height %d) | Frustum: linear %.3f ms (%zu), tree %.3f ms (%zu), %.2fx | %d boxes: linear %.3f ms (%zu), tree %.3f ms (%zu), %.2fx",
+				Count, BuildMs, Tree.GetHeight(),
+				LinearFrustumMs, LinearVisible, TreeFrustumMs, TreeVisible, (TreeFrustumMs > 0.0) ? (LinearFrustumMs / TreeFrustumMs) : 0.0,
+				BoxQueries, LinearBoxMs, LinearHits, TreeBoxMs, TreeHits, (TreeBoxMs > 0.0) ? (LinearBoxMs / TreeBoxMs) : 0.0);
+
+			Report(Line);
+		}
+	}
+
+	// Measure the batched point, normal, and matrix transform kernels on each instruction set, in elements per nanosecond.
+	void RunTransformBenchmark()
+	{
+		const size_t PointCount = 100000;
+		const size_t MatrixCount = 10000;
+
+		Report("Transform benchmark. Widest kernel on this machine: " + std::string(PGetSimdLevelName(PGetTransformSimdLevel())) + ".");
+
+		std::mt19937 Generator(1337);
+		std::uniform_real_distribution<float> Value(-10.0f, 10.0f);
+
+		std::vector<float3> Points(PointCount);
+		std::vector<float3> PointsOut(PointCount);
+		std::vector<float4_a> PointsA(PointCount);
+		std::vector<float4_a> PointsAOut(PointCount);
+		for (size_t i = 0; i < PointCount; ++i)
+		{
+			Points[i] = { Value(Generator), Value(Generator), Value(Generator) };
+			PointsA[i].x = Points[i].x;
+			PointsA[i].y = Points[i].y;
+			PointsA[i].z = Points[i].z;
+			PointsA[i].w = 1.0f;
+		}
+
+		std::vector<float4x4_a> MatricesA(MatrixCount);
+		std::vector<float4x4_a> MatricesB(MatrixCount);
+		std::vector<float4x4_a> MatricesOut(MatrixCount);
+		for (size_t i = 0; i < MatrixCount; ++i)
+		{
+			PQuaternion RotationA = PQuaternionNormalize(PVectorSet(Value(Generator), Value(Generator), Value(Generator), Value(Generator)));
+			PQuaternion RotationB = PQuaternionNormalize(PVectorSet(Value(Generator), Value(Generator), Value(Generator), Value(Generator)));
+
+			MatricesA[i] = PStoreMatrix(PMatrixAffineTransformation(PVectorReplicate(1.0f), RotationA, PVectorSet(Value(Generator), Value(Generator), Value(Generator), 0.0f)));
+			MatricesB[i] = PStoreMatrix(PMatrixAffineTransformation(PVectorReplicate(1.0f), RotationB, PVectorSet(Value(Generator), Value(Generator), Value(Generator), 0.0f)));
+		}
+
+		// A typical object matrix with rotation and non uniform scale.
+		float4x4_a World = PStoreMatrix(PMatrixAffineTransformation(PVectorSet(1.0f, 2.0f, 0.5f, 0.0f), PQuaternionRotationAxis(PVectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.7f), PVectorSet(5.0f, 0.0f, -3.0f, 0.0f)));
+
+		ReportTransformKernel("Points (float3)", PointCount, [&](PSimdLevel Level) { PTransformPoints(Points.data(), PointsOut.data(), PointCount, World, Level); });
+		ReportTransformKernel("Points (float4_a)", PointCount, [&](PSimdLevel Level) { PTransformPointsA(PointsA.data(), PointsAOut.data(), PointCount, World, Level); });
+		ReportTransformKernel("Normals (float3)", PointCount, [&](PSimdLevel Level) { PTransformNormals(Points.data(), PointsOut.data(), PointCount, World, Level); });
+		ReportTransformKernel("Normals (float4_a)", PointCount, [&](PSimdLevel Level) { PTransformNormalsA(PointsA.data(), PointsAOut.data(), PointCount, World, Level); });
+		ReportTransformKernel("Matrix x one matrix", MatrixCount, [&](PSimdLevel Level) { PMultiplyMatricesA(MatricesA.data(), MatricesOut.data(), MatrixCount, World, Level); });
+		ReportTransformKernel("Matrix x matrix (pairwise)", MatrixCount, [&](PSimdLevel Level) { PMultiplyMatricesPairwiseA(MatricesA.data(), MatricesB.data(), MatricesOut.data(), MatrixCount, Level); });
+	}
+
+	// Compare closest-hit ray queries cast one at a time against packets of 8.
+	void RunRaycastBenchmark()
+	{
+		const size_t ObjectCount = 50000;
+		const size_t RayCount = 4096;
+		const float RayLength = 1500.0f;
+
+		std::vector<PAABB> Boxes = CreateBenchmarkBoxes(ObjectCount);
+
+		PAABBTree Tree;
+		for (size_t i = 0; i < ObjectCount; ++i)
+		{
+			Tree.CreateProxy(Boxes[i], reinterpret_cast<void*>(i));
+		}
+
+		std::mt19937 Generator(1337);
+		std::uniform_real_distribution<float> Position(-1000.0f, 1000.0f);
+		std::uniform_real_distribution<float> Angle(-1.0f, 1.0f);
+
+		// A fan of rays from one point (picking, a crowd looking around) and rays with unrelated origins (scattered AI).
+		std::vector<float3> FanOrigins(RayCount, float3{ 0.0f, 0.0f, 0.0f });
+		std::vector<float3> ScatterOrigins(RayCount);
+		std::vector<float3> Directions(RayCount);
+		for (size_t i = 0; i < RayCount; ++i)
+		{
+			ScatterOrigins[i] = { Position(Generator), Position(Generator), Position(Generator) };
+
+			float3 Direction = { Angle(Generator) * 0.5f, Angle(Generator) * 0.5f, 1.0f };
+			Directions[i] = Direction * (1.0f / sqrtf(dot(Direction, Direction)));
+		}
+
+		// The entry distance of a ray into box Id, or -1 if it misses.
+		auto HitDistance = [&](const float3& Origin, const float3& Direction, float MaxDistance, size_t Id)
+		{
+			float3 Min = Boxes[Id].Center - Boxes[Id].Extents;
+			float3 Max = Boxes[Id].Center + Boxes[Id].Extents;
+
+			float Near = 0.0f;
+			float Far = MaxDistance;
+			for (int Axis = 0; Axis < 3; ++Axis)
+			{
+				float T1 = ((Min[Axis] - Origin[Axis]) / Direction[Axis]);
+				float T2 = ((Max[Axis] - Origin[Axis]) / Direction[Axis]);
+
+				Near = fmaxf(Near, fminf(T1, T2));
+				Far = fminf(Far, fmaxf(T1, T2));
+			}
+
+			return (Near <= Far) ? Near : -1.0f;
+		};
+
+		Report("Raycast benchmark (" + std::to_string(ObjectCount) + " objects, " + std::to_string(RayCount) + " closest-hit rays).");
+
+		const std::pair<const char*, const std::vector<float3>*> Cases[] = { { "Fan", &FanOrigins }, { "Scattered", &ScatterOrigins } };
+
+		for (const auto& Case : Cases)
+		{
+			const std::vector<float3>& Origins = *Case.second;
+
+			size_t SingleHits = 0;
+			double SingleMs = TimeBest([&]()
+			{
+				SingleHits = 0;
+				for (size_t i = 0; i < RayCount; ++i)
+				{
+					bool bHit = false;
+					Tree.QueryRay(Origins[i], Directions[i], RayLength, [&](int ProxyId, float MaxDistance)
+					{
+						float Distance = HitDistance(Origins[i], Directions[i], MaxDistance, reinterpret_cast<size_t>(Tree.GetUserData(ProxyId)));
+						bHit |= (Distance >= 0.0f);
+						return (Distance >= 0.0f) ? Distance : MaxDistance;
+					});
+					SingleHits += bHit ? 1 : 0;
+				}
+			});
+
+			size_t PacketHits = 0;
+			double PacketMs = TimeBest([&]()
+			{
+				PacketHits = 0;
+				for (size_t Base = 0; Base < RayCount; Base += PRayPacket::Width)
+				{
+					PRayPacket Packet;
+					for (size_t i = Base; i < (Base + PRayPacket::Width); ++i)
+					{
+						Packet.Add(Origins[i], Directions[i], RayLength);
+					}
+
+					uint32_t HitLanes = 0;
+					Tree.QueryRayPacket(Packet, [&](int ProxyId, uint32_t HitMask)
+					{
+						const PAABB& Box = Boxes[reinterpret_cast<size_t>(Tree.GetUserData(ProxyId))];
+
+						float Near[PRayPacket::Width];
+						HitMask &= PIntersectRayPacketAABB(Packet, (Box.Center - Box.Extents), (Box.Center + Box.Extents), Near);
+
+						for (uint32_t Lane = 0; Lane < PRayPacket::Width; ++Lane)
+						{
+							if (HitMask & (1u << Lane))
+							{
+								Packet.MaxDistance[Lane] = Near[Lane];
+							}
+						}
+
+						HitLanes |= HitMask;
+					});
+
+					for (uint32_t Lane = 0; Lane < PRayPacket::Width; ++Lane)
+					{
+						PacketHits += (HitLanes & (1u << Lane)) ? 1 : 0;
+					}
+				}
+			});
+
+			char Line[256];
+			snprintf(Line, sizeof(Line), "%s: single %.3f ms (%zu hits), packets of 8 (%s) %.3f ms (%zu hits), %.2fx",
+				Case.first, SingleMs, SingleHits, PGetSimdLevelName(PGetRaycastSimdLevel()), PacketMs, PacketHits, (PacketMs > 0.0) ? (SingleMs / PacketMs) : 0.0);
+
+			Report(Line);
+		}
+	}
+
+	void RunMeshBVHBenchmark()
+	{
+		// A bumpy sphere, 224 x 224 quads split into triangles, about the size of a detailed character or prop.
+		const int Segments = 224;
+		const size_t RayCount = 20000;
+		const size_t BruteForceRays = 200;
+
+		std::vector<Vertex> Vertices;
+		std::vector<int> Indices;
+		Vertices.reserve((Segments + 1) * (Segments + 1));
+		Indices.reserve(Segments * Segments * 6);
+
+		for (int Ring = 0; Ring <= Segments; ++Ring)
+		{
+			float Theta = (PI * Ring / Segments);
+
+			for (int Slice = 0; Slice <= Segments; ++Slice)
+			{
+				float Phi = (2.0f * PI * Slice / Segments);
+				float Radius = (1.0f + (0.05f * sinf(Theta * 17.0f) * cosf(Phi * 13.0f)));
+
+				Vertex Vert;
+				Vert.Position = { Radius * sinf(Theta) * cosf(Phi), Radius * cosf(Theta), Radius * sinf(Theta) * sinf(Phi) };
+				Vertices.push_back(Vert);
+			}
+		}
+
+		for (int Ring = 0; Ring < Segments; ++Ring)
+		{
+			for (int Slice = 0; Slice < Segments; ++Slice)
+			{
+				int Corner = ((Ring * (Segments + 1)) + Slice);
+				Indices.insert(Indices.end(), { Corner, (Corner + Segments + 1), (Corner + 1), (Corner + 1), (Corner + Segments + 1), (Corner + Segments + 2) });
+			}
+		}
+
+		size_t TriangleCount = (Indices.size() / 3);
+
+		std::unique_ptr<PMeshBVH> BVH;
+		double BuildMs = TimeBest([&]()
+		{
+			BVH = std::make_unique<PMeshBVH>(Vertices.data(), Vertices.size(), Indices.data(), Indices.size());
+		});
+
+		char Line[256];
+		snprintf(Line, sizeof(Line), "Mesh BVH benchmark (%zu triangles). Build %.2f ms, %zu nodes, depth %d, %.1f bytes per triangle.",
+			TriangleCount, BuildMs, BVH->GetNodeCount(), BVH->GetDepth(), ((double)BVH->GetMemoryBytes() / TriangleCount));
+		Report(Line);
+
+		// Rays from a shell around the mesh aimed through random points near its middle, like picking from any angle.
+		std::mt19937 Generator(1337);
+		std::uniform_real_distribution<float> Value(-1.0f, 1.0f);
+
+		std::vector<float3> Origins(RayCount);
+		std::vector<float3> Directions(RayCount);
+		for (size_t i = 0; i < RayCount; ++i)
+		{
+			float3 Outside = { Value(Generator), Value(Generator), Value(Generator) };
+			Outside = Outside * (3.0f / sqrtf(fmaxf(dot(Outside, Outside), 0.0001f)));
+
+			float3 Target = { Value(Generator) * 0.8f, Value(Generator) * 0.8f, Value(Generator) * 0.8f };
+
+			Origins[i] = Outside;
+			Directions[i] = (Target - Outside);
+		}
+
+		// Test every triangle for the first few rays, both to check the hierarchy and to show what it saves.
+		std::vector<float> Expected(BruteForceRays, FLT_MAX);
+		double BruteMs = TimeBest([&]()
+		{
+			for (size_t i = 0; i < BruteForceRays; ++i)
+			{
+				Expected[i] = FLT_MAX;
+
+				for (size_t Triangle = 0; Triangle < TriangleCount; ++Triangle)
+				{
+					float3 V0 = Vertices[Indices[Triangle * 3]].Position;
+					float3 Edge1 = (Vertices[Indices[(Triangle * 3) + 1]].Position - V0);
+					float3 Edge2 = (Vertices[Indices[(Triangle * 3) + 2]].Position - V0);
+
+					float3 P = cross(Directions[i], Edge2);
+					float InvDeterminant = (1.0f / dot(Edge1, P));
+					float3 T = (Origins[i] - V0);
+					float U = (dot(T, P) * InvDeterminant);
+					float3 Q = cross(T, Edge1);
+					float V = (dot(Directions[i], Q) * InvDeterminant);
+					float Distance = (dot(Edge2, Q) * InvDeterminant);
+
+					if ((U >= 0.0f) && (V >= 0.0f) && ((U + V) <= 1.0f) && (Distance >= 0.0f) && (Distance < Expected[i]))
+					{
+						Expected[i] = Distance;
+					}
+				}
+			}
+		});
+
+		snprintf(Line, sizeof(Line), "Every triangle: %.0f rays/s", (BruteMs > 0.0) ? (BruteForceRays / (BruteMs / 1000.0)) : 0.0);
+		Report(Line);
+
+		const PSimdLevel Levels[] = { PSimdLevel::SCALAR, PSimdLevel::SSE2, PSimdLevel::AVX2 };
+		for (PSimdLevel Level : Levels)
+		{
+			if (Level > PGetRaycastSimdLevel())
+			{
+				continue;
+			}
+
+			size_t Hits = 0;
+			double Ms = TimeBest([&]()
+			{
+				Hits = 0;
+				for (size_t i = 0; i < RayCount; ++i)
+				{
+					PMeshBVH::Hit Hit;
+					Hits += BVH->Raycast(Origins[i], Directions[i], FLT_MAX, Hit, false, Level) ? 1 : 0;
+				}
+			});
+
+			size_t Mismatches = 0;
+			for (size_t i = 0; i < BruteForceRays; ++i)
+			{
+				PMeshBVH::Hit Hit;
+				bool bHit = BVH->Raycast(Origins[i], Directions[i], FLT_MAX, Hit, false, Level);
+
+				if (bHit != (Expected[i] != FLT_MAX) || (bHit && (fabsf(Hit.Distance - Expected[i]) > 0.0001f)))
+				{
+					++Mismatches;
+				}
+			}
+
+			snprintf(Line, sizeof(Line), "%s: %.3f ms, %.0f rays/s (%zu hits), %zu of %zu rays differ from testing every triangle",
+				PGetSimdLevelName(Level), Ms, (Ms > 0.0) ? (RayCount / (Ms / 1000.0)) : 0.0, Hits, Mismatches, BruteForceRays);
+			Report(Line, (Mismatches == 0) ? 4 : 2);
+		}
+	}
+
+	void RunAnimationBenchmark()
+	{
+		// A 30 second clip at 24 frames per second on a 64 joint skeleton, sampled at scattered times like a crowd of
+		// characters all at different points in the same clip.
+		const uint32_t JointCount = 64;
+		const size_t FrameCount = 720;
+		const size_t SampleCount = 4096;
+
+		std::mt19937 Generator(1337);
+		std::uniform_real_distribution<float> Value(-1.0f, 1.0f);
+
+		PAnim::AnimClip Clip = CreateBenchmarkClip(JointCount, FrameCount);
+
+		PAnim::PackedClip Packed = PAnim::PackedClip::FromClip(Clip);
+
+		// Every keyframe owns a separately allocated joint list on top of the frame array itself.
+		size_t KeyframeBytes = sizeof(PAnim::AnimClip) + (Clip.Frames.capacity() * sizeof(PAnim::Keyframe));
+		for (const PAnim::Keyframe& Frame : Clip.Frames)
+		{
+			KeyframeBytes += (Frame.Joints.capacity() * sizeof(PAnim::Joint));
+		}
+
+		char Line[256];
+		snprintf(Line, sizeof(Line), "Animation benchmark (%u joints, %zu frames, %zu samples). Keyframes: %.1f KB in %zu allocations, packed TRS: %.1f KB.",
+			JointCount, FrameCount, SampleCount, (KeyframeBytes / 1024.0), (FrameCount + 1), (Packed.GetMemoryBytes() / 1024.0));
+		Report(Line);
+
+		// The packed pose is solved from local keys, so check it lands back on the exported matrices at every keyframe.
+		std::vector<float4x4_a> PackedPose(JointCount);
+		float MaxError = 0.0f;
+
+		for (const PAnim::Keyframe& Frame : Clip.Frames)
+		{
+			Packed.Sample((float)Frame.Time, PackedPose);
+
+			for (uint32_t i = 0; i < JointCount; ++i)
+			{
+				const float* Solved = &PackedPose[i][0].x;
+				for (int x = 0; x < 16; ++x)
+				{
+					MaxError = std::max(MaxError, fabsf(Solved[x] - Frame.Joints[i].Transform[x]));
+				}
+			}
+		}
+
+		snprintf(Line, sizeof(Line), "Packed TRS max error at keyframes: %g", MaxError);
+		Report(Line);
+
+		std::vector<float> Times(SampleCount);
+		for (float& Time : Times)
+		{
+			Time = ((Value(Generator) * 0.5f) + 0.5f) * (float)Clip.Frames.back().Time;
+		}
+
+		// The keyframe layout the way PAnim used to blend it, one std::lerp per float, but into a reused pose so only the
+		// layout is measured.
+		std::vector<PAnim::Joint> KeyframePose(JointCount);
+		double KeyframeMs = TimeBest([&]()
+		{
+			for (float Time : Times)
+			{
+				size_t Frame = std::min((size_t)(Time * 24.0f), (FrameCount - 2));
+				float Alpha = (Time * 24.0f) - (float)Frame;
+
+				const PAnim::Keyframe& From = Clip.Frames[Frame];
+				const PAnim::Keyframe& To = Clip.Frames[Frame + 1];
+
+				for (uint32_t i = 0; i < JointCount; ++i)
+				{
+					KeyframePose[i].ParentIndex = From.Joints[i].ParentIndex;
+
+					for (int x = 0; x < 16; ++x)
+					{
+						KeyframePose[i].Transform[x] = std::lerp(From.Joints[i].Transform[x], To.Joints[i].Transform[x], Alpha);
+					}
+				}
+			}
+		});
+
+		snprintf(Line, sizeof(Line), "Keyframes: %.3f ms, %.0f samples/s", KeyframeMs, (KeyframeMs > 0.0) ? (SampleCount / (KeyframeMs / 1000.0)) : 0.0);
+		Report(Line);
+
+		const PSimdLevel Levels[] = { PSimdLevel::SCALAR, PSimdLevel::SSE2, PSimdLevel::AVX2 };
+
+		for (PSimdLevel Level : Levels)
+		{
+			if (Level > PGetTransformSimdLevel())
+			{
+				continue;
+			}
+
+			double Ms = TimeBest([&]()
+			{
+				for (float Time : Times)
+				{
+					Packed.Sample(Time, PackedPose, ANIMBLEND_NLERP, Level);
+				}
+			});
+
+			snprintf(Line, sizeof(Line), "Packed TRS + FK, nlerp (%s): %.3f ms, %.0f samples/s, %.2fx", PGetSimdLevelName(Level), Ms,
+				(Ms > 0.0) ? (SampleCount / (Ms / 1000.0)) : 0.0, (Ms > 0.0) ? (KeyframeMs / Ms) : 0.0);
+			Report(Line);
+		}
+
+		double SlerpMs = TimeBest([&]()
+		{
+			for (float Time : Times)
+			{
+				Packed.Sample(Time, PackedPose, ANIMBLEND_SLERP, PGetTransformSimdLevel());
+			}
+		});
+
+		snprintf(Line, sizeof(Line), "Packed TRS + FK, slerp (%s): %.3f ms, %.0f samples/s, %.2fx", PGetSimdLevelName(PGetTransformSimdLevel()), SlerpMs,
+			(SlerpMs > 0.0) ? (SampleCount / (SlerpMs / 1000.0)) : 0.0, (SlerpMs > 0.0) ? (KeyframeMs / SlerpMs) : 0.0);
+		Report(Line);
+
+		// The same clip compressed to a centimetre, if the bones are metres long, measured 10 cm from each joint.
+		PAnim::CompressionSettings Settings;
+		Settings.MaxError = 0.01f;
+		Settings.TipDistance = 0.1f;
+
+		PAnim::PackedClip Compressed = Packed;
+		PAnimCompression::Report Compression;
+
+		Timer Clock;
+		Clock.Restart();
+		PAnimCompression::Compress(Compressed, Settings, &Compression);
+		Clock.Stop();
+		double CompressMs = Clock.GetElapsedMiliseconds();
+
+		snprintf(Line, sizeof(Line), "Compressed in %.1f ms: %s", CompressMs, PAnimCompression::FormatReport(Compression).c_str());
+		Report(Line);
+
+		double CompressedMs = TimeBest([&]()
+		{
+			for (float Time : Times)
+			{
+				Compressed.Sample(Time, PackedPose, ANIMBLEND_NLERP, PGetTransformSimdLevel());
+			}
+		});
+
+		snprintf(Line, sizeof(Line), "Compressed + FK, nlerp (%s): %.3f ms, %.0f samples/s, %.2fx", PGetSimdLevelName(PGetTransformSimdLevel()), CompressedMs,
+			(CompressedMs > 0.0) ? (SampleCount / (CompressedMs / 1000.0)) : 0.0, (CompressedMs > 0.0) ? (KeyframeMs / CompressedMs) : 0.0);
+		Report(Line);
+	}
+
+	// Advance and sample a crowd of animators sharing one clip through PAnim::UpdateAll(), split into 1, 2, 4, and so on
+	// batches up to one per thread in the job pool, so the scaling over threads is visible.
+	void RunAnimationPhaseBenchmark()
+	{
+		const uint32_t JointCount = 64;
+		const size_t FrameCount = 720;
+		const size_t AnimatorCount = 512;
+
+		std::shared_ptr<PAnim::ClipAsset> Asset = std::make_shared<PAnim::ClipAsset>();
+		Asset->FilePath = "Benchmark";
+		Asset->Clip = PAnim::PackedClip::FromClip(CreateBenchmarkClip(JointCount, FrameCount));
+
+		// Stagger the animators through the clip so they don't all sample the same frame.
+		std::vector<std::unique_ptr<PAnim>> Animators(AnimatorCount);
+		std::vector<PAnim*> Phase(AnimatorCount);
+		double Duration = Asset->Clip.Duration;
+
+		for (size_t i = 0; i < AnimatorCount; ++i)
+		{
+			Animators[i] = std::make_unique<PAnim>();
+			Animators[i]->Anim.Set(Asset, ((Duration * i) / AnimatorCount), false);
+			Phase[i] = Animators[i].get();
+		}
+
+		size_t ThreadCount = ((size_t)PJobs::GetWorkerCount() + 1);
+
+		char Line[256];
+		snprintf(Line, sizeof(Line), "Animation phase benchmark (%zu animators, %u joints, %zu frames, up to %zu threads).", AnimatorCount, JointCount, FrameCount, ThreadCount);
+		Report(Line);
+
+		double SingleMs = 0.0;
+
+		for (size_t Batches = 1; ; Batches = std::min((Batches * 2), ThreadCount))
+		{
+			double Ms = TimeBest([&]() { PAnim::UpdateAll(Phase, (1.0f / 60.0f), Batches); });
+			if (Batches == 1)
+			{
+				SingleMs = Ms;
+			}
+
+			snprintf(Line, sizeof(Line), "%zu batches: %.3f ms, %.0f poses/s, %.2fx", Batches, Ms, (Ms > 0.0) ? (AnimatorCount / (Ms / 1000.0)) : 0.0,
+				(Ms > 0.0) ? (SingleMs / Ms) : 0.0);
+			Report(Line);
+
+			if (Batches == ThreadCount)
+			{
+				break;
+			}
+		}
+
+		// The same crowd with a quarter of it at each level of detail. Poses are only due on some frames, so time a second
+		// of frames rather than the best single one.
+		const EAnimLODs LODs[] = { ANIMLOD_FULL, ANIMLOD_REDUCED, ANIMLOD_DISTANT, ANIMLOD_OFFSCREEN };
+		PAnim::LODSettings Settings;
+		PAnim::LODStats Stats;
+		size_t FrameRate = 60;
+
+		auto RunFrames = [&]()
+		{
+			Timer Clock;
+			Clock.Restart();
+
+			for (size_t Frame = 0; Frame < FrameRate; ++Frame)
+			{
+				PAnim::UpdateAll(Phase, (1.0f / 60.0f), 0, &Stats);
+			}
+
+			Clock.Stop();
+			return (Clock.GetElapsedMiliseconds() / FrameRate);
+		};
+
+		double FullMs = RunFrames();
+
+		for (size_t i = 0; i < AnimatorCount; ++i)
+		{
+			Animators[i]->SetLOD(LODs[(i * 4) / AnimatorCount], Settings);
+		}
+
+		double LODMs = RunFrames();
+
+		snprintf(Line, sizeof(Line), "Level of detail, a quarter at each level: %.3f ms per frame against %.3f ms at full, %.2fx. Last frame evaluated %u/%u full, %u/%u reduced, %u/%u distant, %u/%u off-screen.",
+			LODMs, FullMs, (LODMs > 0.0) ? (FullMs / LODMs) : 0.0, Stats.Evaluated[ANIMLOD_FULL], Stats.Animators[ANIMLOD_FULL], Stats.Evaluated[ANIMLOD_REDUCED], Stats.Animators[ANIMLOD_REDUCED],
+			Stats.Evaluated[ANIMLOD_DISTANT], Stats.Animators[ANIMLOD_DISTANT], Stats.Evaluated[ANIMLOD_OFFSCREEN], Stats.Animators[ANIMLOD_OFFSCREEN]);
+		Report(Line);
+	}
+
+	// Skin a 50k vertex mesh with 4 influences per vertex on a 64 joint skeleton, with linear blend and dual quaternion
+	// skinning on each instruction set, and check every path against the scalar one.
+	void RunSkinningBenchmark()
+	{
+		const uint32_t JointCount = 64;
+		const size_t FrameCount = 48;
+		const size_t VertexCount = 50000;
+
+		// The first keyframe is the bind pose, and the mesh is posed part way through the clip.
+		PAnim::AnimClip Clip = CreateBenchmarkClip(JointCount, FrameCount);
+		PAnim::PackedClip Packed = PAnim::PackedClip::FromClip(Clip);
+
+		std::vector<float4x4_a> InverseBind(JointCount);
+		for (uint32_t i = 0; i < JointCount; ++i)
+		{
+			PMatrix Bind;
+			memcpy(&Bind, Clip.Frames[0].Joints[i].Transform, sizeof(Bind));
+			InverseBind[i] = PStoreMatrix(PMatrixInverse(Bind));
+		}
+
+		std::vector<float4x4_a> Pose(JointCount);
+		Packed.Sample((float)(Clip.Duration * 0.5), Pose);
+
+		// Vertices scattered along the chain, each weighted to its nearest joint and the 3 after it.
+		std::mt19937 Generator(1337);
+		std::uniform_real_distribution<float> Value(-1.0f, 1.0f);
+
+		std::vector<Vertex> Mesh(VertexCount);
+		for (Vertex& V : Mesh)
+		{
+			uint32_t Joint = (uint32_t)(((Value(Generator) * 0.5f) + 0.5f) * (JointCount - 4));
+			float3 Normal = { Value(Generator), Value(Generator), Value(Generator) };
+			float Weights[4] = { 1.0f, ((Value(Generator) * 0.5f) + 0.5f), ((Value(Generator) * 0.25f) + 0.25f), ((Value(Generator) * 0.1f) + 0.1f) };
+			float WeightSum = (Weights[0] + Weights[1] + Weights[2] + Weights[3]);
+
+			V.Position = { Value(Generator) * 0.1f, (Joint * 0.25f) + (Value(Generator) * 0.1f), Value(Generator) * 0.1f };
+			V.Normal = Normal * (1.0f / sqrtf(std::max(dot(Normal, Normal), FLT_MIN)));
+			V.Weights = { Weights[0] / WeightSum, Weights[1] / WeightSum, Weights[2] / WeightSum, Weights[3] / WeightSum };
+
+			for (int k = 0; k < 4; ++k)
+			{
+				V.JointIndices[k] = (int)(Joint + k);
+			}
+		}
+
+		std::vector<float4x4_a> Palette(JointCount);
+		std::vector<PSkinning::DualQuat> DualQuats(JointCount);
+
+		double PaletteMs = TimeBest([&]() { PSkinning::ComputePalette(InverseBind, Pose, Palette, false); });
+		double DualQuatMs = TimeBest([&]() { PSkinning::ComputeDualQuats(Palette, DualQuats); });
+
+		char Line[256];
+		snprintf(Line, sizeof(Line), "Skinning benchmark (%zu vertices, %u joints). Palette: %.4f ms, dual quaternions: %.4f ms.", VertexCount, JointCount, PaletteMs, DualQuatMs);
+		Report(Line);
+
+		std::vector<Vertex> Reference = Mesh;
+		std::vector<Vertex> Skinned = Mesh;
+		const PSimdLevel Levels[] = { PSimdLevel::SCALAR, PSimdLevel::SSE2, PSimdLevel::AVX2 };
+		const ESkinningModes Modes[] = { SKINNING_LINEAR, SKINNING_DUALQUAT };
+
+		for (ESkinningModes Mode : Modes)
+		{
+			auto Skin = [&](Vertex* Out, PSimdLevel Level)
+			{
+				if (Mode == SKINNING_DUALQUAT)
+				{
+					PSkinning::SkinVerticesDualQuat(Mesh.data(), Out, VertexCount, DualQuats, Level);
+				}
+				else
+				{
+					PSkinning::SkinVertices(Mesh.data(), Out, VertexCount, Palette, Level);
+				}
+			};
+
+			Skin(Reference.data(), PSimdLevel::SCALAR);
+			double ScalarMs = 0.0;
+
+			for (PSimdLevel Level : Levels)
+			{
+				if (Level > PGetTransformSimdLevel())
+				{
+					continue;
+				}
+
+				double Ms = TimeBest([&]() { Skin(Skinned.data(), Level); });
+				if (Level == PSimdLevel::SCALAR)
+				{
+					ScalarMs = Ms;
+				}
+
+				// The furthest any position or normal component strayed from the scalar path.
+				float MaxError = 0.0f;
+				for (size_t i = 0; i < VertexCount; ++i)
+				{
+					for (int x = 0; x < 3; ++x)
+					{
+						MaxError = std::max(MaxError, fabsf(Skinned[i].Position[x] - Reference[i].Position[x]));
+						MaxError = std::max(MaxError, fabsf(Skinned[i].Normal[x] - Reference[i].Normal[x]));
+					}
+				}
+
+				snprintf(Line, sizeof(Line), "%s (%s): %.3f ms, %.1f vertices/us, %.2fx, max difference from scalar %g", ((Mode == SKINNING_DUALQUAT) ? "Dual quaternion" : "Linear blend"),
+					PGetSimdLevelName(Level), Ms, (Ms > 0.0) ? (VertexCount / (Ms * 1000.0)) : 0.0, (Ms > 0.0) ? (ScalarMs / Ms) : 0.0, MaxError);
+				Report(Line);
+			}
+		}
+
+		// Bounds from the joint spheres against the box around the skinned vertices themselves.
+		std::vector<PSkinning::JointSphere> Spheres;
+		PSkinning::ComputeJointSpheres(Mesh.data(), VertexCount, Spheres);
+		PSkinning::SkinVertices(Mesh.data(), Reference.data(), VertexCount, Palette, PSimdLevel::SCALAR);
+
+		PAABB Exact = {};
+		double ExactMs = TimeBest([&]() { Exact = PComputeAABB(Reference.data(), VertexCount); });
+
+		for (PSimdLevel Level : Levels)
+		{
+			if (Level > PGetTransformSimdLevel())
+			{
+				continue;
+			}
+
+			PAABB Posed = {};
+			double Ms = TimeBest([&]() { PSkinning::ComputePoseBounds(Spheres, Palette, Posed, Level); });
+
+			bool bContains = true;
+			for (int x = 0; x < 3; ++x)
+			{
+				bContains &= ((fabsf(Exact.Center[x] - Posed.Center[x]) + Exact.Extents[x]) <= (Posed.Extents[x] + 1e-4f));
+			}
+
+			float Volume = (Posed.Extents.x * Posed.Extents.y * Posed.Extents.z) / std::max((Exact.Extents.x * Exact.Extents.y * Exact.Extents.z), FLT_MIN);
+
+			snprintf(Line, sizeof(Line), "Pose bounds (%s): %.4f ms against %.3f ms for the skinned vertices, %.2fx their box's volume, %s.", PGetSimdLevelName(Level), Ms, ExactMs,
+				Volume, (bContains ? "contains every vertex" : "MISSES vertices"));
+			Report(Line, bContains ? 1 : 2);
+		}
+	}
+
+	// Write a library of 64 clips (64 joints, 10 seconds at 24 fps) as version 1 .anim files to a folder under Assets and
+	// load it through PAnim::AcquireClip() with the default compression settings, as levels do. Then upgrade it with
+	// PAnimFile::ConvertDirectory(), load it again as version 3, and report the time per clip.
+	void RunAnimationLoadBenchmark()
+	{
+		const uint32_t JointCount = 64;
+		const size_t FrameCount = 240;
+		const size_t ClipCount = 64;
+		const int LoadRuns = 3;
+
+		// AcquireClip() loads from the Assets folder, so the library is written there and removed afterwards.
+		const std::string FolderName = "PolynAnimLoadBenchmark";
+		std::error_code Error;
+		std::filesystem::path Directory = (std::filesystem::path(PGameplayStatics::GetGameDirectory() + "Assets/") / FolderName);
+		std::filesystem::remove_all(Directory, Error);
+		std::filesystem::create_directories(Directory, Error);
+
+		PAnim::AnimClip Clip = CreateBenchmarkClip(JointCount, FrameCount);
+		PAnim::BindPose Bind(Clip.Frames[0].Joints);
+		PAnim::CompressionSettings Compression;
+
+		std::vector<std::string> Paths(ClipCount);
+		for (size_t i = 0; i < ClipCount; ++i)
+		{
+			Paths[i] = (FolderName + "/Clip" + std::to_string(i) + ".anim");
+
+			if (!WriteVersion1Anim((Directory / ("Clip" + std::to_string(i) + ".anim")).string(), Clip, Bind))
+			{
+				Report(("Animation load benchmark could not write to " + Directory.string() + "."), 2);
+				std::filesystem::remove_all(Directory, Error);
+				return;
+			}
+		}
+
+		size_t Version1Bytes = (ClipCount * std::filesystem::file_size((Directory / "Clip0.anim"), Error));
+
+		// Keep every clip of a run loaded until the run ends, as a level loading its library would. Each run lets go of the
+		// last one's first, or AcquireClip() would hand the same clips back.
+		std::vector<std::shared_ptr<const PAnim::ClipAsset>> Library(ClipCount);
+		auto LoadLibrary = [&]()
+		{
+			Library.assign(ClipCount, nullptr);
+
+			for (size_t i = 0; i < ClipCount; ++i)
+			{
+				Library[i] = PAnim::AcquireClip(Paths[i], Compression);
+			}
+		};
+
+		double Version1Ms = TimeBest(LoadLibrary, LoadRuns);
+		std::shared_ptr<const PAnim::ClipAsset> Version1Clip = Library[0];
+		Library.assign(ClipCount, nullptr);
+
+		Timer Clock;
+		Clock.Restart();
+		size_t Converted = PAnimFile::ConvertDirectory(Directory.string(), nullptr, Compression);
+		Clock.Stop();
+		double ConvertMs = Clock.GetElapsedMiliseconds();
+
+		size_t Version3Bytes = (ClipCount * std::filesystem::file_size((Directory / "Clip0.anim"), Error));
+
+		// The first clip is still held from version 1, and AcquireClip() would share it rather than read version 3, so keep
+		// its poses and let go of it before timing.
+		std::vector<float4x4_a> Version1Pose(JointCount);
+		std::vector<std::vector<float4x4_a>> Version1Poses;
+
+		if (Version1Clip)
+		{
+			for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+			{
+				Version1Clip->Clip.Sample((float)(Frame / 24.0), Version1Pose);
+				Version1Poses.push_back(Version1Pose);
+			}
+		}
+
+		bool bWasCompressed = (Version1Clip && Version1Clip->Clip.IsCompressed());
+		Version1Clip.reset();
+
+		double Version3Ms = TimeBest(LoadLibrary, LoadRuns);
+
+		// Sampling a clip the first time reads its data in, so also time a load that samples every clip once.
+		std::vector<float4x4_a> Pose(JointCount);
+		double SampledMs = TimeBest([&]()
+		{
+			LoadLibrary();
+
+			for (const auto& Asset : Library)
+			{
+				if (Asset)
+				{
+					Asset->Clip.Sample((float)(Asset->Clip.Duration * 0.5), Pose);
+				}
+			}
+		}, LoadRuns);
+
+		// Version 3 stores the clip compressed as version 1 files are compressed on every load, so both should play the
+		// same pose.
+		float MaxError = 0.0f;
+		bool bStoredCompressed = (Library[0] && Library[0]->Clip.IsCompressed());
+
+		if (Library[0] && (Version1Poses.size() == FrameCount))
+		{
+			for (size_t Frame = 0; Frame < FrameCount; ++Frame)
+			{
+				Library[0]->Clip.Sample((float)(Frame / 24.0), Pose);
+
+				for (uint32_t i = 0; i < JointCount; ++i)
+				{
+					for (int Row = 0; Row < 4; ++Row)
+					{
+						for (int x = 0; x < 4; ++x)
+						{
+							MaxError = std::max(MaxError, fabsf(Pose[i][Row][x] - Version1Poses[Frame][i][Row][x]));
+						}
+					}
+				}
+			}
+		}
+
+		Library.clear();
+		std::filesystem::remove_all(Directory, Error);
+
+		char Line[256];
+		snprintf(Line, sizeof(Line), "Animation load benchmark (%zu clips, %u joints, %zu frames), through AcquireClip() with default settings. Upgraded %zu files in %.1f ms, %.1f MB to %.1f MB.",
+			ClipCount, JointCount, FrameCount, Converted, ConvertMs, (Version1Bytes / (1024.0 * 1024.0)), (Version3Bytes / (1024.0 * 1024.0)));
+		Report(Line);
+
+		snprintf(Line, sizeof(Line), "Version 1 (compressed on load: %s): %.2f ms, %.1f us per clip. Version 3 (stored compressed: %s): %.2f ms, %.1f us per clip, %.1fx. Version 3 sampled once: %.2f ms. Max difference %g.",
+			(bWasCompressed ? "yes" : "no"), Version1Ms, ((Version1Ms * 1000.0) / ClipCount), (bStoredCompressed ? "yes" : "no"), Version3Ms, ((Version3Ms * 1000.0) / ClipCount),
+			(Version3Ms > 0.0) ? (Version1Ms / Version3Ms) : 0.0, SampledMs, MaxError);
+		Report(Line, (bStoredCompressed && (MaxError < 1e-4f)) ? 1 : 2);
+	}
+
+	// Evaluate 256 animators playing one clip, then the same animators blending three: a base, a second clip fading in
+	// and out under it, and a third over the upper half of the skeleton. Report the time per frame of each and how many
+	// allocations the blended frames made once warmed up.
+	void RunAnimationBlendBenchmark()
+	{
+		const uint32_t JointCount = 64;
+		const size_t FrameCount = 240;
+		const size_t AnimatorCount = 256;
+		const size_t FrameRate = 60;
+
+		std::shared_ptr<PAnim::ClipAsset> Assets[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			Assets[i] = std::make_shared<PAnim::ClipAsset>();
+			Assets[i]->FilePath = ("Benchmark" + std::to_string(i));
+			Assets[i]->Clip = PAnim::PackedClip::FromClip(CreateBenchmarkClip(JointCount, (FrameCount + (i * 24))));
+		}
+
+		std::vector<std::unique_ptr<PAnim>> Animators(AnimatorCount);
+		std::vector<PAnim*> Phase(AnimatorCount);
+
+		for (size_t i = 0; i < AnimatorCount; ++i)
+		{
+			Animators[i] = std::make_unique<PAnim>();
+			Animators[i]->Anim.Set(Assets[0], ((Assets[0]->Clip.Duration * i) / AnimatorCount), false);
+			Phase[i] = Animators[i].get();
+		}
+
+		auto RunFrames = [&]()
+		{
+			Timer Clock;
+			Clock.Restart();
+
+			for (size_t Frame = 0; Frame < FrameRate; ++Frame)
+			{
+				PAnim::UpdateAll(Phase, (1.0f / 60.0f));
+			}
+
+			Clock.Stop();
+			return (Clock.GetElapsedMiliseconds() / FrameRate);
+		};
+
+		double SingleMs = RunFrames();
+
+		// The benchmark skeleton is a chain, so the upper half is everything from the middle joint on.
+		std::vector<float> UpperBody;
+		PAnim::BuildJointMask(Assets[0]->Clip.Parents, (int)(JointCount / 2), UpperBody);
+
+		for (auto& Animator : Animators)
+		{
+			Animator->AddLayer(Assets[1], 0.5f);
+			Animator->AddLayer(Assets[2], 1.0f, 0.0f, UpperBody);
+		}
+
+		// Keep the middle layer fading back and forth, so weights change every frame as in a crossfade.
+		auto RunBlendedFrames = [&]()
+		{
+			for (auto& Animator : Animators)
+			{
+				Animator->FadeLayer(0, ((Animator->Layers[0].Weight > 0.5f) ? 0.0f : 1.0f), 0.5f);
+			}
+
+			return RunFrames();
+		};
+
+		RunBlendedFrames();
+
+		// Count the pose buffers PAnim grows itself, and every heap allocation on any thread, over the measured frames.
+		uint64_t AllocationsBefore = PAnim::GetPoseAllocationCount();
+		uint64_t HeapAllocationsBefore = AllocationCount.load();
+		bCountAllocations.store(true);
+
+		double BlendedMs = RunBlendedFrames();
+
+		bCountAllocations.store(false);
+		uint64_t HeapAllocations = (AllocationCount.load() - HeapAllocationsBefore);
+		uint64_t Allocations = (PAnim::GetPoseAllocationCount() - AllocationsBefore);
+
+		char Line[256];
+		snprintf(Line, sizeof(Line), "Animation blend benchmark (%zu animators, %u joints). One clip: %.3f ms per frame. Three clips, one masked: %.3f ms per frame, %.2fx the cost.",
+			AnimatorCount, JointCount, SingleMs, BlendedMs, (SingleMs > 0.0) ? (BlendedMs / SingleMs) : 0.0);
+		Report(Line);
+
+		snprintf(Line, sizeof(Line), "Over %zu warmed up blended frames: %llu pose allocations, %llu heap allocations (operator new, every thread).",
+			FrameRate, (unsigned long long)Allocations, (unsigned long long)HeapAllocations);
+		Report(Line, ((Allocations == 0) && (HeapAllocations == 0)) ? 1 : 2);
+	}
+
+	// Compare 512 animators on one clip evaluating their own poses and palettes against sharing them through PAnim
+	// instancing, and report the evaluations per frame and hit rate.
+	void RunAnimationInstancingBenchmark()
+	{
+		const uint32_t JointCount = 64;
+		const size_t FrameCount = 240;
+		const size_t AnimatorCount = 512;
+		const size_t FrameRate = 60;
+
+		auto Asset = std::make_shared<PAnim::ClipAsset>();
+		Asset->FilePath = "Benchmark";
+		Asset->Clip = PAnim::PackedClip::FromClip(CreateBenchmarkClip(JointCount, FrameCount));
+		Asset->InverseBind.assign(JointCount, PStoreMatrix(PMatrixIdentity()));
+
+		std::vector<std::unique_ptr<PAnim>> Animators(AnimatorCount);
+		std::vector<PAnim*> Phase(AnimatorCount);
+		std::vector<std::vector<float4x4_a>> Palettes(AnimatorCount, std::vector<float4x4_a>(JointCount));
+
+		// A crowd started at random times, as spawned over a few seconds.
+		std::mt19937 Random(7);
+		std::uniform_real_distribution<double> StartTime(0.0, Asset->Clip.Duration);
+
+		for (size_t i = 0; i < AnimatorCount; ++i)
+		{
+			Animators[i] = std::make_unique<PAnim>();
+			Animators[i]->Anim.Set(Asset, StartTime(Random), false);
+			Phase[i] = Animators[i].get();
+		}
+
+		// Each frame evaluates the poses and builds a palette per animator, as skinning would.
+		PAnim::InstancingStats Stats;
+		auto RunFrames = [&]()
+		{
+			uint64_t Evaluations = 0;
+			uint64_t Requests = 0;
+
+			Timer Clock;
+			Clock.Restart();
+
+			for (size_t Frame = 0; Frame < FrameRate; ++Frame)
+			{
+				PAnim::UpdateAll(Phase, (1.0f / 60.0f), 0, nullptr, &Stats);
+
+				PJobs::ParallelFor(AnimatorCount, 16, [&](size_t Begin, size_t End)
+				{
+					for (size_t i = Begin; i < End; ++i)
+					{
+						std::span<const float4x4_a> Pose = Animators[i]->GetPose();
+
+						if (const auto& Shared = Animators[i]->GetSharedPose())
+						{
+							Shared->GetPalette(true);
+						}
+						else
+						{
+							PSkinning::ComputePalette(Asset->InverseBind, Pose, Palettes[i], true);
+						}
+					}
+				});
+
+				Evaluations += Stats.Evaluations;
+				Requests += Stats.Requests;
+			}
+
+			Clock.Stop();
+
+			Stats.Evaluations = (uint32_t)(Evaluations / FrameRate);
+			Stats.Requests = (uint32_t)(Requests / FrameRate);
+			return (Clock.GetElapsedMiliseconds() / FrameRate);
+		};
+
+		RunFrames();
+		double OwnMs = RunFrames();
+
+		for (auto& Animator : Animators)
+		{
+			Animator->Instancing.bEnabled = true;
+		}
+
+		RunFrames();
+		double SharedMs = RunFrames();
+
+		char Line[256];
+		snprintf(Line, sizeof(Line), "Animation instancing benchmark (%zu animators, %u joints, %.0f Hz time step). Own poses: %.3f ms per frame. Shared: %.3f ms per frame, %.2fx faster.",
+			AnimatorCount, JointCount, (1.0f / PAnim::InstancingSettings().TimeStep), OwnMs, SharedMs, (SharedMs > 0.0) ? (OwnMs / SharedMs) : 0.0);
+		Report(Line);
+
+		snprintf(Line, sizeof(Line), "Shared poses: %u evaluated per frame for %u animators, a %.1f%% hit rate.", Stats.Evaluations, Stats.Requests, (Stats.GetHitRate() * 100.0f));
+		Report(Line, (Stats.Evaluations < Stats.Requests) ? 1 : 2);
+	}
+
+	// Load a 200k triangle .obj with objl::Loader and PObjParser, on one chunk and split across the job pool, and check
+	// that both give the same vertices and indices.
+	void RunObjLoadBenchmark()
+	{
+		const size_t GridSize = 317;
+		const int LoadRuns = 3;
+
+		std::error_code Error;
+		std::filesystem::path Directory = (std::filesystem::temp_directory_path(Error) / "PolynObjLoadBenchmark");
+		std::filesystem::create_directories(Directory, Error);
+		std::string FilePath = (Directory / "Grid.obj").string();
+
+		if (!WriteBenchmarkObj(FilePath, GridSize))
+		{
+			Report(("OBJ load benchmark could not write to " + Directory.string() + "."), 2);
+			return;
+		}
+
+		double FileMB = (std::filesystem::file_size(FilePath, Error) / (1024.0 * 1024.0));
+
+		objl::Loader Reference;
+		double ReferenceMs = TimeBest([&]() { Reference.LoadFile(FilePath); }, 1);
+
+		PObjParser::Result Single;
+		double SingleMs = TimeBest([&]() { PObjParser::Load(FilePath, Single, 1); }, LoadRuns);
+
+		PObjParser::Result Parallel;
+		double ParallelMs = TimeBest([&]() { PObjParser::Load(FilePath, Parallel); }, LoadRuns);
+
+		std::filesystem::remove_all(Directory, Error);
+
+		// Both parsers read numbers with correct rounding, so the vertices should match exactly.
+		bool bMatches = (Reference.LoadedIndices.size() == Parallel.Indices.size()) && (Reference.LoadedVertices.size() == Parallel.Vertices.size()) && (Single.Indices == Parallel.Indices);
+
+		for (size_t i = 0; bMatches && (i < Parallel.Indices.size()); ++i)
+		{
+			bMatches = ((int)Reference.LoadedIndices[i] == Parallel.Indices[i]);
+		}
+
+		for (size_t i = 0; bMatches && (i < Parallel.Vertices.size()); ++i)
+		{
+			const objl::Vertex& A = Reference.LoadedVertices[i];
+			const Vertex& B = Parallel.Vertices[i];
+
+			bMatches = (A.Position.X == B.Position.x) && (A.Position.Y == B.Position.y) && (A.Position.Z == B.Position.z) && (A.Normal.X == B.Normal.x) && (A.Normal.Y == B.Normal.y) &&
+				(A.Normal.Z == B.Normal.z) && (A.TextureCoordinate.X == B.Texture.x) && (A.TextureCoordinate.Y == B.Texture.y);
+		}
+
+		char Line[256];
+		snprintf(Line, sizeof(Line), "OBJ load benchmark (%zu triangles, %.1f MB). objl::Loader: %.1f ms. PObjParser on 1 chunk: %.1f ms, %.1fx. Across the job pool: %.1f ms, %.1fx, %.0f MB/s.",
+			(Parallel.Indices.size() / 3), FileMB, ReferenceMs, SingleMs, (SingleMs > 0.0) ? (ReferenceMs / SingleMs) : 0.0, ParallelMs, (ParallelMs > 0.0) ? (ReferenceMs / ParallelMs) : 0.0,
+			(ParallelMs > 0.0) ? ((FileMB * 1000.0) / ParallelMs) : 0.0);
+		Report(Line);
+
+		Report((bMatches ? "Both parsers give the same vertices and indices." : "The parsers DISAGREE on the vertices or indices."), (bMatches ? 1 : 2));
+	}
+
+	// Weld a million unindexed corners with PVertexWeld, and check it against the nested loop FBXExporter::Compactify used
+	// to run on as many corners as that loop can get through in reasonable time.
+	void RunVertexWeldBenchmark()
+	{
+		const size_t GridSize = 409;
+		const size_t LoopCorners = 60000;
+		const float Tolerance = 0.005f;
+
+		std::vector<Vertex> Corners = CreateWeldCorners(GridSize, true);
+
+		// The loop Compactify ran: each corner against every vertex kept so far, skin data not compared.
+		std::vector<int> LoopRemap(LoopCorners);
+		std::vector<int> LoopKept;
+
+		double LoopMs = TimeBest([&]()
+		{
+			LoopKept.clear();
+
+			for (size_t i = 0; i < LoopCorners; ++i)
+			{
+				const Vertex& A = Corners[i];
+				int Match = -1;
+
+				for (size_t j = 0; j < LoopKept.size(); ++j)
+				{
+					const Vertex& B = Corners[LoopKept[j]];
+
+					if ((fabsf(A.Position.x - B.Position.x) <= Tolerance) && (fabsf(A.Position.y - B.Position.y) <= Tolerance) && (fabsf(A.Position.z - B.Position.z) <= Tolerance) &&
+						(fabsf(A.Normal.x - B.Normal.x) <= Tolerance) && (fabsf(A.Normal.y - B.Normal.y) <= Tolerance) && (fabsf(A.Normal.z - B.Normal.z) <= Tolerance) &&
+						(fabsf(A.Texture.x - B.Texture.x) <= Tolerance) && (fabsf(A.Texture.y - B.Texture.y) <= Tolerance))
+					{
+						Match = (int)j;
+						break;
+					}
+				}
+
+				if (Match == -1)
+				{
+					Match = (int)LoopKept.size();
+					LoopKept.push_back((int)i);
+				}
+
+				LoopRemap[i] = Match;
+			}
+		}, 1);
+
+		PVertexWeld::Settings Weld;
+		Weld.Tolerance = Tolerance;
+		Weld.bCompareSkin = false;
+
+		std::vector<int> Remap;
+		std::vector<int> Kept;
+		double HashedMs = TimeBest([&]() { PVertexWeld::BuildRemap(Corners.data(), LoopCorners, Remap, Kept, Weld); });
+		bool bMatches = ((Remap == LoopRemap) && (Kept == LoopKept));
+
+		// The whole grid, as the FBX path welds it.
+		Weld.bCompareSkin = true;
+		double FullMs = TimeBest([&]() { PVertexWeld::BuildRemap(Corners.data(), Corners.size(), Remap, Kept, Weld); }, 3);
+		size_t FullKept = Kept.size();
+
+		// And as the OBJ path welds it: only equal vertices, which is all an .obj repeats.
+		std::vector<Vertex> ExactCorners = CreateWeldCorners(GridSize, false);
+		double ExactMs = TimeBest([&]() { PVertexWeld::BuildRemap(ExactCorners.data(), ExactCorners.size(), Remap, Kept, PVertexWeld::Settings()); }, 3);
+
+		char Line[320];
+		snprintf(Line, sizeof(Line), "Vertex weld benchmark. Compactify's loop on %zu corners: %.1f ms, %zu kept. PVertexWeld on the same: %.2f ms, %.0fx.",
+			LoopCorners, LoopMs, LoopKept.size(), HashedMs, (HashedMs > 0.0) ? (LoopMs / HashedMs) : 0.0);
+		Report(Line);
+
+		snprintf(Line, sizeof(Line), "%zu corners within %.3f, skin compared: %.1f ms to %zu vertices, %.1f M corners/s. Equal vertices only: %.1f ms to %zu vertices.",
+			Corners.size(), Tolerance, FullMs, FullKept, (FullMs > 0.0) ? (Corners.size() / (FullMs * 1000.0)) : 0.0, ExactMs, Kept.size());
+		Report(Line);
+
+		Report((bMatches ? "PVertexWeld welds the same vertices as the nested loop." : "PVertexWeld and the nested loop DISAGREE."), (bMatches ? 1 : 2));
+	}
+
+	// Load a level's worth of .obj meshes through PMeshCache cold (no entries), warm, and after every source's time has
+	// changed but not its contents, against parsing them every time, and check the cached meshes match the parsed ones.
+	void RunMeshCacheBenchmark()
+	{
+		const size_t MeshCount = 12;
+		const size_t GridSize = 160;
+		const int LoadRuns = 3;
+
+		std::error_code Error;
+		std::filesystem::path Directory = (std::filesystem::temp_directory_path(Error) / "PolynMeshCacheBenchmark");
+		std::filesystem::create_directories(Directory, Error);
+
+		std::vector<std::string> Sources;
+		for (size_t i = 0; i < MeshCount; ++i)
+		{
+			Sources.push_back((Directory / ("Mesh" + std::to_string(i) + ".obj")).string());
+
+			if (!WriteBenchmarkObj(Sources.back(), (GridSize + i)))
+			{
+				Report(("Mesh cache benchmark could not write to " + Directory.string() + "."), 2);
+				std::filesystem::remove_all(Directory, Error);
+				return;
+			}
+		}
+
+		// Cook the way PStaticMesh::LoadMesh does: parse, weld, then bound.
+		auto Cook = [](const std::string& SourcePath, PMeshCache::CookedMesh& OutMesh)
+		{
+			PObjParser::Result Obj;
+
+			if (!PObjParser::Load(SourcePath, Obj))
+			{
+				return false;
+			}
+
+			OutMesh.Vertices = std::move(Obj.Vertices);
+			OutMesh.Indices = std::move(Obj.Indices);
+			PVertexWeld::Weld(OutMesh.Vertices, OutMesh.Indices);
+			OutMesh.Bounds = PComputeAABB(OutMesh.Vertices.data(), OutMesh.Vertices.size());
+			OutMesh.Sphere = PComputeBoundingSphere(OutMesh.Vertices.data(), OutMesh.Vertices.size(), OutMesh.Bounds.Center);
+
+			return true;
+		};
+
+		auto RemoveEntries = [&]()
+		{
+			for (const std::string& Source : Sources)
+			{
+				std::filesystem::remove(PMeshCache::GetEntryPath(Source), Error);
+			}
+		};
+
+		std::vector<PMeshCache::CookedMesh> Parsed(MeshCount);
+		std::vector<PMeshCache::CookedMesh> Loaded(MeshCount);
+
+		double ParseMs = TimeBest([&]()
+		{
+			for (size_t i = 0; i < MeshCount; ++i)
+			{
+				Cook(Sources[i], Parsed[i]);
+			}
+		}, LoadRuns);
+
+		auto LoadAll = [&]()
+		{
+			for (size_t i = 0; i < MeshCount; ++i)
+			{
+				PMeshCache::Load(Sources[i], Loaded[i], Cook);
+			}
+		};
+
+		// Cold runs need the entries gone first, which TimeBest can't do between runs.
+		Timer Clock;
+		double ColdMs = 0.0;
+		PMeshCache::ResetStats();
+
+		for (int Run = 0; Run < LoadRuns; ++Run)
+		{
+			RemoveEntries();
+
+			Clock.Restart();
+			LoadAll();
+			double Ms = Clock.GetElapsedMiliseconds();
+
+			ColdMs = ((Run == 0) || (Ms < ColdMs)) ? Ms : ColdMs;
+		}
+
+		PMeshCache::Stats ColdStats = PMeshCache::GetStats();
+
+		PMeshCache::ResetStats();
+		double WarmMs = TimeBest(LoadAll, LoadRuns);
+		PMeshCache::Stats WarmStats = PMeshCache::GetStats();
+
+		// A fresh checkout gives every source a new time. The first load hashes and restamps, the next is warm again.
+		for (const std::string& Source : Sources)
+		{
+			std::filesystem::last_write_time(Source, (std::filesystem::last_write_time(Source, Error) + std::chrono::seconds(10)), Error);
+		}
+
+		PMeshCache::ResetStats();
+		Clock.Restart();
+		LoadAll();
+		double TouchedMs = Clock.GetElapsedMiliseconds();
+		PMeshCache::Stats TouchedStats = PMeshCache::GetStats();
+
+		bool bMatches = true;
+		size_t Triangles = 0;
+
+		for (size_t i = 0; bMatches && (i < MeshCount); ++i)
+		{
+			bMatches = (Parsed[i].Indices == Loaded[i].Indices) && (Parsed[i].Vertices.size() == Loaded[i].Vertices.size()) &&
+				(memcmp(Parsed[i].Vertices.data(), Loaded[i].Vertices.data(), (sizeof(Vertex) * Parsed[i].Vertices.size())) == 0) &&
+				(memcmp(&Parsed[i].Bounds, &Loaded[i].Bounds, sizeof(PAABB)) == 0) && (memcmp(&Parsed[i].Sphere, &Loaded[i].Sphere, sizeof(PSphere)) == 0);
+			Triangles += (Loaded[i].Indices.size() / 3);
+		}
+
+		RemoveEntries();
+		std::filesystem::remove_all(Directory, Error);
+
+		char Line[320];
+		snprintf(Line, sizeof(Line), "Mesh cache benchmark (%zu meshes, %zu triangles). Parsing every load: %.1f ms. Cold cache: %.1f ms (%llu cooked, %llu write failures). Warm: %.1f ms (%llu hits), %.1fx faster than parsing.",
+			MeshCount, Triangles, ParseMs, ColdMs, (unsigned long long)(ColdStats.Cooked / LoadRuns), (unsigned long long)ColdStats.WriteFailures, WarmMs, (unsigned long long)(WarmStats.Hits / LoadRuns),
+			(WarmMs > 0.0) ? (ParseMs / WarmMs) : 0.0);
+		Report(Line);
+
+		snprintf(Line, sizeof(Line), "Every source's time changed: %.1f ms to hash and restamp (%llu rehashed, %llu cooked).", TouchedMs, (unsigned long long)TouchedStats.Rehashed, (unsigned long long)TouchedStats.Cooked);
+		Report(Line);
+
+		Report((bMatches ? "Cached meshes match the parsed ones." : "Cached meshes DIFFER from the parsed ones."), (bMatches ? 1 : 2));
+	}
+
+	// Rasterize a wall in front of the camera and check which boxes each path culls, then time a frame of scattered
+	// occluders and boxes on each path and check they cull the same boxes as the scalar one.
+	void RunOcclusionBenchmark()
+	{
+		// The camera sits at the origin looking down +z. The wall is at z = 10 and covers pixels 57.6 to 198.4 across and
+		// 24 to 104 down, so its top edge lines up with an 8x8 block but not with a 32x32 one.
+		float4x4_a ViewProjection = PStoreMatrix(PMatrixPerspectiveFovLH((PI * 0.5f), ((float)POcclusionCuller::Width / POcclusionCuller::Height), 0.1f, 100.0f));
+		float4x4_a Identity = PStoreMatrix(PMatrixIdentity());
+
+		std::vector<Vertex> Wall(4);
+		Wall[0].Position = { -11.0f, -6.25f, 10.0f };
+		Wall[1].Position = { -11.0f, 6.25f, 10.0f };
+		Wall[2].Position = { 11.0f, 6.25f, 10.0f };
+		Wall[3].Position = { 11.0f, -6.25f, 10.0f };
+		const std::vector<int> WallIndices = { 0, 1, 2, 0, 2, 3 };
+
+		struct PCase
+		{
+			const char* Name;
+			PAABB Box;
+			bool bVisible;
+		};
+
+		const PCase Cases[] =
+		{
+			{ "behind the wall", { { 0.0f, 0.0f, 20.0f }, { 1.0f, 1.0f, 1.0f } }, false },
+			{ "far behind the wall", { { 2.0f, 1.0f, 60.0f }, { 2.0f, 2.0f, 2.0f } }, false },
+			{ "behind the wall across several blocks", { { 0.0f, 0.0f, 40.0f }, { 15.0f, 8.0f, 1.0f } }, false },
+			{ "behind the top edge of the wall", { { 0.0f, 11.6f, 20.0f }, { 1.0f, 0.3f, 0.3f } }, false },
+			{ "in front of the wall", { { 0.0f, 0.0f, 5.0f }, { 1.0f, 1.0f, 1.0f } }, true },
+			{ "beside the wall", { { 30.0f, 0.0f, 20.0f }, { 1.0f, 1.0f, 1.0f } }, true },
+			{ "over the top edge of the wall", { { 0.0f, 13.0f, 20.0f }, { 1.0f, 1.0f, 1.0f } }, true },
+			{ "wider than the wall", { { 0.0f, 0.0f, 30.0f }, { 40.0f, 1.0f, 1.0f } }, true },
+			{ "far wider than the screen", { { 0.0f, 0.0f, 20.0f }, { 1000.0f, 1.0f, 1.0f } }, true },
+			{ "crossing the camera plane", { { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } }, true },
+			{ "behind the camera", { { 0.0f, 0.0f, -20.0f }, { 1.0f, 1.0f, 1.0f } }, true },
+		};
+
+		// A frame of 1024 small occluder quads scattered in front of the camera and 10k boxes among and behind them.
+		const size_t OccluderCount = 1024;
+		const size_t BoxCount = 10000;
+
+		std::vector<Vertex> Panel(4);
+		Panel[0].Position = { -1.5f, -1.5f, 0.0f };
+		Panel[1].Position = { -1.5f, 1.5f, 0.0f };
+		Panel[2].Position = { 1.5f, 1.5f, 0.0f };
+		Panel[3].Position = { 1.5f, -1.5f, 0.0f };
+
+		std::mt19937 Generator(42);
+		std::uniform_real_distribution<float> Spread(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> OccluderDepth(5.0f, 30.0f);
+		std::uniform_real_distribution<float> BoxDepth(10.0f, 90.0f);
+
+		std::vector<float4x4_a> OccluderWorlds(OccluderCount);
+		for (float4x4_a& World : OccluderWorlds)
+		{
+			float Depth = OccluderDepth(Generator);
+			World = PStoreMatrix(PMatrixTranslation((Spread(Generator) * Depth * 1.6f), (Spread(Generator) * Depth * 0.8f), Depth));
+		}
+
+		std::vector<PAABB> Boxes(BoxCount);
+		for (PAABB& Box : Boxes)
+		{
+			float Depth = BoxDepth(Generator);
+			Box = { { (Spread(Generator) * Depth * 2.0f), (Spread(Generator) * Depth), Depth }, { 0.5f, 0.5f, 0.5f } };
+		}
+
+		POcclusionCuller Culler;
+		std::vector<float> ScalarDepth;
+		std::vector<uint8_t> ScalarVisible;
+		std::vector<uint8_t> Visible(BoxCount);
+		bool bAllPassed = true;
+		char Line[256];
+
+		Report("Occlusion culling benchmark (256x128 depth buffer, 8x8 and 32x32 blocks).");
+
+		const PSimdLevel Levels[] = { PSimdLevel::SCALAR, PSimdLevel::SSE2, PSimdLevel::AVX2 };
+		for (PSimdLevel Level : Levels)
+		{
+			if (Level > PGetTransformSimdLevel())
+			{
+				continue;
+			}
+
+			// The wall.
+			Culler.BeginFrame(ViewProjection);
+			Culler.AddOccluder(Wall.data(), WallIndices.data(), WallIndices.size(), Identity);
+			Culler.Rasterize(Level);
+
+			size_t Failed = 0;
+			for (const PCase& Case : Cases)
+			{
+				bool bVisible = Culler.IsVisible(Case.Box);
+				if (bVisible != Case.bVisible)
+				{
+					snprintf(Line, sizeof(Line), "%s: the box %s was %s, it should be %s.", PGetSimdLevelName(Level), Case.Name, (bVisible ? "kept" : "culled"), (Case.bVisible ? "kept" : "culled"));
+					Report(Line, 2);
+					++Failed;
+				}
+			}
+
+			// The scattered frame.
+			size_t Culled = 0;
+			double Ms = TimeBest([&]()
+			{
+				Culler.BeginFrame(ViewProjection);
+
+				for (const float4x4_a& World : OccluderWorlds)
+				{
+					Culler.AddOccluder(Panel.data(), WallIndices.data(), WallIndices.size(), World);
+				}
+
+				Culler.Rasterize(Level);
+
+				Culled = 0;
+				for (size_t i = 0; i < BoxCount; ++i)
+				{
+					Visible[i] = Culler.IsVisible(Boxes[i]) ? 1 : 0;
+					Culled += (Visible[i] ? 0 : 1);
+				}
+			});
+
+			const float* Depth = Culler.GetDepthBuffer();
+			float MaxDifference = 0.0f;
+			size_t Differ = 0;
+
+			if (Level == PSimdLevel::SCALAR)
+			{
+				ScalarDepth.assign(Depth, (Depth + (POcclusionCuller::Width * POcclusionCuller::Height)));
+				ScalarVisible = Visible;
+			}
+			else
+			{
+				for (size_t i = 0; i < ScalarDepth.size(); ++i)
+				{
+					MaxDifference = std::max(MaxDifference, fabsf(Depth[i] - ScalarDepth[i]));
+				}
+
+				for (size_t i = 0; i < BoxCount; ++i)
+				{
+					Differ += (Visible[i] != ScalarVisible[i]) ? 1 : 0;
+				}
+			}
+
+			bool bPassed = ((Failed == 0) && (Differ == 0) && (MaxDifference < 1e-5f));
+			bAllPassed = (bAllPassed && bPassed);
+
+			snprintf(Line, sizeof(Line), "%s: %zu of %zu wall cases right. %zu occluders, %zu boxes: %.3f ms a frame, %zu culled, %zu differ from scalar, max depth difference %g.",
+				PGetSimdLevelName(Level), (std::size(Cases) - Failed), std::size(Cases), OccluderCount, BoxCount, Ms, Culled, Differ, MaxDifference);
+			Report(Line, (bPassed ? 4 : 2));
+		}
+
+		Report((bAllPassed ? "Every path culls the expected boxes." : "Some paths cull the WRONG boxes."), (bAllPassed ? 1 : 2));
+	}
+}
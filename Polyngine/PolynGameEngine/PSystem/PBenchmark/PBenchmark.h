@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+
+// Engine benchmarks. These are run from the editor (Options > Benchmarks) and print their results to the output log.
+namespace PBenchmark
+{
+	// Compare the per-object PAABBToFrustum() path against the batched scalar, SSE, and AVX2 culling kernels
+	// with 1k, 10k, and 100k boxes.
+	void RunCullingBenchmark();
+
+	// Compare PAABBTree frustum and box queries against a linear scan over every object with 10k, 50k, and 200k objects.
+	void RunSpatialTreeBenchmark();
+
+	// Measure the batched point, normal, and matrix transform kernels on each instruction set, in elements per nanosecond.
+	void RunTransformBenchmark();
+
+	// Compare closest-hit ray queries cast one at a time through PAABBTree::QueryRay() against packets of 8 through
+	// PAABBTree::QueryRayPacket(), for rays fanned out from one point and rays scattered through the scene.
+	void RunRaycastBenchmark();
+
+	// Build a PMeshBVH over a 100k triangle mesh, report its build time, size, and depth, then measure closest-hit rays
+	// per second on each instruction set against testing every triangle.
+	void RunMeshBVHBenchmark();
+
+	// Compare the memory and pose samples per second of an animation clip stored as separate keyframes (PAnim::AnimClip)
+	// against the packed layout (PAnim::PackedClip) blended on each instruction set, and compressed (PAnimCompression).
+	void RunAnimationBenchmark();
+
+	// Measure PAnim::UpdateAll() over 512 animators sharing a clip, split into 1, 2, 4, and so on batches up to one per
+	// thread in the job pool, in poses per second. Then compare a frame with a quarter of them at each level of detail
+	// against all of them at full.
+	void RunAnimationPhaseBenchmark();
+
+	// Skin a 50k vertex mesh with linear blend and dual quaternion skinning on each instruction set, in vertices per
+	// microsecond, and report how far each path strays from the scalar one. Then bound the pose from joint spheres, and
+	// compare the box with the one around the skinned vertices.
+	void RunSkinningBenchmark();
+
+	// Load a library of 64 clips from version 1 .anim files through PAnim::AcquireClip(), as levels do, upgrade it to
+	// version 3 (PAnimFile), and load it again, reporting the time per clip and that both versions play the same poses.
+	void RunAnimationLoadBenchmark();
+
+	// Compare 256 animators playing one clip against the same animators blending three through PAnim layers, one of them
+	// masked to half the skeleton, and check that the blended frames allocate nothing once warmed up.
+	void RunAnimationBlendBenchmark();
+
+	// Compare 512 animators started at random times on one clip evaluating their own poses and skinning palettes against
+	// sharing them through PAnim instancing, and report how many poses each frame evaluates and the hit rate.
+	void RunAnimationInstancingBenchmark();
+
+	// Load a 200k triangle .obj with objl::Loader and with PObjParser on one chunk and across the job pool, in
+	// milliseconds, and check that they give the same vertices and indices.
+	void RunObjLoadBenchmark();
+
+	// Weld a million unindexed corners with PVertexWeld, in milliseconds, and check it welds the same vertices as the
+	// nested loop FBXExporter::Compactify used to run, on the first 60k corners.
+	void RunVertexWeldBenchmark();
+
+	// Load 12 .obj meshes through PMeshCache with no entries, with entries, and after the sources' times change, against
+	// parsing them every load, in milliseconds, and check the cached meshes match the parsed ones.
+	void RunMeshCacheBenchmark();
+
+	// Rasterize a wall with POcclusionCuller on each instruction set and check which boxes around it are culled, then
+	// time a frame of 1024 occluders and 10k boxes, in milliseconds, and check every path culls the same boxes.
+	void RunOcclusionBenchmark();
+}
@@ -0,0 +1,124 @@
+#include "PFileMap.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Unmap the file on destruction.
+PFileMap::~PFileMap()
+{
+	Close();
+}
+
+// Map FilePath, closing whatever was mapped before.
+//
+// Returns true if the file was mapped. Empty files can't be mapped.
+bool PFileMap::Open(const std::string& FilePath)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE File = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, (FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN), NULL);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER FileSize;
+	if (!GetFileSizeEx(File, &FileSize) || (FileSize.QuadPart <= 0))
+	{
+		CloseHandle(File);
+		return false;
+	}
+
+	HANDLE Mapping = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (Mapping == NULL)
+	{
+		CloseHandle(File);
+		return false;
+	}
+
+	const void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (View == NULL)
+	{
+		CloseHandle(Mapping);
+		CloseHandle(File);
+		return false;
+	}
+
+	FileHandle = File;
+	MappingHandle = Mapping;
+	Data = (const uint8_t*)View;
+	Size = (size_t)FileSize.QuadPart;
+#else
+	int File = open(FilePath.c_str(), O_RDONLY);
+	if (File < 0)
+	{
+		return false;
+	}
+
+	struct stat Info;
+	if ((fstat(File, &Info) != 0) || (Info.st_size <= 0))
+	{
+		close(File);
+		return false;
+	}
+
+	void* View = mmap(nullptr, (size_t)Info.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+
+	// The mapping holds its own reference to the file.
+	close(File);
+
+	if (View == MAP_FAILED)
+	{
+		return false;
+	}
+
+	Data = (const uint8_t*)View;
+	Size = (size_t)Info.st_size;
+#endif
+
+	Path = FilePath;
+
+	return true;
+}
+
+// Unmap the file, if one is mapped.
+//
+// No return value.
+void PFileMap::Close()
+{
+#ifdef _WIN32
+	if (Data)
+	{
+		UnmapViewOfFile(Data);
+	}
+
+	if (MappingHandle)
+	{
+		CloseHandle((HANDLE)MappingHandle);
+	}
+
+	if (FileHandle)
+	{
+		CloseHandle((HANDLE)FileHandle);
+	}
+
+	FileHandle = nullptr;
+	MappingHandle = nullptr;
+#else
+	if (Data)
+	{
+		munmap((void*)Data, Size);
+	}
+#endif
+
+	Data = nullptr;
+	Size = 0;
+	Path.clear();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A file mapped read only into memory. The operating system pages the file in as it is read, so opening costs the same
+// whatever the size of the file, and nothing is copied until the caller copies it. The mapping stays valid until Close()
+// or destruction, and the file can't be written while it is open.
+class PFileMap
+{
+public:
+	PFileMap() = default;
+	~PFileMap();
+
+	PFileMap(const PFileMap&) = delete;
+	PFileMap& operator=(const PFileMap&) = delete;
+
+	// Map FilePath, closing whatever was mapped before.
+	//
+	// Returns true if the file was mapped. Empty files can't be mapped.
+	bool Open(const std::string& FilePath);
+
+	// Unmap the file, if one is mapped.
+	//
+	// No return value.
+	void Close();
+
+	// Return whether a file is mapped.
+	bool IsOpen() const { return (Data != nullptr); }
+
+	// Return the first byte of the file, or nullptr if none is mapped.
+	const uint8_t* GetData() const { return Data; }
+
+	// Return the size of the file in bytes.
+	size_t GetSize() const { return Size; }
+
+	// Return the path the file was mapped from.
+	const std::string& GetPath() const { return Path; }
+
+private:
+	const uint8_t* Data = nullptr;			// The mapped view of the file.
+	size_t Size = 0;						// The size of the file.
+	std::string Path;						// The path it was mapped from.
+
+#ifdef _WIN32
+	void* FileHandle = nullptr;				// The open file.
+	void* MappingHandle = nullptr;			// The file mapping object the view belongs to.
+#endif
+};
@@ -0,0 +1,204 @@
+#include "PJobSystem.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PJobs
+{
+	namespace
+	{
+		// Set on worker threads, and on the calling thread while it is inside ParallelFor(), so nested calls run inline
+		// instead of waiting on a pool that is already busy with their parent.
+		thread_local bool bInsideJob = false;
+
+		class PWorkerPool
+		{
+		public:
+			PWorkerPool()
+			{
+				unsigned int HardwareThreads = std::thread::hardware_concurrency();
+				unsigned int WorkerCount = (HardwareThreads > 1) ? (HardwareThreads - 1) : 0;
+
+				for (unsigned int i = 0; i < WorkerCount; ++i)
+				{
+					Workers.emplace_back([this]() { WorkerLoop(); });
+				}
+			}
+
+			~PWorkerPool()
+			{
+				{
+					std::lock_guard<std::mutex> Lock(Mutex);
+					bShutdown = true;
+				}
+
+				Wake.notify_all();
+
+				for (std::thread& Worker : Workers)
+				{
+					Worker.join();
+				}
+			}
+
+			unsigned int GetWorkerCount() const
+			{
+				return (unsigned int)Workers.size();
+			}
+
+			void Run(size_t Count, size_t Grain, const std::function<void(size_t, size_t)>& Body)
+			{
+				// Only one ParallelFor owns the workers at a time.
+				std::lock_guard<std::mutex> Submit(SubmitMutex);
+
+				{
+					std::lock_guard<std::mutex> Lock(Mutex);
+					Job = &Body;
+					JobCount = Count;
+					JobGrain = Grain;
+					NextIndex = 0;
+					RemainingChunks = ((Count + Grain - 1) / Grain);
+					++Generation;
+				}
+
+				Wake.notify_all();
+
+				// The calling thread works on the job too.
+				Work(Body, Count, Grain);
+
+				// Wait for the last chunk, and for every worker to leave the job, before Body goes out of scope.
+				std::unique_lock<std::mutex> Lock(Mutex);
+				Done.wait(Lock, [this]() { return ((RemainingChunks == 0) && (ActiveWorkers == 0)); });
+				Job = nullptr;
+			}
+
+		private:
+			std::vector<std::thread> Workers;
+
+			std::mutex SubmitMutex;
+			std::mutex Mutex;
+			std::condition_variable Wake;
+			std::condition_variable Done;
+
+			const std::function<void(size_t, size_t)>* Job = nullptr;
+			size_t JobCount = 0;
+			size_t JobGrain = 1;
+			unsigned long long Generation = 0;
+			unsigned int ActiveWorkers = 0;
+			bool bShutdown = false;
+
+			std::atomic<size_t> NextIndex = 0;
+			std::atomic<size_t> RemainingChunks = 0;
+
+			// Take chunks from the current job until there are none left.
+			void Work(const std::function<void(size_t, size_t)>& Body, size_t Count, size_t Grain)
+			{
+				while (true)
+				{
+					size_t Begin = NextIndex.fetch_add(Grain);
+					if (Begin >= Count)
+					{
+						return;
+					}
+
+					size_t End = ((Begin + Grain) < Count) ? (Begin + Grain) : Count;
+					Body(Begin, End);
+
+					if (RemainingChunks.fetch_sub(1) == 1)
+					{
+						std::lock_guard<std::mutex> Lock(Mutex);
+						Done.notify_all();
+					}
+				}
+			}
+
+			void WorkerLoop()
+			{
+				bInsideJob = true;
+				unsigned long long SeenGeneration = 0;
+
+				while (true)
+				{
+					const std::function<void(size_t, size_t)>* Body;
+					size_t Count;
+					size_t Grain;
+
+					{
+						std::unique_lock<std::mutex> Lock(Mutex);
+						Wake.wait(Lock, [&]() { return (bShutdown || (Generation != SeenGeneration)); });
+
+						if (bShutdown)
+						{
+							return;
+						}
+
+						SeenGeneration = Generation;
+
+						// The job may already have finished before this worker woke up.
+						if (Job == nullptr)
+						{
+							continue;
+						}
+
+						Body = Job;
+						Count = JobCount;
+						Grain = JobGrain;
+						++ActiveWorkers;
+					}
+
+					Work(*Body, Count, Grain);
+
+					{
+						std::lock_guard<std::mutex> Lock(Mutex);
+						--ActiveWorkers;
+					}
+
+					Done.notify_all();
+				}
+			}
+		};
+
+		PWorkerPool& GetPool()
+		{
+			static PWorkerPool Pool;
+			return Pool;
+		}
+	}
+
+	// Returns the number of worker threads in the pool, not counting the calling thread.
+	unsigned int GetWorkerCount()
+	{
+		return GetPool().GetWorkerCount();
+	}
+
+	// Split [0, Count) into chunks of Grain items and call Body(Begin, End) for each chunk on the workers and the calling
+	// thread. Returns once every chunk has finished. Calls made from inside a Body run on the calling thread.
+	void ParallelFor(size_t Count, size_t Grain, const std::function<void(size_t Begin, size_t End)>& Body)
+	{
+		if (Count == 0)
+		{
+			return;
+		}
+
+		if (Grain == 0)
+		{
+			Grain = 1;
+		}
+
+		// Small jobs, nested jobs, and single core machines just run here.
+		if (bInsideJob || (Count <= Grain) || (GetPool().GetWorkerCount() == 0))
+		{
+			for (size_t Begin = 0; Begin < Count; Begin += Grain)
+			{
+				Body(Begin, ((Begin + Grain) < Count) ? (Begin + Grain) : Count);
+			}
+
+			return;
+		}
+
+		bInsideJob = true;
+		GetPool().Run(Count, Grain, Body);
+		bInsideJob = false;
+	}
+}
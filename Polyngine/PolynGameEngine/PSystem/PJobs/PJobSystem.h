@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// A small pool of worker threads for splitting data-parallel work across the CPU. The pool is created the first time it
+// is used and has one worker fewer than the number of hardware threads, because the calling thread helps with the work.
+namespace PJobs
+{
+	// Returns the number of worker threads in the pool, not counting the calling thread.
+	unsigned int GetWorkerCount();
+
+	// Split [0, Count) into chunks of Grain items and call Body(Begin, End) for each chunk on the workers and the calling
+	// thread. Returns once every chunk has finished. Calls made from inside a Body run on the calling thread.
+	void ParallelFor(size_t Count, size_t Grain, const std::function<void(size_t Begin, size_t End)>& Body);
+}
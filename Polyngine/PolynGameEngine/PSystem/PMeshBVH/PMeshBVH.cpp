@@ -0,0 +1,726 @@
+#include "PMeshBVH.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+using namespace PMath;
+
+namespace
+{
+	// The number of centroid bins per axis when looking for a split. 16 finds splits within a few percent of a full sweep.
+	constexpr int SplitBins = 16;
+
+	// Nodes this deep are always made leaves, so traversal can use a fixed size stack.
+	constexpr int MaxBuildDepth = 96;
+
+	// Cost of visiting a node, relative to testing one triangle.
+	constexpr float TraversalCost = 1.0f;
+
+	// Cost of testing a leaf of up to MaxLeafTriangles. The SIMD kernels test the whole leaf at once, which costs about as
+	// much as two triangles tested one at a time, so small leaves aren't split just to save a triangle or two.
+	constexpr float LeafTestCost = 2.0f;
+
+	float SurfaceArea(const float3& Min, const float3& Max)
+	{
+		float3 Size = (Max - Min);
+		return (2.0f * ((Size.x * Size.y) + (Size.y * Size.z) + (Size.z * Size.x)));
+	}
+
+	float3 Min3(const float3& A, const float3& B)
+	{
+		return { std::min(A.x, B.x), std::min(A.y, B.y), std::min(A.z, B.z) };
+	}
+
+	float3 Max3(const float3& A, const float3& B)
+	{
+		return { std::max(A.x, B.x), std::max(A.y, B.y), std::max(A.z, B.z) };
+	}
+
+	// A box that anything grown into it replaces.
+	constexpr float3 EmptyMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+	constexpr float3 EmptyMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	// A ray prepared for traversal.
+	struct PreparedRay
+	{
+		float3 Origin;
+		float3 Direction;
+		float3 InvDirection;
+	};
+
+	// The distance a ray enters the box Min to Max, or FLT_MAX if it misses it before Best. The running Near and Far are the
+	// first operands of std::max and std::min, so the NaN from a zero direction component on a box face is ignored.
+	float IntersectBox(const PreparedRay& Ray, const float3& Min, const float3& Max, float Best)
+	{
+		float Near = 0.0f;
+		float Far = Best;
+
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			float T1 = ((Min[Axis] - Ray.Origin[Axis]) * Ray.InvDirection[Axis]);
+			float T2 = ((Max[Axis] - Ray.Origin[Axis]) * Ray.InvDirection[Axis]);
+
+			Near = std::max(Near, std::min(T1, T2));
+			Far = std::min(Far, std::max(T1, T2));
+		}
+
+		return (Near <= Far) ? Near : FLT_MAX;
+	}
+
+	// Gather the corners of one triangle. A triangle with an index out of range collapses onto its first valid corner.
+	void GatherCorners(const Vertex* Vertices, size_t VertexCount, const int* Indices, size_t Triangle, float3* OutCorner)
+	{
+		bool bValid = true;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			int Index = Indices[(Triangle * 3) + i];
+			bValid &= ((Index >= 0) && ((size_t)Index < VertexCount));
+			OutCorner[i] = bValid ? Vertices[Index].Position : ((i > 0) ? OutCorner[0] : float3{ 0.0f, 0.0f, 0.0f });
+		}
+
+		if (!bValid)
+		{
+			OutCorner[1] = OutCorner[2] = OutCorner[0];
+		}
+	}
+}
+
+// Build the hierarchy over IndexCount / 3 triangles.
+PMeshBVH::PMeshBVH(const Vertex* Vertices, size_t VertexCount, const int* Indices, size_t IndexCount)
+{
+	size_t TriangleCount = (IndexCount / 3);
+
+	SourceVertexCount = VertexCount;
+	SourceIndexCount = IndexCount;
+
+	if (TriangleCount == 0)
+	{
+		return;
+	}
+
+	// Gather each triangle's corners.
+	std::vector<float3> Corners(TriangleCount * 3);
+	std::vector<float3> TriangleMin(TriangleCount);
+	std::vector<float3> TriangleMax(TriangleCount);
+	std::vector<float3> Centroids(TriangleCount);
+
+	for (size_t Triangle = 0; Triangle < TriangleCount; ++Triangle)
+	{
+		float3* Corner = &Corners[Triangle * 3];
+		GatherCorners(Vertices, VertexCount, Indices, Triangle, Corner);
+
+		TriangleMin[Triangle] = Min3(Corner[0], Min3(Corner[1], Corner[2]));
+		TriangleMax[Triangle] = Max3(Corner[0], Max3(Corner[1], Corner[2]));
+		Centroids[Triangle] = (TriangleMin[Triangle] + TriangleMax[Triangle]) * 0.5f;
+	}
+
+	std::vector<uint32_t> Order(TriangleCount);
+	for (size_t i = 0; i < TriangleCount; ++i)
+	{
+		Order[i] = (uint32_t)i;
+	}
+
+	struct BuildTask
+	{
+		uint32_t NodeIndex;
+		uint32_t Begin;
+		uint32_t End;
+		int NodeDepth;
+	};
+
+	Nodes.reserve(TriangleCount * 2);
+	Nodes.push_back(Node{});
+
+	std::vector<BuildTask> Tasks;
+	Tasks.push_back({ 0, 0, (uint32_t)TriangleCount, 0 });
+
+	while (!Tasks.empty())
+	{
+		BuildTask Task = Tasks.back();
+		Tasks.pop_back();
+
+		uint32_t Count = (Task.End - Task.Begin);
+
+		float3 BoundsMin = EmptyMin, BoundsMax = EmptyMax;
+		float3 CentroidMin = EmptyMin, CentroidMax = EmptyMax;
+		for (uint32_t i = Task.Begin; i < Task.End; ++i)
+		{
+			BoundsMin = Min3(BoundsMin, TriangleMin[Order[i]]);
+			BoundsMax = Max3(BoundsMax, TriangleMax[Order[i]]);
+			CentroidMin = Min3(CentroidMin, Centroids[Order[i]]);
+			CentroidMax = Max3(CentroidMax, Centroids[Order[i]]);
+		}
+
+		Nodes[Task.NodeIndex].Min = BoundsMin;
+		Nodes[Task.NodeIndex].Max = BoundsMax;
+		Depth = std::max(Depth, Task.NodeDepth);
+
+		auto MakeLeaf = [&]()
+		{
+			Nodes[Task.NodeIndex].LeftOrFirst = Task.Begin;
+			Nodes[Task.NodeIndex].Count = Count;
+		};
+
+		if ((Count <= 1) || (Task.NodeDepth >= MaxBuildDepth))
+		{
+			MakeLeaf();
+			continue;
+		}
+
+		// Find the cheapest split plane between bins on each axis. Cost is measured in triangle tests: splitting costs a
+		// traversal step plus each child's triangles weighted by the chance a ray through this node also enters the child.
+		float NodeArea = SurfaceArea(BoundsMin, BoundsMax);
+		float BestCost = FLT_MAX;
+		int BestAxis = -1;
+		int BestSplit = 0;
+
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			float Extent = (CentroidMax[Axis] - CentroidMin[Axis]);
+			if (Extent <= 0.0f)
+			{
+				continue;
+			}
+
+			struct Bin
+			{
+				float3 Min = EmptyMin;
+				float3 Max = EmptyMax;
+				uint32_t Count = 0;
+			};
+
+			Bin Bins[SplitBins];
+			float BinScale = (SplitBins / Extent);
+
+			for (uint32_t i = Task.Begin; i < Task.End; ++i)
+			{
+				uint32_t Triangle = Order[i];
+				int BinIndex = std::min(SplitBins - 1, (int)((Centroids[Triangle][Axis] - CentroidMin[Axis]) * BinScale));
+
+				Bins[BinIndex].Min = Min3(Bins[BinIndex].Min, TriangleMin[Triangle]);
+				Bins[BinIndex].Max = Max3(Bins[BinIndex].Max, TriangleMax[Triangle]);
+				Bins[BinIndex].Count++;
+			}
+
+			// Sweep from the right to get the area and count of every right hand side, then from the left to price each split.
+			float RightArea[SplitBins];
+			uint32_t RightCount[SplitBins];
+			float3 SweepMin = EmptyMin, SweepMax = EmptyMax;
+			uint32_t SweepCount = 0;
+
+			for (int i = (SplitBins - 1); i > 0; --i)
+			{
+				SweepMin = Min3(SweepMin, Bins[i].Min);
+				SweepMax = Max3(SweepMax, Bins[i].Max);
+				SweepCount += Bins[i].Count;
+
+				RightArea[i] = (SweepCount > 0) ? SurfaceArea(SweepMin, SweepMax) : 0.0f;
+				RightCount[i] = SweepCount;
+			}
+
+			SweepMin = EmptyMin;
+			SweepMax = EmptyMax;
+			SweepCount = 0;
+
+			for (int i = 0; i < (SplitBins - 1); ++i)
+			{
+				SweepMin = Min3(SweepMin, Bins[i].Min);
+				SweepMax = Max3(SweepMax, Bins[i].Max);
+				SweepCount += Bins[i].Count;
+
+				if ((SweepCount == 0) || (RightCount[i + 1] == 0))
+				{
+					continue;
+				}
+
+				float Cost = TraversalCost + (((SurfaceArea(SweepMin, SweepMax) * SweepCount) + (RightArea[i + 1] * RightCount[i + 1])) / NodeArea);
+				if (Cost < BestCost)
+				{
+					BestCost = Cost;
+					BestAxis = Axis;
+					BestSplit = (i + 1);
+				}
+			}
+		}
+
+		uint32_t Middle = 0;
+
+		if (BestAxis >= 0)
+		{
+			// Keep small leaves when splitting doesn't pay for itself.
+			if ((BestCost >= LeafTestCost) && (Count <= MaxLeafTriangles))
+			{
+				MakeLeaf();
+				continue;
+			}
+
+			float Extent = (CentroidMax[BestAxis] - CentroidMin[BestAxis]);
+			float BinScale = (SplitBins / Extent);
+
+			uint32_t* Split = std::partition(Order.data() + Task.Begin, Order.data() + Task.End, [&](uint32_t Triangle)
+			{
+				return (std::min(SplitBins - 1, (int)((Centroids[Triangle][BestAxis] - CentroidMin[BestAxis]) * BinScale)) < BestSplit);
+			});
+
+			Middle = (uint32_t)(Split - Order.data());
+		}
+
+		if ((Middle <= Task.Begin) || (Middle >= Task.End))
+		{
+			// Every centroid is in the same place. Small groups become a leaf, big ones are cut in half so leaves stay small.
+			if (Count <= MaxLeafTriangles)
+			{
+				MakeLeaf();
+				continue;
+			}
+
+			Middle = (Task.Begin + (Count / 2));
+		}
+
+		uint32_t Left = (uint32_t)Nodes.size();
+		Nodes.push_back(Node{});
+		Nodes.push_back(Node{});
+
+		Nodes[Task.NodeIndex].LeftOrFirst = Left;
+		Nodes[Task.NodeIndex].Count = 0;
+
+		Tasks.push_back({ (Left + 1), Middle, Task.End, (Task.NodeDepth + 1) });
+		Tasks.push_back({ Left, Task.Begin, Middle, (Task.NodeDepth + 1) });
+	}
+
+	Nodes.shrink_to_fit();
+
+	// Store the triangles in leaf order.
+	size_t PaddedCount = (TriangleCount + MaxLeafTriangles);
+	for (float_array_t* Array : { &V0X, &V0Y, &V0Z, &E1X, &E1Y, &E1Z, &E2X, &E2Y, &E2Z })
+	{
+		Array->assign(PaddedCount, 0.0f);
+	}
+
+	TriangleIds = Order;
+
+	for (size_t Slot = 0; Slot < TriangleCount; ++Slot)
+	{
+		const float3* Corner = &Corners[Order[Slot] * 3];
+		float3 Edge1 = (Corner[1] - Corner[0]);
+		float3 Edge2 = (Corner[2] - Corner[0]);
+
+		V0X[Slot] = Corner[0].x; V0Y[Slot] = Corner[0].y; V0Z[Slot] = Corner[0].z;
+		E1X[Slot] = Edge1.x; E1Y[Slot] = Edge1.y; E1Z[Slot] = Edge1.z;
+		E2X[Slot] = Edge2.x; E2Y[Slot] = Edge2.y; E2Z[Slot] = Edge2.z;
+	}
+}
+
+// Return the shared hierarchy for this geometry.
+std::shared_ptr<const PMeshBVH> PMeshBVH::Acquire(const std::vector<Vertex>& Vertices, const std::vector<int>& Indices)
+{
+	// Meshes are matched by a hash of their positions and indices (FNV-1a), so two instances of one model file, or two
+	// primitives of the same type, find the same hierarchy.
+	uint64_t Hash = 14695981039346656037ull;
+	auto HashBytes = [&](const void* Data, size_t Size)
+	{
+		const unsigned char* Bytes = static_cast<const unsigned char*>(Data);
+		for (size_t i = 0; i < Size; ++i)
+		{
+			Hash = ((Hash ^ Bytes[i]) * 1099511628211ull);
+		}
+	};
+
+	size_t Counts[2] = { Vertices.size(), Indices.size() };
+	HashBytes(Counts, sizeof(Counts));
+	for (const Vertex& Vert : Vertices)
+	{
+		HashBytes(&Vert.Position, sizeof(float3));
+	}
+	HashBytes(Indices.data(), (Indices.size() * sizeof(int)));
+
+	static std::mutex CacheLock;
+	static std::unordered_map<uint64_t, std::weak_ptr<const PMeshBVH>> Cache;
+
+	std::lock_guard<std::mutex> Lock(CacheLock);
+
+	std::shared_ptr<const PMeshBVH> Shared = Cache[Hash].lock();
+
+	// Different geometry with the same hash gets a hierarchy of its own rather than the wrong one. The shared one stays
+	// with the meshes that already hold it.
+	if (Shared && !Shared->Matches(Vertices.data(), Vertices.size(), Indices.data(), Indices.size()))
+	{
+		return std::make_shared<const PMeshBVH>(Vertices.data(), Vertices.size(), Indices.data(), Indices.size());
+	}
+
+	if (!Shared)
+	{
+		// Forget hierarchies whose meshes have all gone.
+		for (auto It = Cache.begin(); It != Cache.end();)
+		{
+			It = It->second.expired() ? Cache.erase(It) : std::next(It);
+		}
+
+		Shared = std::make_shared<const PMeshBVH>(Vertices.data(), Vertices.size(), Indices.data(), Indices.size());
+		Cache[Hash] = Shared;
+	}
+
+	return Shared;
+}
+
+
+// ------------------------------------------------------------------
+//		Leaf Kernels.
+// ------------------------------------------------------------------
+//
+// Each kernel tests one ray against Count triangles starting at slot First, with the Moller-Trumbore test, and keeps the
+// nearest hit closer than Best. They return true if Best was lowered.
+
+namespace
+{
+	struct LeafArrays
+	{
+		const float* V0X; const float* V0Y; const float* V0Z;
+		const float* E1X; const float* E1Y; const float* E1Z;
+		const float* E2X; const float* E2Y; const float* E2Z;
+	};
+
+	bool IntersectLeafScalar(const PreparedRay& Ray, const LeafArrays& Tris, uint32_t First, uint32_t Count, float& Best, uint32_t& BestSlot, float& BestU, float& BestV)
+	{
+		bool bHit = false;
+
+		for (uint32_t Slot = First; Slot < (First + Count); ++Slot)
+		{
+			float3 Edge1 = { Tris.E1X[Slot], Tris.E1Y[Slot], Tris.E1Z[Slot] };
+			float3 Edge2 = { Tris.E2X[Slot], Tris.E2Y[Slot], Tris.E2Z[Slot] };
+
+			float3 P = cross(Ray.Direction, Edge2);
+			float Determinant = dot(Edge1, P);
+			if (Determinant == 0.0f)
+			{
+				continue;
+			}
+
+			float InvDeterminant = (1.0f / Determinant);
+			float3 T = (Ray.Origin - float3{ Tris.V0X[Slot], Tris.V0Y[Slot], Tris.V0Z[Slot] });
+			float U = (dot(T, P) * InvDeterminant);
+			float3 Q = cross(T, Edge1);
+			float V = (dot(Ray.Direction, Q) * InvDeterminant);
+			float Distance = (dot(Edge2, Q) * InvDeterminant);
+
+			if ((U >= 0.0f) && (V >= 0.0f) && ((U + V) <= 1.0f) && (Distance >= 0.0f) && (Distance < Best))
+			{
+				Best = Distance;
+				BestSlot = Slot;
+				BestU = U;
+				BestV = V;
+				bHit = true;
+			}
+		}
+
+		return bHit;
+	}
+
+	// Pick the nearest lane of Mask out of Distances.
+	bool ResolveLanes(uint32_t Mask, uint32_t Base, const float* Distances, const float* Us, const float* Vs, float& Best, uint32_t& BestSlot, float& BestU, float& BestV)
+	{
+		bool bHit = false;
+
+		for (uint32_t Lane = 0; Mask != 0; ++Lane, Mask >>= 1)
+		{
+			if ((Mask & 1u) && (Distances[Lane] < Best))
+			{
+				Best = Distances[Lane];
+				BestSlot = (Base + Lane);
+				BestU = Us[Lane];
+				BestV = Vs[Lane];
+				bHit = true;
+			}
+		}
+
+		return bHit;
+	}
+
+#if defined(PMATH_SSE)
+	bool IntersectLeafSSE(const PreparedRay& Ray, const LeafArrays& Tris, uint32_t First, uint32_t Count, float& Best, uint32_t& BestSlot, float& BestU, float& BestV)
+	{
+		const __m128 OriginX = _mm_set1_ps(Ray.Origin.x), OriginY = _mm_set1_ps(Ray.Origin.y), OriginZ = _mm_set1_ps(Ray.Origin.z);
+		const __m128 DirX = _mm_set1_ps(Ray.Direction.x), DirY = _mm_set1_ps(Ray.Direction.y), DirZ = _mm_set1_ps(Ray.Direction.z);
+		const __m128 Zero = _mm_setzero_ps();
+		const __m128 One = _mm_set1_ps(1.0f);
+
+		bool bHit = false;
+
+		for (uint32_t Base = First; Base < (First + Count); Base += 4)
+		{
+			__m128 E1X = _mm_loadu_ps(Tris.E1X + Base), E1Y = _mm_loadu_ps(Tris.E1Y + Base), E1Z = _mm_loadu_ps(Tris.E1Z + Base);
+			__m128 E2X = _mm_loadu_ps(Tris.E2X + Base), E2Y = _mm_loadu_ps(Tris.E2Y + Base), E2Z = _mm_loadu_ps(Tris.E2Z + Base);
+
+			// P = Direction x Edge2.
+			__m128 PX = _mm_sub_ps(_mm_mul_ps(DirY, E2Z), _mm_mul_ps(DirZ, E2Y));
+			__m128 PY = _mm_sub_ps(_mm_mul_ps(DirZ, E2X), _mm_mul_ps(DirX, E2Z));
+			__m128 PZ = _mm_sub_ps(_mm_mul_ps(DirX, E2Y), _mm_mul_ps(DirY, E2X));
+
+			__m128 Determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(E1X, PX), _mm_mul_ps(E1Y, PY)), _mm_mul_ps(E1Z, PZ));
+			__m128 InvDeterminant = _mm_div_ps(One, Determinant);
+
+			// T = Origin - V0.
+			__m128 TX = _mm_sub_ps(OriginX, _mm_loadu_ps(Tris.V0X + Base));
+			__m128 TY = _mm_sub_ps(OriginY, _mm_loadu_ps(Tris.V0Y + Base));
+			__m128 TZ = _mm_sub_ps(OriginZ, _mm_loadu_ps(Tris.V0Z + Base));
+
+			__m128 U = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(TX, PX), _mm_mul_ps(TY, PY)), _mm_mul_ps(TZ, PZ)), InvDeterminant);
+
+			// Q = T x Edge1.
+			__m128 QX = _mm_sub_ps(_mm_mul_ps(TY, E1Z), _mm_mul_ps(TZ, E1Y));
+			__m128 QY = _mm_sub_ps(_mm_mul_ps(TZ, E1X), _mm_mul_ps(TX, E1Z));
+			__m128 QZ = _mm_sub_ps(_mm_mul_ps(TX, E1Y), _mm_mul_ps(TY, E1X));
+
+			__m128 V = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(DirX, QX), _mm_mul_ps(DirY, QY)), _mm_mul_ps(DirZ, QZ)), InvDeterminant);
+			__m128 Distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(E2X, QX), _mm_mul_ps(E2Y, QY)), _mm_mul_ps(E2Z, QZ)), InvDeterminant);
+
+			// Ordered compares are false for the NaNs a zero determinant produces, so degenerate triangles drop out here.
+			__m128 Valid = _mm_cmpneq_ps(Determinant, Zero);
+			Valid = _mm_and_ps(Valid, _mm_cmpge_ps(U, Zero));
+			Valid = _mm_and_ps(Valid, _mm_cmpge_ps(V, Zero));
+			Valid = _mm_and_ps(Valid, _mm_cmple_ps(_mm_add_ps(U, V), One));
+			Valid = _mm_and_ps(Valid, _mm_cmpge_ps(Distance, Zero));
+			Valid = _mm_and_ps(Valid, _mm_cmplt_ps(Distance, _mm_set1_ps(Best)));
+
+			uint32_t Remaining = ((First + Count) - Base);
+			uint32_t Mask = (uint32_t)_mm_movemask_ps(Valid) & ((Remaining >= 4) ? 0xFu : ((1u << Remaining) - 1u));
+
+			if (Mask != 0)
+			{
+				alignas(16) float Distances[4], Us[4], Vs[4];
+				_mm_store_ps(Distances, Distance);
+				_mm_store_ps(Us, U);
+				_mm_store_ps(Vs, V);
+
+				bHit |= ResolveLanes(Mask, Base, Distances, Us, Vs, Best, BestSlot, BestU, BestV);
+			}
+		}
+
+		return bHit;
+	}
+#endif
+
+#if defined(PMATH_AVX2_KERNELS)
+	PMATH_AVX2_TARGET bool IntersectLeafAVX2(const PreparedRay& Ray, const LeafArrays& Tris, uint32_t First, uint32_t Count, float& Best, uint32_t& BestSlot, float& BestU, float& BestV)
+	{
+		const __m256 OriginX = _mm256_set1_ps(Ray.Origin.x), OriginY = _mm256_set1_ps(Ray.Origin.y), OriginZ = _mm256_set1_ps(Ray.Origin.z);
+		const __m256 DirX = _mm256_set1_ps(Ray.Direction.x), DirY = _mm256_set1_ps(Ray.Direction.y), DirZ = _mm256_set1_ps(Ray.Direction.z);
+		const __m256 Zero = _mm256_setzero_ps();
+		const __m256 One = _mm256_set1_ps(1.0f);
+
+		bool bHit = false;
+
+		for (uint32_t Base = First; Base < (First + Count); Base += 8)
+		{
+			__m256 E1X = _mm256_loadu_ps(Tris.E1X + Base), E1Y = _mm256_loadu_ps(Tris.E1Y + Base), E1Z = _mm256_loadu_ps(Tris.E1Z + Base);
+			__m256 E2X = _mm256_loadu_ps(Tris.E2X + Base), E2Y = _mm256_loadu_ps(Tris.E2Y + Base), E2Z = _mm256_loadu_ps(Tris.E2Z + Base);
+
+			__m256 PX = _mm256_fmsub_ps(DirY, E2Z, _mm256_mul_ps(DirZ, E2Y));
+			__m256 PY = _mm256_fmsub_ps(DirZ, E2X, _mm256_mul_ps(DirX, E2Z));
+			__m256 PZ = _mm256_fmsub_ps(DirX, E2Y, _mm256_mul_ps(DirY, E2X));
+
+			__m256 Determinant = _mm256_fmadd_ps(E1X, PX, _mm256_fmadd_ps(E1Y, PY, _mm256_mul_ps(E1Z, PZ)));
+			__m256 InvDeterminant = _mm256_div_ps(One, Determinant);
+
+			__m256 TX = _mm256_sub_ps(OriginX, _mm256_loadu_ps(Tris.V0X + Base));
+			__m256 TY = _mm256_sub_ps(OriginY, _mm256_loadu_ps(Tris.V0Y + Base));
+			__m256 TZ = _mm256_sub_ps(OriginZ, _mm256_loadu_ps(Tris.V0Z + Base));
+
+			__m256 U = _mm256_mul_ps(_mm256_fmadd_ps(TX, PX, _mm256_fmadd_ps(TY, PY, _mm256_mul_ps(TZ, PZ))), InvDeterminant);
+
+			__m256 QX = _mm256_fmsub_ps(TY, E1Z, _mm256_mul_ps(TZ, E1Y));
+			__m256 QY = _mm256_fmsub_ps(TZ, E1X, _mm256_mul_ps(TX, E1Z));
+			__m256 QZ = _mm256_fmsub_ps(TX, E1Y, _mm256_mul_ps(TY, E1X));
+
+			__m256 V = _mm256_mul_ps(_mm256_fmadd_ps(DirX, QX, _mm256_fmadd_ps(DirY, QY, _mm256_mul_ps(DirZ, QZ))), InvDeterminant);
+			__m256 Distance = _mm256_mul_ps(_mm256_fmadd_ps(E2X, QX, _mm256_fmadd_ps(E2Y, QY, _mm256_mul_ps(E2Z, QZ))), InvDeterminant);
+
+			__m256 Valid = _mm256_cmp_ps(Determinant, Zero, _CMP_NEQ_OQ);
+			Valid = _mm256_and_ps(Valid, _mm256_cmp_ps(U, Zero, _CMP_GE_OQ));
+			Valid = _mm256_and_ps(Valid, _mm256_cmp_ps(V, Zero, _CMP_GE_OQ));
+			Valid = _mm256_and_ps(Valid, _mm256_cmp_ps(_mm256_add_ps(U, V), One, _CMP_LE_OQ));
+			Valid = _mm256_and_ps(Valid, _mm256_cmp_ps(Distance, Zero, _CMP_GE_OQ));
+			Valid = _mm256_and_ps(Valid, _mm256_cmp_ps(Distance, _mm256_set1_ps(Best), _CMP_LT_OQ));
+
+			uint32_t Remaining = ((First + Count) - Base);
+			uint32_t Mask = (uint32_t)_mm256_movemask_ps(Valid) & ((Remaining >= 8) ? 0xFFu : ((1u << Remaining) - 1u));
+
+			if (Mask != 0)
+			{
+				alignas(32) float Distances[8], Us[8], Vs[8];
+				_mm256_store_ps(Distances, Distance);
+				_mm256_store_ps(Us, U);
+				_mm256_store_ps(Vs, V);
+
+				bHit |= ResolveLanes(Mask, Base, Distances, Us, Vs, Best, BestSlot, BestU, BestV);
+			}
+		}
+
+		return bHit;
+	}
+#endif
+}
+
+// Find the nearest triangle hit by a model space ray.
+bool PMeshBVH::Raycast(const float3& Origin, const float3& Direction, float MaxDistance, Hit& OutHit, bool bAnyHit, PSimdLevel Level) const
+{
+	if (Nodes.empty() || (MaxDistance < 0.0f))
+	{
+		return false;
+	}
+
+	static const PSimdLevel Supported = PGetRaycastSimdLevel();
+	Level = std::min(Level, Supported);
+
+	auto IntersectLeaf = &IntersectLeafScalar;
+#if defined(PMATH_AVX2_KERNELS)
+	if (Level == PSimdLevel::AVX2)
+	{
+		IntersectLeaf = &IntersectLeafAVX2;
+	}
+	else
+#endif
+#if defined(PMATH_SSE)
+	if (Level >= PSimdLevel::SSE2)
+	{
+		IntersectLeaf = &IntersectLeafSSE;
+	}
+#endif
+
+	PreparedRay Ray = { Origin, Direction, { (1.0f / Direction.x), (1.0f / Direction.y), (1.0f / Direction.z) } };
+	LeafArrays Tris = { V0X.data(), V0Y.data(), V0Z.data(), E1X.data(), E1Y.data(), E1Z.data(), E2X.data(), E2Y.data(), E2Z.data() };
+
+	float Best = MaxDistance;
+	uint32_t BestSlot = 0;
+	float BestU = 0.0f;
+	float BestV = 0.0f;
+	bool bHit = false;
+
+	// Nodes waiting to be visited, with the distance the ray enters them. The build caps the depth, and each level leaves at
+	// most one node behind, so this can't overflow.
+	struct StackEntry
+	{
+		uint32_t NodeIndex;
+		float Near;
+	};
+
+	StackEntry Stack[MaxBuildDepth + 2];
+	int StackSize = 0;
+
+	float RootNear = IntersectBox(Ray, Nodes[0].Min, Nodes[0].Max, Best);
+	if (RootNear == FLT_MAX)
+	{
+		return false;
+	}
+
+	Stack[StackSize++] = { 0, RootNear };
+
+	while (StackSize > 0)
+	{
+		StackEntry Entry = Stack[--StackSize];
+
+		// A nearer hit may have been found since this node was pushed.
+		if (Entry.Near > Best)
+		{
+			continue;
+		}
+
+		const Node& Current = Nodes[Entry.NodeIndex];
+
+		if (Current.IsLeaf())
+		{
+			if (IntersectLeaf(Ray, Tris, Current.LeftOrFirst, Current.Count, Best, BestSlot, BestU, BestV))
+			{
+				bHit = true;
+
+				if (bAnyHit)
+				{
+					break;
+				}
+			}
+
+			continue;
+		}
+
+		// Visit the nearer child first so its hits clip the ray before the farther child is tested.
+		uint32_t Left = Current.LeftOrFirst;
+		float NearLeft = IntersectBox(Ray, Nodes[Left].Min, Nodes[Left].Max, Best);
+		float NearRight = IntersectBox(Ray, Nodes[Left + 1].Min, Nodes[Left + 1].Max, Best);
+
+		StackEntry First = { Left, NearLeft };
+		StackEntry Second = { (Left + 1), NearRight };
+		if (NearRight < NearLeft)
+		{
+			std::swap(First, Second);
+		}
+
+		if (Second.Near != FLT_MAX)
+		{
+			Stack[StackSize++] = Second;
+		}
+		if (First.Near != FLT_MAX)
+		{
+			Stack[StackSize++] = First;
+		}
+	}
+
+	if (bHit)
+	{
+		OutHit.Distance = Best;
+		OutHit.Triangle = TriangleIds[BestSlot];
+		OutHit.U = BestU;
+		OutHit.V = BestV;
+	}
+
+	return bHit;
+}
+
+// Return the model space box around every triangle.
+PAABB PMeshBVH::GetBounds() const
+{
+	if (Nodes.empty())
+	{
+		return { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+	}
+
+	return { (Nodes[0].Min + Nodes[0].Max) * 0.5f, (Nodes[0].Max - Nodes[0].Min) * 0.5f };
+}
+
+// Return the memory used by the nodes and triangles, in bytes.
+size_t PMeshBVH::GetMemoryBytes() const
+{
+	return (Nodes.capacity() * sizeof(Node)) + (V0X.capacity() * sizeof(float) * 9) + (TriangleIds.capacity() * sizeof(uint32_t));
+}
+
+// Check that the hierarchy was built over this geometry.
+bool PMeshBVH::Matches(const Vertex* Vertices, size_t VertexCount, const int* Indices, size_t IndexCount) const
+{
+	if ((VertexCount != SourceVertexCount) || (IndexCount != SourceIndexCount))
+	{
+		return false;
+	}
+
+	// Every slot's first corner and edges are rebuilt the way the constructor stored them, so equal geometry compares
+	// exactly equal.
+	for (size_t Slot = 0; Slot < TriangleIds.size(); ++Slot)
+	{
+		float3 Corner[3];
+		GatherCorners(Vertices, VertexCount, Indices, TriangleIds[Slot], Corner);
+
+		float3 Edge1 = (Corner[1] - Corner[0]);
+		float3 Edge2 = (Corner[2] - Corner[0]);
+
+		if ((V0X[Slot] != Corner[0].x) || (V0Y[Slot] != Corner[0].y) || (V0Z[Slot] != Corner[0].z) ||
+			(E1X[Slot] != Edge1.x) || (E1Y[Slot] != Edge1.y) || (E1Z[Slot] != Edge1.z) ||
+			(E2X[Slot] != Edge2.x) || (E2Y[Slot] != Edge2.y) || (E2Z[Slot] != Edge2.z))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../../PMath/PMath.h"
+#include "../../PMath/PSimd.h"
+#include "../../PMath/PRaycast.h"
+#include <memory>
+#include <vector>
+
+// A bounding volume hierarchy over the triangles of one mesh, in model space, for exact ray queries (picking, line of
+// sight against detailed meshes).
+//
+// The hierarchy is built top-down with the surface area heuristic over binned triangle centroids. Nodes are 32 bytes, so
+// two fit in a cache line. Leaf triangles are stored as a structure of arrays (first vertex and two edges) in leaf order,
+// so a ray is tested against up to 8 triangles of a leaf at once.
+//
+// Meshes with the same positions and indices share one hierarchy. Get it with Acquire() rather than constructing one.
+class PMeshBVH
+{
+public:
+	// Leaves are split until they hold this many triangles or fewer, unless the heuristic says a bigger leaf is cheaper.
+	static constexpr uint32_t MaxLeafTriangles = 8;
+
+	// Where a ray hit a triangle.
+	struct Hit
+	{
+		float Distance = 0.0f;		// In multiples of the ray's Direction.
+		uint32_t Triangle = 0;		// The triangle's position in the mesh's index list (its first index is Triangle * 3).
+		float U = 0.0f;				// Barycentric weight of the triangle's second vertex.
+		float V = 0.0f;				// Barycentric weight of the triangle's third vertex.
+	};
+
+	// Build a hierarchy over IndexCount / 3 triangles. Indices that are out of range make a triangle degenerate.
+	PMeshBVH(const PMath::Vertex* Vertices, size_t VertexCount, const int* Indices, size_t IndexCount);
+
+	// Return the shared hierarchy for this geometry, building it if no other mesh with the same positions and indices
+	// still holds one. Hierarchies are found by a hash of the geometry and then checked against it, so a hash collision
+	// builds a new one rather than sharing the wrong one. Safe to call from any thread.
+	static std::shared_ptr<const PMeshBVH> Acquire(const std::vector<PMath::Vertex>& Vertices, const std::vector<int>& Indices);
+
+	// Find the nearest triangle hit by the ray Origin + (Direction * t) for 0 <= t <= MaxDistance, in model space. Both
+	// faces of a triangle are hit. With bAnyHit the search stops at the first hit found, which is not always the nearest.
+	//
+	// RETURN: True if a triangle was hit, with the hit stored in OutHit.
+	bool Raycast(const PMath::float3& Origin, const PMath::float3& Direction, float MaxDistance, Hit& OutHit, bool bAnyHit = false, PMath::PSimdLevel Level = PMath::PSimdLevel::AVX2) const;
+
+	// Return the model space box around every triangle.
+	PMath::PAABB GetBounds() const;
+
+	// Return the number of triangles in the hierarchy.
+	size_t GetTriangleCount() const { return TriangleIds.size(); }
+
+	// Return the number of nodes in the hierarchy.
+	size_t GetNodeCount() const { return Nodes.size(); }
+
+	// Return the depth of the deepest leaf. A single leaf has a depth of 0.
+	int GetDepth() const { return Depth; }
+
+	// Return the memory used by the nodes and triangles, in bytes.
+	size_t GetMemoryBytes() const;
+
+private:
+	struct alignas(32) Node
+	{
+		PMath::float3 Min;
+		uint32_t LeftOrFirst;		// Interior nodes: the left child, the right child follows it. Leaves: the first triangle.
+		PMath::float3 Max;
+		uint32_t Count;				// The number of triangles in a leaf, 0 for interior nodes.
+
+		bool IsLeaf() const { return (Count != 0); }
+	};
+
+	static_assert(sizeof(Node) == 32, "PMeshBVH nodes should stay 32 bytes.");
+
+	using float_array_t = std::vector<float, PMath::PAlignedAllocator<float, 32>>;
+
+	std::vector<Node, PMath::PAlignedAllocator<Node, 32>> Nodes;
+
+	// Triangles in leaf order: the first vertex and the edges to the other two. Padded with MaxLeafTriangles degenerate
+	// triangles so the SIMD kernels can always load a full 8 from a leaf's first triangle.
+	float_array_t V0X, V0Y, V0Z;
+	float_array_t E1X, E1Y, E1Z;
+	float_array_t E2X, E2Y, E2Z;
+
+	std::vector<uint32_t> TriangleIds;		// The mesh triangle stored in each leaf-order slot.
+	int Depth = 0;
+
+	size_t SourceVertexCount = 0;			// The vertex count of the mesh the hierarchy was built over.
+	size_t SourceIndexCount = 0;			// The index count of the mesh the hierarchy was built over.
+
+	// Check that the hierarchy was built over these vertices and indices, by rebuilding every stored triangle from them.
+	//
+	// RETURN: True if every triangle matches.
+	bool Matches(const PMath::Vertex* Vertices, size_t VertexCount, const int* Indices, size_t IndexCount) const;
+};
@@ -0,0 +1,306 @@
+#include "PMeshCache.h"
+#include "../PFileMap/PFileMap.h"
+#include "../../PStatics/PGameplayStatics/PGameplayStatics.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <thread>
+
+namespace PMeshCache
+{
+	namespace
+	{
+		std::atomic<uint64_t> HitCount{ 0 };
+		std::atomic<uint64_t> RehashCount{ 0 };
+		std::atomic<uint64_t> CookCount{ 0 };
+		std::atomic<uint64_t> WriteFailureCount{ 0 };
+
+		// The size and last write time of a source file.
+		struct SourceInfo
+		{
+			uint64_t Size = 0;
+			int64_t Time = 0;
+		};
+
+		// Read the size and last write time of FilePath.
+		//
+		// Returns false if the file can't be found.
+		bool ReadSourceInfo(const std::string& FilePath, SourceInfo& OutInfo)
+		{
+			std::error_code Error;
+
+			OutInfo.Size = (uint64_t)std::filesystem::file_size(FilePath, Error);
+			if (Error)
+			{
+				return false;
+			}
+
+			OutInfo.Time = (int64_t)std::filesystem::last_write_time(FilePath, Error).time_since_epoch().count();
+			return !Error;
+		}
+
+		// Hash the contents of FilePath into OutHash.
+		//
+		// Returns false if the file can't be read.
+		bool HashFile(const std::string& FilePath, uint64_t& OutHash)
+		{
+			PFileMap File;
+
+			if (!File.Open(FilePath))
+			{
+				return false;
+			}
+
+			OutHash = HashBytes(File.GetData(), File.GetSize());
+			return true;
+		}
+
+		// Check that the mapped entry File is a whole, current entry for SourcePath, and read its header into OutHead.
+		//
+		// Returns true if it is.
+		bool ReadEntry(const PFileMap& File, const std::string& SourcePath, Header& OutHead)
+		{
+			if (File.GetSize() < sizeof(Header))
+			{
+				return false;
+			}
+
+			memcpy(&OutHead, File.GetData(), sizeof(Header));
+
+			if ((OutHead.Magic != Magic) || (OutHead.Version != Version) || (OutHead.HeaderSize != sizeof(Header)) || (OutHead.VertexSize != sizeof(Vertex)))
+			{
+				return false;
+			}
+
+			// Counts too large to be real would overflow the size check below.
+			if ((OutHead.VertexCount > (File.GetSize() / sizeof(Vertex))) || (OutHead.IndexCount > (File.GetSize() / sizeof(int))))
+			{
+				return false;
+			}
+
+			uint64_t Expected = (sizeof(Header) + OutHead.PathLength + (OutHead.VertexCount * sizeof(Vertex)) + (OutHead.IndexCount * sizeof(int)));
+			if (Expected != File.GetSize())
+			{
+				return false;
+			}
+
+			// Two paths whose hashes collide share an entry name, so the entry says which one it holds.
+			return (OutHead.PathLength == SourcePath.size()) && (memcmp((File.GetData() + sizeof(Header)), SourcePath.data(), SourcePath.size()) == 0);
+		}
+
+		// Write Head, SourcePath, and Mesh to a temporary file and rename it over EntryPath.
+		//
+		// Returns true if the entry was written.
+		bool WriteEntry(const std::string& EntryPath, Header Head, const std::string& SourcePath, const CookedMesh& Mesh)
+		{
+			std::error_code Error;
+			std::filesystem::create_directories(GetCacheDirectory(), Error);
+
+			Head.PathLength = (uint32_t)SourcePath.size();
+			Head.VertexCount = Mesh.Vertices.size();
+			Head.IndexCount = Mesh.Indices.size();
+			Head.Bounds = Mesh.Bounds;
+			Head.Sphere = Mesh.Sphere;
+
+			// Threads cooking the same mesh at once each write their own temporary file. The last rename wins.
+			std::string TempPath = (EntryPath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp");
+
+			{
+				std::ofstream File(TempPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+
+				File.write((const char*)&Head, sizeof(Header));
+				File.write(SourcePath.data(), SourcePath.size());
+				File.write((const char*)Mesh.Vertices.data(), (sizeof(Vertex) * Mesh.Vertices.size()));
+				File.write((const char*)Mesh.Indices.data(), (sizeof(int) * Mesh.Indices.size()));
+
+				if (!File)
+				{
+					File.close();
+					std::filesystem::remove(TempPath, Error);
+					return false;
+				}
+			}
+
+			std::filesystem::rename(TempPath, EntryPath, Error);
+
+			if (Error)
+			{
+				std::filesystem::remove(TempPath, Error);
+				return false;
+			}
+
+			return true;
+		}
+	}
+
+	// Return the folder entries are kept in.
+	std::string GetCacheDirectory()
+	{
+		return (PGameplayStatics::GetGameDirectory() + "Cache/Meshes/");
+	}
+
+	// Return the path of the entry for SourcePath, named for a hash of the path.
+	std::string GetEntryPath(const std::string& SourcePath)
+	{
+		std::string Key = std::filesystem::path(SourcePath).lexically_normal().generic_string();
+
+		char Name[32];
+		snprintf(Name, sizeof(Name), "%016llx.pmesh", (unsigned long long)HashBytes(Key.data(), Key.size()));
+
+		return (GetCacheDirectory() + Name);
+	}
+
+	// Fill OutMesh from the entry for SourcePath, cooking the source if there's no valid entry.
+	//
+	// Returns false if there was no valid entry and Cook failed.
+	bool Load(const std::string& SourcePath, CookedMesh& OutMesh, const CookFunction& Cook)
+	{
+		SourceInfo Info;
+
+		// Without a source there's nothing to check an entry against. Let the cook report it.
+		if (!ReadSourceInfo(SourcePath, Info))
+		{
+			return Cook(SourcePath, OutMesh);
+		}
+
+		std::string EntryPath = GetEntryPath(SourcePath);
+		Header Head;
+		uint64_t Hash = 0;
+		bool bHashed = false;
+
+		{
+			PFileMap Entry;
+
+			if (Entry.Open(EntryPath) && ReadEntry(Entry, SourcePath, Head) && (Head.SourceSize == Info.Size))
+			{
+				bool bFresh = (Head.SourceTime == Info.Time);
+
+				if (!bFresh)
+				{
+					bHashed = HashFile(SourcePath, Hash);
+				}
+
+				if (bFresh || (bHashed && (Hash == Head.SourceHash)))
+				{
+					const uint8_t* Data = (Entry.GetData() + sizeof(Header) + Head.PathLength);
+
+					OutMesh.Vertices.resize(Head.VertexCount);
+					OutMesh.Indices.resize(Head.IndexCount);
+					memcpy(OutMesh.Vertices.data(), Data, (sizeof(Vertex) * Head.VertexCount));
+					memcpy(OutMesh.Indices.data(), (Data + (sizeof(Vertex) * Head.VertexCount)), (sizeof(int) * Head.IndexCount));
+					OutMesh.Bounds = Head.Bounds;
+					OutMesh.Sphere = Head.Sphere;
+
+					HitCount.fetch_add(1, std::memory_order_relaxed);
+
+					if (bFresh)
+					{
+						return true;
+					}
+
+					// Same contents with a new time. Restamp the entry so the next load can skip the hash.
+					RehashCount.fetch_add(1, std::memory_order_relaxed);
+					Entry.Close();
+
+					Head.SourceTime = Info.Time;
+					if (!WriteEntry(EntryPath, Head, SourcePath, OutMesh))
+					{
+						WriteFailureCount.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					return true;
+				}
+			}
+		}
+
+		// Hash the source before cooking it. If it's saved while the cook reads it, the entry holds the older hash, so the
+		// next load finds the new contents don't match and cooks again rather than serving a mesh from a different save.
+		if (!bHashed)
+		{
+			bHashed = HashFile(SourcePath, Hash);
+		}
+
+		if (!Cook(SourcePath, OutMesh))
+		{
+			return false;
+		}
+
+		CookCount.fetch_add(1, std::memory_order_relaxed);
+
+		Head = Header();
+		Head.SourceSize = Info.Size;
+		Head.SourceTime = Info.Time;
+		Head.SourceHash = Hash;
+
+		if (!bHashed || !WriteEntry(EntryPath, Head, SourcePath, OutMesh))
+		{
+			WriteFailureCount.fetch_add(1, std::memory_order_relaxed);
+			PGameplayStatics::PrintToConsole(("Mesh cache could not write an entry for " + SourcePath + " to " + GetCacheDirectory() + ". It will be cooked again next load."), 3, "Mesh");
+		}
+
+		return true;
+	}
+
+	// Return a 64 bit hash of Count bytes at Data.
+	uint64_t HashBytes(const void* Data, size_t Count)
+	{
+		const uint8_t* Bytes = (const uint8_t*)Data;
+		uint64_t Hash = (0x9E3779B97F4A7C15ull ^ (Count * 0xC2B2AE3D27D4EB4Full));
+
+		// A word at a time, each mixed before it's folded in so neighbouring bits don't cancel.
+		auto Fold = [&](uint64_t Word)
+		{
+			Word *= 0xFF51AFD7ED558CCDull;
+			Word ^= (Word >> 32);
+			Hash = ((Hash ^ Word) * 0x100000001B3ull);
+			Hash ^= (Hash >> 29);
+		};
+
+		size_t i = 0;
+		for (; (i + 8) <= Count; i += 8)
+		{
+			uint64_t Word;
+			memcpy(&Word, (Bytes + i), sizeof(Word));
+			Fold(Word);
+		}
+
+		if (i < Count)
+		{
+			uint64_t Word = 0;
+			memcpy(&Word, (Bytes + i), (Count - i));
+			Fold(Word);
+		}
+
+		Hash ^= (Hash >> 33);
+		Hash *= 0xC4CEB9FE1A85EC53ull;
+		Hash ^= (Hash >> 33);
+
+		return Hash;
+	}
+
+	// Returns the counts since the last reset.
+	Stats GetStats()
+	{
+		Stats Current;
+		Current.Hits = HitCount.load(std::memory_order_relaxed);
+		Current.Rehashed = RehashCount.load(std::memory_order_relaxed);
+		Current.Cooked = CookCount.load(std::memory_order_relaxed);
+		Current.WriteFailures = WriteFailureCount.load(std::memory_order_relaxed);
+
+		return Current;
+	}
+
+	// Zero the counts.
+	//
+	// No return value.
+	void ResetStats()
+	{
+		HitCount.store(0, std::memory_order_relaxed);
+		RehashCount.store(0, std::memory_order_relaxed);
+		CookCount.store(0, std::memory_order_relaxed);
+		WriteFailureCount.store(0, std::memory_order_relaxed);
+	}
+}
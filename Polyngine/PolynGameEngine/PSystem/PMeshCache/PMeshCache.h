@@ -0,0 +1,88 @@
+#pragma once
+
+#include "../../PMath/PMath.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace PMath;
+
+// An on-disk cache of cooked meshes, so sources such as .obj files are parsed once rather than on every load.
+//
+// Each source has one entry in CacheDirectory, named for a hash of its path. An entry starts with a Header giving the
+// source's path, size, modification time, and a hash of its contents, followed by the welded vertices and indices
+// exactly as they go into PStaticMesh::Vertices and Indices. An entry whose size and time match the source is used as it is. One
+// whose size matches but time doesn't (a fresh checkout, say) has the source hashed, and is used and restamped if the
+// hash matches. Anything else is cooked again. Entries are written to a temporary file and renamed over the old one, so
+// a load never sees half an entry.
+namespace PMeshCache
+{
+	constexpr uint32_t Magic = 0x48534D50;					// "PMSH" as a little endian word.
+	constexpr uint32_t Version = 2;							// Bump when the layout, or what cooking produces, changes.
+
+	// A mesh as the cache holds it.
+	struct CookedMesh
+	{
+		std::vector<Vertex> Vertices;
+		std::vector<int> Indices;
+		PAABB Bounds = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };		// Around Vertices, in model space.
+		PSphere Sphere = { { 0.0f, 0.0f, 0.0f }, 0.0f };						// Around Vertices, in model space.
+	};
+
+	// The start of an entry. The source path follows it, then the vertices and indices.
+	struct Header
+	{
+		uint32_t Magic = PMeshCache::Magic;
+		uint32_t Version = PMeshCache::Version;
+		uint32_t HeaderSize = sizeof(Header);
+		uint32_t PathLength = 0;						// Bytes of source path after the header.
+		uint64_t SourceSize = 0;
+		int64_t SourceTime = 0;							// The source's last write time, in file clock ticks.
+		uint64_t SourceHash = 0;						// HashBytes() of the source's contents.
+		uint64_t VertexCount = 0;
+		uint64_t IndexCount = 0;
+		PAABB Bounds;
+		PSphere Sphere;
+		uint32_t VertexSize = sizeof(Vertex);			// Catches entries written by a build with a different Vertex.
+		uint32_t Reserved = 0;
+	};
+
+	static_assert(sizeof(Header) == 104, "The mesh cache header layout is part of the file format.");
+
+	// Turns a source file into a mesh. Returns false if it can't.
+	using CookFunction = std::function<bool(const std::string& SourcePath, CookedMesh& OutMesh)>;
+
+	// How the cache has been used since the program started, or since ResetStats().
+	struct Stats
+	{
+		uint64_t Hits = 0;				// Loads served from an entry.
+		uint64_t Rehashed = 0;			// Hits whose source had to be hashed because its time changed.
+		uint64_t Cooked = 0;			// Loads that cooked the source.
+		uint64_t WriteFailures = 0;		// Cooked meshes that could not be written back.
+	};
+
+	// Return the folder entries are kept in: Cache/Meshes/ under the game directory.
+	std::string GetCacheDirectory();
+
+	// Return the path of the entry for SourcePath, whether or not it exists. Deleting it forces the next load to cook.
+	std::string GetEntryPath(const std::string& SourcePath);
+
+	// Fill OutMesh from the entry for SourcePath, cooking the source with Cook and writing a new entry if there's no valid
+	// one. A mesh that can't be written back is still returned. Safe to call from any thread.
+	//
+	// Returns false if there was no valid entry and Cook failed.
+	bool Load(const std::string& SourcePath, CookedMesh& OutMesh, const CookFunction& Cook);
+
+	// Return a 64 bit hash of Count bytes at Data. Not for security: only to tell one version of a file from another.
+	uint64_t HashBytes(const void* Data, size_t Count);
+
+	// Returns the counts since the last reset.
+	Stats GetStats();
+
+	// Zero the counts.
+	//
+	// No return value.
+	void ResetStats();
+}
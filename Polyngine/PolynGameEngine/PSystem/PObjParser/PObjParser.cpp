@@ -0,0 +1,634 @@
+#include "PObjParser.h"
+#include "../PFileMap/PFileMap.h"
+#include "../PJobs/PJobSystem.h"
+#include "../../PStatics/PGameplayStatics/PGameplayStatics.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace PObjParser
+{
+	namespace
+	{
+		// Chunks smaller than this aren't worth a job of their own.
+		constexpr size_t MinChunkBytes = (1 << 20);
+
+		// A face corner's position, texture coordinate, and normal, as 0 based indices. -1 where the corner has none.
+		struct Corner
+		{
+			int32_t Index[3];
+		};
+
+		// A face: how many corners it has, and the line it's on within its chunk.
+		struct Face
+		{
+			uint32_t Size;
+			uint32_t Line;
+		};
+
+		// What one chunk of the text parsed to.
+		struct Chunk
+		{
+			std::string_view Text;
+			std::vector<float3> Positions;
+			std::vector<float2> TexCoords;
+			std::vector<float3> Normals;
+			std::vector<Corner> Corners;			// Every face's corners, in order.
+			std::vector<Face> Faces;
+			std::vector<uint32_t> RelativeSlots;	// Corner indices given relative to the end of a list (negative in the file), as Corner * 3 + which index.
+			size_t TriangleCount = 0;
+			size_t LineCount = 0;
+
+			// Where the chunk's first position, texture coordinate, normal, vertex, index, and line land in the whole file.
+			size_t Base[3] = {};
+			size_t VertexBase = 0;
+			size_t IndexBase = 0;
+			size_t LineBase = 0;
+
+			const char* Error = nullptr;			// Why the chunk failed, if it did.
+			size_t ErrorLine = 0;					// The line it failed on, within the chunk.
+		};
+
+		// Skip spaces, tabs, and the carriage return of a CRLF line ending.
+		inline const char* SkipSpaces(const char* Cursor, const char* End)
+		{
+			while ((Cursor < End) && ((*Cursor == ' ') || (*Cursor == '\t') || (*Cursor == '\r')))
+			{
+				++Cursor;
+			}
+
+			return Cursor;
+		}
+
+		// Read a float at Cursor, after any spaces, and move Cursor past it.
+		//
+		// Returns false if there is no number there.
+		inline bool ReadFloat(const char*& Cursor, const char* End, float& OutValue)
+		{
+			Cursor = SkipSpaces(Cursor, End);
+
+			// from_chars doesn't take a leading plus.
+			if ((Cursor < End) && (*Cursor == '+'))
+			{
+				++Cursor;
+			}
+
+			std::from_chars_result Read = std::from_chars(Cursor, End, OutValue);
+
+			if (Read.ec == std::errc::invalid_argument)
+			{
+				return false;
+			}
+
+			// Values too small or large for a float still end where they should. Flush them to 0.
+			if (Read.ec == std::errc::result_out_of_range)
+			{
+				OutValue = 0.0f;
+			}
+
+			Cursor = Read.ptr;
+			return true;
+		}
+
+		// Read an index at Cursor and move Cursor past it.
+		//
+		// Returns false if there is no number there.
+		inline bool ReadIndex(const char*& Cursor, const char* End, int64_t& OutValue)
+		{
+			if ((Cursor < End) && (*Cursor == '+'))
+			{
+				++Cursor;
+			}
+
+			std::from_chars_result Read = std::from_chars(Cursor, End, OutValue);
+
+			if (Read.ec != std::errc())
+			{
+				return false;
+			}
+
+			Cursor = Read.ptr;
+			return true;
+		}
+
+		// Read the corners of the face between Cursor and End into Target.
+		//
+		// Returns the reason if the face is malformed, otherwise nullptr.
+		const char* ReadFace(const char* Cursor, const char* End, Chunk& Target)
+		{
+			const size_t Counts[3] = { Target.Positions.size(), Target.TexCoords.size(), Target.Normals.size() };
+			uint32_t Size = 0;
+
+			for (Cursor = SkipSpaces(Cursor, End); Cursor < End; Cursor = SkipSpaces(Cursor, End))
+			{
+				Corner New = { { -1, -1, -1 } };
+				size_t Slot = (Target.Corners.size() * 3);
+
+				for (int Which = 0; Which < 3; ++Which)
+				{
+					// v, v/vt, v//vn, and v/vt/vn. Only the position is required.
+					if (Which > 0)
+					{
+						if ((Cursor >= End) || (*Cursor != '/'))
+						{
+							break;
+						}
+
+						++Cursor;
+
+						if ((Which == 1) && (Cursor < End) && (*Cursor == '/'))
+						{
+							continue;
+						}
+					}
+
+					int64_t Index;
+					if (!ReadIndex(Cursor, End, Index) || (Index == 0) || (Index > INT32_MAX) || (Index < -INT32_MAX))
+					{
+						return "has a face corner that isn't a valid index.";
+					}
+
+					if (Index > 0)
+					{
+						New.Index[Which] = (int32_t)(Index - 1);
+					}
+					else
+					{
+						// Counted back from the end of the list as it is so far, which may reach into earlier chunks.
+						New.Index[Which] = (int32_t)((int64_t)Counts[Which] + Index);
+						Target.RelativeSlots.push_back((uint32_t)(Slot + Which));
+					}
+				}
+
+				if ((Cursor < End) && (*Cursor != ' ') && (*Cursor != '\t') && (*Cursor != '\r'))
+				{
+					return "has a face corner that isn't a valid index.";
+				}
+
+				Target.Corners.push_back(New);
+				++Size;
+			}
+
+			if (Size < 3)
+			{
+				return "has a face with fewer than 3 corners.";
+			}
+
+			Target.Faces.push_back({ Size, (uint32_t)Target.LineCount });
+			Target.TriangleCount += (Size - 2);
+
+			return nullptr;
+		}
+
+		// Tokenize every line of a chunk, keeping the attributes and face corners it holds.
+		//
+		// No return value. Errors are left in Target.Error.
+		void ReadChunk(Chunk& Target)
+		{
+			const char* Cursor = Target.Text.data();
+			const char* End = (Cursor + Target.Text.size());
+
+			while (Cursor < End)
+			{
+				const char* LineEnd = (const char*)memchr(Cursor, '\n', (size_t)(End - Cursor));
+				if (!LineEnd)
+				{
+					LineEnd = End;
+				}
+
+				++Target.LineCount;
+
+				const char* Token = SkipSpaces(Cursor, LineEnd);
+				size_t Length = (size_t)(LineEnd - Token);
+				const char* Error = nullptr;
+
+				// The keyword must be followed by a space, so "vt" isn't read as "v" and names like "fur" aren't faces.
+				auto IsKeyword = [&](const char* Keyword, size_t KeywordLength)
+				{
+					return (Length > KeywordLength) && (memcmp(Token, Keyword, KeywordLength) == 0) && ((Token[KeywordLength] == ' ') || (Token[KeywordLength] == '\t'));
+				};
+
+				if (IsKeyword("v", 1))
+				{
+					float3 Position;
+					const char* Value = (Token + 1);
+
+					if (!ReadFloat(Value, LineEnd, Position.x) || !ReadFloat(Value, LineEnd, Position.y) || !ReadFloat(Value, LineEnd, Position.z))
+					{
+						Error = "has a position without 3 numbers.";
+					}
+
+					Target.Positions.push_back(Position);
+				}
+				else if (IsKeyword("vt", 2))
+				{
+					float2 TexCoord = { 0.0f, 0.0f };
+					const char* Value = (Token + 2);
+
+					if (!ReadFloat(Value, LineEnd, TexCoord.x))
+					{
+						Error = "has a texture coordinate without a number.";
+					}
+
+					// The second coordinate is optional in the format.
+					ReadFloat(Value, LineEnd, TexCoord.y);
+
+					Target.TexCoords.push_back(TexCoord);
+				}
+				else if (IsKeyword("vn", 2))
+				{
+					float3 Normal;
+					const char* Value = (Token + 2);
+
+					if (!ReadFloat(Value, LineEnd, Normal.x) || !ReadFloat(Value, LineEnd, Normal.y) || !ReadFloat(Value, LineEnd, Normal.z))
+					{
+						Error = "has a normal without 3 numbers.";
+					}
+
+					Target.Normals.push_back(Normal);
+				}
+				else if (IsKeyword("f", 1))
+				{
+					Error = ReadFace((Token + 1), LineEnd, Target);
+				}
+
+				if (Error)
+				{
+					Target.Error = Error;
+					Target.ErrorLine = Target.LineCount;
+					return;
+				}
+
+				Cursor = (LineEnd + 1);
+			}
+		}
+
+		// Return the area weighted normal of a polygon, by Newell's method.
+		float3 NewellNormal(const Vertex* Corners, size_t Count)
+		{
+			float3 Normal = { 0.0f, 0.0f, 0.0f };
+
+			for (size_t i = 0; i < Count; ++i)
+			{
+				const float3& A = Corners[i].Position;
+				const float3& B = Corners[(i + 1) % Count].Position;
+
+				Normal.x += ((A.y - B.y) * (A.z + B.z));
+				Normal.y += ((A.z - B.z) * (A.x + B.x));
+				Normal.z += ((A.x - B.x) * (A.y + B.y));
+			}
+
+			return Normal;
+		}
+
+		// Split a polygon of Count corners into Count - 2 triangles by ear clipping, writing corner numbers to OutIndices.
+		// Polygons too degenerate to clip finish as a fan.
+		//
+		// No return value.
+		void ClipEars(const Vertex* Corners, size_t Count, std::vector<uint32_t>& Remaining, int* OutIndices)
+		{
+			// Work in the plane the polygon faces most, dropping the normal's largest axis.
+			float3 Normal = NewellNormal(Corners, Count);
+			int Drop = ((fabsf(Normal.x) > fabsf(Normal.y)) ? ((fabsf(Normal.x) > fabsf(Normal.z)) ? 0 : 2) : ((fabsf(Normal.y) > fabsf(Normal.z)) ? 1 : 2));
+			int U = ((Drop + 1) % 3);
+			int V = ((Drop + 2) % 3);
+			float Winding = ((Normal[Drop] < 0.0f) ? -1.0f : 1.0f);
+
+			auto Cross = [&](uint32_t A, uint32_t B, uint32_t C)
+			{
+				const float3& PA = Corners[A].Position;
+				const float3& PB = Corners[B].Position;
+				const float3& PC = Corners[C].Position;
+
+				return (((PB[U] - PA[U]) * (PC[V] - PA[V])) - ((PB[V] - PA[V]) * (PC[U] - PA[U]))) * Winding;
+			};
+
+			Remaining.resize(Count);
+			for (size_t i = 0; i < Count; ++i)
+			{
+				Remaining[i] = (uint32_t)i;
+			}
+
+			size_t Written = 0;
+
+			while (Remaining.size() > 3)
+			{
+				size_t Size = Remaining.size();
+				bool bClipped = false;
+
+				for (size_t i = 0; i < Size; ++i)
+				{
+					uint32_t Prev = Remaining[(i + Size - 1) % Size];
+					uint32_t Curr = Remaining[i];
+					uint32_t Next = Remaining[(i + 1) % Size];
+
+					// Reflex corners aren't ears.
+					if (Cross(Prev, Curr, Next) <= 0.0f)
+					{
+						continue;
+					}
+
+					// Nor are corners whose triangle holds another corner.
+					bool bEar = true;
+					for (uint32_t Other : Remaining)
+					{
+						if ((Other != Prev) && (Other != Curr) && (Other != Next) && (Cross(Prev, Curr, Other) >= 0.0f) && (Cross(Curr, Next, Other) >= 0.0f) && (Cross(Next, Prev, Other) >= 0.0f))
+						{
+							bEar = false;
+							break;
+						}
+					}
+
+					if (bEar)
+					{
+						OutIndices[Written++] = (int)Prev;
+						OutIndices[Written++] = (int)Curr;
+						OutIndices[Written++] = (int)Next;
+						Remaining.erase(Remaining.begin() + i);
+						bClipped = true;
+						break;
+					}
+				}
+
+				if (!bClipped)
+				{
+					break;
+				}
+			}
+
+			for (size_t i = 1; (i + 1) < Remaining.size(); ++i)
+			{
+				OutIndices[Written++] = (int)Remaining[0];
+				OutIndices[Written++] = (int)Remaining[i];
+				OutIndices[Written++] = (int)Remaining[i + 1];
+			}
+		}
+
+		// Build a chunk's vertices and indices in OutResult, at the chunk's offsets.
+		//
+		// No return value. Errors are left in Target.Error.
+		void WriteChunk(Chunk& Target, Result& OutResult, const std::vector<float3>& Positions, const std::vector<float2>& TexCoords, const std::vector<float3>& Normals)
+		{
+			const size_t Counts[3] = { Positions.size(), TexCoords.size(), Normals.size() };
+
+			// Indices counted back from the end of a list become absolute now the lists before this chunk are known.
+			for (uint32_t Slot : Target.RelativeSlots)
+			{
+				int32_t& Index = Target.Corners[Slot / 3].Index[Slot % 3];
+				Index = (int32_t)((int64_t)Index + (int64_t)Target.Base[Slot % 3]);
+
+				if (Index < 0)
+				{
+					Index = INT32_MAX;
+				}
+			}
+
+			Vertex* OutVertex = (OutResult.Vertices.data() + Target.VertexBase);
+			int* OutIndex = (OutResult.Indices.data() + Target.IndexBase);
+			const Corner* InCorner = Target.Corners.data();
+			std::vector<uint32_t> Remaining;
+
+			for (const Face& Poly : Target.Faces)
+			{
+				bool bNoNormal = false;
+
+				for (uint32_t i = 0; i < Poly.Size; ++i)
+				{
+					const Corner& In = InCorner[i];
+					Vertex& Out = OutVertex[i];
+
+					for (int Which = 0; Which < 3; ++Which)
+					{
+						if ((In.Index[Which] != -1) && ((size_t)(uint32_t)In.Index[Which] >= Counts[Which]))
+						{
+							Target.Error = "has a face that refers past the end of a list.";
+							Target.ErrorLine = Poly.Line;
+							return;
+						}
+					}
+
+					Out = Vertex();
+					Out.Position = Positions[In.Index[0]];
+					Out.Texture = ((In.Index[1] != -1) ? TexCoords[In.Index[1]] : float2{ 0.0f, 0.0f });
+
+					if (In.Index[2] != -1)
+					{
+						Out.Normal = Normals[In.Index[2]];
+					}
+					else
+					{
+						bNoNormal = true;
+					}
+				}
+
+				if (bNoNormal)
+				{
+					float3 A = (OutVertex[0].Position - OutVertex[1].Position);
+					float3 B = (OutVertex[2].Position - OutVertex[1].Position);
+					float3 Normal = { ((A.y * B.z) - (A.z * B.y)), ((A.z * B.x) - (A.x * B.z)), ((A.x * B.y) - (A.y * B.x)) };
+
+					for (uint32_t i = 0; i < Poly.Size; ++i)
+					{
+						OutVertex[i].Normal = Normal;
+					}
+				}
+
+				int First = (int)(OutVertex - OutResult.Vertices.data());
+
+				if (Poly.Size == 3)
+				{
+					OutIndex[0] = First;
+					OutIndex[1] = (First + 1);
+					OutIndex[2] = (First + 2);
+				}
+				else if (Poly.Size == 4)
+				{
+					OutIndex[0] = First;
+					OutIndex[1] = (First + 1);
+					OutIndex[2] = (First + 3);
+					OutIndex[3] = (First + 1);
+					OutIndex[4] = (First + 2);
+					OutIndex[5] = (First + 3);
+				}
+				else
+				{
+					ClipEars(OutVertex, Poly.Size, Remaining, OutIndex);
+
+					for (uint32_t i = 0; i < ((Poly.Size - 2) * 3); ++i)
+					{
+						OutIndex[i] += First;
+					}
+				}
+
+				OutVertex += Poly.Size;
+				OutIndex += ((Poly.Size - 2) * 3);
+				InCorner += Poly.Size;
+			}
+		}
+	}
+
+	// Parse the .obj file held in Text into OutResult.
+	//
+	// Returns false if the text is malformed.
+	bool Parse(std::string_view Text, Result& OutResult, size_t ChunkCount, std::string* OutError)
+	{
+		OutResult = Result();
+
+		if (ChunkCount == 0)
+		{
+			ChunkCount = std::min<size_t>((PJobs::GetWorkerCount() + 1), std::max<size_t>(1, (Text.size() / MinChunkBytes)));
+		}
+
+		ChunkCount = std::max<size_t>(1, std::min(ChunkCount, Text.size()));
+
+		// Split at the line break after each even share of the text. Chunks a long line swallows are left empty.
+		std::vector<Chunk> Chunks(ChunkCount);
+		size_t Start = 0;
+
+		for (size_t i = 0; i < ChunkCount; ++i)
+		{
+			size_t Stop = Text.size();
+
+			if ((i + 1) < ChunkCount)
+			{
+				Stop = std::max(Start, ((Text.size() * (i + 1)) / ChunkCount));
+				size_t Break = Text.find('\n', Stop);
+				Stop = ((Break == std::string_view::npos) ? Text.size() : (Break + 1));
+			}
+
+			Chunks[i].Text = Text.substr(Start, (Stop - Start));
+
+			// Most of an .obj's bytes are face lines of about 30 characters, so reserve for that much.
+			Chunks[i].Corners.reserve(Chunks[i].Text.size() / 10);
+			Start = Stop;
+		}
+
+		PJobs::ParallelFor(Chunks.size(), 1, [&](size_t Begin, size_t End)
+		{
+			for (size_t i = Begin; i < End; ++i)
+			{
+				ReadChunk(Chunks[i]);
+			}
+		});
+
+		// Find where each chunk's output goes from the totals of those before it.
+		size_t Totals[3] = {};
+		size_t VertexCount = 0;
+		size_t IndexCount = 0;
+		size_t LineCount = 0;
+
+		for (Chunk& Part : Chunks)
+		{
+			Part.Base[0] = Totals[0];
+			Part.Base[1] = Totals[1];
+			Part.Base[2] = Totals[2];
+			Part.VertexBase = VertexCount;
+			Part.IndexBase = IndexCount;
+			Part.LineBase = LineCount;
+
+			Totals[0] += Part.Positions.size();
+			Totals[1] += Part.TexCoords.size();
+			Totals[2] += Part.Normals.size();
+			VertexCount += Part.Corners.size();
+			IndexCount += (Part.TriangleCount * 3);
+			LineCount += Part.LineCount;
+			OutResult.FaceCount += Part.Faces.size();
+		}
+
+		auto FirstError = [&]()
+		{
+			for (const Chunk& Part : Chunks)
+			{
+				if (Part.Error)
+				{
+					if (OutError)
+					{
+						*OutError = ("Line " + std::to_string(Part.LineBase + Part.ErrorLine) + " " + Part.Error);
+					}
+
+					return true;
+				}
+			}
+
+			return false;
+		};
+
+		if (FirstError())
+		{
+			OutResult = Result();
+			return false;
+		}
+
+		if ((VertexCount > (size_t)INT32_MAX) || (Totals[0] > (size_t)INT32_MAX))
+		{
+			if (OutError)
+			{
+				*OutError = "It has more vertices than 32 bit indices can address.";
+			}
+
+			return false;
+		}
+
+		std::vector<float3> Positions(Totals[0]);
+		std::vector<float2> TexCoords(Totals[1]);
+		std::vector<float3> Normals(Totals[2]);
+		OutResult.Vertices.resize(VertexCount);
+		OutResult.Indices.resize(IndexCount);
+
+		PJobs::ParallelFor(Chunks.size(), 1, [&](size_t Begin, size_t End)
+		{
+			for (size_t i = Begin; i < End; ++i)
+			{
+				Chunk& Part = Chunks[i];
+				std::copy(Part.Positions.begin(), Part.Positions.end(), (Positions.begin() + Part.Base[0]));
+				std::copy(Part.TexCoords.begin(), Part.TexCoords.end(), (TexCoords.begin() + Part.Base[1]));
+				std::copy(Part.Normals.begin(), Part.Normals.end(), (Normals.begin() + Part.Base[2]));
+			}
+		});
+
+		PJobs::ParallelFor(Chunks.size(), 1, [&](size_t Begin, size_t End)
+		{
+			for (size_t i = Begin; i < End; ++i)
+			{
+				WriteChunk(Chunks[i], OutResult, Positions, TexCoords, Normals);
+			}
+		});
+
+		if (FirstError())
+		{
+			OutResult = Result();
+			return false;
+		}
+
+		OutResult.PositionCount = Totals[0];
+		OutResult.TexCoordCount = Totals[1];
+		OutResult.NormalCount = Totals[2];
+
+		return true;
+	}
+
+	// Map and parse the .obj file at FilePath.
+	//
+	// Returns false if the file could not be loaded.
+	bool Load(const std::string& FilePath, Result& OutResult, size_t ChunkCount)
+	{
+		PFileMap File;
+
+		if (!File.Open(FilePath))
+		{
+			PGameplayStatics::PrintToConsole(("Mesh file " + FilePath + " could not be opened."), 2, "Mesh");
+			return false;
+		}
+
+		std::string Error;
+		if (!Parse(std::string_view((const char*)File.GetData(), File.GetSize()), OutResult, ChunkCount, &Error))
+		{
+			PGameplayStatics::PrintToConsole(("Mesh file " + FilePath + " could not be parsed. " + Error), 2, "Mesh");
+			return false;
+		}
+
+		return true;
+	}
+}
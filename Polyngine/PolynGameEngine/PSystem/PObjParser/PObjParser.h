@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../../PMath/PMath.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace PMath;
+
+// Reading Wavefront .obj files into vertex and index arrays.
+//
+// The file is mapped (see PFileMap) and split into chunks at line boundaries, which are tokenized in parallel on the job
+// pool by scanning pointers and reading numbers with std::from_chars, so nothing is allocated per line. A second
+// parallel pass writes each chunk's vertices and indices straight into the result, at offsets found by counting what
+// the chunks before it hold. Only v, vt, vn, and f lines are read; groups, materials, and the rest are skipped.
+//
+// The output matches objl::Loader's LoadedVertices and LoadedIndices: one vertex per face corner, in file order, with
+// texture coordinates of 0 where a corner has none. A face with any corner missing its normal gets the unnormalized
+// normal (P0 - P1) x (P2 - P1) on every corner. Triangles and quads are split as objl splits them, (0, 1, 2) and
+// (0, 1, 3), (1, 2, 3); larger polygons are ear clipped in the plane of their Newell normal.
+namespace PObjParser
+{
+	// What Parse() read.
+	struct Result
+	{
+		std::vector<Vertex> Vertices;		// One per face corner.
+		std::vector<int> Indices;			// Three per triangle, into Vertices.
+		size_t PositionCount = 0;			// The v lines read.
+		size_t TexCoordCount = 0;			// The vt lines read.
+		size_t NormalCount = 0;				// The vn lines read.
+		size_t FaceCount = 0;				// The f lines read, before triangulation.
+	};
+
+	// Parse the .obj file held in Text into OutResult. ChunkCount splits it into that many chunks parsed in parallel; leave
+	// it at 0 to pick from the size of the text and the job pool.
+	//
+	// Returns false, with the reason and line in OutError if given, if the text is malformed.
+	bool Parse(std::string_view Text, Result& OutResult, size_t ChunkCount = 0, std::string* OutError = nullptr);
+
+	// Map and parse the .obj file at FilePath, as above. Why a file could not be loaded is printed to the console.
+	//
+	// Returns false if the file could not be loaded.
+	bool Load(const std::string& FilePath, Result& OutResult, size_t ChunkCount = 0);
+}
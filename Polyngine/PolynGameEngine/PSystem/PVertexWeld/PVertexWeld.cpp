@@ -0,0 +1,287 @@
+#include "PVertexWeld.h"
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace PVertexWeld
+{
+	namespace
+	{
+		constexpr int KeyCount = 8;					// Position, normal, and texture components that are quantized.
+		constexpr float PositionCellScale = 8.0f;	// Position cells are this many tolerances wide.
+		constexpr float AttributeCellScale = 32.0f;	// Normal and texture cells are wider, as their values are bounded.
+		constexpr float MinimumCell = 1.0e-4f;		// The cell width when welding only equal vertices.
+
+		// A cell of kept vertices, chained in the order they were kept.
+		struct Slot
+		{
+			uint64_t Hash = 0;						// 0 marks an empty slot.
+			int Head = -1;
+			int Tail = -1;
+		};
+
+		// Copy the quantized components of V into Out.
+		//
+		// No return value.
+		void GatherKeys(const Vertex& V, double (&Out)[KeyCount])
+		{
+			Out[0] = V.Position.x;
+			Out[1] = V.Position.y;
+			Out[2] = V.Position.z;
+			Out[3] = V.Normal.x;
+			Out[4] = V.Normal.y;
+			Out[5] = V.Normal.z;
+			Out[6] = V.Texture.x;
+			Out[7] = V.Texture.y;
+		}
+
+		// Returns true if A and B are within T of each other. False if either is NaN.
+		inline bool IsWithin(float A, float B, float T)
+		{
+			return (fabsf(A - B) <= T);
+		}
+
+		// Returns true if every component of A and B is within Tolerance (and the skin data matches, if compared).
+		bool IsMatch(const Vertex& A, const Vertex& B, const Settings& Weld)
+		{
+			const float T = (Weld.Tolerance > 0.0f) ? Weld.Tolerance : 0.0f;
+
+			if (!IsWithin(A.Position.x, B.Position.x, T) || !IsWithin(A.Position.y, B.Position.y, T) || !IsWithin(A.Position.z, B.Position.z, T) ||
+				!IsWithin(A.Normal.x, B.Normal.x, T) || !IsWithin(A.Normal.y, B.Normal.y, T) || !IsWithin(A.Normal.z, B.Normal.z, T) ||
+				!IsWithin(A.Texture.x, B.Texture.x, T) || !IsWithin(A.Texture.y, B.Texture.y, T))
+			{
+				return false;
+			}
+
+			if (!Weld.bCompareSkin)
+			{
+				return true;
+			}
+
+			return (memcmp(A.JointIndices, B.JointIndices, sizeof(A.JointIndices)) == 0) &&
+				IsWithin(A.Weights.x, B.Weights.x, T) && IsWithin(A.Weights.y, B.Weights.y, T) && IsWithin(A.Weights.z, B.Weights.z, T) && IsWithin(A.Weights.w, B.Weights.w, T);
+		}
+
+		// Returns a hash of a cell and, if compared, the joint indices. Never 0.
+		uint64_t HashCell(const int64_t (&Cell)[KeyCount], const int (&Joints)[4], bool bCompareSkin)
+		{
+			uint64_t Hash = 0x9E3779B97F4A7C15ull;
+
+			auto Fold = [&](uint64_t Word)
+			{
+				Hash ^= Word;
+				Hash *= 0xFF51AFD7ED558CCDull;
+				Hash ^= (Hash >> 32);
+			};
+
+			for (int k = 0; k < KeyCount; ++k)
+			{
+				Fold((uint64_t)Cell[k]);
+			}
+
+			if (bCompareSkin)
+			{
+				Fold(((uint64_t)(uint32_t)Joints[0] << 32) | (uint32_t)Joints[1]);
+				Fold(((uint64_t)(uint32_t)Joints[2] << 32) | (uint32_t)Joints[3]);
+			}
+
+			Hash ^= (Hash >> 29);
+			return (Hash != 0) ? Hash : 1;
+		}
+	}
+
+	// Find which vertices weld together.
+	//
+	// No return value.
+	void BuildRemap(const Vertex* Vertices, size_t Count, std::vector<int>& OutRemap, std::vector<int>& OutKept, const Settings& Weld)
+	{
+		OutRemap.resize(Count);
+		OutKept.clear();
+
+		if (Count == 0)
+		{
+			return;
+		}
+
+		const bool bExact = !(Weld.Tolerance > 0.0f);
+		const double Tolerance = (bExact ? 0.0 : Weld.Tolerance);
+		double InvCell[KeyCount];
+		double Reach[KeyCount];
+
+		for (int k = 0; k < KeyCount; ++k)
+		{
+			double Cell = (bExact ? MinimumCell : (Tolerance * ((k < 3) ? PositionCellScale : AttributeCellScale)));
+
+			InvCell[k] = (1.0 / Cell);
+
+			// A little past the tolerance, so rounding in the scaled values can't hide a neighbour.
+			Reach[k] = ((Tolerance * InvCell[k]) * 1.0001);
+		}
+
+		size_t Capacity = 16;
+		while (Capacity < (Count * 2))
+		{
+			Capacity *= 2;
+		}
+
+		std::vector<Slot> Table(Capacity);
+		std::vector<int> Next;
+		const size_t Mask = (Capacity - 1);
+
+		// Returns the slot holding Hash, or the empty slot it would go in.
+		auto FindSlot = [&](uint64_t Hash) -> Slot&
+		{
+			size_t i = (size_t)(Hash & Mask);
+
+			while ((Table[i].Hash != 0) && (Table[i].Hash != Hash))
+			{
+				i = ((i + 1) & Mask);
+			}
+
+			return Table[i];
+		};
+
+		for (size_t i = 0; i < Count; ++i)
+		{
+			const Vertex& V = Vertices[i];
+			double Values[KeyCount];
+			int64_t Cell[KeyCount];
+			int NearAxes[KeyCount];
+			int NearSide[KeyCount];
+			int NearCount = 0;
+
+			GatherKeys(V, Values);
+
+			for (int k = 0; k < KeyCount; ++k)
+			{
+				double Scaled = (Values[k] * InvCell[k]);
+
+				// Far out or NaN values all share one cell. NaNs never match, so they're each kept.
+				if (!((Scaled > -4.0e18) && (Scaled < 4.0e18)))
+				{
+					Cell[k] = INT64_MIN;
+					continue;
+				}
+
+				double Floor = floor(Scaled);
+				double Fraction = (Scaled - Floor);
+				Cell[k] = (int64_t)Floor;
+
+				if (bExact)
+				{
+					continue;
+				}
+
+				if (Fraction <= Reach[k])
+				{
+					NearAxes[NearCount] = k;
+					NearSide[NearCount++] = -1;
+				}
+				else if (Fraction >= (1.0 - Reach[k]))
+				{
+					NearAxes[NearCount] = k;
+					NearSide[NearCount++] = 1;
+				}
+			}
+
+			const uint64_t OwnHash = HashCell(Cell, V.JointIndices, Weld.bCompareSkin);
+			int Best = INT_MAX;
+
+			// Every combination of the neighbouring cells on the near axes, starting with the vertex's own cell.
+			for (uint32_t Probe = 0; Probe < (1u << NearCount); ++Probe)
+			{
+				uint64_t Hash = OwnHash;
+
+				if (Probe != 0)
+				{
+					int64_t Neighbour[KeyCount];
+					memcpy(Neighbour, Cell, sizeof(Cell));
+
+					for (int n = 0; n < NearCount; ++n)
+					{
+						if (Probe & (1u << n))
+						{
+							Neighbour[NearAxes[n]] += NearSide[n];
+						}
+					}
+
+					Hash = HashCell(Neighbour, V.JointIndices, Weld.bCompareSkin);
+				}
+
+				const Slot& Found = FindSlot(Hash);
+
+				// Chains are in kept order, so nothing past Best can be an earlier match.
+				for (int Kept = Found.Head; (Kept != -1) && (Kept < Best); Kept = Next[Kept])
+				{
+					if (IsMatch(V, Vertices[OutKept[Kept]], Weld))
+					{
+						Best = Kept;
+						break;
+					}
+				}
+			}
+
+			if (Best != INT_MAX)
+			{
+				OutRemap[i] = Best;
+				continue;
+			}
+
+			int Kept = (int)OutKept.size();
+			OutKept.push_back((int)i);
+			Next.push_back(-1);
+			OutRemap[i] = Kept;
+
+			Slot& Own = FindSlot(OwnHash);
+
+			if (Own.Hash == 0)
+			{
+				Own.Hash = OwnHash;
+				Own.Head = Kept;
+			}
+			else
+			{
+				Next[Own.Tail] = Kept;
+			}
+
+			Own.Tail = Kept;
+		}
+	}
+
+	// Weld Vertices in place and rewrite Indices to point at the welded set.
+	//
+	// Returns the number of vertices removed.
+	size_t Weld(std::vector<Vertex>& Vertices, std::vector<int>& Indices, const Settings& Weld)
+	{
+		std::vector<int> Remap;
+		std::vector<int> Kept;
+
+		BuildRemap(Vertices.data(), Vertices.size(), Remap, Kept, Weld);
+
+		size_t Removed = (Vertices.size() - Kept.size());
+
+		if (Removed == 0)
+		{
+			return 0;
+		}
+
+		std::vector<Vertex> Welded(Kept.size());
+		for (size_t i = 0; i < Kept.size(); ++i)
+		{
+			Welded[i] = Vertices[Kept[i]];
+		}
+
+		for (int& Index : Indices)
+		{
+			if ((Index >= 0) && ((size_t)Index < Remap.size()))
+			{
+				Index = Remap[Index];
+			}
+		}
+
+		Vertices = std::move(Welded);
+
+		return Removed;
+	}
+}
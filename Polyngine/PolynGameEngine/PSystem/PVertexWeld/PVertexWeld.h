@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../../PMath/PMath.h"
+#include <cstddef>
+#include <vector>
+
+using namespace PMath;
+
+// Vertex welding: merging vertices that are the same, or within a tolerance of each other, so each is stored once and
+// shared by index.
+//
+// Each vertex's position, normal, and texture coordinate are quantized into cells a few times wider than the tolerance,
+// and hashed with its joint indices into a table of the vertices kept so far. A vertex only has to be compared against
+// the kept vertices in its own cell, plus the neighbouring cell along any axis it sits within the tolerance of a cell
+// wall, so the cost is close to linear however many vertices there are. Vertices are taken in order and each welds to
+// the first kept vertex it matches, the same result as testing it against every kept vertex in turn.
+namespace PVertexWeld
+{
+	// When two vertices count as the same.
+	struct Settings
+	{
+		float Tolerance = 0.0f;			// The most each position, normal, texture, and weight component may differ by. 0 welds only equal vertices.
+		bool bCompareSkin = true;		// Whether joint indices must match and weights must be within Tolerance. When false, skin data is ignored.
+	};
+
+	// Find which vertices weld together. OutRemap gets, for each of the Count vertices, the index of the vertex it becomes
+	// in the welded set. OutKept gets, for each vertex in the welded set, the index of the vertex it was in Vertices.
+	//
+	// No return value.
+	void BuildRemap(const Vertex* Vertices, size_t Count, std::vector<int>& OutRemap, std::vector<int>& OutKept, const Settings& Weld = Settings());
+
+	// Weld Vertices in place and rewrite Indices to point at the welded set. Indices outside Vertices are left alone.
+	//
+	// Returns the number of vertices removed.
+	size_t Weld(std::vector<Vertex>& Vertices, std::vector<int>& Indices, const Settings& Weld = Settings());
+}
@@ -3,8 +3,8 @@
 // Constructor.
 Timer::Timer()
 {
-	start = std::chrono::high_resolution_clock::now();
-	stop = std::chrono::high_resolution_clock::now();
+	start = std::chrono::steady_clock::now();
+	stop = std::chrono::steady_clock::now();
 }
 
 // Get time elapsed in miliseconds since the last tick.  
@@ -13,7 +13,7 @@ double Timer::GetElapsedMiliseconds()
 	if (bActivated)
 	{
 		// Get time since last Restart.
-		auto Elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start);
+		auto Elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
 		return Elapsed.count();
 	}
 	else
@@ -29,7 +29,7 @@ void Timer::Restart()
 {
 	// Set the start time to the current time.
 	bActivated = true;
-	start = std::chrono::high_resolution_clock::now();
+	start = std::chrono::steady_clock::now();
 }
 
 // Start the Timer object's count.
@@ -43,7 +43,7 @@ bool Timer::Start()
 	else
 	{
 		// Set the start time to now, return true as true.
-		start = std::chrono::high_resolution_clock::now();
+		start = std::chrono::steady_clock::now();
 		bActivated = true;
 		return true;
 	}
@@ -60,7 +60,7 @@ bool Timer::Stop()
 	else
 	{
 		// Set the stop time to now and return true.
-		stop = std::chrono::high_resolution_clock::now();
+		stop = std::chrono::steady_clock::now();
 		bActivated = false;
 		return true;
 	}